@@ -0,0 +1,929 @@
+/************************************************************************
+* Module: Micro_Main(host micro benchmarks)
+* Function: time the portable core modules on the PC, Google Benchmark style output
+*		@ micro [--benchmark_filter=<regex>] [--benchmark_min_time=<s>] [--benchmark_list_tests]
+*		@ OS_System.c		byte/record queues, message pool
+*		@ Hal_RFD_Decode.c	canned RF sample streams(clean, jittered, noise, idle),
+*							captured pulse streams(clean, jittered)
+*		@ Device.c			matching on a full detector table(EEPROM in RAM)
+*		@ Hal_OLED_GRAM.c	strings and typical menu screens into OLED_GRAM
+* Description:
+*		@ one item: untimed Setup, then Run(n) timed as a whole, n grows until
+*		  the run lasts --benchmark_min_time(default 0.5s)
+*		@ Time: wall clock, CPU: process CPU time, both per iteration
+*		@ items_per_second: frames, screens or bytes per iteration as given by the item
+*		@ inputs are checked once before timing(codes decoded, IDs matched):
+*		  a wrong result ends the run with exit code 1
+*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <regex.h>
+#include <unistd.h>
+#include "os_system.h"
+#include "hal_rfd.h"
+#include "hal_oled.h"
+#include "hal_i2c_eeprom.h"
+#include "device.h"
+
+#define MICRO_MIN_TIME			0.5		// s
+#define MICRO_ITER_MAX			1000000000ULL
+#define MICRO_NAME_MIN			10
+
+#define MICRO_RFD_CODE			0x12AB02
+#define MICRO_RFD_FRAME_LEN		128		// sampled bytes of one ev1527 frame: 8 samples(50us) = 1 unit(400us)
+#define MICRO_RFD_FRAMES		8
+#define MICRO_RFD_STREAM_LEN	(MICRO_RFD_FRAME_LEN * MICRO_RFD_FRAMES)
+#define MICRO_RFD_CHUNK			(CFG_RFD_POLL_MS * 1000 / RFD_INT_FRQ / 8)	// sampled bytes per RFD task period(2ms)
+#define MICRO_RFD_PULSES		50		// captured pulses of one ev1527 frame: sync 2 + 24 bits of 2
+#define MICRO_RFD_PULSE_LEN		(MICRO_RFD_PULSES * MICRO_RFD_FRAMES)
+#define MICRO_RFD_PULSE_CHUNK	(CFG_RFD_POLL_MS * 1000 / RFD_CLK_SENDLEN)	// pulses per RFD task period(2ms) at most
+#define MICRO_RFD_PULSE_JITTER	50		// us, edges of BM_RFDPulse/jitter
+
+typedef struct
+{
+	const char *Name;
+	void (*Setup)(void);					// untimed, before every timed run
+	unsigned int (*Run)(unsigned long long Iterations);	// returns a value of the work, kept from the optimizer
+	unsigned int Items;						// items per iteration for items_per_second, 0: none
+}Micro_ItemTypeDef;
+
+static void Micro_QueueSetup(void);
+static unsigned int Micro_QueueIn1(unsigned long long n);
+static unsigned int Micro_QueueIn16(unsigned long long n);
+static unsigned int Micro_QueueInOut1(unsigned long long n);
+static unsigned int Micro_QueueInOut16(unsigned long long n);
+static unsigned int Micro_QueueInRead16(unsigned long long n);
+static unsigned int Micro_QueueInOutLock1(unsigned long long n);
+static unsigned int Micro_RecQueueInOut(unsigned long long n);
+static unsigned int Micro_MsgAllocFree(unsigned long long n);
+static void Micro_RFDSetupClean(void);
+static void Micro_RFDSetupJitter(void);
+static void Micro_RFDSetupNoise(void);
+static void Micro_RFDSetupIdle(void);
+static unsigned int Micro_RFDDecode(unsigned long long n);
+static void Micro_RFDSetupPulseClean(void);
+static void Micro_RFDSetupPulseJitter(void);
+static unsigned int Micro_RFDDecodePulse(unsigned long long n);
+static void Micro_DTCSetup(void);
+static unsigned int Micro_DTCMatchFirst(unsigned long long n);
+static unsigned int Micro_DTCMatchLast(unsigned long long n);
+static unsigned int Micro_DTCMatchMiss(unsigned long long n);
+static unsigned int Micro_DTCGetNum(unsigned long long n);
+static void Micro_OledSetup(void);
+static unsigned int Micro_OledString8(unsigned long long n);
+static unsigned int Micro_OledString12(unsigned long long n);
+static unsigned int Micro_OledString16(unsigned long long n);
+static unsigned int Micro_OledString24(unsigned long long n);
+static unsigned int Micro_OledDesktop(unsigned long long n);
+static unsigned int Micro_OledMainMenu(unsigned long long n);
+static unsigned int Micro_OledDtcList(unsigned long long n);
+static unsigned int Micro_OledLearning(unsigned long long n);
+
+static const Micro_ItemTypeDef Micro_Items[] =
+{
+	{"BM_QueueIn/1",			Micro_QueueSetup,		Micro_QueueIn1,			1},
+	{"BM_QueueIn/16",			Micro_QueueSetup,		Micro_QueueIn16,		16},
+	{"BM_QueueInOut/1",			Micro_QueueSetup,		Micro_QueueInOut1,		1},
+	{"BM_QueueInOut/16",		Micro_QueueSetup,		Micro_QueueInOut16,		16},
+	{"BM_QueueInRead/16",		Micro_QueueSetup,		Micro_QueueInRead16,	16},
+	{"BM_QueueInOutLock/1",		Micro_QueueSetup,		Micro_QueueInOutLock1,	1},
+	{"BM_RecQueueInOut",		Micro_QueueSetup,		Micro_RecQueueInOut,	1},
+	{"BM_MsgAllocFree",			Micro_QueueSetup,		Micro_MsgAllocFree,		1},
+	{"BM_RFDDecode/clean",		Micro_RFDSetupClean,	Micro_RFDDecode,		MICRO_RFD_FRAMES},
+	{"BM_RFDDecode/jitter",		Micro_RFDSetupJitter,	Micro_RFDDecode,		MICRO_RFD_FRAMES},
+	{"BM_RFDDecode/noise",		Micro_RFDSetupNoise,	Micro_RFDDecode,		MICRO_RFD_FRAMES},
+	{"BM_RFDDecode/idle",		Micro_RFDSetupIdle,		Micro_RFDDecode,		MICRO_RFD_FRAMES},
+	{"BM_RFDPulse/clean",		Micro_RFDSetupPulseClean,	Micro_RFDDecodePulse,	MICRO_RFD_FRAMES},
+	{"BM_RFDPulse/jitter",		Micro_RFDSetupPulseJitter,	Micro_RFDDecodePulse,	MICRO_RFD_FRAMES},
+	{"BM_DTCMatch/first",		Micro_DTCSetup,			Micro_DTCMatchFirst,	1},
+	{"BM_DTCMatch/last",		Micro_DTCSetup,			Micro_DTCMatchLast,		1},
+	{"BM_DTCMatch/miss",		Micro_DTCSetup,			Micro_DTCMatchMiss,		1},
+	{"BM_DTCGetNum",			Micro_DTCSetup,			Micro_DTCGetNum,		1},
+	{"BM_OledString/8",			Micro_OledSetup,		Micro_OledString8,		0},
+	{"BM_OledString/12",		Micro_OledSetup,		Micro_OledString12,		0},
+	{"BM_OledString/16",		Micro_OledSetup,		Micro_OledString16,		0},
+	{"BM_OledString/24",		Micro_OledSetup,		Micro_OledString24,		0},
+	{"BM_OledScreen/desktop",	Micro_OledSetup,		Micro_OledDesktop,		1},
+	{"BM_OledScreen/main_menu",	Micro_OledSetup,		Micro_OledMainMenu,		1},
+	{"BM_OledScreen/dtc_list",	Micro_OledSetup,		Micro_OledDtcList,		1},
+	{"BM_OledScreen/learning",	Micro_OledSetup,		Micro_OledLearning,		1},
+};
+
+#define MICRO_ITEM_SUM			(sizeof(Micro_Items) / sizeof(Micro_Items[0]))
+
+static double Micro_MinTime = MICRO_MIN_TIME;
+static volatile unsigned int Micro_Sink;		// results of the runs
+
+static Queue256 Micro_Queue;
+static RecQueue(OS_MsgTypeDef, 8) Micro_RecQueue;
+static unsigned char Micro_Data[16];
+
+static unsigned char Micro_RFDStream[MICRO_RFD_STREAM_LEN];
+static unsigned short Micro_RFDPulse[MICRO_RFD_PULSE_LEN];
+static unsigned int Micro_RFDCodes;				// codes out of the decoder
+
+static unsigned char Micro_EEPROM[CFG_EEPROM_SIZE];
+static unsigned char Micro_CodeFirst[3];
+static unsigned char Micro_CodeLast[3];
+static unsigned char Micro_CodeMiss[3];
+
+/*-------------------------- EEPROM in RAM -----------------------------------*/
+// Device.c reads and writes its table through the EEPROM driver
+void Hal_I2C_EEPROM_PageWrite(unsigned short address, unsigned char *pDat, unsigned short Num)
+{
+	memcpy(&Micro_EEPROM[address], pDat, Num);
+}
+
+void Hal_I2C_EEPROM_SequentialRead(unsigned short address, unsigned char *pBuffer, unsigned short Num)
+{
+	memcpy(pBuffer, &Micro_EEPROM[address], Num);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Micro_Fail(pName, pText)
+@Function	: wrong result of an input check, end the run
+------------------------------------------------------------------------------*/
+static void Micro_Fail(const char *pName, const char *pText)
+{
+	fprintf(stderr, "micro: %s: %s\n", pName, pText);
+	exit(1);
+}
+
+/*-------------------------- OS_System ---------------------------------------*/
+// OS_CPUInterruptCBSRegister call-back: the cost of the lock without a CPU to mask
+static void Micro_Critical(CPU_EA_TYPEDEF cmd, unsigned char *pSta)
+{
+	static volatile unsigned char Mask;
+
+	if(cmd == CPU_ENTER_CRITICAL)
+	{
+		*pSta = Mask;
+		Mask = 1;
+	}
+	else
+	{
+		Mask = *pSta;
+	}
+}
+
+static void Micro_QueueSetup(void)
+{
+	unsigned char i;
+
+	QueueEmpty(Micro_Queue);
+	QueueEmpty(Micro_RecQueue);
+	for(i=0; i<sizeof(Micro_Data); i++)
+	{
+		Micro_Data[i] = i;
+	}
+	OS_CPUInterruptCBSRegister(Micro_Critical);
+}
+
+// 1 byte in, the queue emptied(untimed in the firmware: the consumer) every 256 bytes
+static unsigned int Micro_QueueIn1(unsigned long long n)
+{
+	unsigned long long i;
+
+	for(i=0; i<n; i++)
+	{
+		if((i & 0xFF) == 0)
+		{
+			QueueEmpty(Micro_Queue);
+		}
+		QueueDataIn(Micro_Queue, &Micro_Data[0], 1);
+	}
+	return QueueDataLen(Micro_Queue);
+}
+
+static unsigned int Micro_QueueIn16(unsigned long long n)
+{
+	unsigned long long i;
+
+	for(i=0; i<n; i++)
+	{
+		if((i & 0x0F) == 0)
+		{
+			QueueEmpty(Micro_Queue);
+		}
+		QueueDataIn(Micro_Queue, Micro_Data, 16);
+	}
+	return QueueDataLen(Micro_Queue);
+}
+
+static unsigned int Micro_QueueInOut1(unsigned long long n)
+{
+	unsigned long long i;
+	unsigned char Temp = 0;
+	unsigned int Sum = 0;
+
+	for(i=0; i<n; i++)
+	{
+		QueueDataIn(Micro_Queue, &Micro_Data[1], 1);
+		QueueDataOut(Micro_Queue, &Temp);
+		Sum += Temp;
+	}
+	return Sum;
+}
+
+static unsigned int Micro_QueueInOut16(unsigned long long n)
+{
+	unsigned long long i;
+	unsigned char j;
+	unsigned char Temp = 0;
+	unsigned int Sum = 0;
+
+	for(i=0; i<n; i++)
+	{
+		QueueDataIn(Micro_Queue, Micro_Data, 16);
+		for(j=0; j<16; j++)
+		{
+			QueueDataOut(Micro_Queue, &Temp);
+			Sum += Temp;
+		}
+	}
+	return Sum;
+}
+
+static unsigned int Micro_QueueInRead16(unsigned long long n)
+{
+	unsigned long long i;
+	unsigned char Buff[16];
+	unsigned int Sum = 0;
+
+	for(i=0; i<n; i++)
+	{
+		QueueDataIn(Micro_Queue, Micro_Data, 16);
+		Sum += QueueDataRead(Micro_Queue, Buff, sizeof(Buff));
+	}
+	return Sum + Buff[15];
+}
+
+static unsigned int Micro_QueueInOutLock1(unsigned long long n)
+{
+	unsigned long long i;
+	unsigned char Temp = 0;
+	unsigned int Sum = 0;
+
+	for(i=0; i<n; i++)
+	{
+		QueueDataInLock(Micro_Queue, &Micro_Data[1], 1);
+		QueueDataOutLock(Micro_Queue, &Temp);
+		Sum += Temp;
+	}
+	return Sum;
+}
+
+// one message record(as a handle queue of OS messages would copy it)
+static unsigned int Micro_RecQueueInOut(unsigned long long n)
+{
+	unsigned long long i;
+	OS_MsgTypeDef Rec;
+	unsigned int Sum = 0;
+
+	memset(&Rec, 0, sizeof(Rec));
+	for(i=0; i<n; i++)
+	{
+		Rec.Len = (unsigned char)i;
+		RecQueueIn(Micro_RecQueue, &Rec);
+		RecQueueOut(Micro_RecQueue, &Rec);
+		Sum += Rec.Len;
+	}
+	return Sum;
+}
+
+static unsigned int Micro_MsgAllocFree(unsigned long long n)
+{
+	unsigned long long i;
+	unsigned char hMsg;
+	unsigned int Sum = 0;
+
+	for(i=0; i<n; i++)
+	{
+		hMsg = OS_MsgAlloc(RFD_MSG_CODE);
+		Sum += hMsg;
+		OS_MsgFree(hMsg);
+	}
+	return Sum;
+}
+
+/*-------------------------- Hal_RFD_Decode ----------------------------------*/
+/*----------------------------------------------------------------------------
+@Name		: Micro_RFDUnits(pUnit, Code)
+@Function	: ev1527 frame in 400us units: sync 1 high + 31 low, 24 bits of 4 units
+		--> Bit '1': 3 high 1 low, Bit '0': 1 high 3 low
+@Parameter	:
+		pUnit: 128 levels
+		Code: 24 bit code
+------------------------------------------------------------------------------*/
+static void Micro_RFDUnits(unsigned char *pUnit, unsigned long Code)
+{
+	unsigned char i;
+	unsigned char Len = 0;
+
+	pUnit[Len++] = 1;
+	for(i=0; i<31; i++)
+	{
+		pUnit[Len++] = 0;
+	}
+	for(i=0; i<24; i++)
+	{
+		unsigned char Bit = (Code >> (23 - i)) & 0x01;
+
+		pUnit[Len++] = 1;
+		pUnit[Len++] = Bit;
+		pUnit[Len++] = Bit;
+		pUnit[Len++] = 0;
+	}
+}
+
+// sampled stream from levels of 50us, bit[7] first as Hal_PulseACQ_Handler packs them
+static void Micro_RFDPack(const unsigned char *pLevel, unsigned int Samples)
+{
+	unsigned int i;
+
+	memset(Micro_RFDStream, 0, sizeof(Micro_RFDStream));
+	for(i=0; i<Samples; i++)
+	{
+		if(pLevel[i])
+		{
+			Micro_RFDStream[i / 8] |= 0x80 >> (i % 8);
+		}
+	}
+}
+
+static void Micro_RFDCode(unsigned char *pCode)
+{
+	if((pCode[0] == ((MICRO_RFD_CODE >> 16) & 0xFF)) && (pCode[1] == ((MICRO_RFD_CODE >> 8) & 0xFF))
+		&& (pCode[2] == (MICRO_RFD_CODE & 0xFF)))
+	{
+		Micro_RFDCodes++;
+	}
+}
+
+// stream through the decoder as Hal_RFD_Pro gets it: MICRO_RFD_CHUNK bytes every 2ms
+static void Micro_RFDFeed(void)
+{
+	unsigned int i;
+	unsigned short Len;
+
+	for(i=0; i<MICRO_RFD_STREAM_LEN; i+=Len)
+	{
+		Len = MICRO_RFD_STREAM_LEN - i;
+		if(Len > MICRO_RFD_CHUNK)
+		{
+			Len = MICRO_RFD_CHUNK;
+		}
+		Hal_RFD_Decode(&Micro_RFDStream[i], Len);
+	}
+}
+
+// pulse stream as Hal_RFD_Pro gets it from the capture: up to MICRO_RFD_PULSE_CHUNK pulses every 2ms
+static void Micro_RFDFeedPulse(void)
+{
+	unsigned int i;
+	unsigned short Len;
+
+	for(i=0; i<MICRO_RFD_PULSE_LEN; i+=Len)
+	{
+		Len = MICRO_RFD_PULSE_LEN - i;
+		if(Len > MICRO_RFD_PULSE_CHUNK)
+		{
+			Len = MICRO_RFD_PULSE_CHUNK;
+		}
+		Hal_RFD_DecodePulse(&Micro_RFDPulse[i], Len);
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Micro_RFDCheck(pName, Min, pFeed)
+@Function	: decode the stream twice(the first code only fills the repeat buffer)
+		--> at least Min codes out of the second pass
+------------------------------------------------------------------------------*/
+static void Micro_RFDCheck(const char *pName, unsigned int Min, void (*pFeed)(void))
+{
+	Hal_RFD_DecodeInit(Micro_RFDCode);
+	pFeed();
+	Micro_RFDCodes = 0;
+	pFeed();
+	if(Micro_RFDCodes < Min)
+	{
+		Micro_Fail(pName, "codes missing");
+	}
+}
+
+// MICRO_RFD_FRAMES frames of MICRO_RFD_CODE back to back, exact 400us units
+static void Micro_RFDSetupClean(void)
+{
+	static unsigned char Level[MICRO_RFD_STREAM_LEN * 8];
+	unsigned char Unit[MICRO_RFD_FRAME_LEN];
+	unsigned int i;
+
+	Micro_RFDUnits(Unit, MICRO_RFD_CODE);
+	for(i=0; i<sizeof(Level); i++)
+	{
+		Level[i] = Unit[(i / 8) % MICRO_RFD_FRAME_LEN];
+	}
+	Micro_RFDPack(Level, sizeof(Level));
+	Micro_RFDCheck("BM_RFDDecode/clean", MICRO_RFD_FRAMES, Micro_RFDFeed);
+}
+
+// the same frames, every edge moved by -1~+1 sample(50us): pulse ratios off by up to 4 samples
+static void Micro_RFDSetupJitter(void)
+{
+	static unsigned char Level[MICRO_RFD_STREAM_LEN * 8];
+	unsigned char Unit[MICRO_RFD_FRAME_LEN];
+	unsigned int i;
+	unsigned int Edge = 0;			// sample of the next edge
+	unsigned int Seed = 1;
+
+	Micro_RFDUnits(Unit, MICRO_RFD_CODE);
+	for(i=0; i<sizeof(Level); i++)
+	{
+		unsigned int u = i / 8;
+
+		// at the start of a unit with a new level: this edge from -1 to +1 sample of its place
+		if((i != 0) && ((i % 8) == 0) && (i >= Edge) && (Unit[u % MICRO_RFD_FRAME_LEN] != Unit[(u + MICRO_RFD_FRAME_LEN - 1) % MICRO_RFD_FRAME_LEN]))
+		{
+			Seed = Seed * 1103515245 + 12345;
+			Edge = i + (Seed >> 16) % 3 - 1;
+			if(Edge < i)
+			{
+				Level[Edge] = Unit[u % MICRO_RFD_FRAME_LEN];
+			}
+		}
+		Level[i] = (i < Edge) ? Level[i - 1] : Unit[u % MICRO_RFD_FRAME_LEN];
+	}
+	Micro_RFDPack(Level, sizeof(Level));
+	Micro_RFDCheck("BM_RFDDecode/jitter", MICRO_RFD_FRAMES / 2, Micro_RFDFeed);
+}
+
+// receiver noise without a transmitter: random levels
+static void Micro_RFDSetupNoise(void)
+{
+	unsigned int i;
+	unsigned int Seed = 7;
+
+	for(i=0; i<MICRO_RFD_STREAM_LEN; i++)
+	{
+		Seed = Seed * 1103515245 + 12345;
+		Micro_RFDStream[i] = (unsigned char)(Seed >> 16);
+	}
+	Hal_RFD_DecodeInit(Micro_RFDCode);
+}
+
+// quiet band: pin low all the time
+static void Micro_RFDSetupIdle(void)
+{
+	memset(Micro_RFDStream, 0, sizeof(Micro_RFDStream));
+	Hal_RFD_DecodeInit(Micro_RFDCode);
+}
+
+static unsigned int Micro_RFDDecode(unsigned long long n)
+{
+	unsigned long long i;
+
+	for(i=0; i<n; i++)
+	{
+		Micro_RFDFeed();
+	}
+	return Micro_RFDCodes;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Micro_RFDPulses(Jitter)
+@Function	: MICRO_RFD_FRAMES frames as the TIM1 capture records them(1us):
+			  RFD_PULSE_HIGH | width per pulse, the last one ended by the next sync
+@Parameter	:
+		Jitter: every edge moved by -Jitter~+Jitter us(0: exact 400us units)
+------------------------------------------------------------------------------*/
+static void Micro_RFDPulses(unsigned int Jitter)
+{
+	unsigned char Unit[MICRO_RFD_FRAME_LEN];
+	unsigned int u;
+	unsigned int n = 0;
+	unsigned int Seed = 3;
+	long Edge;
+	long Last = 0;			// time of the edge starting the current pulse
+
+	Micro_RFDUnits(Unit, MICRO_RFD_CODE);
+	for(u=1; u<=MICRO_RFD_FRAME_LEN * MICRO_RFD_FRAMES; u++)
+	{
+		if(Unit[u % MICRO_RFD_FRAME_LEN] == Unit[(u - 1) % MICRO_RFD_FRAME_LEN])
+		{
+			continue;
+		}
+		Edge = (long)u * RFD_CLK_SENDLEN;
+		if(Jitter)
+		{
+			Seed = Seed * 1103515245 + 12345;
+			Edge += (long)((Seed >> 16) % (2 * Jitter + 1)) - (long)Jitter;
+		}
+		Micro_RFDPulse[n++] = (Unit[(u - 1) % MICRO_RFD_FRAME_LEN] ? RFD_PULSE_HIGH : 0) | (unsigned short)(Edge - Last);
+		Last = Edge;
+	}
+}
+
+// MICRO_RFD_FRAMES frames of MICRO_RFD_CODE back to back, exact 400us units
+static void Micro_RFDSetupPulseClean(void)
+{
+	Micro_RFDPulses(0);
+	Micro_RFDCheck("BM_RFDPulse/clean", MICRO_RFD_FRAMES, Micro_RFDFeedPulse);
+}
+
+// the same frames, every edge moved by up to MICRO_RFD_PULSE_JITTER: no code lost at 1us resolution
+static void Micro_RFDSetupPulseJitter(void)
+{
+	Micro_RFDPulses(MICRO_RFD_PULSE_JITTER);
+	Micro_RFDCheck("BM_RFDPulse/jitter", MICRO_RFD_FRAMES, Micro_RFDFeedPulse);
+}
+
+static unsigned int Micro_RFDDecodePulse(unsigned long long n)
+{
+	unsigned long long i;
+
+	for(i=0; i<n; i++)
+	{
+		Micro_RFDFeedPulse();
+	}
+	return Micro_RFDCodes;
+}
+
+/*-------------------------- Device ------------------------------------------*/
+/*----------------------------------------------------------------------------
+@Name		: Micro_DTCSetup()
+@Function	: full detector table: DTC_SUM sensors paired through Device_AddDTC
+		--> codes: 0x5A, ID in Code[1], 0x0A + type in Code[2]
+		--> Code[1]/Code[2] of the miss code belong to no detector
+------------------------------------------------------------------------------*/
+static void Micro_DTCSetup(void)
+{
+	Stru_DTC DTC;
+	unsigned char i;
+
+	memset(Micro_EEPROM, 0xFF, sizeof(Micro_EEPROM));
+	Device_FactoryReset();
+
+	memset(&DTC, 0, sizeof(DTC));
+	for(i=0; i<DTC_SUM; i++)
+	{
+		DTC.DTCType = (DTC_TYPE_TYPEDEF)(i % DTC_TYP_SUM);
+		DTC.ZoneType = (ZONE_TYPED_TYPEDEF)(i % STG_DEV_AT_SUM);
+		DTC.Code[0] = 0x5A;
+		DTC.Code[1] = i;
+		DTC.Code[2] = 0x0A + DTC.DTCType;
+		if(Device_AddDTC(&DTC) != i)
+		{
+			Micro_Fail("BM_DTCMatch", "table not filled");
+		}
+		if(i == 0)
+		{
+			memcpy(Micro_CodeFirst, DTC.Code, 3);
+		}
+		memcpy(Micro_CodeLast, DTC.Code, 3);
+	}
+	Micro_CodeMiss[0] = 0x5A;
+	Micro_CodeMiss[1] = DTC_SUM;
+	Micro_CodeMiss[2] = 0x0A;
+
+	if((Device_DTCMatching(Micro_CodeFirst) != 1) || (Device_DTCMatching(Micro_CodeLast) != DTC_SUM)
+		|| (Device_DTCMatching(Micro_CodeMiss) != 0xFF) || (Device_GetDTCNum() != DTC_SUM))
+	{
+		Micro_Fail("BM_DTCMatch", "wrong ID");
+	}
+}
+
+static unsigned int Micro_DTCMatch(unsigned char *pCode, unsigned long long n)
+{
+	unsigned long long i;
+	unsigned int Sum = 0;
+
+	for(i=0; i<n; i++)
+	{
+		Sum += Device_DTCMatching(pCode);
+	}
+	return Sum;
+}
+
+static unsigned int Micro_DTCMatchFirst(unsigned long long n)
+{
+	return Micro_DTCMatch(Micro_CodeFirst, n);
+}
+
+static unsigned int Micro_DTCMatchLast(unsigned long long n)
+{
+	return Micro_DTCMatch(Micro_CodeLast, n);
+}
+
+static unsigned int Micro_DTCMatchMiss(unsigned long long n)
+{
+	return Micro_DTCMatch(Micro_CodeMiss, n);
+}
+
+static unsigned int Micro_DTCGetNum(unsigned long long n)
+{
+	unsigned long long i;
+	unsigned int Sum = 0;
+
+	for(i=0; i<n; i++)
+	{
+		Sum += Device_GetDTCNum();
+	}
+	return Sum;
+}
+
+/*-------------------------- Hal_OLED_GRAM -----------------------------------*/
+// screens use the detector names of a full table(Zone-001...)
+static void Micro_OledSetup(void)
+{
+	Micro_DTCSetup();
+	hal_Oled_ClearGRAM();
+}
+
+static unsigned int Micro_OledGRAMSum(void)
+{
+	return OLED_GRAM[0][0] + OLED_GRAM[64][4] + OLED_GRAM[127][7];
+}
+
+static unsigned int Micro_OledString(unsigned char Size, unsigned long long n)
+{
+	unsigned long long i;
+
+	for(i=0; i<n; i++)
+	{
+		hal_Oled_ShowString(0, 20, "Zone-012 ", Size, i & 0x01);
+	}
+	return Micro_OledGRAMSum();
+}
+
+static unsigned int Micro_OledString8(unsigned long long n)
+{
+	return Micro_OledString(8, n);
+}
+
+static unsigned int Micro_OledString12(unsigned long long n)
+{
+	return Micro_OledString(12, n);
+}
+
+static unsigned int Micro_OledString16(unsigned long long n)
+{
+	return Micro_OledString(16, n);
+}
+
+static unsigned int Micro_OledString24(unsigned long long n)
+{
+	return Micro_OledString(24, n);
+}
+
+// Disarm desktop: status icons, mode in 24, date and time line
+static unsigned int Micro_OledDesktop(unsigned long long n)
+{
+	unsigned long long i;
+
+	for(i=0; i<n; i++)
+	{
+		hal_Oled_ClearGRAM();
+		hal_Oled_ShowPicture(110, 0, 16, 16, gImage_BMP[ICON_SIGNAL_L04], 1);
+		hal_Oled_ShowPicture(92, 0, 16, 16, gImage_BMP[ICON_ONENET_STA_LINK], 1);
+		hal_Oled_ShowString(28, 20, "Disarm", 24, 1);
+		hal_Oled_ShowString(14, 55, "2024-04-12 19:00", 8, 1);
+	}
+	return Micro_OledGRAMSum();
+}
+
+// setting main menu, second line selected(reverse)
+static unsigned int Micro_OledMainMenu(unsigned long long n)
+{
+	static const char *Menu[] = {"Main Menu", "1. Learning Dtc", "2. Dtc List", "3. Mac Info", "4. Default Setting"};
+	unsigned long long i;
+	unsigned char j;
+
+	for(i=0; i<n; i++)
+	{
+		hal_Oled_ClearGRAM();
+		hal_Oled_ShowString(37, 0, Menu[0], 12, 1);
+		for(j=1; j<5; j++)
+		{
+			hal_Oled_ShowString(0, 14 * j, Menu[j], 8, (j == 2) ? 0 : 1);
+		}
+	}
+	return Micro_OledGRAMSum();
+}
+
+// detector list: title and the first four names of the table
+static unsigned int Micro_OledDtcList(unsigned long long n)
+{
+	Stru_DTC DTC[4];
+	unsigned long long i;
+	unsigned char j;
+
+	for(j=0; j<4; j++)
+	{
+		Device_GetDTCStructure(&DTC[j], j);
+		DTC[j].DeviceName[15] = 0;
+	}
+	for(i=0; i<n; i++)
+	{
+		hal_Oled_ClearGRAM();
+		hal_Oled_ShowString(40, 0, "Dtc List", 12, 1);
+		for(j=0; j<4; j++)
+		{
+			hal_Oled_ShowString(0, 14 * (j + 1), DTC[j].DeviceName, 8, (j == 0) ? 0 : 1);
+		}
+	}
+	return Micro_OledGRAMSum();
+}
+
+// learning screen after a pairing: result area cleared and redrawn
+static unsigned int Micro_OledLearning(unsigned long long n)
+{
+	unsigned long long i;
+
+	for(i=0; i<n; i++)
+	{
+		hal_Oled_ClearGRAM();
+		hal_Oled_ShowString(28, 0, "Learning DTC", 12, 1);
+		hal_Oled_ShowString(43, 28, "Pairing...", 8, 1);
+		hal_Oled_ClearArea(0, 28, 128, 36);
+		hal_Oled_ShowString(34, 28, "Success!", 8, 1);
+		hal_Oled_ShowString(16, 36, "Added door dtc..", 8, 1);
+	}
+	return Micro_OledGRAMSum();
+}
+
+/*-------------------------- runner ------------------------------------------*/
+static double Micro_Seconds(clockid_t Clock)
+{
+	struct timespec Now;
+
+	clock_gettime(Clock, &Now);
+	return Now.tv_sec + Now.tv_nsec * 1e-9;
+}
+
+// 3 significant digits as Google Benchmark prints its times
+static void Micro_PrintTime(double ns)
+{
+	if(ns < 10.0)
+	{
+		printf(" %10.2f ns", ns);
+	}
+	else if(ns < 100.0)
+	{
+		printf(" %10.1f ns", ns);
+	}
+	else
+	{
+		printf(" %10.0f ns", ns);
+	}
+}
+
+static void Micro_PrintRate(double Rate)
+{
+	static const char Unit[] = {' ', 'k', 'M', 'G', 'T'};
+	unsigned char i = 0;
+
+	while((Rate >= 1000.0) && (i < sizeof(Unit) - 1))
+	{
+		Rate /= 1000.0;
+		i++;
+	}
+	printf(" items_per_second=%.5g%c/s", Rate, Unit[i]);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Micro_Measure(pItem, NameWidth)
+@Function	: run an item until it lasts Micro_MinTime, print its line
+		--> next iteration count from the last run(x1.4 of the time left), at most x10
+------------------------------------------------------------------------------*/
+static void Micro_Measure(const Micro_ItemTypeDef *pItem, int NameWidth)
+{
+	unsigned long long n = 1;
+	double Wall, Cpu;
+
+	for(;;)
+	{
+		double Wall0, Cpu0;
+		double Multiplier;
+
+		pItem->Setup();
+		Wall0 = Micro_Seconds(CLOCK_MONOTONIC);
+		Cpu0 = Micro_Seconds(CLOCK_PROCESS_CPUTIME_ID);
+		Micro_Sink += pItem->Run(n);
+		Cpu = Micro_Seconds(CLOCK_PROCESS_CPUTIME_ID) - Cpu0;
+		Wall = Micro_Seconds(CLOCK_MONOTONIC) - Wall0;
+
+		if((Wall >= Micro_MinTime) || (n >= MICRO_ITER_MAX))
+		{
+			break;
+		}
+		Multiplier = (Wall > 1e-9) ? (Micro_MinTime * 1.4 / Wall) : 10.0;
+		if(Multiplier > 10.0)
+		{
+			Multiplier = 10.0;
+		}
+		n = (unsigned long long)(n * Multiplier) + 1;
+		if(n > MICRO_ITER_MAX)
+		{
+			n = MICRO_ITER_MAX;
+		}
+	}
+
+	printf("%-*s", NameWidth, pItem->Name);
+	Micro_PrintTime(Wall * 1e9 / n);
+	Micro_PrintTime(Cpu * 1e9 / n);
+	printf(" %12llu", n);
+	if(pItem->Items && (Cpu > 0.0))
+	{
+		Micro_PrintRate((double)pItem->Items * n / Cpu);
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+static void Micro_Line(int Width)
+{
+	while(Width--)
+	{
+		putchar('-');
+	}
+	putchar('\n');
+}
+
+int main(int argc, char *argv[])
+{
+	regex_t Filter;
+	unsigned char Filtered = 0;
+	unsigned char List = 0;
+	int NameWidth = MICRO_NAME_MIN;
+	char Date[32];
+	time_t Now;
+	unsigned int i;
+
+	for(i=1; i<(unsigned int)argc; i++)
+	{
+		if(strncmp(argv[i], "--benchmark_filter=", 19) == 0)
+		{
+			if(regcomp(&Filter, argv[i] + 19, REG_EXTENDED | REG_NOSUB) != 0)
+			{
+				fprintf(stderr, "micro: bad filter '%s'\n", argv[i] + 19);
+				return 2;
+			}
+			Filtered = 1;
+		}
+		else if(strncmp(argv[i], "--benchmark_min_time=", 21) == 0)
+		{
+			Micro_MinTime = atof(argv[i] + 21);
+		}
+		else if(strcmp(argv[i], "--benchmark_list_tests") == 0)
+		{
+			List = 1;
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [--benchmark_filter=<regex>] [--benchmark_min_time=<s>] [--benchmark_list_tests]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	for(i=0; i<MICRO_ITEM_SUM; i++)
+	{
+		if(Filtered && (regexec(&Filter, Micro_Items[i].Name, 0, 0, 0) != 0))
+		{
+			continue;
+		}
+		if(List)
+		{
+			printf("%s\n", Micro_Items[i].Name);
+		}
+		else if((int)strlen(Micro_Items[i].Name) > NameWidth)
+		{
+			NameWidth = strlen(Micro_Items[i].Name);
+		}
+	}
+	if(List)
+	{
+		return 0;
+	}
+
+	Now = time(0);
+	strftime(Date, sizeof(Date), "%Y-%m-%dT%H:%M:%S%z", localtime(&Now));
+	printf("%s\n", Date);
+	printf("Running %s\n", argv[0]);
+	printf("Run on (%ld X CPU s)\n", sysconf(_SC_NPROCESSORS_ONLN));
+	Micro_Line(NameWidth + 44);
+	printf("%-*s %13s %13s %12s\n", NameWidth, "Benchmark", "Time", "CPU", "Iterations");
+	Micro_Line(NameWidth + 44);
+
+	for(i=0; i<MICRO_ITEM_SUM; i++)
+	{
+		if(Filtered && (regexec(&Filter, Micro_Items[i].Name, 0, 0, 0) != 0))
+		{
+			continue;
+		}
+		Micro_Measure(&Micro_Items[i], NameWidth);
+	}
+	return 0;
+}
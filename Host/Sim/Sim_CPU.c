@@ -0,0 +1,188 @@
+/************************************************************************
+* Module: Sim_CPU(host simulation)
+* Function: Hal_CPU of the simulation build(replaces Src/Hal/Hal_CPU.c)
+*		@ SysTick on the virtual clock, OS idle advances the virtual clock
+*		  (fixed period: no reload to retime on a clock change)
+*		@ STOP(CFG_POWER_STOP): Hal_Power decides as on the target, SysTick
+*		  resumes with the time Hal_Power_Stop returns
+*		@ critical section: interrupts are only taken in the idle call-back,
+*		  the mask state is kept for the OS save/restore
+*		@ cycle counter: virtual time(ns) by default, tasks take none: a run is
+*		  repeated exactly; host monotonic clock(ns) with sim -c(bench timing)
+*		@ stack check: the host stack is not measured, only the interrupt
+*		  nesting peak is reported
+*************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+#include "stm32f10x.h"
+#include "os_system.h"
+#include "hal_cpu.h"
+#include "hal_power.h"
+#include "sim_periph.h"
+
+#if !CFG_OS_TICKLESS_IDLE
+#error "simulation build: virtual time passes in the OS idle call-back, define CFG_OS_TICKLESS_IDLE"
+#endif
+
+#if CFG_OS_PREEMPTIVE
+#error "simulation build: CFG_OS_PREEMPTIVE needs the Cortex-M3 context switch"
+#endif
+
+static void Sim_CPU_Critical_Control(CPU_EA_TYPEDEF cmd, unsigned char *pSta);
+static unsigned short Sim_CPU_Idle(unsigned short Ticks);
+
+static unsigned char Sim_CPU_IntEnable = 1;
+
+unsigned char Sim_CPU_HostCycle = 0;
+
+#if CFG_CPU_STACK_CHECK
+volatile unsigned char Hal_CPU_IsrNest = 0;
+volatile unsigned char Hal_CPU_IsrNestPeak = 0;
+#endif
+
+void SysTick_Handler(void);
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_CPU_Init()
+@Function	: system tick on the virtual clock, OS call-backs
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+void Hal_CPU_Init(void)
+{
+	Sim_Clock_SetTick(SIM_NS_PER_S / OS_TICK_HZ, SysTick_Handler);
+
+	OS_CPUInterruptCBSRegister(Sim_CPU_Critical_Control);
+	OS_CPUIdleCBSRegister(Sim_CPU_Idle);
+#if CFG_OS_PROFILE
+	OS_CPUCycleCBSRegister(Hal_CPU_GetCycle);
+#endif
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_CPU_GetCycle()
+@Function	: free running cycle counter
+		--> virtual time: the host never feeds back into the firmware(CFG_OS_PROFILE
+			report lengths, USART1 busy time, clock changes and STOP follow)
+		--> Sim_CPU_HostCycle: host clock, code run times in ns(bench)
+@Return		: virtual or host monotonic time(ns), wraps every 4.29s
+------------------------------------------------------------------------------*/
+unsigned int Hal_CPU_GetCycle(void)
+{
+	struct timespec Now;
+
+	if(!Sim_CPU_HostCycle)
+	{
+		return (unsigned int)Sim_Time;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &Now);
+	return (unsigned int)((unsigned long long)Now.tv_sec * SIM_NS_PER_S + Now.tv_nsec);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_CPU_GetIdleRate()
+@Function	: tasks take no virtual time, the CPU is always idle
+@Return		: idle rate in per-mille
+------------------------------------------------------------------------------*/
+unsigned short Hal_CPU_GetIdleRate(void)
+{
+	return 1000;
+}
+
+#if CFG_CPU_STACK_CHECK
+/*----------------------------------------------------------------------------
+@Name		: Hal_CPU_GetStackSize()
+@Function	: the host stack is not measured
+@Return		: 0
+------------------------------------------------------------------------------*/
+unsigned int Hal_CPU_GetStackSize(void)
+{
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_CPU_GetStackPeak()
+@Function	: the host stack is not measured
+@Return		: 0
+------------------------------------------------------------------------------*/
+unsigned int Hal_CPU_GetStackPeak(void)
+{
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_CPU_StackReport(Index, Output)
+@Function	: "STK,MSP,0,0,IsrNestPeak\r\n" for Index 0, same format as the target
+@Return		: 1: line output, 0: Index past the last line
+------------------------------------------------------------------------------*/
+unsigned char Hal_CPU_StackReport(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len))
+{
+	char Buff[32];
+	int Len;
+
+	if(Index != 0)
+	{
+		return 0;
+	}
+	Len = snprintf(Buff, sizeof(Buff), "STK,MSP,%u,%u,%u\r\n",
+		Hal_CPU_GetStackSize(), Hal_CPU_GetStackPeak(), (unsigned int)Hal_CPU_IsrNestPeak);
+	Output((unsigned char *)Buff, (unsigned int)Len);
+	return 1;
+}
+#endif
+
+static void Sim_CPU_Critical_Control(CPU_EA_TYPEDEF cmd, unsigned char *pSta)
+{
+	if(cmd == CPU_ENTER_CRITICAL)
+	{
+		*pSta = Sim_CPU_IntEnable;
+		Sim_CPU_IntEnable = 0;
+	}
+	else if(cmd == CPU_EXIT_CRITICAL)
+	{
+		Sim_CPU_IntEnable = *pSta;
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_CPU_Idle(Ticks)
+@Function	: OS idle call-back: run the virtual clock to the next peripheral
+			  event and take its interrupts, SysTick counts every tick itself
+		--> STOP allowed by Hal_Power: till the next task release(Hal_CPU_Stop)
+@Return		: complete ticks slept in STOP, 0 otherwise
+------------------------------------------------------------------------------*/
+static unsigned short Sim_CPU_Idle(unsigned short Ticks)
+{
+#if CFG_POWER_STOP
+	unsigned long long Left;
+	unsigned long Us;
+
+	Left = Sim_Clock_TickLeft();
+	if(Ticks)
+	{
+		Us = (unsigned long)(Left / SIM_NS_PER_US) + ((Ticks - 1UL) * (1000000UL / OS_TICK_HZ));
+		if(Hal_Power_StopAllowed(Us))
+		{
+			Us = Hal_Power_Stop(Us);
+			Hal_Power_Sync();
+			return Sim_Clock_TickResume(Left, Us);
+		}
+	}
+#else
+	(void)Ticks;
+#endif
+
+	Sim_Clock_Step();
+	return 0;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: SysTick_Handler()
+@Function	:
+------------------------------------------------------------------------------*/
+void SysTick_Handler(void)
+{
+	HAL_CPU_ISR_ENTER();
+	OS_ClockInterruptHandle();
+	HAL_CPU_ISR_EXIT();
+}
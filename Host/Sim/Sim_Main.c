@@ -0,0 +1,793 @@
+/************************************************************************
+* Module: Sim_Main(host simulation)
+* Function: run the firmware against the peripheral models from a script
+*		@ sim [-e eeprom.bin] [-u uart1.txt | -q] [-c] [script]	(script: stdin if omitted)
+*			-c: cycle counter on the host clock(bench), virtual time otherwise
+*		@ script commands(one per line, '#' comment), times in virtual ms:
+*			wait <ms>							let the firmware run
+*			rf <code> [repeat] [unit_us]		ev1527 transmission, code: 24 bit hex
+*			key <1~6> [hold_ms]					press a key
+*			dtc <code>							pair a sensor(as the learning menu does)
+*			uart1 <text> / uart2 <text>			bytes on the RX line, CR LF appended
+*			srv mode <away|home|disarm>			server operation(NBIOT_HOST_STATE)
+*			srv state <0~2> / srv csq <0~99>	module state, signal quality
+*			screen								print the OLED panel
+*			mark <text>							print a marker line with the time
+*			repeat <n> ... end					loop(nestable)
+*		@ the run ends with the script, results: "SIM,..." lines on stdout
+*		@ deterministic: every event is driven by the virtual clock, no host time
+*		  or randomness reaches the firmware(without -c): two runs of a script
+*		  print the same lines but SIM,WALL
+* Description:
+*		@ RF: transmissions are queued back to back on PA11, each decoded code is
+*		  matched to the oldest sent code: latency is from the transmission start
+*		@ Hal_RFD_RxCBF_Register/Hal_Key_KeyScanCBF_Register are wrapped(ld --wrap)
+*		  to count decodes and key events before the App call-backs
+*************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stm32f10x.h"
+#include "os_system.h"
+#include "hal_cpu.h"
+#include "hal_rfd.h"
+#include "hal_timer.h"
+#include "hal_time.h"
+#include "hal_clock.h"
+#include "hal_power.h"
+#include "hal_key.h"
+#include "hal_nbiot.h"
+#include "device.h"
+#include "app.h"
+#include "sim_periph.h"
+
+#define SIM_SCRIPT_MAX			4096	// script lines
+#define SIM_SCRIPT_TEXT			64
+#define SIM_LOOP_DEPTH			8
+#define SIM_RF_MAX				1024	// transmissions queued or waiting for their decode
+#define SIM_RF_UNITS			128		// ev1527 frame: sync 1+31, 24 bits of 4 units
+#define SIM_RF_GAP				(10 * SIM_NS_PER_MS)
+
+typedef enum
+{
+	SIM_CMD_WAIT,
+	SIM_CMD_RF,
+	SIM_CMD_KEY,
+	SIM_CMD_DTC,
+	SIM_CMD_UART1,
+	SIM_CMD_UART2,
+	SIM_CMD_SRV,
+	SIM_CMD_SCREEN,
+	SIM_CMD_MARK,
+	SIM_CMD_REPEAT,
+	SIM_CMD_END,
+}SIM_CMD_TYPEDEF;
+
+typedef struct
+{
+	SIM_CMD_TYPEDEF Cmd;
+	unsigned long Arg[3];
+	char Text[SIM_SCRIPT_TEXT];
+	unsigned short Line;
+}Sim_CmdTypeDef;
+
+typedef struct
+{
+	unsigned long Code;
+	unsigned char Repeat;
+	unsigned long long Unit;		// ns
+	unsigned long long Start;
+	unsigned long long End;
+	unsigned char Decoded;
+}Sim_RfTypeDef;
+
+extern int Sim_FirmwareMain(void);
+extern void __real_Hal_RFD_RxCBF_Register(RFD_RxCallBack_t pCBF);
+extern void __real_Hal_Key_KeyScanCBF_Register(KeyEvent_CallBack_t pCBF);
+
+static void Sim_Stimulus(unsigned long long Now);
+static void Sim_Finish(void);
+
+static Sim_CmdTypeDef Sim_Script[SIM_SCRIPT_MAX];
+static unsigned short Sim_ScriptLen;
+static unsigned short Sim_Pc;
+static unsigned long long Sim_WaitUntil;
+static unsigned short Sim_LoopPc[SIM_LOOP_DEPTH];
+static unsigned long Sim_LoopCnt[SIM_LOOP_DEPTH];
+static unsigned char Sim_LoopDepth;
+
+static Sim_RfTypeDef Sim_Rf[SIM_RF_MAX];
+static unsigned short Sim_RfWait;		// oldest transmission not decoded or still on air
+static unsigned short Sim_RfTx;			// transmission on air or next
+static unsigned short Sim_RfTail;
+static unsigned long long Sim_RfFree;	// air free from this time
+
+static unsigned long long Sim_KeyRelease[KEY_NUM];
+
+static RFD_RxCallBack_t Sim_AppRfdCBF;
+static KeyEvent_CallBack_t Sim_AppKeyCBF;
+
+static struct
+{
+	unsigned long RfSent;
+	unsigned long RfDecoded;
+	unsigned long RfLost;
+	unsigned long RfError;
+	unsigned long long RfLatencySum;
+	unsigned long long RfLatencyMax;
+	unsigned long KeyPressed;
+	unsigned long KeyEvents;
+	unsigned long KeyClicks;
+}Sim_Result;
+
+static struct timespec Sim_WallStart;
+
+static GPIO_TypeDef * const Sim_KeyPort[KEY_NUM] = {K1_PORT, K2_PORT, K3_PORT, K4_PORT, K5_PORT, K6_PORT};
+static const uint16_t Sim_KeyPin[KEY_NUM] = {K1_PIN, K2_PIN, K3_PIN, K4_PIN, K5_PIN, K6_PIN};
+
+
+/*-------------------------- script ------------------------------------------*/
+static void Sim_ScriptError(unsigned short Line, const char *pMsg)
+{
+	fprintf(stderr, "sim: script line %u: %s\n", Line, pMsg);
+	exit(2);
+}
+
+static void Sim_ScriptLoad(FILE *fp)
+{
+	char Buff[256];
+	char Word[16];
+	char *p;
+	unsigned short Line = 0;
+	unsigned char Depth = 0;
+	int n;
+	Sim_CmdTypeDef *pCmd;
+
+	while(fgets(Buff, sizeof(Buff), fp))
+	{
+		Line++;
+
+		p = strchr(Buff, '\n');
+		if(p)
+		{
+			*p = 0;
+		}
+		p = strchr(Buff, '\r');
+		if(p)
+		{
+			*p = 0;
+		}
+
+		p = Buff;
+		while((*p == ' ') || (*p == '\t'))
+		{
+			p++;
+		}
+		if((*p == 0) || (*p == '#'))
+		{
+			continue;
+		}
+
+		if(Sim_ScriptLen >= SIM_SCRIPT_MAX)
+		{
+			Sim_ScriptError(Line, "script too long");
+		}
+		pCmd = &Sim_Script[Sim_ScriptLen];
+		memset(pCmd, 0, sizeof(Sim_CmdTypeDef));
+		pCmd->Line = Line;
+
+		if(sscanf(p, "%15s%n", Word, &n) != 1)
+		{
+			continue;
+		}
+		p += n;
+		while((*p == ' ') || (*p == '\t'))
+		{
+			p++;
+		}
+
+		if(!strcmp(Word, "wait"))
+		{
+			pCmd->Cmd = SIM_CMD_WAIT;
+			if(sscanf(p, "%lu", &pCmd->Arg[0]) != 1)
+			{
+				Sim_ScriptError(Line, "wait <ms>");
+			}
+		}
+		else if(!strcmp(Word, "rf"))
+		{
+			pCmd->Cmd = SIM_CMD_RF;
+			pCmd->Arg[1] = 4;
+			pCmd->Arg[2] = RFD_CLK_SENDLEN;
+			if((sscanf(p, "%lx %lu %lu", &pCmd->Arg[0], &pCmd->Arg[1], &pCmd->Arg[2]) < 1)
+			|| (pCmd->Arg[0] > 0xFFFFFF) || !pCmd->Arg[1] || (pCmd->Arg[1] > 255) || !pCmd->Arg[2])
+			{
+				Sim_ScriptError(Line, "rf <code24hex> [repeat 1~255] [unit_us]");
+			}
+		}
+		else if(!strcmp(Word, "key"))
+		{
+			pCmd->Cmd = SIM_CMD_KEY;
+			pCmd->Arg[1] = 100;
+			if((sscanf(p, "%lu %lu", &pCmd->Arg[0], &pCmd->Arg[1]) < 1) || !pCmd->Arg[0] || (pCmd->Arg[0] > KEY_NUM))
+			{
+				Sim_ScriptError(Line, "key <1~6> [hold_ms]");
+			}
+		}
+		else if(!strcmp(Word, "dtc"))
+		{
+			pCmd->Cmd = SIM_CMD_DTC;
+			if((sscanf(p, "%lx", &pCmd->Arg[0]) != 1) || (pCmd->Arg[0] > 0xFFFFFF))
+			{
+				Sim_ScriptError(Line, "dtc <code24hex>");
+			}
+		}
+		else if(!strcmp(Word, "uart1") || !strcmp(Word, "uart2"))
+		{
+			pCmd->Cmd = (Word[4] == '1') ? SIM_CMD_UART1 : SIM_CMD_UART2;
+			snprintf(pCmd->Text, SIM_SCRIPT_TEXT, "%s\r\n", p);
+		}
+		else if(!strcmp(Word, "srv"))
+		{
+			pCmd->Cmd = SIM_CMD_SRV;
+			if(sscanf(p, "mode %15s", Word) == 1)
+			{
+				pCmd->Arg[0] = NBIOT_HOST_STATE;
+				if(!strcmp(Word, "away"))
+				{
+					pCmd->Arg[1] = ONENET_DOWNDATA_OPER_AWAYARM;
+				}
+				else if(!strcmp(Word, "home"))
+				{
+					pCmd->Arg[1] = ONENET_DOWNDATA_OPER_HOMEARM;
+				}
+				else if(!strcmp(Word, "disarm"))
+				{
+					pCmd->Arg[1] = ONENET_DOWNDATA_OPER_DISARM;
+				}
+				else
+				{
+					Sim_ScriptError(Line, "srv mode <away|home|disarm>");
+				}
+			}
+			else if(sscanf(p, "state %lu", &pCmd->Arg[1]) == 1)
+			{
+				pCmd->Arg[0] = NBIOT_CONNECT_STATE;
+			}
+			else if(sscanf(p, "csq %lu", &pCmd->Arg[1]) == 1)
+			{
+				pCmd->Arg[0] = NBIOT_CSQ;
+			}
+			else
+			{
+				Sim_ScriptError(Line, "srv mode|state|csq <value>");
+			}
+		}
+		else if(!strcmp(Word, "screen"))
+		{
+			pCmd->Cmd = SIM_CMD_SCREEN;
+		}
+		else if(!strcmp(Word, "mark"))
+		{
+			pCmd->Cmd = SIM_CMD_MARK;
+			snprintf(pCmd->Text, SIM_SCRIPT_TEXT, "%s", p);
+		}
+		else if(!strcmp(Word, "repeat"))
+		{
+			pCmd->Cmd = SIM_CMD_REPEAT;
+			if((sscanf(p, "%lu", &pCmd->Arg[0]) != 1) || (++Depth > SIM_LOOP_DEPTH))
+			{
+				Sim_ScriptError(Line, "repeat <n>, nested too deep?");
+			}
+		}
+		else if(!strcmp(Word, "end"))
+		{
+			pCmd->Cmd = SIM_CMD_END;
+			if(!Depth--)
+			{
+				Sim_ScriptError(Line, "end without repeat");
+			}
+		}
+		else
+		{
+			Sim_ScriptError(Line, "unknown command");
+		}
+
+		Sim_ScriptLen++;
+	}
+
+	if(Depth)
+	{
+		Sim_ScriptError(Line, "repeat without end");
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_DtcAdd(Code)
+@Function	: pair a sensor as stgMenu_LearnSensorCBS does
+------------------------------------------------------------------------------*/
+static void Sim_DtcAdd(unsigned long Code)
+{
+	Stru_DTC Dtc;
+
+	memset(&Dtc, 0, sizeof(Dtc));
+	Dtc.Code[2] = (Code >> 16) & 0xFF;
+	Dtc.Code[1] = (Code >> 8) & 0xFF;
+	Dtc.Code[0] = Code & 0x0F;
+
+	if((Dtc.Code[0] == SENSOR_CODE_REMOTE_ENARM) || (Dtc.Code[0] == SENSOR_CODE_REMOTE_DISARM)
+	|| (Dtc.Code[0] == SENSOR_CODE_REMOTE_HOMEARM) || (Dtc.Code[0] == SENSOR_CODE_REMOTE_SOS))
+	{
+		Dtc.DTCType = DTC_REMOTE;
+	}
+	else
+	{
+		Dtc.DTCType = DTC_DOOR;
+	}
+	Dtc.ZoneType = ZONE_TYP_1ST;
+
+	if(Device_AddDTC(&Dtc) == 0xFF)
+	{
+		fprintf(stderr, "sim: dtc %06lX not added\n", Code);
+	}
+}
+
+static void Sim_RfQueue(unsigned long Code, unsigned char Repeat, unsigned long Unit, unsigned long long Now)
+{
+	Sim_RfTypeDef *pRf;
+
+	if((((Sim_RfTail + 1) % SIM_RF_MAX) == Sim_RfWait) && (Sim_RfWait != Sim_RfTx))
+	{
+		// oldest ended transmission still without a decode: lost
+		Sim_Result.RfLost += !Sim_Rf[Sim_RfWait].Decoded;
+		Sim_RfWait = (Sim_RfWait + 1) % SIM_RF_MAX;
+	}
+	if(((Sim_RfTail + 1) % SIM_RF_MAX) == Sim_RfWait)
+	{
+		fprintf(stderr, "sim: more than %d transmissions queued\n", SIM_RF_MAX - 1);
+		exit(2);
+	}
+
+	pRf = &Sim_Rf[Sim_RfTail];
+	pRf->Code = Code;
+	pRf->Decoded = 0;
+	pRf->Repeat = Repeat;
+	pRf->Unit = Unit * SIM_NS_PER_US;
+	pRf->Start = (Sim_RfFree > Now) ? Sim_RfFree : Now;
+	pRf->End = pRf->Start + (pRf->Unit * (SIM_RF_UNITS * Repeat + 1));	// closing high pulse
+	Sim_RfFree = pRf->End + SIM_RF_GAP;
+	Sim_RfTail = (Sim_RfTail + 1) % SIM_RF_MAX;
+	Sim_Result.RfSent++;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_ScriptRun(Now)
+@Function	: execute the script till the next wait
+@Return		: 0: script ended
+------------------------------------------------------------------------------*/
+static unsigned char Sim_ScriptRun(unsigned long long Now)
+{
+	Sim_CmdTypeDef *pCmd;
+	unsigned char Data[6];
+
+	while(Now >= Sim_WaitUntil)
+	{
+		if(Sim_Pc >= Sim_ScriptLen)
+		{
+			return 0;
+		}
+
+		pCmd = &Sim_Script[Sim_Pc++];
+		switch(pCmd->Cmd)
+		{
+			case SIM_CMD_WAIT:
+				Sim_WaitUntil = Now + pCmd->Arg[0] * SIM_NS_PER_MS;
+			break;
+
+			case SIM_CMD_RF:
+				Sim_RfQueue(pCmd->Arg[0], pCmd->Arg[1], pCmd->Arg[2], Now);
+			break;
+
+			case SIM_CMD_KEY:
+				Sim_GPIO_SetInput(Sim_KeyPort[pCmd->Arg[0] - 1], Sim_KeyPin[pCmd->Arg[0] - 1], 0);
+				Sim_KeyRelease[pCmd->Arg[0] - 1] = Now + pCmd->Arg[1] * SIM_NS_PER_MS;
+				Sim_Result.KeyPressed++;
+			break;
+
+			case SIM_CMD_DTC:
+				Sim_DtcAdd(pCmd->Arg[0]);
+			break;
+
+			case SIM_CMD_UART1:
+			case SIM_CMD_UART2:
+				Sim_USART_RxInput((pCmd->Cmd == SIM_CMD_UART1) ? USART1 : USART2, (unsigned char *)pCmd->Text, strlen(pCmd->Text));
+			break;
+
+			case SIM_CMD_SRV:
+				memset(Data, 0, sizeof(Data));
+				Data[0] = (unsigned char)pCmd->Arg[1];
+				Sim_NBIOT_ServerEvent((en_NBIot_MSG_TYPE)pCmd->Arg[0], Data);
+			break;
+
+			case SIM_CMD_SCREEN:
+				printf("SIM,SCREEN,%llu\n", Now / SIM_NS_PER_MS);
+				Sim_OLED_Dump(stdout);
+			break;
+
+			case SIM_CMD_MARK:
+				printf("SIM,MARK,%llu,%s\n", Now / SIM_NS_PER_MS, pCmd->Text);
+			break;
+
+			case SIM_CMD_REPEAT:
+				Sim_LoopPc[Sim_LoopDepth] = Sim_Pc;
+				Sim_LoopCnt[Sim_LoopDepth] = pCmd->Arg[0];
+				Sim_LoopDepth++;
+				if(!pCmd->Arg[0])
+				{
+					// skip the body
+					unsigned char Depth = 1;
+					while(Depth)
+					{
+						pCmd = &Sim_Script[Sim_Pc++];
+						Depth += (pCmd->Cmd == SIM_CMD_REPEAT);
+						Depth -= (pCmd->Cmd == SIM_CMD_END);
+					}
+					Sim_LoopDepth--;
+				}
+			break;
+
+			case SIM_CMD_END:
+				if(--Sim_LoopCnt[Sim_LoopDepth - 1])
+				{
+					Sim_Pc = Sim_LoopPc[Sim_LoopDepth - 1];
+				}
+				else
+				{
+					Sim_LoopDepth--;
+				}
+			break;
+		}
+	}
+
+	return 1;
+}
+
+
+/*-------------------------- stimulus ----------------------------------------*/
+/*----------------------------------------------------------------------------
+@Name		: Sim_RfLevel(pRf, Now)
+@Function	: ev1527 level of a transmission:
+			  sync: 1 unit high + 31 units low,
+			  bit '1': 3 units high + 1 unit low, bit '0': 1 unit high + 3 units low
+------------------------------------------------------------------------------*/
+static unsigned char Sim_RfLevel(Sim_RfTypeDef *pRf, unsigned long long Now)
+{
+	unsigned long Unit;
+	unsigned long Pos;
+	unsigned long Bit;
+
+	Unit = (Now - pRf->Start) / pRf->Unit;
+	if(Unit >= (unsigned long)SIM_RF_UNITS * pRf->Repeat)
+	{
+		return 1;		// closing high pulse: ends the low of the last bit
+	}
+
+	Pos = Unit % SIM_RF_UNITS;
+	if(Pos < 32)
+	{
+		return (Pos == 0);
+	}
+
+	Pos -= 32;
+	Bit = (pRf->Code >> (23 - (Pos / 4))) & 0x01;
+	return ((Pos % 4) < (Bit ? 3 : 1));
+}
+
+static void Sim_Stimulus(unsigned long long Now)
+{
+	Sim_RfTypeDef *pRf;
+	unsigned char Level = 0;
+	unsigned char Run;
+	unsigned char i;
+
+	// script first: a transmission queued now starts on air now
+	Run = Sim_ScriptRun(Now);
+
+	// RF receiver output, next step at the next unit boundary(edges captured on time)
+	while((Sim_RfTx != Sim_RfTail) && (Now >= Sim_Rf[Sim_RfTx].End))
+	{
+		Sim_RfTx = (Sim_RfTx + 1) % SIM_RF_MAX;
+	}
+	if(Sim_RfTx != Sim_RfTail)
+	{
+		pRf = &Sim_Rf[Sim_RfTx];
+		if(Now >= pRf->Start)
+		{
+			Level = Sim_RfLevel(pRf, Now);
+			Sim_Clock_Event(pRf->Start + ((Now - pRf->Start) / pRf->Unit + 1) * pRf->Unit);
+		}
+		else
+		{
+			Sim_Clock_Event(pRf->Start);
+		}
+	}
+	Sim_GPIO_SetInput(RFD_RX_PORT, RFD_RX_PIN, Level);
+
+	// released keys
+	for(i=0; i<KEY_NUM; i++)
+	{
+		if(Sim_KeyRelease[i] && (Now >= Sim_KeyRelease[i]))
+		{
+			Sim_KeyRelease[i] = 0;
+			Sim_GPIO_SetInput(Sim_KeyPort[i], Sim_KeyPin[i], 1);
+		}
+	}
+
+	if(!Run && (Sim_RfTx == Sim_RfTail))
+	{
+		Sim_Finish();
+	}
+}
+
+
+/*-------------------------- wrapped call-back registers ---------------------*/
+static void Sim_RfdRxHook(unsigned char hMsg)
+{
+	unsigned char *pBuff;
+	unsigned long Code;
+	unsigned long long Latency;
+	unsigned short Last;
+	unsigned short i;
+
+	pBuff = OS_MsgGet(hMsg)->Data;
+	Code = ((unsigned long)pBuff[0] << 16) | ((unsigned long)pBuff[1] << 8) | pBuff[2];
+
+	// sent transmissions and the one on air
+	Last = Sim_RfTx;
+	if((Sim_RfTx != Sim_RfTail) && (Sim_Time >= Sim_Rf[Sim_RfTx].Start))
+	{
+		Last = (Sim_RfTx + 1) % SIM_RF_MAX;
+	}
+
+	for(i=Sim_RfWait; i!=Last; i=(i+1)%SIM_RF_MAX)
+	{
+		if(!Sim_Rf[i].Decoded && (Sim_Rf[i].Code == Code))
+		{
+			break;
+		}
+	}
+
+	if(i == Last)
+	{
+		Sim_Result.RfError++;
+	}
+	else
+	{
+		Latency = Sim_Time - Sim_Rf[i].Start;
+		Sim_Result.RfLatencySum += Latency;
+		if(Latency > Sim_Result.RfLatencyMax)
+		{
+			Sim_Result.RfLatencyMax = Latency;
+		}
+		Sim_Result.RfDecoded++;
+		Sim_Rf[i].Decoded = 1;
+
+		// earlier transmissions without a decode were lost(or filtered as a repeat)
+		while((Sim_RfWait != i) && (Sim_RfWait != Sim_RfTx))
+		{
+			if(!Sim_Rf[Sim_RfWait].Decoded)
+			{
+				Sim_Result.RfLost++;
+			}
+			Sim_RfWait = (Sim_RfWait + 1) % SIM_RF_MAX;
+		}
+		if((Sim_RfWait == i) && (i != Sim_RfTx))
+		{
+			Sim_RfWait = (i + 1) % SIM_RF_MAX;
+		}
+	}
+
+	if(Sim_AppRfdCBF)
+	{
+		Sim_AppRfdCBF(hMsg);
+	}
+	else
+	{
+		OS_MsgFree(hMsg);
+	}
+}
+
+static void Sim_KeyHook(KEY_VALUE_TYPEDEF KeyValue)
+{
+	Sim_Result.KeyEvents++;
+	if((KeyValue != KEY_IDLE_VAL) && (((KeyValue - KEY1_CLICK) % 5) == 0))
+	{
+		Sim_Result.KeyClicks++;
+	}
+
+	if(Sim_AppKeyCBF)
+	{
+		Sim_AppKeyCBF(KeyValue);
+	}
+}
+
+void __wrap_Hal_RFD_RxCBF_Register(RFD_RxCallBack_t pCBF)
+{
+	if(Sim_AppRfdCBF == 0)
+	{
+		Sim_AppRfdCBF = pCBF;
+	}
+	__real_Hal_RFD_RxCBF_Register(Sim_RfdRxHook);
+}
+
+void __wrap_Hal_Key_KeyScanCBF_Register(KeyEvent_CallBack_t pCBF)
+{
+	if(Sim_AppKeyCBF == 0)
+	{
+		Sim_AppKeyCBF = pCBF;
+	}
+	__real_Hal_Key_KeyScanCBF_Register(Sim_KeyHook);
+}
+
+
+/*-------------------------- results -----------------------------------------*/
+#if CFG_OS_PROFILE || CFG_OS_QUEUE_STAT || CFG_CPU_STACK_CHECK || CFG_TIMER_JITTER || CFG_TIME_LATENCY || CFG_CLOCK_RESIDENCY \
+	|| (CFG_POWER_STOP && CFG_POWER_WAKE_STAT)
+static void Sim_ReportOutput(unsigned char *buf, unsigned int len)
+{
+	fwrite(buf, 1, len, stdout);
+}
+#endif
+
+static void Sim_Finish(void)
+{
+	struct timespec WallEnd;
+	unsigned long long WallNs;
+	unsigned char i;
+
+	clock_gettime(CLOCK_MONOTONIC, &WallEnd);
+	WallNs = (unsigned long long)(WallEnd.tv_sec - Sim_WallStart.tv_sec) * SIM_NS_PER_S + WallEnd.tv_nsec - Sim_WallStart.tv_nsec;
+	if(!WallNs)
+	{
+		WallNs = 1;
+	}
+
+	// all transmissions ended, the ones without a decode were lost
+	while(Sim_RfWait != Sim_RfTail)
+	{
+		if(!Sim_Rf[Sim_RfWait].Decoded)
+		{
+			Sim_Result.RfLost++;
+		}
+		Sim_RfWait = (Sim_RfWait + 1) % SIM_RF_MAX;
+	}
+
+	fflush(stdout);
+	printf("SIM,TIME,virtual_ms=%llu\n", Sim_Time / SIM_NS_PER_MS);
+	printf("SIM,WALL,wall_ms=%llu,speedup=%.1f\n", WallNs / SIM_NS_PER_MS, (double)Sim_Time / (double)WallNs);
+	printf("SIM,RF,sent=%lu,decoded=%lu,lost=%lu,error=%lu,lat_avg_ms=%.2f,lat_max_ms=%.2f\n",
+		Sim_Result.RfSent, Sim_Result.RfDecoded, Sim_Result.RfLost, Sim_Result.RfError,
+		Sim_Result.RfDecoded ? ((double)Sim_Result.RfLatencySum / Sim_Result.RfDecoded / SIM_NS_PER_MS) : 0.0,
+		(double)Sim_Result.RfLatencyMax / SIM_NS_PER_MS);
+	printf("SIM,KEY,pressed=%lu,clicks=%lu,events=%lu\n", Sim_Result.KeyPressed, Sim_Result.KeyClicks, Sim_Result.KeyEvents);
+	printf("SIM,UPLINK,sent=%lu\n", Sim_NBIOT_GetUplinkCount());
+	printf("SIM,BUS,spi=%lu,oled_refresh=%lu,eeprom_rd=%lu,eeprom_wr=%lu,uart1_tx=%lu,uart2_tx=%lu,uart_rx_drop=%lu\n",
+		Sim_Stat.SpiBytes, Sim_Stat.OledRefresh, Sim_Stat.EepromRead, Sim_Stat.EepromWrite,
+		Sim_Stat.Uart1Tx, Sim_Stat.Uart2Tx, Sim_Stat.UartRxDrop);
+	printf("SIM,CLK,switches=%lu,clock_err=%lu,uart_baud_err=%lu\n", Sim_Stat.ClockSwitch, Sim_Stat.ClockErr, Sim_Stat.UartBaudErr);
+	printf("SIM,PWR,stops=%lu,stop_ms=%llu,stop_rx_drop=%lu,alarm_writes=%lu,rtc_stale=%lu\n", Sim_Stat.StopCount, Sim_Stat.StopNs / SIM_NS_PER_MS, Sim_Stat.StopRxDrop, Sim_Stat.RtcAlarmWrite, Sim_Stat.RtcStale);
+	for(i=0; i<OS_TASK_SUM; i++)
+	{
+		printf("SIM,TASK,id=%u,miss=%u\n", i, OS_TaskGetMissCnt((OS_TaskIDTypeDef)i));
+	}
+	printf("SIM,PEAK,releases=%u\n", OS_GetPeakReleases());
+#if CFG_OS_PROFILE
+	for(i=0; i<OS_TASK_SUM; i++)
+	{
+		OS_ProfileReport((OS_TaskIDTypeDef)i, Sim_ReportOutput);
+	}
+	OS_LoadReport(Sim_ReportOutput);
+#endif
+#if CFG_OS_QUEUE_STAT
+	for(i=0; OS_QueueReport((unsigned char)i, Sim_ReportOutput); i++)
+	{
+	}
+#endif
+#if CFG_CPU_STACK_CHECK
+	for(i=0; Hal_CPU_StackReport(i, Sim_ReportOutput); i++)
+	{
+	}
+#endif
+#if CFG_TIMER_JITTER
+	Hal_Timer_JitterReport(Sim_ReportOutput);
+#endif
+#if CFG_TIME_LATENCY
+	for(i=0; Hal_Time_LatencyReport(i, Sim_ReportOutput); i++)
+	{
+	}
+#endif
+#if CFG_CLOCK_RESIDENCY
+	for(i=0; Hal_Clock_Report(i, Sim_ReportOutput); i++)
+	{
+	}
+#endif
+#if CFG_POWER_STOP && CFG_POWER_WAKE_STAT
+	for(i=0; Hal_Power_Report(i, Sim_ReportOutput); i++)
+	{
+	}
+#endif
+	fflush(stdout);
+
+	exit(0);
+}
+
+static void Sim_Usage(void)
+{
+	fprintf(stderr, "usage: sim [-e eeprom.bin] [-u uart1.txt | -q] [-c] [script]\n");
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	const char *pEeprom = 0;
+	const char *pScript = 0;
+	FILE *pUart1 = stdout;
+	FILE *fp;
+	int i;
+
+	for(i=1; i<argc; i++)
+	{
+		if(!strcmp(argv[i], "-e") && (i + 1 < argc))
+		{
+			pEeprom = argv[++i];
+		}
+		else if(!strcmp(argv[i], "-u") && (i + 1 < argc))
+		{
+			pUart1 = fopen(argv[++i], "w");
+			if(!pUart1)
+			{
+				perror(argv[i]);
+				return 2;
+			}
+		}
+		else if(!strcmp(argv[i], "-q"))
+		{
+			pUart1 = 0;
+		}
+		else if(!strcmp(argv[i], "-c"))
+		{
+			Sim_CPU_HostCycle = 1;
+		}
+		else if((argv[i][0] != '-') && !pScript)
+		{
+			pScript = argv[i];
+		}
+		else
+		{
+			Sim_Usage();
+		}
+	}
+
+	fp = pScript ? fopen(pScript, "r") : stdin;
+	if(!fp)
+	{
+		perror(pScript);
+		return 2;
+	}
+	Sim_ScriptLoad(fp);
+	if(fp != stdin)
+	{
+		fclose(fp);
+	}
+
+	Sim_Periph_Init(pEeprom, pUart1);
+	Sim_GPIO_SetInput(RFD_RX_PORT, RFD_RX_PIN, 0);		// receiver output idles low
+	Sim_StimulusRegister(Sim_Stimulus);
+
+	clock_gettime(CLOCK_MONOTONIC, &Sim_WallStart);
+
+	// never returns: the run ends in Sim_Finish
+	return Sim_FirmwareMain();
+}
@@ -0,0 +1,114 @@
+/************************************************************************
+* Module: Sim_NBIOT(host simulation)
+* Function: stand-in of the NB-IoT module driver(hal_nbiot.h)
+*		@ uplink events are queued by App and sent on USART2 by the task
+*		@ bytes received on USART2 are counted
+*		@ server messages from the simulation script are delivered to App
+*		  in the task, as the module driver does after parsing a downlink
+*************************************************************************/
+
+#include <string.h>
+#include "stm32f10x.h"
+#include "hal_nbiot.h"
+#include "hal_usart.h"
+#include "os_system.h"
+
+#define SIM_NBIOT_EVT_MAX		8
+#define SIM_NBIOT_DATA_LEN		6
+
+typedef struct
+{
+	en_NBIot_MSG_TYPE Type;
+	unsigned char Data[SIM_NBIOT_DATA_LEN];
+}Sim_NBIOT_EvtTypeDef;
+
+static void Sim_NBIOT_RxByte(unsigned char dat);
+
+static NBIot_ServerEvent_t ServerEventCBF;
+static Queue64 Sim_NBIOT_UpList;
+static Sim_NBIOT_EvtTypeDef Sim_NBIOT_Evt[SIM_NBIOT_EVT_MAX];
+static unsigned char Sim_NBIOT_EvtIn;
+static unsigned char Sim_NBIOT_EvtOut;
+static unsigned long Sim_NBIOT_Uplinks;
+
+void Hal_NBIOT_Init(void)
+{
+	QueueEmpty(Sim_NBIOT_UpList);
+	QueueRegister(Sim_NBIOT_UpList, "NBIOT_Up");
+	Hal_USART2_RxDatCBSRegister(Sim_NBIOT_RxByte);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_NBIOT_Pro()
+@Function	: deliver one pending server message, send one queued uplink
+------------------------------------------------------------------------------*/
+void Hal_NBIOT_Pro(void)
+{
+	unsigned char Event;
+	unsigned char Frame[8] = "UP,00\r\n";
+	static const char Hex[] = "0123456789ABCDEF";
+
+	if(Sim_NBIOT_EvtOut != Sim_NBIOT_EvtIn)
+	{
+		if(ServerEventCBF)
+		{
+			ServerEventCBF(Sim_NBIOT_Evt[Sim_NBIOT_EvtOut].Type, Sim_NBIOT_Evt[Sim_NBIOT_EvtOut].Data);
+		}
+		Sim_NBIOT_EvtOut = (Sim_NBIOT_EvtOut + 1) % SIM_NBIOT_EVT_MAX;
+	}
+
+	if(QueueDataOut(Sim_NBIOT_UpList, &Event))
+	{
+		Frame[3] = Hex[Event >> 4];
+		Frame[4] = Hex[Event & 0x0F];
+		Hal_USART2_Send_Data(Frame, 7);
+		Sim_NBIOT_Uplinks++;
+	}
+}
+
+void ServerEventCBFRegister(NBIot_ServerEvent_t pCBF)
+{
+	if(ServerEventCBF == 0)
+	{
+		ServerEventCBF = pCBF;
+	}
+}
+
+void OneNet_UpEventQueue(En_OneNetUpDatList Event)
+{
+	unsigned char dat;
+
+	dat = (unsigned char)Event;
+	QueueDataIn(Sim_NBIOT_UpList, &dat, 1);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_NBIOT_ServerEvent(type, pData)
+@Function	: queue a server message for App(delivered by Hal_NBIOT_Pro)
+@Parameter	:
+		pData: SIM_NBIOT_DATA_LEN bytes
+------------------------------------------------------------------------------*/
+void Sim_NBIOT_ServerEvent(en_NBIot_MSG_TYPE type, unsigned char *pData)
+{
+	unsigned char Next;
+
+	Next = (Sim_NBIOT_EvtIn + 1) % SIM_NBIOT_EVT_MAX;
+	if(Next == Sim_NBIOT_EvtOut)
+	{
+		return;
+	}
+
+	Sim_NBIOT_Evt[Sim_NBIOT_EvtIn].Type = type;
+	memcpy(Sim_NBIOT_Evt[Sim_NBIOT_EvtIn].Data, pData, SIM_NBIOT_DATA_LEN);
+	Sim_NBIOT_EvtIn = Next;
+}
+
+unsigned long Sim_NBIOT_GetUplinkCount(void)
+{
+	return Sim_NBIOT_Uplinks;
+}
+
+static void Sim_NBIOT_RxByte(unsigned char dat)
+{
+	(void)dat;		// AT responses are not modelled
+}
@@ -0,0 +1,1688 @@
+/************************************************************************
+* Module: Sim_Periph(host simulation)
+* Function: StdPeriph driver models and virtual clock of the simulation build
+*		@ GPIO: output/input/open-drain levels, input pins driven by Sim_GPIO_SetInput
+*		@ TIM1: free running counter, update interrupt and CH4 capture of PA11 edges(Hal_RFD)
+*		@ TIM2: free running counter and update flag/interrupt(Hal_Time)
+*		@ TIM4: counter and update interrupt from PSC/ARR on the virtual clock
+*		@ RCC/FLASH: SYSCLK from HSI, HSE or PLL, APB1 prescaler, wait states(checked, not timed)
+*		@ PWR/RTC/EXTI: STOP mode, RTC counter and alarm on LSI, edge lines of GPIOA/GPIOB
+*		@ USART1: TX timed by BRR and the APB clock(interrupt driven or polled), output to a file
+*		@ USART2: polled TX in zero time(counted only)
+*		@ USART1/USART2 RX: bytes from Sim_USART_RxInput, one per byte time
+*		@ SPI1: SSD1306 panel model(page addressing) behind the OLED driver
+*		@ GPIOB SCL/SDA: AT24C128 slave model behind the bit-banged I2C driver
+* Description:
+*		@ the clock only moves in Sim_Clock_Step(OS idle): the firmware itself
+*		  takes no virtual time, interrupts are taken between tasks
+*		@ the stimulus asks for a step at its next input change(Sim_Clock_Event):
+*		  input edges are captured at their exact time
+*		@ STOP runs the clock inside PWR_EnterSTOPMode: the stimulus still drives
+*		  the pins, the edge lines and the RTC alarm end it
+*************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "stm32f10x.h"
+#include "hal_i2c_eeprom.h"
+#include "hal_oled.h"
+#include "sim_periph.h"
+
+#define SIM_OLED_PAGES			8
+#define SIM_OLED_COLUMNS		128
+
+#define SIM_TIME_NEVER			(~0ULL)
+#define SIM_HSI_CLK				8000000UL		// internal RC: STOP wake-up clock
+
+typedef enum
+{
+	SIM_I2C_IDLE,		// not addressed, wait for START
+	SIM_I2C_DEV,		// device address byte
+	SIM_I2C_ADDRH,		// word address high byte
+	SIM_I2C_ADDRL,		// word address low byte
+	SIM_I2C_WRITE,		// data bytes to memory
+	SIM_I2C_READ,		// data bytes from memory
+}SIM_I2C_STATE_TYPEDEF;
+
+typedef struct
+{
+	USART_TypeDef *Port;
+	void (*Handler)(void);
+	unsigned char Fifo[SIM_USART_RX_SIZE];
+	unsigned short Head;
+	unsigned short Len;
+	unsigned long long RxNext;		// next byte received
+	unsigned long long TxDone;		// TX shift register empty
+}Sim_USARTTypeDef;
+
+extern void SysTick_Handler(void);
+extern void TIM1_UP_IRQHandler(void) __attribute__((weak));	// Hal_RFD: CFG_RFD_CAPTURE only
+extern void TIM1_CC_IRQHandler(void) __attribute__((weak));
+extern void TIM2_IRQHandler(void);
+extern void TIM4_IRQHandler(void);
+extern void USART1_IRQHandler(void);
+extern void USART2_IRQHandler(void);
+extern void CAN1_RX1_IRQHandler(void) __attribute__((weak));	// Hal_RFD: CFG_RFD_CAPTURE and CFG_CPU_CRITICAL_BASEPRI only
+extern void CAN1_SCE_IRQHandler(void) __attribute__((weak));	// Hal_Timer: CFG_CPU_CRITICAL_BASEPRI only
+
+uint32_t SystemCoreClock = 72000000;
+
+GPIO_TypeDef Sim_GPIOA, Sim_GPIOB, Sim_GPIOC;
+USART_TypeDef Sim_USART1, Sim_USART2;
+TIM_TypeDef Sim_TIM1, Sim_TIM2, Sim_TIM3, Sim_TIM4;
+SPI_TypeDef Sim_SPI1;
+EXTI_TypeDef Sim_EXTI;
+RCC_TypeDef Sim_RCC;
+
+unsigned long long Sim_Time;
+Sim_StatTypeDef Sim_Stat;
+
+static Sim_Stimulus_t Sim_Stimulus;
+
+static unsigned long long Sim_TickPeriod;
+static unsigned long long Sim_TickNext;
+static void (*Sim_TickHandler)(void);
+
+static unsigned long long Sim_EventNext;		// next input change(Sim_Clock_Event)
+static unsigned long long Sim_TIM1Start;		// CNT 0 of TIM1
+static unsigned long long Sim_TIM1Next;		// next TIM1 wrap
+static unsigned long long Sim_TIM2Start;		// CNT 0 of TIM2
+static unsigned long long Sim_TIM2Next;		// next TIM2 wrap
+static unsigned long long Sim_TIM4Start;		// CNT 0 of TIM4
+static unsigned long long Sim_TIM4Next;		// next TIM4 update interrupt
+static unsigned char Sim_CAN1RX1Pending;		// software pended(NVIC_SetPendingIRQ)
+static unsigned char Sim_CAN1SCEPending;
+
+static unsigned char Sim_RccHseOn;
+static unsigned char Sim_RccPllOn;
+static uint32_t Sim_RccSysclk;			// RCC_SYSCLKSource_xxx
+static uint32_t Sim_RccPclk1;			// APB1 prescaler: RCC_HCLK_xxx
+static uint32_t Sim_FlashLatency;
+
+static unsigned char Sim_ExtiPort[16];		// EXTI line n: pin n of GPIOA(0)/GPIOB(1)
+static unsigned char Sim_PwrStop;			// in STOP: no capture, no interrupt
+static unsigned char Sim_RtcOn;				// RTC clock enabled
+static unsigned long long Sim_RtcStart;		// time of Sim_RtcBase
+static uint32_t Sim_RtcBase;				// RTC counter at Sim_RtcStart
+static uint32_t Sim_RtcPrl;					// RTC prescaler: LSI / (PRL + 1)
+static uint32_t Sim_RtcAlarm;
+static uint16_t Sim_RtcFlags;
+static unsigned char Sim_RtcStale;			// APB1 stopped in STOP: RTC_WaitForSynchro due
+static uint16_t Sim_BkpDr1;					// backup data register(Hal_Power marker)
+
+static Sim_USARTTypeDef Sim_Usart[2] =
+{
+	{.Port = &Sim_USART1, .Handler = USART1_IRQHandler},
+	{.Port = &Sim_USART2, .Handler = USART2_IRQHandler},
+};
+static FILE *Sim_Uart1Out;
+
+static unsigned char Sim_OledFb[SIM_OLED_PAGES][SIM_OLED_COLUMNS];
+static unsigned char Sim_OledPage;
+static unsigned char Sim_OledColumn;
+static unsigned char Sim_OledArgSkip;
+
+static unsigned char Sim_Eeprom[SIM_EEPROM_SIZE];
+static const char *Sim_EepromFile;
+static unsigned char Sim_EepromDirty;
+
+static SIM_I2C_STATE_TYPEDEF Sim_I2CState;
+static unsigned char Sim_I2CScl = 1;
+static unsigned char Sim_I2CSda = 1;		// bus level
+static unsigned char Sim_I2CSlaveSda = 1;	// level driven by the slave
+static unsigned char Sim_I2CBit;			// SCL rising edges in the current byte(9: ACK)
+static unsigned char Sim_I2CShift;			// byte received
+static unsigned char Sim_I2CTxByte;			// byte sent(SIM_I2C_READ)
+static unsigned char Sim_I2CMasterAck;
+static unsigned char Sim_I2CReadFirst;
+static unsigned short Sim_I2CPtr;
+
+static void Sim_GPIO_Update(GPIO_TypeDef *GPIOx);
+static void Sim_GPIO_Write(GPIO_TypeDef *GPIOx, uint32_t Odr);
+static void Sim_I2C_Bus(void);
+static void Sim_EEPROM_Flush(void);
+static unsigned long long Sim_USART_ByteTime(USART_TypeDef *USARTx);
+static Sim_USARTTypeDef *Sim_USART_Get(USART_TypeDef *USARTx);
+static unsigned long long Sim_TIM_Period(TIM_TypeDef* TIMx);
+static void Sim_TIM_Count(TIM_TypeDef* TIMx, unsigned long long Start);
+static void Sim_TIM_Rebase(TIM_TypeDef* TIMx);
+static void Sim_TIM_Handler(TIM_TypeDef* TIMx, void (*pHandler)(void));
+static void Sim_TIM1_Capture(uint32_t Idr);
+
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_Periph_Init(pEepromFile, pUart1Out)
+@Function	: reset the peripheral models
+		--> pull-up level on every input pin
+		--> EEPROM image from pEepromFile(erased if the file does not exist)
+@Parameter	:
+		pEepromFile	: EEPROM image file, written back on every STOP(0: not persisted)
+		pUart1Out	: debug USART output(0: discarded)
+------------------------------------------------------------------------------*/
+void Sim_Periph_Init(const char *pEepromFile, FILE *pUart1Out)
+{
+	FILE *fp;
+
+	Sim_GPIOA.ExtLevel = 0xFFFF;
+	Sim_GPIOB.ExtLevel = 0xFFFF;
+	Sim_GPIOC.ExtLevel = 0xFFFF;
+	Sim_GPIO_Update(GPIOA);
+	Sim_GPIO_Update(GPIOB);
+	Sim_GPIO_Update(GPIOC);
+
+	// clock tree as left by SystemInit: 72MHz from the PLL, APB1 36MHz
+	Sim_RccHseOn = 1;
+	Sim_RccPllOn = 1;
+	Sim_RccSysclk = RCC_SYSCLKSource_PLLCLK;
+	Sim_RccPclk1 = RCC_HCLK_Div2;
+	Sim_FlashLatency = FLASH_Latency_2;
+	SystemCoreClock = SIM_PLL_CLK;
+	RCC_BackupResetCmd(ENABLE);
+
+	Sim_USART1.SR = USART_FLAG_TXE | USART_FLAG_TC;
+	Sim_USART2.SR = USART_FLAG_TXE | USART_FLAG_TC;
+	Sim_Uart1Out = pUart1Out;
+
+	Sim_TickNext = SIM_TIME_NEVER;
+	Sim_EventNext = SIM_TIME_NEVER;
+	Sim_TIM1Next = SIM_TIME_NEVER;
+	Sim_TIM2Next = SIM_TIME_NEVER;
+	Sim_TIM4Next = SIM_TIME_NEVER;
+	Sim_Usart[0].RxNext = SIM_TIME_NEVER;
+	Sim_Usart[1].RxNext = SIM_TIME_NEVER;
+
+	memset(Sim_Eeprom, 0xFF, sizeof(Sim_Eeprom));
+	Sim_EepromFile = pEepromFile;
+	if(pEepromFile)
+	{
+		fp = fopen(pEepromFile, "rb");
+		if(fp)
+		{
+			if(fread(Sim_Eeprom, 1, sizeof(Sim_Eeprom), fp) != sizeof(Sim_Eeprom))
+			{
+				fprintf(stderr, "sim: %s shorter than %d bytes, rest erased\n", pEepromFile, SIM_EEPROM_SIZE);
+			}
+			fclose(fp);
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_StimulusRegister(pStimulus)
+@Function	: register the input driver, called at every clock step
+@Parameter	:
+		pStimulus: call-back function
+------------------------------------------------------------------------------*/
+void Sim_StimulusRegister(Sim_Stimulus_t pStimulus)
+{
+	Sim_Stimulus = pStimulus;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_Clock_SetTick(Period, pHandler)
+@Function	: start the system tick(SysTick) on the virtual clock
+@Parameter	:
+		Period	: tick period(ns)
+		pHandler: tick interrupt handler
+------------------------------------------------------------------------------*/
+void Sim_Clock_SetTick(unsigned long long Period, void (*pHandler)(void))
+{
+	Sim_TickPeriod = Period;
+	Sim_TickHandler = pHandler;
+	Sim_TickNext = Sim_Time + Period;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_Clock_Event(When)
+@Function	: step the clock at When as well(input change of the stimulus),
+			  the earliest time asked for since the last step counts
+@Parameter	:
+		When: virtual time(ns)
+------------------------------------------------------------------------------*/
+void Sim_Clock_Event(unsigned long long When)
+{
+	if((When > Sim_Time) && (When < Sim_EventNext))
+	{
+		Sim_EventNext = When;
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_Clock_TickLeft()
+@Function	: time till the next system tick(SysTick count down)
+@Return		: ns
+------------------------------------------------------------------------------*/
+unsigned long long Sim_Clock_TickLeft(void)
+{
+	return (Sim_TickNext > Sim_Time) ? (Sim_TickNext - Sim_Time) : 0;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_Clock_TickResume(Left, Us)
+@Function	: SysTick stood still in STOP: restart it with the rest of the
+			  current tick after Us more(as Hal_CPU_Stop does on the target)
+@Parameter	:
+		Left: Sim_Clock_TickLeft() before STOP
+		Us	: time passed for the firmware(Hal_Power_Stop)
+@Return		: complete ticks passed, counted by the caller
+------------------------------------------------------------------------------*/
+unsigned short Sim_Clock_TickResume(unsigned long long Left, unsigned long Us)
+{
+	unsigned long long Passed;
+	unsigned short Complete;
+
+	Passed = (Sim_TickPeriod - Left) + (Us * SIM_NS_PER_US);
+	Complete = (unsigned short)(Passed / Sim_TickPeriod);
+	Sim_TickNext = Sim_Time + (((Complete + 1ULL) * Sim_TickPeriod) - Passed);
+	return Complete;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_Clock_Step()
+@Function	: advance the virtual clock to the next peripheral event
+		--> SysTick, TIM1/TIM2/TIM4 update, USART1 TX done, USART RX byte, input event
+		--> drive the inputs(stimulus), then take the due interrupts
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+void Sim_Clock_Step(void)
+{
+	unsigned long long Next;
+	unsigned char TickDue;
+	unsigned char TIM1UpDue;
+	unsigned char TIM2Due;
+	unsigned char TIM4Due;
+	unsigned char i;
+	Sim_USARTTypeDef *pUsart;
+
+	Next = Sim_TickNext;
+	if(Sim_EventNext < Next)
+	{
+		Next = Sim_EventNext;
+	}
+	if(Sim_TIM1Next < Next)
+	{
+		Next = Sim_TIM1Next;
+	}
+	if(Sim_TIM2Next < Next)
+	{
+		Next = Sim_TIM2Next;
+	}
+	if(Sim_TIM4Next < Next)
+	{
+		Next = Sim_TIM4Next;
+	}
+	for(i=0; i<2; i++)
+	{
+		if(Sim_Usart[i].RxNext < Next)
+		{
+			Next = Sim_Usart[i].RxNext;
+		}
+		if((Sim_Usart[i].TxDone > Sim_Time) && (Sim_Usart[i].TxDone < Next))
+		{
+			Next = Sim_Usart[i].TxDone;
+		}
+	}
+
+	if(Next == SIM_TIME_NEVER)
+	{
+		fprintf(stderr, "sim: no clock source running\n");
+		Next = Sim_Time + SIM_NS_PER_MS;
+	}
+	Sim_Time = Next;
+	if(Sim_EventNext <= Sim_Time)
+	{
+		Sim_EventNext = SIM_TIME_NEVER;
+	}
+
+	// TIM1 wrap before the inputs: an edge at the wrap is captured at count 0
+	TIM1UpDue = 0;
+	if(Sim_TIM1Next <= Sim_Time)
+	{
+		Sim_TIM1Next += Sim_TIM_Period(TIM1);
+		TIM1->SR |= TIM_FLAG_Update;
+		TIM1UpDue = (TIM1->ITMask & TIM_IT_Update) ? 1 : 0;
+	}
+	Sim_TIM_Count(TIM1, Sim_TIM1Start);
+
+	if(Sim_Stimulus)
+	{
+		Sim_Stimulus(Sim_Time);
+	}
+
+	TickDue = (Sim_TickNext <= Sim_Time);
+	if(TickDue)
+	{
+		Sim_TickNext += Sim_TickPeriod;
+	}
+
+	TIM2Due = 0;
+	if(Sim_TIM2Next <= Sim_Time)
+	{
+		Sim_TIM2Next += Sim_TIM_Period(TIM2);
+		TIM2->SR |= TIM_FLAG_Update;
+		TIM2Due = (TIM2->ITMask & TIM_IT_Update) ? 1 : 0;
+	}
+	Sim_TIM_Count(TIM2, Sim_TIM2Start);
+
+	TIM4Due = (Sim_TIM4Next <= Sim_Time);
+	if(TIM4Due)
+	{
+		Sim_TIM4Next += Sim_TIM_Period(TIM4);
+	}
+	Sim_TIM_Count(TIM4, Sim_TIM4Start);
+
+	for(i=0; i<2; i++)
+	{
+		pUsart = &Sim_Usart[i];
+
+		if((pUsart->TxDone <= Sim_Time) && !(pUsart->Port->SR & USART_FLAG_TXE))
+		{
+			pUsart->Port->SR |= USART_FLAG_TXE | USART_FLAG_TC;
+		}
+
+		if(pUsart->RxNext <= Sim_Time)
+		{
+			if(pUsart->Port->SR & USART_FLAG_RXNE)
+			{
+				Sim_Stat.UartRxDrop++;		// overrun: byte lost
+			}
+			else
+			{
+				pUsart->Port->RxData = pUsart->Fifo[pUsart->Head];
+				pUsart->Port->SR |= USART_FLAG_RXNE;
+			}
+			pUsart->Head = (pUsart->Head + 1) % SIM_USART_RX_SIZE;
+			pUsart->Len--;
+			pUsart->RxNext = pUsart->Len ? (Sim_Time + Sim_USART_ByteTime(pUsart->Port)) : SIM_TIME_NEVER;
+		}
+	}
+
+	// interrupts in vector order, TIM1 capture before its update(priority)
+	if(TickDue && Sim_TickHandler)
+	{
+		Sim_TickHandler();
+	}
+	if((TIM1->SR & TIM_FLAG_CC4) && (TIM1->ITMask & TIM_IT_CC4) && TIM1_CC_IRQHandler)
+	{
+		TIM1->SR &= ~TIM_FLAG_CC4;		// read of CCR4 in the handler
+		Sim_TIM_Handler(TIM1, TIM1_CC_IRQHandler);
+	}
+	if(TIM1UpDue && TIM1_UP_IRQHandler)
+	{
+		Sim_TIM_Handler(TIM1, TIM1_UP_IRQHandler);
+	}
+	if(TIM2Due)
+	{
+		Sim_TIM_Handler(TIM2, TIM2_IRQHandler);
+	}
+	if(TIM4Due)
+	{
+		TIM4_IRQHandler();
+	}
+	for(i=0; i<2; i++)
+	{
+		if((USART_GetITStatus(Sim_Usart[i].Port, USART_IT_RXNE) != RESET)
+		|| (USART_GetITStatus(Sim_Usart[i].Port, USART_IT_TXE) != RESET))
+		{
+			Sim_Usart[i].Handler();
+		}
+	}
+	// pended by the handlers above, lowest priority
+	if(Sim_CAN1RX1Pending)
+	{
+		Sim_CAN1RX1Pending = 0;
+		CAN1_RX1_IRQHandler();
+	}
+	if(Sim_CAN1SCEPending)
+	{
+		Sim_CAN1SCEPending = 0;
+		CAN1_SCE_IRQHandler();
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_GPIO_SetInput(GPIOx, GPIO_Pin, Level)
+@Function	: drive pins from outside(sensor, key, bus slave)
+@Parameter	:
+		Level: 0: low, others: high(released)
+------------------------------------------------------------------------------*/
+void Sim_GPIO_SetInput(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, unsigned char Level)
+{
+	if(Level)
+	{
+		GPIOx->ExtLevel |= GPIO_Pin;
+	}
+	else
+	{
+		GPIOx->ExtLevel &= ~(uint32_t)GPIO_Pin;
+	}
+	Sim_GPIO_Update(GPIOx);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_USART_RxInput(USARTx, pData, Len)
+@Function	: queue bytes on the RX line, received one per byte time
+------------------------------------------------------------------------------*/
+void Sim_USART_RxInput(USART_TypeDef *USARTx, const unsigned char *pData, unsigned int Len)
+{
+	Sim_USARTTypeDef *pUsart;
+
+	pUsart = Sim_USART_Get(USARTx);
+
+	while(Len--)
+	{
+		if(!USARTx->Enable || (pUsart->Len >= SIM_USART_RX_SIZE))
+		{
+			Sim_Stat.UartRxDrop++;
+			pData++;
+			continue;
+		}
+
+		pUsart->Fifo[(pUsart->Head + pUsart->Len) % SIM_USART_RX_SIZE] = *pData++;
+		pUsart->Len++;
+		if(pUsart->RxNext == SIM_TIME_NEVER)
+		{
+			pUsart->RxNext = Sim_Time + Sim_USART_ByteTime(USARTx);
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_OLED_Dump(fp)
+@Function	: print the panel GRAM as text, 2 pixel rows per line
+------------------------------------------------------------------------------*/
+void Sim_OLED_Dump(FILE *fp)
+{
+	static const char Glyph[4] = {' ', '\'', '.', ':'};
+	unsigned char x, y;
+	unsigned char Top, Bottom;
+
+	for(y=0; y<SIM_OLED_PAGES*8; y+=2)
+	{
+		fputc('|', fp);
+		for(x=0; x<SIM_OLED_COLUMNS; x++)
+		{
+			Top = (Sim_OledFb[y/8][x] >> (y%8)) & 0x01;
+			Bottom = (Sim_OledFb[y/8][x] >> ((y%8) + 1)) & 0x01;
+			fputc(Glyph[Top | (Bottom << 1)], fp);
+		}
+		fputs("|\n", fp);
+	}
+}
+
+
+/*-------------------------- RCC / NVIC --------------------------------------*/
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState)
+{
+	(void)RCC_APB2Periph;
+	(void)NewState;
+}
+
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState)
+{
+	(void)RCC_APB1Periph;
+	(void)NewState;
+}
+
+static unsigned long Sim_RCC_Hclk(void)
+{
+	if(Sim_RccSysclk == RCC_SYSCLKSource_PLLCLK)
+	{
+		return SIM_PLL_CLK;
+	}
+	return (Sim_RccSysclk == RCC_SYSCLKSource_HSE) ? SIM_HSE_CLK : SIM_HSI_CLK;
+}
+
+static unsigned long Sim_RCC_Pclk1(void)
+{
+	return (Sim_RccPclk1 == RCC_HCLK_Div2) ? (Sim_RCC_Hclk() / 2) : Sim_RCC_Hclk();
+}
+
+// limits of the STM32F103 clock tree: 24MHz per flash wait state, APB1 36MHz
+static void Sim_RCC_Check(void)
+{
+	if((Sim_RccSysclk == RCC_SYSCLKSource_PLLCLK) && !Sim_RccPllOn)
+	{
+		Sim_Stat.ClockErr++;
+	}
+	if(((Sim_RccSysclk == RCC_SYSCLKSource_HSE) || Sim_RccPllOn) && !Sim_RccHseOn)
+	{
+		Sim_Stat.ClockErr++;		// HSE is the PLL source
+	}
+	if(Sim_RCC_Hclk() > (Sim_FlashLatency + 1) * 24000000UL)
+	{
+		Sim_Stat.ClockErr++;
+	}
+	if(Sim_RCC_Pclk1() > 36000000UL)
+	{
+		Sim_Stat.ClockErr++;
+	}
+}
+
+// new clock tree: the timers go on from the counts reached at the old clock
+static void Sim_RCC_Config(uint32_t Sysclk, uint32_t Pclk1)
+{
+	Sim_TIM_Count(TIM1, Sim_TIM1Start);
+	Sim_TIM_Count(TIM2, Sim_TIM2Start);
+	Sim_TIM_Count(TIM4, Sim_TIM4Start);
+
+	if(Sysclk != Sim_RccSysclk)
+	{
+		Sim_Stat.ClockSwitch++;
+	}
+	Sim_RccSysclk = Sysclk;
+	Sim_RccPclk1 = Pclk1;
+	Sim_RCC_Check();
+
+	Sim_TIM_Rebase(TIM1);
+	Sim_TIM_Rebase(TIM2);
+	Sim_TIM_Rebase(TIM4);
+}
+
+// PLL lock time not modelled: ready at once
+void RCC_PLLCmd(FunctionalState NewState)
+{
+	Sim_RccPllOn = (NewState != DISABLE);
+	Sim_RCC_Check();
+}
+
+// HSE start-up and LSI not modelled either
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG)
+{
+	if(RCC_FLAG == RCC_FLAG_HSERDY)
+	{
+		return Sim_RccHseOn ? SET : RESET;
+	}
+	if(RCC_FLAG == RCC_FLAG_LSIRDY)
+	{
+		return SET;
+	}
+	return ((RCC_FLAG == RCC_FLAG_PLLRDY) && Sim_RccPllOn) ? SET : RESET;
+}
+
+void RCC_HSEConfig(uint32_t RCC_HSE)
+{
+	Sim_RccHseOn = (RCC_HSE == RCC_HSE_ON);
+	Sim_RCC_Check();
+}
+
+void RCC_SYSCLKConfig(uint32_t RCC_SYSCLKSource)
+{
+	Sim_RCC_Config(RCC_SYSCLKSource, Sim_RccPclk1);
+}
+
+uint8_t RCC_GetSYSCLKSource(void)
+{
+	return (uint8_t)(Sim_RccSysclk << 2);		// SWS = SW
+}
+
+void RCC_PCLK1Config(uint32_t RCC_HCLK)
+{
+	Sim_RCC_Config(Sim_RccSysclk, RCC_HCLK);
+}
+
+void SystemCoreClockUpdate(void)
+{
+	SystemCoreClock = Sim_RCC_Hclk();
+}
+
+void FLASH_SetLatency(uint32_t FLASH_Latency)
+{
+	Sim_FlashLatency = FLASH_Latency;
+	Sim_RCC_Check();
+}
+
+void NVIC_PriorityGroupConfig(uint32_t NVIC_PriorityGroup)
+{
+	(void)NVIC_PriorityGroup;
+}
+
+void NVIC_Init(NVIC_InitTypeDef* NVIC_InitStruct)
+{
+	(void)NVIC_InitStruct;
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type IRQn)
+{
+	if((IRQn == CAN1_RX1_IRQn) && CAN1_RX1_IRQHandler)
+	{
+		Sim_CAN1RX1Pending = 1;
+	}
+	if((IRQn == CAN1_SCE_IRQn) && CAN1_SCE_IRQHandler)
+	{
+		Sim_CAN1SCEPending = 1;
+	}
+}
+
+// EXTI lines pend no interrupt in the model(unmasked in STOP only)
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn)
+{
+	(void)IRQn;
+}
+
+
+/*-------------------------- GPIO --------------------------------------------*/
+// CRL/CRH: 4 bits per pin, MODE[1:0] = 0: input, CNF[0] of an output = 1: open-drain
+#define SIM_GPIO_CFG(GPIOx, pin)	((((pin) < 8) ? ((GPIOx)->CRL >> ((pin) * 4)) : ((GPIOx)->CRH >> (((pin) - 8) * 4))) & 0x0F)
+
+void GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_InitStruct)
+{
+	uint32_t Cfg;
+	uint32_t Pin;
+
+	Cfg = (GPIO_InitStruct->GPIO_Mode & 0x0F);
+	if(GPIO_InitStruct->GPIO_Mode & 0x10)
+	{
+		Cfg |= GPIO_InitStruct->GPIO_Speed;
+	}
+
+	for(Pin=0; Pin<16; Pin++)
+	{
+		if(!(GPIO_InitStruct->GPIO_Pin & (1 << Pin)))
+		{
+			continue;
+		}
+
+		if(Pin < 8)
+		{
+			GPIOx->CRL = (GPIOx->CRL & ~(0x0FUL << (Pin * 4))) | (Cfg << (Pin * 4));
+		}
+		else
+		{
+			GPIOx->CRH = (GPIOx->CRH & ~(0x0FUL << ((Pin - 8) * 4))) | (Cfg << ((Pin - 8) * 4));
+		}
+
+		if(Cfg & 0x03)
+		{
+			GPIOx->OutMask |= (1 << Pin);
+		}
+		else
+		{
+			GPIOx->OutMask &= ~(1UL << Pin);
+
+			// input pull-up/pull-down selected by ODR
+			if(GPIO_InitStruct->GPIO_Mode == GPIO_Mode_IPU)
+			{
+				GPIOx->ODR |= (1 << Pin);
+			}
+			else if(GPIO_InitStruct->GPIO_Mode == GPIO_Mode_IPD)
+			{
+				GPIOx->ODR &= ~(1UL << Pin);
+			}
+		}
+	}
+
+	Sim_GPIO_Update(GPIOx);
+}
+
+uint8_t GPIO_ReadInputDataBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+	return (GPIOx->IDR & GPIO_Pin) ? 1 : 0;
+}
+
+void GPIO_SetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+	Sim_GPIO_Write(GPIOx, GPIOx->ODR | GPIO_Pin);
+}
+
+void GPIO_ResetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin)
+{
+	Sim_GPIO_Write(GPIOx, GPIOx->ODR & ~(uint32_t)GPIO_Pin);
+}
+
+void GPIO_WriteBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, BitAction BitVal)
+{
+	if(BitVal != Bit_RESET)
+	{
+		GPIO_SetBits(GPIOx, GPIO_Pin);
+	}
+	else
+	{
+		GPIO_ResetBits(GPIOx, GPIO_Pin);
+	}
+}
+
+void GPIO_PinRemapConfig(uint32_t GPIO_Remap, FunctionalState NewState)
+{
+	(void)GPIO_Remap;
+	(void)NewState;
+}
+
+void GPIO_EXTILineConfig(uint8_t GPIO_PortSource, uint8_t GPIO_PinSource)
+{
+	Sim_ExtiPort[GPIO_PinSource & 0x0F] = GPIO_PortSource;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_GPIO_Update(GPIOx)
+@Function	: pin levels(IDR): push-pull output = ODR, open-drain output = ODR & external,
+			  input = external level(released pins follow the pull-up)
+		--> an edge on a pin selected for its EXTI line sets the pending bit
+------------------------------------------------------------------------------*/
+static void Sim_GPIO_Update(GPIO_TypeDef *GPIOx)
+{
+	uint32_t Last;
+	uint32_t Idr;
+	uint32_t Pin;
+	uint32_t Mask;
+	unsigned char Port;
+
+	Idr = 0;
+	for(Pin=0; Pin<16; Pin++)
+	{
+		Mask = (1 << Pin);
+
+		if(!(GPIOx->OutMask & Mask))
+		{
+			Idr |= (GPIOx->ExtLevel & Mask);
+		}
+		else if(SIM_GPIO_CFG(GPIOx, Pin) & 0x04)
+		{
+			Idr |= (GPIOx->ODR & GPIOx->ExtLevel & Mask);
+		}
+		else
+		{
+			Idr |= (GPIOx->ODR & Mask);
+		}
+	}
+	Last = GPIOx->IDR;
+	GPIOx->IDR = Idr;
+
+	Port = (GPIOx == GPIOA) ? GPIO_PortSourceGPIOA : ((GPIOx == GPIOB) ? GPIO_PortSourceGPIOB : 0xFF);
+	for(Pin=0; Pin<16; Pin++)
+	{
+		Mask = (1 << Pin);
+		if(!((Last ^ Idr) & Mask) || (Sim_ExtiPort[Pin] != Port))
+		{
+			continue;
+		}
+		if(((Idr & Mask) && (EXTI->RTSR & Mask)) || (!(Idr & Mask) && (EXTI->FTSR & Mask)))
+		{
+			EXTI->PR |= Mask;
+		}
+	}
+
+	// TIM1 not clocked in STOP
+	if((GPIOx == GPIOA) && ((Last ^ Idr) & GPIO_Pin_11) && !Sim_PwrStop)
+	{
+		Sim_TIM1_Capture(Idr);
+	}
+}
+
+static void Sim_GPIO_Write(GPIO_TypeDef *GPIOx, uint32_t Odr)
+{
+	uint32_t Changed;
+
+	Changed = GPIOx->ODR ^ Odr;
+	GPIOx->ODR = Odr;
+	Sim_GPIO_Update(GPIOx);
+
+	if((GPIOx == I2C_SCL_PORT) && (Changed & (I2C_SCL_PIN | I2C_SDA_PIN)))
+	{
+		Sim_I2C_Bus();
+	}
+}
+
+
+/*-------------------------- PWR / RTC / EXTI --------------------------------*/
+// RTC counter: LSI / (PRL + 1) since the last prescaler write or clock enable
+static uint32_t Sim_RTC_Count(void)
+{
+	if(!Sim_RtcOn)
+	{
+		return Sim_RtcBase;
+	}
+	return Sim_RtcBase + (uint32_t)(((Sim_Time - Sim_RtcStart) * SIM_LSI_CLK) / (SIM_NS_PER_S * (Sim_RtcPrl + 1ULL)));
+}
+
+// first time the counter reads the alarm value
+static unsigned long long Sim_RTC_AlarmTime(void)
+{
+	unsigned long long Counts;
+
+	if(!Sim_RtcOn)
+	{
+		return SIM_TIME_NEVER;
+	}
+	Counts = (uint32_t)(Sim_RtcAlarm - Sim_RtcBase);
+	return Sim_RtcStart + ((Counts * (Sim_RtcPrl + 1ULL) * SIM_NS_PER_S) + SIM_LSI_CLK - 1) / SIM_LSI_CLK;
+}
+
+// backup domain reset: RTC stopped, registers at their reset values
+void RCC_BackupResetCmd(FunctionalState NewState)
+{
+	if(NewState != DISABLE)
+	{
+		Sim_RtcOn = 0;
+		Sim_RtcBase = 0;
+		Sim_RtcPrl = 0x8000;
+		Sim_RtcAlarm = 0xFFFFFFFF;
+		Sim_RtcFlags = 0;
+		Sim_RCC.BDCR = 0;
+		Sim_BkpDr1 = 0;
+	}
+}
+
+void RCC_LSICmd(FunctionalState NewState)
+{
+	(void)NewState;
+}
+
+void RCC_RTCCLKConfig(uint32_t RCC_RTCCLKSource)
+{
+	Sim_RCC.BDCR |= RCC_RTCCLKSource & RCC_BDCR_RTCSEL;
+}
+
+void RCC_RTCCLKCmd(FunctionalState NewState)
+{
+	Sim_RtcBase = Sim_RTC_Count();
+	Sim_RtcStart = Sim_Time;
+	Sim_RtcOn = (NewState != DISABLE);
+	if(Sim_RtcOn)
+	{
+		Sim_RCC.BDCR |= RCC_BDCR_RTCEN;
+	}
+	else
+	{
+		Sim_RCC.BDCR &= ~RCC_BDCR_RTCEN;
+	}
+}
+
+void PWR_BackupAccessCmd(FunctionalState NewState)
+{
+	(void)NewState;
+}
+
+// APB1/RTC domain resynchronisation and write completion take no virtual time
+void RTC_WaitForSynchro(void)
+{
+	Sim_RtcStale = 0;
+}
+
+void RTC_WaitForLastTask(void)
+{
+}
+
+void RTC_SetPrescaler(uint32_t PrescalerValue)
+{
+	Sim_RtcBase = Sim_RTC_Count();
+	Sim_RtcStart = Sim_Time;
+	Sim_RtcPrl = PrescalerValue & 0x000FFFFF;
+}
+
+uint32_t RTC_GetCounter(void)
+{
+	if(Sim_RtcStale)
+	{
+		Sim_Stat.RtcStale++;
+	}
+	return Sim_RTC_Count();
+}
+
+void RTC_SetAlarm(uint32_t AlarmValue)
+{
+	Sim_Stat.RtcAlarmWrite++;
+	Sim_RtcAlarm = AlarmValue;
+}
+
+void RTC_ClearFlag(uint16_t RTC_FLAG)
+{
+	Sim_RtcFlags &= ~RTC_FLAG;
+}
+
+// DR1 only: the other data registers read 0
+uint16_t BKP_ReadBackupRegister(uint16_t BKP_DR)
+{
+	return (BKP_DR == BKP_DR1) ? Sim_BkpDr1 : 0;
+}
+
+void BKP_WriteBackupRegister(uint16_t BKP_DR, uint16_t Data)
+{
+	if(BKP_DR == BKP_DR1)
+	{
+		Sim_BkpDr1 = Data;
+	}
+}
+
+void EXTI_Init(EXTI_InitTypeDef* EXTI_InitStruct)
+{
+	uint32_t Line;
+
+	Line = EXTI_InitStruct->EXTI_Line;
+	EXTI->IMR &= ~Line;
+	EXTI->EMR &= ~Line;
+	EXTI->RTSR &= ~Line;
+	EXTI->FTSR &= ~Line;
+	if(EXTI_InitStruct->EXTI_LineCmd == DISABLE)
+	{
+		return;
+	}
+	if(EXTI_InitStruct->EXTI_Mode == EXTI_Mode_Interrupt)
+	{
+		EXTI->IMR |= Line;
+	}
+	else
+	{
+		EXTI->EMR |= Line;
+	}
+	if(EXTI_InitStruct->EXTI_Trigger != EXTI_Trigger_Falling)
+	{
+		EXTI->RTSR |= Line;
+	}
+	if(EXTI_InitStruct->EXTI_Trigger != EXTI_Trigger_Rising)
+	{
+		EXTI->FTSR |= Line;
+	}
+}
+
+void EXTI_ClearITPendingBit(uint32_t EXTI_Line)
+{
+	EXTI->PR &= ~EXTI_Line;
+}
+
+// a timer standing still in STOP: its count and next update move on by Ns
+static void Sim_TIM_Hold(unsigned long long *pStart, unsigned long long *pNext, unsigned long long Ns)
+{
+	if(*pNext != SIM_TIME_NEVER)
+	{
+		*pStart += Ns;
+		*pNext += Ns;
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: PWR_EnterSTOPMode(PWR_Regulator, PWR_STOPEntry)
+@Function	: STOP till an unmasked EXTI line is pending(PR & IMR)
+		--> pending at the entry: returns at once(WFI does not sleep)
+		--> the clock runs to the next input change(stimulus) or the RTC alarm,
+			the stimulus drives the pins, their edges set the EXTI pending bits
+		--> TIM1/TIM2/TIM4 stand still, USART bytes arriving are lost
+		--> wake-up on HSI, HSE and PLL off
+@Parameter	: regulator and entry mode not modelled
+------------------------------------------------------------------------------*/
+void PWR_EnterSTOPMode(uint32_t PWR_Regulator, uint8_t PWR_STOPEntry)
+{
+	unsigned long long Enter;
+	unsigned long long Next;
+	unsigned long long Alarm;
+	unsigned long long Slept;
+	unsigned char i;
+	Sim_USARTTypeDef *pUsart;
+
+	(void)PWR_Regulator;
+	(void)PWR_STOPEntry;
+	if(EXTI->PR & EXTI->IMR)
+	{
+		return;
+	}
+
+	Sim_TIM_Count(TIM1, Sim_TIM1Start);
+	Sim_TIM_Count(TIM2, Sim_TIM2Start);
+	Sim_TIM_Count(TIM4, Sim_TIM4Start);
+	Enter = Sim_Time;
+	Alarm = Sim_RTC_AlarmTime();
+	Sim_PwrStop = 1;
+
+	while(!(EXTI->PR & EXTI->IMR))
+	{
+		Next = (Alarm < Sim_EventNext) ? Alarm : Sim_EventNext;
+		for(i=0; i<2; i++)
+		{
+			if(Sim_Usart[i].RxNext < Next)
+			{
+				Next = Sim_Usart[i].RxNext;
+			}
+		}
+		if(Next == SIM_TIME_NEVER)
+		{
+			fprintf(stderr, "sim: STOP without a wake-up source\n");
+			break;
+		}
+		Sim_Time = Next;
+		if(Sim_EventNext <= Sim_Time)
+		{
+			Sim_EventNext = SIM_TIME_NEVER;
+		}
+
+		for(i=0; i<2; i++)
+		{
+			pUsart = &Sim_Usart[i];
+			while(pUsart->RxNext <= Sim_Time)
+			{
+				Sim_Stat.StopRxDrop++;
+				pUsart->Head = (pUsart->Head + 1) % SIM_USART_RX_SIZE;
+				pUsart->Len--;
+				pUsart->RxNext = pUsart->Len ? (pUsart->RxNext + Sim_USART_ByteTime(pUsart->Port)) : SIM_TIME_NEVER;
+			}
+		}
+
+		if(Sim_Stimulus)
+		{
+			Sim_Stimulus(Sim_Time);
+		}
+
+		if(Alarm <= Sim_Time)
+		{
+			Alarm = SIM_TIME_NEVER;
+			Sim_RtcFlags |= RTC_FLAG_ALR;
+			if(EXTI->RTSR & EXTI_Line17)
+			{
+				EXTI->PR |= EXTI_Line17;
+			}
+		}
+	}
+	Sim_PwrStop = 0;
+	Sim_RtcStale = 1;
+
+	Slept = Sim_Time - Enter;
+	Sim_TIM_Hold(&Sim_TIM1Start, &Sim_TIM1Next, Slept);
+	Sim_TIM_Hold(&Sim_TIM2Start, &Sim_TIM2Next, Slept);
+	Sim_TIM_Hold(&Sim_TIM4Start, &Sim_TIM4Next, Slept);
+	Sim_Stat.StopCount++;
+	Sim_Stat.StopNs += Slept;
+
+	Sim_RccHseOn = 0;
+	Sim_RccPllOn = 0;
+	Sim_RCC_Config(RCC_SYSCLKSource_HSI, Sim_RccPclk1);
+}
+
+
+/*-------------------------- I2C EEPROM(AT24C128) ----------------------------*/
+/*----------------------------------------------------------------------------
+@Name		: Sim_I2C_Bus()
+@Function	: AT24C128 slave on the bus levels after a master pin write
+		--> SDA change while SCL high: START/STOP
+		--> SCL rising: sample SDA(data bits, ACK of the master)
+		--> SCL falling: ACK a received byte / drive the next data bit
+------------------------------------------------------------------------------*/
+static void Sim_I2C_Bus(void)
+{
+	unsigned char Scl;
+	unsigned char Sda;
+
+	Scl = (I2C_SCL_PORT->ODR & I2C_SCL_PIN) ? 1 : 0;
+	Sda = ((I2C_SDA_PORT->ODR & I2C_SDA_PIN) ? 1 : 0) & Sim_I2CSlaveSda;
+
+	if(Scl && Sim_I2CScl && (Sda != Sim_I2CSda))
+	{
+		if(!Sda)
+		{
+			// START(repeated START)
+			Sim_I2CState = SIM_I2C_DEV;
+		}
+		else
+		{
+			// STOP
+			Sim_I2CState = SIM_I2C_IDLE;
+			Sim_EEPROM_Flush();
+		}
+		Sim_I2CBit = 0;
+		Sim_I2CShift = 0;
+		Sim_I2CSlaveSda = 1;
+	}
+	else if(Scl && !Sim_I2CScl)
+	{
+		Sim_I2CBit++;
+		if(Sim_I2CBit <= 8)
+		{
+			Sim_I2CShift = (Sim_I2CShift << 1) | Sda;
+		}
+		else
+		{
+			Sim_I2CMasterAck = Sda;
+		}
+	}
+	else if(!Scl && Sim_I2CScl && (Sim_I2CState != SIM_I2C_IDLE))
+	{
+		if(Sim_I2CBit == 8)
+		{
+			// byte complete
+			Sim_I2CSlaveSda = 0;	// ACK
+			switch(Sim_I2CState)
+			{
+				case SIM_I2C_DEV:
+					if((Sim_I2CShift & 0xFE) != 0xA0)
+					{
+						Sim_I2CState = SIM_I2C_IDLE;
+						Sim_I2CSlaveSda = 1;
+					}
+					else if(Sim_I2CShift & 0x01)
+					{
+						Sim_I2CState = SIM_I2C_READ;
+						Sim_I2CReadFirst = 1;
+					}
+					else
+					{
+						Sim_I2CState = SIM_I2C_ADDRH;
+					}
+				break;
+
+				case SIM_I2C_ADDRH:
+					Sim_I2CPtr = (Sim_I2CShift << 8) & (SIM_EEPROM_SIZE - 1);
+					Sim_I2CState = SIM_I2C_ADDRL;
+				break;
+
+				case SIM_I2C_ADDRL:
+					Sim_I2CPtr |= Sim_I2CShift;
+					Sim_I2CState = SIM_I2C_WRITE;
+				break;
+
+				case SIM_I2C_WRITE:
+					// address rolls over inside the page
+					Sim_Eeprom[Sim_I2CPtr] = Sim_I2CShift;
+					Sim_I2CPtr = (Sim_I2CPtr & ~(SIM_EEPROM_PAGE - 1)) | ((Sim_I2CPtr + 1) & (SIM_EEPROM_PAGE - 1));
+					Sim_EepromDirty = 1;
+					Sim_Stat.EepromWrite++;
+				break;
+
+				case SIM_I2C_READ:
+					Sim_I2CSlaveSda = 1;	// release for the ACK of the master
+				break;
+
+				default:
+				break;
+			}
+		}
+		else if(Sim_I2CBit == 9)
+		{
+			Sim_I2CBit = 0;
+			Sim_I2CShift = 0;
+			Sim_I2CSlaveSda = 1;
+
+			if(Sim_I2CState == SIM_I2C_READ)
+			{
+				if(Sim_I2CReadFirst || !Sim_I2CMasterAck)
+				{
+					Sim_I2CReadFirst = 0;
+					Sim_I2CTxByte = Sim_Eeprom[Sim_I2CPtr];
+					Sim_I2CPtr = (Sim_I2CPtr + 1) & (SIM_EEPROM_SIZE - 1);
+					Sim_Stat.EepromRead++;
+					Sim_I2CSlaveSda = (Sim_I2CTxByte >> 7) & 0x01;
+				}
+				else
+				{
+					Sim_I2CState = SIM_I2C_IDLE;	// NACK: end of read
+				}
+			}
+		}
+		else if(Sim_I2CState == SIM_I2C_READ)
+		{
+			Sim_I2CSlaveSda = (Sim_I2CTxByte >> (7 - Sim_I2CBit)) & 0x01;
+		}
+	}
+
+	Sim_I2CScl = Scl;
+	Sim_I2CSda = ((I2C_SDA_PORT->ODR & I2C_SDA_PIN) ? 1 : 0) & Sim_I2CSlaveSda;
+	Sim_GPIO_SetInput(I2C_SDA_PORT, I2C_SDA_PIN, Sim_I2CSlaveSda);
+}
+
+static void Sim_EEPROM_Flush(void)
+{
+	FILE *fp;
+
+	if(!Sim_EepromDirty || !Sim_EepromFile)
+	{
+		return;
+	}
+	Sim_EepromDirty = 0;
+
+	fp = fopen(Sim_EepromFile, "wb");
+	if(!fp)
+	{
+		perror(Sim_EepromFile);
+		return;
+	}
+	fwrite(Sim_Eeprom, 1, sizeof(Sim_Eeprom), fp);
+	fclose(fp);
+}
+
+
+/*-------------------------- TIM ---------------------------------------------*/
+// TIM1(Hal_RFD capture)/TIM2(Hal_Time)/TIM4(Hal_Timer) counts and updates are timed, TIM3(buzzer PWM) keeps its registers
+// timer clock(MHz): TIM1 on APB2, TIM2~TIM4 on APB1(x2 when APB1 is divided)
+static unsigned long long Sim_TIM_MHz(TIM_TypeDef* TIMx)
+{
+	if((TIMx == TIM1) || (Sim_RccPclk1 == RCC_HCLK_Div2))
+	{
+		return Sim_RCC_Hclk() / SIM_NS_PER_MS;
+	}
+	return Sim_RCC_Pclk1() / SIM_NS_PER_MS;
+}
+
+// time(ns) of Counts at the current clock and prescaler
+static unsigned long long Sim_TIM_Ns(TIM_TypeDef* TIMx, unsigned long Counts)
+{
+	return ((unsigned long long)(TIMx->PSC + 1) * Counts * SIM_NS_PER_US) / Sim_TIM_MHz(TIMx);
+}
+
+static unsigned long long Sim_TIM_Period(TIM_TypeDef* TIMx)
+{
+	return Sim_TIM_Ns(TIMx, TIMx->ARR + 1UL);
+}
+
+// counter at the current time, read by the firmware as a register
+static void Sim_TIM_Count(TIM_TypeDef* TIMx, unsigned long long Start)
+{
+	unsigned long long Counts;
+
+	if(!TIMx->Enable)
+	{
+		return;
+	}
+	Counts = ((Sim_Time - Start) * Sim_TIM_MHz(TIMx)) / ((TIMx->PSC + 1) * SIM_NS_PER_US);
+	TIMx->CNT = (uint16_t)(Counts % (TIMx->ARR + 1));
+}
+
+// the counter goes on from CNT at the current clock and prescaler(written, or clock changed)
+static void Sim_TIM_Rebase(TIM_TypeDef* TIMx)
+{
+	unsigned long long *pStart;
+	unsigned long long *pNext;
+
+	if(TIMx == TIM1)
+	{
+		pStart = &Sim_TIM1Start;
+		pNext = &Sim_TIM1Next;
+	}
+	else if(TIMx == TIM2)
+	{
+		pStart = &Sim_TIM2Start;
+		pNext = &Sim_TIM2Next;
+	}
+	else if(TIMx == TIM4)
+	{
+		pStart = &Sim_TIM4Start;
+		pNext = &Sim_TIM4Next;
+	}
+	else
+	{
+		return;
+	}
+
+	if(!TIMx->Enable || (*pNext == SIM_TIME_NEVER))
+	{
+		return;
+	}
+	*pStart = Sim_Time - Sim_TIM_Ns(TIMx, TIMx->CNT);
+	*pNext = *pStart + Sim_TIM_Period(TIMx);
+}
+
+// SR flags are rc_w0: the firmware clears them by writing 0, the 1s it writes leave them as they are
+static void Sim_TIM_Handler(TIM_TypeDef* TIMx, void (*pHandler)(void))
+{
+	uint16_t Flags;
+
+	Flags = TIMx->SR;
+	pHandler();
+	TIMx->SR &= Flags;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_TIM1_Capture(Idr)
+@Function	: TIM1_CH4 input capture: PA11 changed to the level in Idr,
+			  an edge of the polarity selected by CC4P latches the count in CCR4
+------------------------------------------------------------------------------*/
+static void Sim_TIM1_Capture(uint32_t Idr)
+{
+	unsigned char Rising;
+	if(!TIM1->Enable || !(TIM1->CCER & TIM_CCER_CC4E))
+	{
+		return;
+	}
+	Rising = (Idr & GPIO_Pin_11) ? 1 : 0;
+	if(Rising == ((TIM1->CCER & TIM_CCER_CC4P) ? 1 : 0))
+	{
+		return;
+	}
+
+	Sim_TIM_Count(TIM1, Sim_TIM1Start);
+	TIM1->CCR4 = TIM1->CNT;
+	TIM1->SR |= TIM_FLAG_CC4;
+}
+
+// TIM1/TIM2 run free from TIM_Cmd, the wraps are timed
+static void Sim_TIM_Run(TIM_TypeDef* TIMx, unsigned long long *pStart, unsigned long long *pNext)
+{
+	if(TIMx->Enable)
+	{
+		if(*pNext == SIM_TIME_NEVER)
+		{
+			*pStart = Sim_Time;
+			*pNext = Sim_Time + Sim_TIM_Period(TIMx);
+		}
+	}
+	else
+	{
+		*pNext = SIM_TIME_NEVER;
+	}
+}
+
+static void Sim_TIM_Update(TIM_TypeDef* TIMx)
+{
+	if(TIMx == TIM1)
+	{
+		Sim_TIM_Run(TIM1, &Sim_TIM1Start, &Sim_TIM1Next);
+		return;
+	}
+	if(TIMx == TIM2)
+	{
+		Sim_TIM_Run(TIM2, &Sim_TIM2Start, &Sim_TIM2Next);
+		return;
+	}
+	if(TIMx != TIM4)
+	{
+		return;
+	}
+
+	if(TIMx->Enable && (TIMx->ITMask & TIM_IT_Update))
+	{
+		if(Sim_TIM4Next == SIM_TIME_NEVER)
+		{
+			Sim_TIM4Start = Sim_Time;
+			Sim_TIM4Next = Sim_Time + Sim_TIM_Period(TIM4);
+		}
+	}
+	else
+	{
+		Sim_TIM4Next = SIM_TIME_NEVER;
+	}
+}
+
+void TIM_DeInit(TIM_TypeDef* TIMx)
+{
+	memset(TIMx, 0, sizeof(TIM_TypeDef));
+	Sim_TIM_Update(TIMx);
+}
+
+void TIM_TimeBaseInit(TIM_TypeDef* TIMx, TIM_TimeBaseInitTypeDef* TIM_TimeBaseInitStruct)
+{
+	TIMx->PSC = TIM_TimeBaseInitStruct->TIM_Prescaler;
+	TIMx->ARR = TIM_TimeBaseInitStruct->TIM_Period;
+}
+
+void TIM_OC1Init(TIM_TypeDef* TIMx, TIM_OCInitTypeDef* TIM_OCInitStruct)
+{
+	TIMx->CCR1 = TIM_OCInitStruct->TIM_Pulse;
+}
+
+void TIM_OC1PreloadConfig(TIM_TypeDef* TIMx, uint16_t TIM_OCPreload)
+{
+	(void)TIMx;
+	(void)TIM_OCPreload;
+}
+
+// channel 4 only(Hal_RFD), filter and prescaler not modelled
+void TIM_ICInit(TIM_TypeDef* TIMx, TIM_ICInitTypeDef* TIM_ICInitStruct)
+{
+	if(TIM_ICInitStruct->TIM_Channel != TIM_Channel_4)
+	{
+		return;
+	}
+	TIMx->CCER &= ~(TIM_CCER_CC4E | TIM_CCER_CC4P);
+	TIMx->CCER |= TIM_CCER_CC4E;
+	if(TIM_ICInitStruct->TIM_ICPolarity == TIM_ICPolarity_Falling)
+	{
+		TIMx->CCER |= TIM_CCER_CC4P;
+	}
+}
+
+void TIM_Cmd(TIM_TypeDef* TIMx, FunctionalState NewState)
+{
+	TIMx->Enable = (NewState != DISABLE);
+	Sim_TIM_Update(TIMx);
+}
+
+void TIM_ITConfig(TIM_TypeDef* TIMx, uint16_t TIM_IT, FunctionalState NewState)
+{
+	if(NewState != DISABLE)
+	{
+		TIMx->ITMask |= TIM_IT;
+	}
+	else
+	{
+		TIMx->ITMask &= ~TIM_IT;
+	}
+	Sim_TIM_Update(TIMx);
+}
+
+void TIM_ClearFlag(TIM_TypeDef* TIMx, uint16_t TIM_FLAG)
+{
+	TIMx->SR &= ~TIM_FLAG;
+}
+
+void TIM_SetCounter(TIM_TypeDef* TIMx, uint16_t Counter)
+{
+	TIMx->CNT = Counter;
+	Sim_TIM_Rebase(TIMx);
+}
+
+// TIM_PSCReloadMode_Update(new prescaler at the next update) is taken at once as well
+void TIM_PrescalerConfig(TIM_TypeDef* TIMx, uint16_t Prescaler, uint16_t TIM_PSCReloadMode)
+{
+	TIMx->PSC = Prescaler;
+	if(TIM_PSCReloadMode == TIM_PSCReloadMode_Immediate)
+	{
+		// UG: counter cleared, update flag unless URS
+		TIMx->CNT = 0;
+		if(!TIMx->UpdateRegular)
+		{
+			TIMx->SR |= TIM_FLAG_Update;
+		}
+	}
+	Sim_TIM_Rebase(TIMx);
+}
+
+void TIM_UpdateRequestConfig(TIM_TypeDef* TIMx, uint16_t TIM_UpdateSource)
+{
+	TIMx->UpdateRegular = (TIM_UpdateSource == TIM_UpdateSource_Regular);
+}
+
+void TIM_SetAutoreload(TIM_TypeDef* TIMx, uint16_t Autoreload)
+{
+	TIMx->ARR = Autoreload;
+}
+
+void TIM_SetCompare1(TIM_TypeDef* TIMx, uint16_t Compare1)
+{
+	TIMx->CCR1 = Compare1;
+}
+
+
+/*-------------------------- USART -------------------------------------------*/
+static Sim_USARTTypeDef *Sim_USART_Get(USART_TypeDef *USARTx)
+{
+	return (USARTx == USART1) ? &Sim_Usart[0] : &Sim_Usart[1];
+}
+
+// USART1 on APB2(HCLK), USART2 on APB1
+static unsigned long Sim_USART_Pclk(USART_TypeDef *USARTx)
+{
+	return (USARTx == USART1) ? Sim_RCC_Hclk() : Sim_RCC_Pclk1();
+}
+
+static unsigned long long Sim_USART_ByteTime(USART_TypeDef *USARTx)
+{
+	unsigned long Baud;
+
+	if(!USARTx->BRR)
+	{
+		return (10 * SIM_NS_PER_S) / 9600;
+	}
+
+	// the line runs at APB clock / BRR: counted when the other side(configured baudrate) is more than 3% off
+	Baud = Sim_USART_Pclk(USARTx) / USARTx->BRR;
+	if((Baud > USARTx->BaudRate + USARTx->BaudRate / 33) || (Baud < USARTx->BaudRate - USARTx->BaudRate / 33))
+	{
+		Sim_Stat.UartBaudErr++;
+	}
+
+	// start + 8 data + stop bits
+	return (10 * SIM_NS_PER_S) / Baud;
+}
+
+// IT mask bit of USART_IT_xxx: bit position in the low 5 bits
+static uint16_t Sim_USART_ITBit(uint16_t USART_IT)
+{
+	return (uint16_t)(1 << (USART_IT & 0x1F));
+}
+
+void USART_Init(USART_TypeDef* USARTx, USART_InitTypeDef* USART_InitStruct)
+{
+	USARTx->BaudRate = USART_InitStruct->USART_BaudRate;
+	USARTx->BRR = (uint16_t)((Sim_USART_Pclk(USARTx) + USARTx->BaudRate / 2) / USARTx->BaudRate);
+}
+
+void USART_Cmd(USART_TypeDef* USARTx, FunctionalState NewState)
+{
+	USARTx->Enable = (NewState != DISABLE);
+}
+
+void USART_ITConfig(USART_TypeDef* USARTx, uint16_t USART_IT, FunctionalState NewState)
+{
+	if(NewState != DISABLE)
+	{
+		USARTx->ITMask |= Sim_USART_ITBit(USART_IT);
+	}
+	else
+	{
+		USARTx->ITMask &= ~Sim_USART_ITBit(USART_IT);
+	}
+}
+
+void USART_SendData(USART_TypeDef* USARTx, uint16_t Data)
+{
+	Sim_USARTTypeDef *pUsart;
+
+	USARTx->DR = Data & 0xFF;
+
+	if(USARTx == USART1)
+	{
+		Sim_Stat.Uart1Tx++;
+		if(Sim_Uart1Out)
+		{
+			fputc(Data & 0xFF, Sim_Uart1Out);
+		}
+
+		// TXE again after the byte time
+		pUsart = Sim_USART_Get(USARTx);
+		pUsart->TxDone = ((pUsart->TxDone > Sim_Time) ? pUsart->TxDone : Sim_Time) + Sim_USART_ByteTime(USARTx);
+		USARTx->SR &= ~(USART_FLAG_TXE | USART_FLAG_TC);
+	}
+	else
+	{
+		// polled by the driver: sent in zero time
+		Sim_Stat.Uart2Tx++;
+	}
+}
+
+uint16_t USART_ReceiveData(USART_TypeDef* USARTx)
+{
+	USARTx->SR &= ~USART_FLAG_RXNE;
+	return USARTx->RxData;
+}
+
+// a driver polling for TX empty spins until the byte is out: the clock runs on
+FlagStatus USART_GetFlagStatus(USART_TypeDef* USARTx, uint16_t USART_FLAG)
+{
+	if(!(USARTx->SR & USART_FLAG) && (USART_FLAG & (USART_FLAG_TXE | USART_FLAG_TC)))
+	{
+		Sim_Clock_Step();
+	}
+	return (USARTx->SR & USART_FLAG) ? SET : RESET;
+}
+
+ITStatus USART_GetITStatus(USART_TypeDef* USARTx, uint16_t USART_IT)
+{
+	uint16_t Flag;
+
+	if(!(USARTx->ITMask & Sim_USART_ITBit(USART_IT)))
+	{
+		return RESET;
+	}
+
+	// flag bit position in the high byte of USART_IT_xxx
+	Flag = (uint16_t)(1 << (USART_IT >> 8));
+	return (USARTx->SR & Flag) ? SET : RESET;
+}
+
+void USART_ClearITPendingBit(USART_TypeDef* USARTx, uint16_t USART_IT)
+{
+	USARTx->SR &= ~(uint16_t)(1 << (USART_IT >> 8));
+}
+
+
+/*-------------------------- SPI(SSD1306) ------------------------------------*/
+void SPI_Init(SPI_TypeDef* SPIx, SPI_InitTypeDef* SPI_InitStruct)
+{
+	(void)SPIx;
+	(void)SPI_InitStruct;
+}
+
+void SPI_Cmd(SPI_TypeDef* SPIx, FunctionalState NewState)
+{
+	SPIx->Enable = (NewState != DISABLE);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Sim_SPI_Transfer(SPIx)
+@Function	: SSD1306 on SPI1: DC high: GRAM data, DC low: command
+		--> page addressing: 0xB0~0xB7 page, 0x00~0x0F/0x10~0x1F column
+		--> argument byte of the 2 byte commands is skipped
+------------------------------------------------------------------------------*/
+void Sim_SPI_Transfer(SPI_TypeDef* SPIx)
+{
+	unsigned char Dat;
+
+	Dat = SPIx->DR & 0xFF;
+	Sim_Stat.SpiBytes++;
+
+	if(OLED_CMD_PORT->ODR & OLED_CMD_PIN)
+	{
+		Sim_OledFb[Sim_OledPage][Sim_OledColumn] = Dat;
+		Sim_OledColumn = (Sim_OledColumn + 1) % SIM_OLED_COLUMNS;
+		return;
+	}
+
+	if(Sim_OledArgSkip)
+	{
+		Sim_OledArgSkip = 0;
+		return;
+	}
+
+	if((Dat >= 0xB0) && (Dat <= 0xB7))
+	{
+		Sim_OledPage = Dat - 0xB0;
+		if(Sim_OledPage == 0)
+		{
+			Sim_Stat.OledRefresh++;
+		}
+	}
+	else if(Dat <= 0x0F)
+	{
+		Sim_OledColumn = (Sim_OledColumn & 0xF0) | Dat;
+	}
+	else if(Dat <= 0x1F)
+	{
+		Sim_OledColumn = ((Dat & 0x07) << 4) | (Sim_OledColumn & 0x0F);
+	}
+	else
+	{
+		switch(Dat)
+		{
+			case 0x20:
+			case 0x81:
+			case 0x8D:
+			case 0xA8:
+			case 0xD3:
+			case 0xD5:
+			case 0xD9:
+			case 0xDA:
+			case 0xDB:
+				Sim_OledArgSkip = 1;
+			break;
+
+			default:
+			break;
+		}
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef __SIM_PERIPH_H_
+#define __SIM_PERIPH_H_
+
+/*------------------------------------------------------------------------------------------
+  Host simulation: virtual clock and peripheral models behind the StdPeriph stand-in
+  	(1) time only passes in the OS idle call-back(Sim_Clock_Step), tasks take no virtual time
+  	(2) every step runs to the next peripheral event: SysTick, TIM1/TIM2/TIM4 update, USART byte
+  	(3) the clock tree(HSE/PLL, APB1 prescaler) sets the timer counts and the USART byte times
+  	(4) the stimulus call-back drives the input pins before the interrupts of the step,
+  	    Sim_Clock_Event asks for a step at its next input change(TIM1 edge capture)
+  	(5) STOP(PWR_EnterSTOPMode) runs the clock to a wake-up line or the RTC alarm with
+  	    every counter but the RTC standing still, SysTick resumed by Sim_Clock_TickResume
+------------------------------------------------------------------------------------------*/
+#define SIM_NS_PER_US			1000ULL
+#define SIM_NS_PER_MS			1000000ULL
+#define SIM_NS_PER_S			1000000000ULL
+
+#define SIM_HSE_CLK				8000000UL		// HSE crystal
+#define SIM_PLL_CLK				72000000UL		// PLL output(HSE x9)
+#define SIM_LSI_CLK				37000UL			// LSI of this part(typ 40kHz, 30~60kHz)
+#define SIM_EEPROM_SIZE			16384			// AT24C128
+#define SIM_EEPROM_PAGE			64
+#define SIM_USART_RX_SIZE		1024			// bytes waiting to be received per USART
+
+// stimulus call-back: set input pins and feed the USARTs for the time Now(ns)
+typedef void (*Sim_Stimulus_t)(unsigned long long Now);
+
+typedef struct
+{
+	unsigned long SpiBytes;			// bytes sent to the OLED panel
+	unsigned long OledRefresh;		// full GRAM transfers(page 0 selected)
+	unsigned long EepromRead;		// bytes read from EEPROM
+	unsigned long EepromWrite;		// bytes written to EEPROM
+	unsigned long Uart1Tx;			// debug USART bytes sent
+	unsigned long Uart2Tx;			// NB-IoT USART bytes sent
+	unsigned long UartRxDrop;		// bytes lost: USART not enabled or receive buffer full
+	unsigned long UartBaudErr;		// bytes sent/received with a BRR more than 3% off the baudrate
+	unsigned long ClockSwitch;		// SYSCLK source changes
+	unsigned long ClockErr;			// clock tree out of its limits(PLL/HSE off, flash wait states, APB1 > 36MHz)
+	unsigned long StopCount;		// STOP entered
+	unsigned long long StopNs;		// time in STOP
+	unsigned long StopRxDrop;		// USART bytes arriving in STOP(no receiver clock)
+	unsigned long RtcAlarmWrite;	// RTC alarm writes
+	unsigned long RtcStale;			// RTC counter read after STOP before the resynchronisation
+}Sim_StatTypeDef;
+
+extern unsigned long long Sim_Time;		// virtual time(ns)
+extern unsigned char Sim_CPU_HostCycle;	// cycle counter: 1: host clock(-c), 0: virtual time
+extern Sim_StatTypeDef Sim_Stat;
+
+void Sim_Periph_Init(const char *pEepromFile, FILE *pUart1Out);
+void Sim_StimulusRegister(Sim_Stimulus_t pStimulus);
+void Sim_Clock_SetTick(unsigned long long Period, void (*pHandler)(void));
+void Sim_Clock_Event(unsigned long long When);
+void Sim_Clock_Step(void);
+unsigned long long Sim_Clock_TickLeft(void);
+unsigned short Sim_Clock_TickResume(unsigned long long Left, unsigned long Us);
+
+void Sim_GPIO_SetInput(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, unsigned char Level);
+void Sim_USART_RxInput(USART_TypeDef *USARTx, const unsigned char *pData, unsigned int Len);
+void Sim_OLED_Dump(FILE *fp);
+
+#endif
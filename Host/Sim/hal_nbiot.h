@@ -0,0 +1,64 @@
+#ifndef __HAL_NBIOT_H_
+#define __HAL_NBIOT_H_
+
+/*------------------------------------------------------------------------------------------
+  Host simulation: stand-in of the NB-IoT module interface used by App and main
+  	--> the module driver is not part of this tree, Sim_NBIOT.c implements the interface:
+  		uplinks are counted, server messages are injected by the simulation script
+------------------------------------------------------------------------------------------*/
+
+// module work state(NBIOT_CONNECT_STATE)
+typedef enum
+{
+	NBIOT_STA_INIT = 0,
+	NBIOT_SATE_GET_SIM,
+	NBIOT_SATE_CONN_ONENET,
+}en_NBIot_WORK_STATE;
+
+// signal level(App display)
+typedef enum
+{
+	NBIOT_CSQL_0 = 0,
+	NBIOT_CSQL_1,
+	NBIOT_CSQL_2,
+	NBIOT_CSQL_3,
+	NBIOT_CSQL_4,
+	NBIOT_CSQL_UNKUOW,
+}en_NBIot_CSQ_LEVEL;
+
+// messages from the module to App
+typedef enum
+{
+	NBIOT_HOST_STATE = 0,		// pData[0]: ONENET_DOWNDATA_OPER_xxx
+	NBIOT_TIME,					// pData[0~5]: year-2000, month, day, hour, minute, second
+	NBIOT_CONNECT_STATE,		// pData[0]: en_NBIot_WORK_STATE
+	NBIOT_CSQ,					// pData[0]: CSQ(0~31, 99: unknown)
+}en_NBIot_MSG_TYPE;
+
+// server operations(NBIOT_HOST_STATE)
+typedef enum
+{
+	ONENET_DOWNDATA_OPER_AWAYARM = 0,
+	ONENET_DOWNDATA_OPER_HOMEARM,
+	ONENET_DOWNDATA_OPER_DISARM,
+}en_OneNet_DOWNDATA_OPER;
+
+// uplink list: system modes and sensor IDs are queued as they are, alarm tags above them
+typedef enum
+{
+	UPDATA_ALARMINFO_REMOTE = 0x40,
+	UPDATA_ALARMINFO_DOOR,
+}En_OneNetUpDatList;
+
+typedef void (*NBIot_ServerEvent_t)(en_NBIot_MSG_TYPE type, unsigned char *pData);
+
+void Hal_NBIOT_Init(void);
+void Hal_NBIOT_Pro(void);
+void ServerEventCBFRegister(NBIot_ServerEvent_t pCBF);
+void OneNet_UpEventQueue(En_OneNetUpDatList Event);
+
+// simulation hooks
+void Sim_NBIOT_ServerEvent(en_NBIot_MSG_TYPE type, unsigned char *pData);
+unsigned long Sim_NBIOT_GetUplinkCount(void);
+
+#endif
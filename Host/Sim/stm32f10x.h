@@ -0,0 +1,453 @@
+/************************************************************************
+* Module: stm32f10x.h(host simulation)
+* Function: stand-in of the device header for the Linux simulation build:
+*		@ peripheral types, instances and StdPeriph constants used by Src/Hal
+*		@ StdPeriph driver prototypes, implemented by the models in Sim_Periph.c
+* Description:
+*		@ only what the HAL modules use is declared: a missing name is a
+*		  compile error in the simulation build, add it here and in Sim_Periph.c
+*		@ registers are plain memory: the peripheral models act on the
+*		  StdPeriph calls, not on register writes
+*************************************************************************/
+#ifndef __STM32F10X_SIM_H_
+#define __STM32F10X_SIM_H_
+
+#include <stdint.h>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+typedef enum {RESET = 0, SET = !RESET} FlagStatus, ITStatus;
+typedef enum {DISABLE = 0, ENABLE = !DISABLE} FunctionalState;
+typedef enum {Bit_RESET = 0, Bit_SET} BitAction;
+
+extern uint32_t SystemCoreClock;
+
+void SystemCoreClockUpdate(void);
+
+/*----------------------------- Peripherals ----------------------------------*/
+typedef struct
+{
+	volatile uint32_t CRL;
+	volatile uint32_t CRH;
+	volatile uint32_t IDR;			// pin levels(external level of inputs, ODR of outputs)
+	volatile uint32_t ODR;
+	uint32_t OutMask;				// sim: pins configured as output
+	uint32_t ExtLevel;				// sim: levels driven from outside(pull-up: 1)
+}GPIO_TypeDef;
+
+typedef struct
+{
+	volatile uint16_t SR;
+	volatile uint16_t DR;
+	volatile uint16_t BRR;			// sim: APB clock / baud rate at USART_Init
+	uint16_t ITMask;				// sim: enabled interrupts(USART_IT_xxx)
+	uint16_t RxData;				// sim: last received byte
+	uint32_t BaudRate;				// sim: from USART_Init
+	uint8_t Enable;
+}USART_TypeDef;
+
+typedef struct
+{
+	volatile uint16_t SR;			// sim: flags of TIM1/TIM2(rc_w0: applied after the handler)
+	volatile uint16_t CCER;
+	volatile uint16_t CNT;
+	volatile uint16_t PSC;
+	volatile uint16_t ARR;
+	volatile uint16_t CCR1;
+	volatile uint16_t CCR4;
+	uint16_t ITMask;				// sim: enabled interrupts(TIM_IT_xxx)
+	uint8_t Enable;
+	uint8_t UpdateRegular;			// sim: TIM_UpdateSource_Regular(UG sets no update flag)
+}TIM_TypeDef;
+
+typedef struct
+{
+	volatile uint16_t SR;
+	volatile uint16_t DR;
+	uint8_t Enable;
+}SPI_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t IMR;
+	volatile uint32_t EMR;
+	volatile uint32_t RTSR;
+	volatile uint32_t FTSR;
+	volatile uint32_t SWIER;
+	volatile uint32_t PR;			// sim: rc_w1, cleared by EXTI_ClearITPendingBit only
+}EXTI_TypeDef;
+
+typedef struct
+{
+	volatile uint32_t BDCR;			// sim: RTCSEL and RTCEN only
+}RCC_TypeDef;
+
+extern GPIO_TypeDef Sim_GPIOA, Sim_GPIOB, Sim_GPIOC;
+extern USART_TypeDef Sim_USART1, Sim_USART2;
+extern TIM_TypeDef Sim_TIM1, Sim_TIM2, Sim_TIM3, Sim_TIM4;
+extern SPI_TypeDef Sim_SPI1;
+extern EXTI_TypeDef Sim_EXTI;
+extern RCC_TypeDef Sim_RCC;
+
+#define GPIOA				(&Sim_GPIOA)
+#define GPIOB				(&Sim_GPIOB)
+#define GPIOC				(&Sim_GPIOC)
+#define USART1				(&Sim_USART1)
+#define USART2				(&Sim_USART2)
+#define TIM1				(&Sim_TIM1)
+#define TIM2				(&Sim_TIM2)
+#define TIM3				(&Sim_TIM3)
+#define TIM4				(&Sim_TIM4)
+#define SPI1				(&Sim_SPI1)
+#define EXTI				(&Sim_EXTI)
+#define RCC					(&Sim_RCC)
+
+typedef enum
+{
+	EXTI3_IRQn = 9,
+	CAN1_RX1_IRQn = 21,
+	CAN1_SCE_IRQn = 22,
+	EXTI9_5_IRQn = 23,
+	TIM1_UP_IRQn = 25,
+	TIM1_CC_IRQn = 27,
+	TIM2_IRQn = 28,
+	TIM4_IRQn = 30,
+	SPI1_IRQn = 35,
+	USART1_IRQn = 37,
+	USART2_IRQn = 38,
+	EXTI15_10_IRQn = 40,
+	RTCAlarm_IRQn = 41,
+}IRQn_Type;
+
+/*----------------------------- RCC ------------------------------------------*/
+#define RCC_APB2Periph_AFIO			0x00000001
+#define RCC_APB2Periph_GPIOA		0x00000004
+#define RCC_APB2Periph_GPIOB		0x00000008
+#define RCC_APB2Periph_GPIOC		0x00000010
+#define RCC_APB2Periph_TIM1			0x00000800
+#define RCC_APB2Periph_SPI1			0x00001000
+#define RCC_APB2Periph_USART1		0x00004000
+#define RCC_APB1Periph_TIM2			0x00000001
+#define RCC_APB1Periph_TIM3			0x00000002
+#define RCC_APB1Periph_TIM4			0x00000004
+#define RCC_APB1Periph_USART2		0x00020000
+#define RCC_APB1Periph_BKP			0x08000000
+#define RCC_APB1Periph_PWR			0x10000000
+
+#define RCC_SYSCLKSource_HSI		((uint32_t)0x00000000)
+#define RCC_SYSCLKSource_HSE		((uint32_t)0x00000001)
+#define RCC_SYSCLKSource_PLLCLK		((uint32_t)0x00000002)
+#define RCC_HCLK_Div1				((uint32_t)0x00000000)
+#define RCC_HCLK_Div2				((uint32_t)0x00000400)
+#define RCC_FLAG_HSERDY				((uint8_t)0x31)
+#define RCC_FLAG_PLLRDY				((uint8_t)0x39)
+#define RCC_FLAG_LSIRDY				((uint8_t)0x61)
+#define RCC_HSE_OFF					((uint32_t)0x00000000)
+#define RCC_HSE_ON					((uint32_t)0x00010000)
+#define HSE_STARTUP_TIMEOUT			((uint16_t)0x0500)
+#define RCC_RTCCLKSource_LSI		((uint32_t)0x00000200)
+#define RCC_BDCR_RTCSEL				((uint32_t)0x00000300)
+#define RCC_BDCR_RTCSEL_LSI			((uint32_t)0x00000200)
+#define RCC_BDCR_RTCEN				((uint32_t)0x00008000)
+
+void RCC_APB2PeriphClockCmd(uint32_t RCC_APB2Periph, FunctionalState NewState);
+void RCC_APB1PeriphClockCmd(uint32_t RCC_APB1Periph, FunctionalState NewState);
+void RCC_PLLCmd(FunctionalState NewState);
+FlagStatus RCC_GetFlagStatus(uint8_t RCC_FLAG);
+void RCC_SYSCLKConfig(uint32_t RCC_SYSCLKSource);
+uint8_t RCC_GetSYSCLKSource(void);
+void RCC_PCLK1Config(uint32_t RCC_HCLK);
+void RCC_HSEConfig(uint32_t RCC_HSE);
+void RCC_LSICmd(FunctionalState NewState);
+void RCC_RTCCLKConfig(uint32_t RCC_RTCCLKSource);
+void RCC_RTCCLKCmd(FunctionalState NewState);
+void RCC_BackupResetCmd(FunctionalState NewState);
+
+/*----------------------------- PWR / RTC ------------------------------------*/
+#define PWR_Regulator_LowPower		((uint32_t)0x00000001)
+#define PWR_STOPEntry_WFI			((uint8_t)0x01)
+#define RTC_FLAG_ALR				((uint16_t)0x0002)
+#define BKP_DR1						((uint16_t)0x0004)
+
+void PWR_BackupAccessCmd(FunctionalState NewState);
+void PWR_EnterSTOPMode(uint32_t PWR_Regulator, uint8_t PWR_STOPEntry);
+void RTC_WaitForSynchro(void);
+void RTC_WaitForLastTask(void);
+void RTC_SetPrescaler(uint32_t PrescalerValue);
+uint32_t RTC_GetCounter(void);
+void RTC_SetAlarm(uint32_t AlarmValue);
+void RTC_ClearFlag(uint16_t RTC_FLAG);
+uint16_t BKP_ReadBackupRegister(uint16_t BKP_DR);
+void BKP_WriteBackupRegister(uint16_t BKP_DR, uint16_t Data);
+
+/*----------------------------- EXTI -----------------------------------------*/
+#define EXTI_Line3					((uint32_t)0x00008)
+#define EXTI_Line5					((uint32_t)0x00020)
+#define EXTI_Line6					((uint32_t)0x00040)
+#define EXTI_Line7					((uint32_t)0x00080)
+#define EXTI_Line10					((uint32_t)0x00400)
+#define EXTI_Line11					((uint32_t)0x00800)
+#define EXTI_Line17					((uint32_t)0x20000)		// RTC alarm
+
+typedef enum
+{
+	EXTI_Mode_Interrupt = 0x00,
+	EXTI_Mode_Event = 0x04
+}EXTIMode_TypeDef;
+
+typedef enum
+{
+	EXTI_Trigger_Rising = 0x08,
+	EXTI_Trigger_Falling = 0x0C,
+	EXTI_Trigger_Rising_Falling = 0x10
+}EXTITrigger_TypeDef;
+
+typedef struct
+{
+	uint32_t EXTI_Line;
+	EXTIMode_TypeDef EXTI_Mode;
+	EXTITrigger_TypeDef EXTI_Trigger;
+	FunctionalState EXTI_LineCmd;
+}EXTI_InitTypeDef;
+
+void EXTI_Init(EXTI_InitTypeDef* EXTI_InitStruct);
+void EXTI_ClearITPendingBit(uint32_t EXTI_Line);
+
+/*----------------------------- FLASH ----------------------------------------*/
+#define FLASH_Latency_0				((uint32_t)0x00000000)
+#define FLASH_Latency_1				((uint32_t)0x00000001)
+#define FLASH_Latency_2				((uint32_t)0x00000002)
+
+void FLASH_SetLatency(uint32_t FLASH_Latency);
+
+/*----------------------------- GPIO -----------------------------------------*/
+#define GPIO_Pin_0					((uint16_t)0x0001)
+#define GPIO_Pin_1					((uint16_t)0x0002)
+#define GPIO_Pin_2					((uint16_t)0x0004)
+#define GPIO_Pin_3					((uint16_t)0x0008)
+#define GPIO_Pin_4					((uint16_t)0x0010)
+#define GPIO_Pin_5					((uint16_t)0x0020)
+#define GPIO_Pin_6					((uint16_t)0x0040)
+#define GPIO_Pin_7					((uint16_t)0x0080)
+#define GPIO_Pin_8					((uint16_t)0x0100)
+#define GPIO_Pin_9					((uint16_t)0x0200)
+#define GPIO_Pin_10					((uint16_t)0x0400)
+#define GPIO_Pin_11					((uint16_t)0x0800)
+#define GPIO_Pin_12					((uint16_t)0x1000)
+#define GPIO_Pin_13					((uint16_t)0x2000)
+#define GPIO_Pin_14					((uint16_t)0x4000)
+#define GPIO_Pin_15					((uint16_t)0x8000)
+#define GPIO_Pin_All				((uint16_t)0xFFFF)
+
+typedef enum
+{
+	GPIO_Speed_10MHz = 1,
+	GPIO_Speed_2MHz,
+	GPIO_Speed_50MHz
+}GPIOSpeed_TypeDef;
+
+typedef enum
+{
+	GPIO_Mode_AIN = 0x0,
+	GPIO_Mode_IN_FLOATING = 0x04,
+	GPIO_Mode_IPD = 0x28,
+	GPIO_Mode_IPU = 0x48,
+	GPIO_Mode_Out_OD = 0x14,
+	GPIO_Mode_Out_PP = 0x10,
+	GPIO_Mode_AF_OD = 0x1C,
+	GPIO_Mode_AF_PP = 0x18
+}GPIOMode_TypeDef;
+
+typedef struct
+{
+	uint16_t GPIO_Pin;
+	GPIOSpeed_TypeDef GPIO_Speed;
+	GPIOMode_TypeDef GPIO_Mode;
+}GPIO_InitTypeDef;
+
+#define GPIO_PortSourceGPIOA		((uint8_t)0x00)
+#define GPIO_PortSourceGPIOB		((uint8_t)0x01)
+#define GPIO_PinSource3				((uint8_t)0x03)
+#define GPIO_PinSource5				((uint8_t)0x05)
+#define GPIO_PinSource6				((uint8_t)0x06)
+#define GPIO_PinSource7				((uint8_t)0x07)
+#define GPIO_PinSource10			((uint8_t)0x0A)
+#define GPIO_PinSource11			((uint8_t)0x0B)
+
+#define GPIO_PartialRemap_TIM3		((uint32_t)0x001A0800)
+#define GPIO_Remap_SWJ_JTAGDisable	((uint32_t)0x00300200)
+
+void GPIO_Init(GPIO_TypeDef* GPIOx, GPIO_InitTypeDef* GPIO_InitStruct);
+uint8_t GPIO_ReadInputDataBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+void GPIO_SetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+void GPIO_ResetBits(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin);
+void GPIO_WriteBit(GPIO_TypeDef* GPIOx, uint16_t GPIO_Pin, BitAction BitVal);
+void GPIO_PinRemapConfig(uint32_t GPIO_Remap, FunctionalState NewState);
+void GPIO_EXTILineConfig(uint8_t GPIO_PortSource, uint8_t GPIO_PinSource);
+
+/*----------------------------- Core -----------------------------------------*/
+// interrupts are only taken in Sim_Clock_Step: masking has nothing to hold off,
+// waiting for an interrupt runs the virtual clock to the next event
+#define __disable_irq()
+#define __enable_irq()
+#define __get_PRIMASK()				0
+#define __set_PRIMASK(x)			((void)(x))
+#define __WFI()						Sim_Clock_Step()
+
+void Sim_Clock_Step(void);
+
+/*----------------------------- NVIC -----------------------------------------*/
+#define NVIC_PriorityGroup_0		((uint32_t)0x700)
+#define NVIC_PriorityGroup_4		((uint32_t)0x300)
+
+typedef struct
+{
+	uint8_t NVIC_IRQChannel;
+	uint8_t NVIC_IRQChannelPreemptionPriority;
+	uint8_t NVIC_IRQChannelSubPriority;
+	FunctionalState NVIC_IRQChannelCmd;
+}NVIC_InitTypeDef;
+
+void NVIC_PriorityGroupConfig(uint32_t NVIC_PriorityGroup);
+void NVIC_Init(NVIC_InitTypeDef* NVIC_InitStruct);
+void NVIC_SetPendingIRQ(IRQn_Type IRQn);
+void NVIC_ClearPendingIRQ(IRQn_Type IRQn);
+
+/*----------------------------- TIM ------------------------------------------*/
+#define TIM_CKD_DIV1				((uint16_t)0x0000)
+#define TIM_CounterMode_Up			((uint16_t)0x0000)
+#define TIM_OCMode_PWM1				((uint16_t)0x0060)
+#define TIM_OCMode_PWM2				((uint16_t)0x0070)
+#define TIM_OutputState_Enable		((uint16_t)0x0001)
+#define TIM_OCPolarity_High			((uint16_t)0x0000)
+#define TIM_OCPreload_Enable		((uint16_t)0x0008)
+#define TIM_IT_Update				((uint16_t)0x0001)
+#define TIM_IT_CC4					((uint16_t)0x0010)
+#define TIM_FLAG_Update				((uint16_t)0x0001)
+#define TIM_FLAG_CC4				((uint16_t)0x0010)
+#define TIM_Channel_4				((uint16_t)0x000C)
+#define TIM_ICPolarity_Rising		((uint16_t)0x0000)
+#define TIM_ICPolarity_Falling		((uint16_t)0x0002)
+#define TIM_ICSelection_DirectTI	((uint16_t)0x0001)
+#define TIM_ICPSC_DIV1				((uint16_t)0x0000)
+#define TIM_CCER_CC4E				((uint16_t)0x1000)
+#define TIM_CCER_CC4P				((uint16_t)0x2000)
+#define TIM_PSCReloadMode_Update	((uint16_t)0x0000)
+#define TIM_PSCReloadMode_Immediate	((uint16_t)0x0001)
+#define TIM_UpdateSource_Global		((uint16_t)0x0000)
+#define TIM_UpdateSource_Regular	((uint16_t)0x0001)
+
+typedef struct
+{
+	uint16_t TIM_Prescaler;
+	uint16_t TIM_CounterMode;
+	uint16_t TIM_Period;
+	uint16_t TIM_ClockDivision;
+	uint8_t TIM_RepetitionCounter;
+}TIM_TimeBaseInitTypeDef;
+
+typedef struct
+{
+	uint16_t TIM_OCMode;
+	uint16_t TIM_OutputState;
+	uint16_t TIM_OutputNState;
+	uint16_t TIM_Pulse;
+	uint16_t TIM_OCPolarity;
+	uint16_t TIM_OCNPolarity;
+	uint16_t TIM_OCIdleState;
+	uint16_t TIM_OCNIdleState;
+}TIM_OCInitTypeDef;
+
+typedef struct
+{
+	uint16_t TIM_Channel;
+	uint16_t TIM_ICPolarity;
+	uint16_t TIM_ICSelection;
+	uint16_t TIM_ICPrescaler;
+	uint16_t TIM_ICFilter;
+}TIM_ICInitTypeDef;
+
+void TIM_DeInit(TIM_TypeDef* TIMx);
+void TIM_TimeBaseInit(TIM_TypeDef* TIMx, TIM_TimeBaseInitTypeDef* TIM_TimeBaseInitStruct);
+void TIM_OC1Init(TIM_TypeDef* TIMx, TIM_OCInitTypeDef* TIM_OCInitStruct);
+void TIM_OC1PreloadConfig(TIM_TypeDef* TIMx, uint16_t TIM_OCPreload);
+void TIM_ICInit(TIM_TypeDef* TIMx, TIM_ICInitTypeDef* TIM_ICInitStruct);
+void TIM_Cmd(TIM_TypeDef* TIMx, FunctionalState NewState);
+void TIM_ITConfig(TIM_TypeDef* TIMx, uint16_t TIM_IT, FunctionalState NewState);
+void TIM_ClearFlag(TIM_TypeDef* TIMx, uint16_t TIM_FLAG);
+void TIM_SetCounter(TIM_TypeDef* TIMx, uint16_t Counter);
+void TIM_SetAutoreload(TIM_TypeDef* TIMx, uint16_t Autoreload);
+void TIM_SetCompare1(TIM_TypeDef* TIMx, uint16_t Compare1);
+void TIM_PrescalerConfig(TIM_TypeDef* TIMx, uint16_t Prescaler, uint16_t TIM_PSCReloadMode);
+void TIM_UpdateRequestConfig(TIM_TypeDef* TIMx, uint16_t TIM_UpdateSource);
+
+/*----------------------------- USART ----------------------------------------*/
+#define USART_WordLength_8b			((uint16_t)0x0000)
+#define USART_StopBits_1			((uint16_t)0x0000)
+#define USART_Parity_No				((uint16_t)0x0000)
+#define USART_Mode_Rx				((uint16_t)0x0004)
+#define USART_Mode_Tx				((uint16_t)0x0008)
+#define USART_HardwareFlowControl_None	((uint16_t)0x0000)
+
+#define USART_IT_TXE				((uint16_t)0x0727)
+#define USART_IT_TC					((uint16_t)0x0626)
+#define USART_IT_RXNE				((uint16_t)0x0525)
+
+#define USART_FLAG_TXE				((uint16_t)0x0080)
+#define USART_FLAG_TC				((uint16_t)0x0040)
+#define USART_FLAG_RXNE				((uint16_t)0x0020)
+
+typedef struct
+{
+	uint32_t USART_BaudRate;
+	uint16_t USART_WordLength;
+	uint16_t USART_StopBits;
+	uint16_t USART_Parity;
+	uint16_t USART_Mode;
+	uint16_t USART_HardwareFlowControl;
+}USART_InitTypeDef;
+
+void USART_Init(USART_TypeDef* USARTx, USART_InitTypeDef* USART_InitStruct);
+void USART_Cmd(USART_TypeDef* USARTx, FunctionalState NewState);
+void USART_ITConfig(USART_TypeDef* USARTx, uint16_t USART_IT, FunctionalState NewState);
+void USART_SendData(USART_TypeDef* USARTx, uint16_t Data);
+uint16_t USART_ReceiveData(USART_TypeDef* USARTx);
+FlagStatus USART_GetFlagStatus(USART_TypeDef* USARTx, uint16_t USART_FLAG);
+ITStatus USART_GetITStatus(USART_TypeDef* USARTx, uint16_t USART_IT);
+void USART_ClearITPendingBit(USART_TypeDef* USARTx, uint16_t USART_IT);
+
+/*----------------------------- SPI ------------------------------------------*/
+#define SPI_Direction_1Line_Tx		((uint16_t)0xC000)
+#define SPI_Mode_Master				((uint16_t)0x0104)
+#define SPI_DataSize_8b				((uint16_t)0x0000)
+#define SPI_CPOL_High				((uint16_t)0x0002)
+#define SPI_CPHA_2Edge				((uint16_t)0x0001)
+#define SPI_NSS_Soft				((uint16_t)0x0200)
+#define SPI_BaudRatePrescaler_2		((uint16_t)0x0000)
+#define SPI_BaudRatePrescaler_8		((uint16_t)0x0010)
+#define SPI_FirstBit_MSB			((uint16_t)0x0000)
+
+// no bus cycles on the host: the byte written to DR is handed to the panel model
+// when the driver polls BSY after the write, BSY always reads back clear
+#define SPI_I2S_FLAG_BSY			((uint16_t)(Sim_SPI_Transfer(SPI1), 0x0080))
+
+typedef struct
+{
+	uint16_t SPI_Direction;
+	uint16_t SPI_Mode;
+	uint16_t SPI_DataSize;
+	uint16_t SPI_CPOL;
+	uint16_t SPI_CPHA;
+	uint16_t SPI_NSS;
+	uint16_t SPI_BaudRatePrescaler;
+	uint16_t SPI_FirstBit;
+	uint16_t SPI_CRCPolynomial;
+}SPI_InitTypeDef;
+
+void SPI_Init(SPI_TypeDef* SPIx, SPI_InitTypeDef* SPI_InitStruct);
+void SPI_Cmd(SPI_TypeDef* SPIx, FunctionalState NewState);
+void Sim_SPI_Transfer(SPI_TypeDef* SPIx);
+
+#endif
@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+"""
+RAM budget of the target image from the Keil(armlink) map file
+	(1) .data(RW) / .bss(ZI) per object and library member, largest first
+	(2) total against the RAM size of the part(STM32F103C8: 20KB)
+	(3) largest RAM data symbols
+
+usage: ram_budget.py [-r RAM_BYTES] [-n TOP] SecurityHost.map
+	the map file needs "Image component sizes" and "Image Symbol Table"
+	(Keil: Options for Target -> Listing -> Linker Listing, all boxes)
+"""
+
+import argparse
+import re
+import sys
+
+# armlink "Image component sizes" row: Code (inc. data) RO Data RW Data ZI Data Debug Object Name
+COMPONENT_ROW = re.compile(r"^\s*(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\d+)\s+(\S.*?)\s*$")
+# armlink "Image Symbol Table" row of a RAM data symbol: Name Value Ov Type Size Object(Section)
+SYMBOL_ROW = re.compile(r"^\s*(\S+)\s+(0x2[0-9a-fA-F]{7})\s+Data\s+(\d+)\s+(\S+)")
+
+
+def parse_components(lines):
+	"""(name, rw, zi) of every object and library member"""
+	modules = []
+	section = None
+
+	for line in lines:
+		if "Image component sizes" in line:
+			section = "object"
+			continue
+		if section is None:
+			continue
+		if "Library Member Name" in line:
+			section = "member"
+			continue
+		if "Library Name" in line:
+			section = "library"		# per library sums: members are already counted
+			continue
+		if "Grand Totals" in line:
+			break
+		row = COMPONENT_ROW.match(line)
+		if row is None or section == "library":
+			continue
+		name = row.group(7)
+		if name.startswith("Object Totals") or name.startswith("Library Totals") or name.startswith("(incl."):
+			continue
+		modules.append((name, int(row.group(4)), int(row.group(5))))
+	return modules
+
+
+def parse_symbols(lines):
+	"""(name, address, size, object) of every data symbol in RAM"""
+	symbols = []
+	in_table = False
+
+	for line in lines:
+		if "Image Symbol Table" in line:
+			in_table = True
+			continue
+		if not in_table:
+			continue
+		row = SYMBOL_ROW.match(line)
+		if row is not None:
+			symbols.append((row.group(1), int(row.group(2), 16), int(row.group(3)), row.group(4)))
+	return symbols
+
+
+def main():
+	parser = argparse.ArgumentParser(description="RAM budget per module from a Keil map file")
+	parser.add_argument("map", help="armlink map file")
+	parser.add_argument("-r", "--ram", type=lambda x: int(x, 0), default=0x5000, help="RAM size in bytes(default 0x5000)")
+	parser.add_argument("-n", "--top", type=int, default=10, help="largest RAM symbols listed(default 10)")
+	args = parser.parse_args()
+
+	with open(args.map, "r", errors="replace") as fp:
+		lines = fp.readlines()
+
+	modules = parse_components(lines)
+	if not modules:
+		sys.exit("ram_budget: no 'Image component sizes' in %s" % args.map)
+	modules.sort(key=lambda m: m[1] + m[2], reverse=True)
+
+	total_rw = sum(m[1] for m in modules)
+	total_zi = sum(m[2] for m in modules)
+
+	print("%-32s %8s %8s %8s" % ("Module", "RW", "ZI", "RAM"))
+	for name, rw, zi in modules:
+		if rw + zi:
+			print("%-32s %8u %8u %8u" % (name, rw, zi, rw + zi))
+	print("%-32s %8u %8u %8u" % ("Total", total_rw, total_zi, total_rw + total_zi))
+	print("RAM %u / %u bytes(%.1f%%), free %d" % (total_rw + total_zi, args.ram,
+		100.0 * (total_rw + total_zi) / args.ram, args.ram - total_rw - total_zi))
+
+	symbols = parse_symbols(lines)
+	if symbols:
+		symbols.sort(key=lambda s: s[2], reverse=True)
+		print("")
+		print("%-32s %10s %8s  %s" % ("Symbol", "Address", "Size", "Object"))
+		for name, addr, size, obj in symbols[:args.top]:
+			print("%-32s 0x%08x %8u  %s" % (name, addr, size, obj))
+	return 0
+
+
+if __name__ == "__main__":
+	sys.exit(main())
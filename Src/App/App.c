@@ -8,9 +8,25 @@
 #include "hal_i2c_eeprom.h"
 #include "hal_beep.h"
 #include "hal_nbiot.h"
+#include "hal_time.h"
+#include "hal_clock.h"
+#include "hal_power.h"
 #include "os_system.h"
+#include "os_pt.h"
+
+// screen arena: working memory of the active menu screen, sized for the largest one(detector list)
+#define APP_ARENA_ALIGN(x)	(((x) + 3) & ~3UL)
+#define APP_ARENA_DTCLIST	(APP_ARENA_ALIGN(DTC_SUM * 16) + APP_ARENA_ALIGN(DTC_SUM * sizeof(stu_mode_menu)))
+#define APP_ARENA_DTCEDIT	APP_ARENA_ALIGN(sizeof(Stru_DTC))
+#define APP_ARENA_SIZE		APP_ARENA_DTCLIST
+
+// working memory of each screen(App_ArenaAlloc, word aligned) fits in the arena
+CFG_STATIC_ASSERT(APP_ARENA_DTCLIST <= APP_ARENA_SIZE, app_arena_dtc_list);
+CFG_STATIC_ASSERT(APP_ARENA_DTCEDIT <= APP_ARENA_SIZE, app_arena_dtc_edit);
 
 static void menuInit(void);
+static void ModeMenu_Action(void);
+static void *App_ArenaAlloc(unsigned short Size);
 static void showSystemTime(void);
 
 static void gnlMenu_DesktopCBS(void);
@@ -25,22 +41,42 @@ static void stgMenu_dl_ReviewCBS(void);
 static void stgMenu_dl_EditCBS(void);
 static void stgMenu_dl_DeleteCBS(void);
 
+static char stgMenu_ListDrawPT(OS_PtTypeDef *pt, stu_mode_menu *pHead, unsigned char rows, unsigned char selPos, stu_mode_menu *pSel);
+static char stgMenu_dl_EditDrawPT(OS_PtTypeDef *pt, char *pTitle, Stru_DTC *pDtc);
+
 static void S_ENArmModeProc(void);
 static void S_DisArmModeProc(void);
 static void S_HomeArmModeProc(void);
 static void S_AlarmModeProc(void);
+static void S_ENArmModeRfdProc(void);
+static void S_DisArmModeRfdProc(void);
+static void S_HomeArmModeRfdProc(void);
+static void S_AlarmModeRfdProc(void);
+static char S_AlarmBlinkPT(OS_PtTypeDef *pt);
+static char S_AlarmTriggerPT(OS_PtTypeDef *pt);
 static void SystemMode_Change(SYSTEMMODE_TYPEDEF sysMode);
 
 static void HexToAscii(unsigned char *pHex, unsigned char *pAscii, int nLen);
 
 static void KeyEventHandler(KEY_VALUE_TYPEDEF keys);
-static void RFDRxHandler(unsigned char *pBuff);
+static void RFDRxHandler(unsigned char hMsg);
+static void RFDRxMsgFlush(void);
+static unsigned char *RFDRxMsgGet(unsigned char hMsg);
+static void DtcTriggerIn(unsigned char id, unsigned char hMsg);
 static void ServerEventHandle(en_NBIot_MSG_TYPE type, unsigned char *pData);
 
 static void ScreenControl(unsigned char cmd);
 
-unsigned char *pMcuVersions = "v2.8";                        // MCU Firmware version
-unsigned char *pHardVersions = "v7.0";                       // Hardware version
+#if CFG_CLOCK_SCALING
+static void App_ClockActive(void);
+static void App_ClockPolicy(void);
+#else
+#define App_ClockActive()
+#define App_ClockPolicy()
+#endif
+
+char *pMcuVersions = "v2.8";                                 // MCU Firmware version
+char *pHardVersions = "v7.0";                                // Hardware version
 
 unsigned char NbIotWorkState;  // NBIot module work state
 unsigned char bNbIotWorkState; // NBIot module work state backup
@@ -50,6 +86,7 @@ unsigned char bNbIotCsQ;       // NBIot module CSQ backup
 unsigned short PutoutScreenTiemr;   // Timer for Screen-Turnoff
 unsigned char ScreenState;          // 0->off, 1->on
 unsigned short SetupMenuTimeOutCnt;
+unsigned short SysModeDoorInfoTimer; // Timer for door information of arm/disarm mode
 
 stu_mode_menu *pModeMenu;   	
 stu_system_time stuSystemtime; 	
@@ -58,7 +95,7 @@ stu_system_time stuSystemtime;
 /**********************************************************************
 		unsigned char ID;   			// = GNL_MENU_DESKTOP  
         MENU_POS menuPos;   			// = DESKTOP_MENU_POS
-        unsigned char *pModeType; 		// = "Desktop"
+        char *pModeType; 				// = "Desktop"
         void (*action)(void); 			// = gnlMenu_DesktopCBS
         SCREEN_CMD refreshScreenCMD;  	// = SCREEN_CMD_RESET
         unsigned char reserved;  		// = 0
@@ -76,20 +113,20 @@ stu_mode_menu generalModeMenu[GNL_MENU_SUM] =
 // Initialize the SettingModeMenu
 stu_mode_menu settingModeMenu[STG_MENU_SUM] = 
 {
-    {STG_MENU_MAIN_SETTING,STG_MENU_POS,(unsigned char *)"Main Menu",stgMenu_MainMenuCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},                		
-    {STG_MENU_LEARNING_SENSOR,STG_SUB_2_MENU_POS,(unsigned char *)"1. Learning Dtc",stgMenu_LearnSensorCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},        
-    {STG_MENU_DTC_LIST,STG_SUB_2_MENU_POS,(unsigned char *)"2. Dtc List",stgMenu_DTCListCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},                        
-    {STG_MENU_MACHINE_INFO,STG_SUB_2_MENU_POS,(unsigned char *)"3. Mac Info",stgMenu_MachineInfoCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},                
-    {STG_MENU_FACTORY_SETTINGS,STG_SUB_2_MENU_POS,(unsigned char *)"4. Default Setting",stgMenu_FactorySettingsCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0}, 
+    {STG_MENU_MAIN_SETTING,STG_MENU_POS,"Main Menu",stgMenu_MainMenuCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},                		
+    {STG_MENU_LEARNING_SENSOR,STG_SUB_2_MENU_POS,"1. Learning Dtc",stgMenu_LearnSensorCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},        
+    {STG_MENU_DTC_LIST,STG_SUB_2_MENU_POS,"2. Dtc List",stgMenu_DTCListCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},                        
+    {STG_MENU_MACHINE_INFO,STG_SUB_2_MENU_POS,"3. Mac Info",stgMenu_MachineInfoCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},                
+    {STG_MENU_FACTORY_SETTINGS,STG_SUB_2_MENU_POS,"4. Default Setting",stgMenu_FactorySettingsCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0}, 
 };
 
 // Initialize the DetectorListMenu
 stu_mode_menu DL_ZX_Review[STG_MENU_DL_ZX_SUM] = 
 {   
-    {STG_MENU_DL_ZX_REVIEW_MAIN,STG_SUB_2_MENU_POS,(unsigned char *)"View",stgMenu_dl_ReviewMainCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},        
-    {STG_MENU_DL_ZX_REVIEW,STG_SUB_3_MENU_POS,(unsigned char *)"View",stgMenu_dl_ReviewCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},                 
-    {STG_MENU_DL_ZX_EDIT,STG_SUB_3_MENU_POS,(unsigned char *)"Edit",stgMenu_dl_EditCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},
-    {STG_MENU_DL_ZX_DELETE,STG_SUB_3_MENU_POS,(unsigned char *)"Delete",stgMenu_dl_DeleteCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},
+    {STG_MENU_DL_ZX_REVIEW_MAIN,STG_SUB_2_MENU_POS,"View",stgMenu_dl_ReviewMainCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},        
+    {STG_MENU_DL_ZX_REVIEW,STG_SUB_3_MENU_POS,"View",stgMenu_dl_ReviewCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},                 
+    {STG_MENU_DL_ZX_EDIT,STG_SUB_3_MENU_POS,"Edit",stgMenu_dl_EditCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},
+    {STG_MENU_DL_ZX_DELETE,STG_SUB_3_MENU_POS,"Delete",stgMenu_dl_DeleteCBS,SCREEN_CMD_RESET,0,0xFF,0,0,0,0},
 };
 
 
@@ -97,15 +134,39 @@ stu_system_mode *pStuSystemMode;
 
 stu_system_mode stu_Sysmode[SYSTEM_MODE_SUM] =            
 {
-    {SYSTEM_MODE_ENARM, SCREEN_CMD_RESET, 0xFF, S_ENArmModeProc},
-    {SYSTEM_MODE_HOMEARM, SCREEN_CMD_RESET, 0xFF, S_HomeArmModeProc},
-    {SYSTEM_MODE_DISARM, SCREEN_CMD_RESET, 0xFF, S_DisArmModeProc},
-    {SYSTEM_MODE_ALARM, SCREEN_CMD_RESET, 0xFF, S_AlarmModeProc},
+    {SYSTEM_MODE_ENARM, SCREEN_CMD_RESET, 0xFF, S_ENArmModeProc, S_ENArmModeRfdProc},
+    {SYSTEM_MODE_HOMEARM, SCREEN_CMD_RESET, 0xFF, S_HomeArmModeProc, S_HomeArmModeRfdProc},
+    {SYSTEM_MODE_DISARM, SCREEN_CMD_RESET, 0xFF, S_DisArmModeProc, S_DisArmModeRfdProc},
+    {SYSTEM_MODE_ALARM, SCREEN_CMD_RESET, 0xFF, S_AlarmModeProc, S_AlarmModeRfdProc},
 };
 
 
-Queue8 RFD_RxMsg;	        // RFD Receiver Queue
-Queue8 DtcTriggerIDMsg;     // Triggered Detector ID Queue
+unsigned int App_Arena[(APP_ARENA_SIZE + 3) / 4];	// screen arena(word aligned)
+unsigned short App_ArenaUsed;						// bytes taken by the active screen
+stu_mode_menu *App_ArenaOwner;						// screen the arena was reset for
+
+Queue(CFG_QUEUE_APP_RFD_MSG) RFD_RxMsg;			// RFD message handles: OS_MsgGet()->Data[0]: function code, Data[1~2]: address
+
+// triggered detector, stamped with the RF decode time
+typedef struct
+{
+    unsigned long long Stamp;
+    unsigned char ID;
+}App_DtcTriggerTypeDef;
+
+RecQueue(App_DtcTriggerTypeDef, CFG_QUEUE_APP_DTC_TRIGGER) DtcTrigger;     // Triggered Detector Queue
+
+#if CFG_TIME_LATENCY
+// latency paths(Hal_Time): RF decode -> mode process, key event -> menu action, RF decode -> alarm uplink
+static Hal_Time_LatencyTypeDef App_RfdLatency;
+static Hal_Time_LatencyTypeDef App_KeyLatency;
+static Hal_Time_LatencyTypeDef App_UplinkLatency;
+#endif
+static unsigned long long App_KeyStamp;
+
+#if CFG_CLOCK_SCALING
+static unsigned short App_ClockHold;				// App ticks left at full clock
+#endif
 
 /*----------------------------------------------------------------------------
 @Name		: App_Init()
@@ -119,7 +180,18 @@ void App_Init(void)
     ServerEventCBFRegister(ServerEventHandle);
 	
 	QueueEmpty(RFD_RxMsg);
-    QueueEmpty(DtcTriggerIDMsg);
+    QueueEmpty(DtcTrigger);
+    QueueRegister(RFD_RxMsg, "RFD_RxMsg");
+    RecQueueRegister(DtcTrigger, "DtcTrigger");
+    LatencyRegister(App_RfdLatency, "RFD");
+    LatencyRegister(App_KeyLatency, "KEY");
+    LatencyRegister(App_UplinkLatency, "UPLINK");
+#if CFG_CLOCK_SCALING
+    App_ClockHold = APP_CLOCK_HOLD_PERIOD;
+#endif
+
+    App_ArenaUsed = 0;
+    App_ArenaOwner = 0;
     
     pStuSystemMode = &stu_Sysmode[SYSTEM_MODE_ENARM];  
 
@@ -284,7 +356,7 @@ static void gnlMenu_DesktopCBS(void)
         
         showSystemTime();
         
-        QueueEmpty(RFD_RxMsg);
+        RFDRxMsgFlush();
         
         hal_Oled_Refresh();
     }
@@ -519,8 +591,7 @@ static void stgMenu_MainMenuCBS(void)
 static void stgMenu_LearnSensorCBS(void)
 {
 	unsigned char keys;
-	unsigned char dat;
-	unsigned char tBuff[3];
+	unsigned char *tBuff, hMsg;
 	
 	static unsigned char PairingComplete = 0; 	// learning flag，1->learning successfully
     static unsigned short Timer = 0;        	
@@ -544,68 +615,63 @@ static void stgMenu_LearnSensorCBS(void)
         Timer = 0;
     }  
 	
-    if(QueueDataLen(RFD_RxMsg) && (!PairingComplete))
+    if(!PairingComplete && QueueDataOut(RFD_RxMsg, &hMsg))
     {
-        QueueDataOut(RFD_RxMsg, &dat);
+        tBuff = RFDRxMsgGet(hMsg);		// read in place: tBuff[0]: function code, tBuff[1~2]: address
+        hal_Oled_ClearArea(0,28,128,36);
 
-        if(dat == '#')
+        stuTempDevice.Code[2] = tBuff[2];   
+        stuTempDevice.Code[1] = tBuff[1];  
+        stuTempDevice.Code[0] = tBuff[0];  
+
+        if((stuTempDevice.Code[0]==SENSOR_CODE_DOOR_OPEN) ||
+           (stuTempDevice.Code[0]==SENSOR_CODE_DOOR_CLOSE) ||
+           (stuTempDevice.Code[0]==SENSOR_CODE_DOOR_TAMPER)||
+           (stuTempDevice.Code[0]==SENSOR_CODE_DOOR_LOWPWR))
         {
-            QueueDataOut(RFD_RxMsg,&tBuff[2]);      // address 
-            QueueDataOut(RFD_RxMsg,&tBuff[1]);      // address 
-            QueueDataOut(RFD_RxMsg,&tBuff[0]);     	// code 
-    
-            hal_Oled_ClearArea(0,28,128,36);
-    
-            stuTempDevice.Code[2] = tBuff[2];   
-            stuTempDevice.Code[1] = tBuff[1];  
-            stuTempDevice.Code[0] = tBuff[0];  
-    
-            if((stuTempDevice.Code[0]==SENSOR_CODE_DOOR_OPEN) ||
-               (stuTempDevice.Code[0]==SENSOR_CODE_DOOR_CLOSE) ||
-               (stuTempDevice.Code[0]==SENSOR_CODE_DOOR_TAMPER)||
-               (stuTempDevice.Code[0]==SENSOR_CODE_DOOR_LOWPWR))
-            {
-                stuTempDevice.DTCType = DTC_DOOR;               
-            }
-			else if((stuTempDevice.Code[0]==SENSOR_CODE_REMOTE_ENARM) ||
-                    (stuTempDevice.Code[0]==SENSOR_CODE_REMOTE_DISARM) ||
-                    (stuTempDevice.Code[0]==SENSOR_CODE_REMOTE_HOMEARM) ||
-                    (stuTempDevice.Code[0]==SENSOR_CODE_REMOTE_SOS))
-            {
-                stuTempDevice.DTCType = DTC_REMOTE;
-            }  
-            
-            stuTempDevice.ZoneType = ZONE_TYP_1ST;
-    
-            if(Device_AddDTC(&stuTempDevice) != 0xFF)
-            {
-                switch(stuTempDevice.DTCType)
-                {
-                    case DTC_DOOR:    
-                        hal_Oled_ShowString(34,28,"Success!",8,1);
-                        hal_Oled_ShowString(16,36,"Added door dtc..",8,1);
-                    break;
-                    
-                    case DTC_REMOTE: 
-                        hal_Oled_ShowString(34,28,"Success!",8,1);
-                        hal_Oled_ShowString(7,36,"Added remote dtc..",8,1);
-                    break;
-    
-               
-                }
-    
-                hal_Oled_Refresh();
-    
-                PairingComplete = 1;
+            stuTempDevice.DTCType = DTC_DOOR;               
+        }
+		else if((stuTempDevice.Code[0]==SENSOR_CODE_REMOTE_ENARM) ||
+                (stuTempDevice.Code[0]==SENSOR_CODE_REMOTE_DISARM) ||
+                (stuTempDevice.Code[0]==SENSOR_CODE_REMOTE_HOMEARM) ||
+                (stuTempDevice.Code[0]==SENSOR_CODE_REMOTE_SOS))
+        {
+            stuTempDevice.DTCType = DTC_REMOTE;
+        }  
+        
+        stuTempDevice.ZoneType = ZONE_TYP_1ST;
 
-                Timer = 0;
-            }
-            else
+        if(Device_AddDTC(&stuTempDevice) != 0xFF)
+        {
+            switch(stuTempDevice.DTCType)
             {
-                hal_Oled_ShowString(34,28,"Fail...",8,1);
-                hal_Oled_Refresh();
+                case DTC_DOOR:    
+                    hal_Oled_ShowString(34,28,"Success!",8,1);
+                    hal_Oled_ShowString(16,36,"Added door dtc..",8,1);
+                break;
+                
+                case DTC_REMOTE: 
+                    hal_Oled_ShowString(34,28,"Success!",8,1);
+                    hal_Oled_ShowString(7,36,"Added remote dtc..",8,1);
+                break;
+
+                default:
+                break;
             }
+
+            hal_Oled_Refresh();
+
+            PairingComplete = 1;
+
+            Timer = 0;
         }
+        else
+        {
+            hal_Oled_ShowString(34,28,"Fail...",8,1);
+            hal_Oled_Refresh();
+        }
+
+        OS_MsgFree(hMsg);
     }
     
     if(PairingComplete)
@@ -654,14 +720,14 @@ static void stgMenu_LearnSensorCBS(void)
 static void stgMenu_DTCListCBS(void)
 {	
     unsigned char keys; 			
-	unsigned char ClrScreenFlag; 	// Screen_Clear flag, when the menu list need to roll-over, set this flag to 1
+	unsigned char ClrScreenFlag = 0; 	// Screen_Clear flag, when the menu list need to roll-over, set this flag to 1
     unsigned char i,j;
     
     Stru_DTC tStuDtc;
     
-    static unsigned char DtcNameBuff[DTC_SUM][16];
+    static char (*DtcNameBuff)[16];                             // arena: DTC_SUM names
 
-    static stu_mode_menu settingMode_DTCList_Sub_Menu[DTC_SUM];
+    static stu_mode_menu *settingMode_DTCList_Sub_Menu;         // arena: DTC_SUM items
 
     static stu_mode_menu *pMenu;
 
@@ -672,15 +738,36 @@ static void stgMenu_DTCListCBS(void)
     static stu_mode_menu *MHead;
   
     static unsigned char pMenuIdx = 0;
+
+    static OS_PtTypeDef DrawPt;         // list redraw, one row per tick
+
+    static unsigned char DrawRunning = 0;
+
+    unsigned char SelIdx = 0;           // selected item and first item of the page
+    unsigned char HeadIdx = 0;
     
-    if(pModeMenu->refreshScreenCmd == SCREEN_CMD_RESET)
+    // the arena is reset on every screen change: the list is built again on RESET and RECOVER
+    if((pModeMenu->refreshScreenCmd == SCREEN_CMD_RESET) || (pModeMenu->refreshScreenCmd == SCREEN_CMD_RECOVER))
     {
+        if(pModeMenu->refreshScreenCmd == SCREEN_CMD_RECOVER)
+        {
+            // back from the detector menus: keep the selection, only indexes of the old list are used
+            SelIdx = pMenu - settingMode_DTCList_Sub_Menu;
+            HeadIdx = MHead - settingMode_DTCList_Sub_Menu;
+        }
+        else
+        {
+            stgMainMenuSelectedPos = 1;
+        }
         pModeMenu->refreshScreenCmd = SCREEN_CMD_NULL;
 
+        DtcNameBuff = App_ArenaAlloc(DTC_SUM * 16);
+        settingMode_DTCList_Sub_Menu = App_ArenaAlloc(DTC_SUM * sizeof(stu_mode_menu));
+
         pMenuIdx = 0;
-        stgMainMenuSelectedPos = 1;
         bpMenu = 0;
         ClrScreenFlag = 1;
+        DrawRunning = 0;
         pMenu = settingMode_DTCList_Sub_Menu; 
         
         keys = 0xFF;
@@ -744,22 +831,20 @@ static void stgMenu_DTCListCBS(void)
             hal_Oled_ShowString(0,14," No detectors.",8,1);
             hal_Oled_Refresh();
         }
-                
-        MHead = pMenu;
-    }
 
-    else if(pModeMenu->refreshScreenCmd==SCREEN_CMD_RECOVER)
-    {        
-        pModeMenu->refreshScreenCmd = SCREEN_CMD_NULL;
-        hal_Oled_Clear();
-        hal_Oled_ShowString(40,0,"Dtc List",12,1);
-        hal_Oled_Refresh();
-        keys = 0xFF;
-        ClrScreenFlag = 1;
-        bpMenu = 0;
+        if((SelIdx >= pMenuIdx) || (HeadIdx >= pMenuIdx) || (stgMainMenuSelectedPos > pMenuIdx))
+        {
+            SelIdx = 0;
+            HeadIdx = 0;
+            stgMainMenuSelectedPos = 1;
+        }
+                
+        MHead = pMenu + HeadIdx;
+        pMenu += SelIdx;
     }
 
-    if(pModeMenu->keyVal != 0xFF)
+    // keys wait until the list redraw is complete, the redraw walks pMenu/MHead
+    if((pModeMenu->keyVal != 0xFF) && (!DrawRunning))
     {
         keys = pModeMenu->keyVal;
 
@@ -880,32 +965,8 @@ static void stgMenu_DTCListCBS(void)
         if(ClrScreenFlag)    
         {
             ClrScreenFlag = 0;  
-            pMenu = MHead;      
-            hal_Oled_ClearArea(0,14,128,50);
-            hal_Oled_Refresh();
-        
-            if(pMenuIdx < 4)
-            {
-                for(i=0; i<pMenuIdx; i++)
-                {
-                    hal_Oled_ShowString(0,14*(i+1),pMenu->pModeType,8,1);
-                    hal_Oled_Refresh();
-                    pMenu = pMenu->pNext; 
-                }
-            }
-            else
-            {
-                for(i=1; i<5; i++)
-                {
-                    hal_Oled_ShowString(0,14*i,pMenu->pModeType,8,1);
-                    hal_Oled_Refresh();
-                    pMenu = pMenu->pNext; 
-                } 
-            }
-        
-            pMenu = bpMenu; 
-            hal_Oled_ShowString(0,14*stgMainMenuSelectedPos,pMenu->pModeType,8,0);
-            hal_Oled_Refresh(); 
+            OS_PT_INIT(&DrawPt);
+            DrawRunning = 1;
         }
         else
         { 
@@ -914,6 +975,49 @@ static void stgMenu_DTCListCBS(void)
         }     
     } 
 
+    if(DrawRunning)
+    {
+        DrawRunning = OS_PT_SCHEDULE(stgMenu_ListDrawPT(&DrawPt, MHead, (pMenuIdx < 4) ? pMenuIdx : 4, stgMainMenuSelectedPos, pMenu));
+    }
+}
+
+/*----------------------------------------------------------------------------
+@Name		: stgMenu_ListDrawPT(pt, pHead, rows, selPos, pSel)
+@Function	: redraw a menu list page, one screen refresh per tick
+@Parameter	: 
+		--> pt		: protothread of the caller
+		--> pHead	: first item of the page
+		--> rows	: rows on the page
+		--> selPos	: selected row(1~4), pSel: selected item
+------------------------------------------------------------------------------*/
+static char stgMenu_ListDrawPT(OS_PtTypeDef *pt, stu_mode_menu *pHead, unsigned char rows, unsigned char selPos, stu_mode_menu *pSel)
+{
+    static stu_mode_menu *pRow;
+
+    static unsigned char row;
+
+    OS_PT_BEGIN(pt);
+
+    hal_Oled_ClearArea(0,14,128,50);
+    hal_Oled_Refresh();
+
+    pRow = pHead;
+
+    for(row=1; row<=rows; row++)
+    {
+        OS_PT_YIELD(pt);
+
+        hal_Oled_ShowString(0,14*row,pRow->pModeType,8,1);
+        hal_Oled_Refresh();
+        pRow = pRow->pNext; 
+    }
+
+    OS_PT_YIELD(pt);
+
+    hal_Oled_ShowString(0,14*selPos,pSel->pModeType,8,0);
+    hal_Oled_Refresh(); 
+
+    OS_PT_END(pt);
 }
 
 
@@ -1177,78 +1281,57 @@ static void stgMenu_dl_ReviewCBS(void)
 static void stgMenu_dl_EditCBS(void)
 {
     unsigned char keys = 0xFF;
-    static Stru_DTC tStuDtc;
+    static Stru_DTC *pStuDtc;                   // arena
     static unsigned short timer = 0;
     static unsigned char editComplete = 0;
     static unsigned char stgMainMenuSelectedPos=0;
     static unsigned char setValue = DTC_DOOR;
-    static unsigned char *pDL_ZX_Edit_DTCType_Val[DTC_TYP_SUM] =
+    static char *pDL_ZX_Edit_DTCType_Val[DTC_TYP_SUM] =
     {
         "door dtc",
         "pir dtc",
         "remote",
     };
 
-    static unsigned char *pDL_ZX_Edit_ZoneType_Val[STG_DEV_AT_SUM] =
+    static char *pDL_ZX_Edit_ZoneType_Val[STG_DEV_AT_SUM] =
     {
         "24 hrs",
         "1ST",
         "2ND",
     };
+
+    static OS_PtTypeDef DrawPt;         // attribute page draw, one screen refresh per tick
+
+    static unsigned char DrawRunning = 0;
     
 
     if(pModeMenu->refreshScreenCmd == SCREEN_CMD_RESET)
     {   
         pModeMenu->refreshScreenCmd = SCREEN_CMD_NULL;
+
+        pStuDtc = App_ArenaAlloc(sizeof(Stru_DTC));
         stgMainMenuSelectedPos = 0; 
         if(Device_CheckDTCExisting(pModeMenu->reserved))
         {
-            Device_GetDTCStructure(&tStuDtc,pModeMenu->reserved);
+            Device_GetDTCStructure(pStuDtc,pModeMenu->reserved);
         }
          
         stgMainMenuSelectedPos = 0;
-        setValue = tStuDtc.DTCType;
-        hal_Oled_Clear();
-        hal_Oled_ShowString(40,0,pModeMenu->pModeType,12,1);
-        hal_Oled_Refresh();
-        
-        hal_Oled_ShowString(0,16,"<Name>: ",8,1); 
-        hal_Oled_ShowString(48,16,tStuDtc.DeviceName,8,1);
-        
-        hal_Oled_ShowString(0,28,"<Type>: ",8,1);
-        hal_Oled_Refresh();
-        
-        if(tStuDtc.DTCType == DTC_DOOR)
-        {
-                hal_Oled_ShowString(48,28,"door dtc",8,0);
-        }else if(tStuDtc.DTCType == DTC_PIR_MOTION)
-        {
-                hal_Oled_ShowString(48,28,"pir dtc",8,0);
-        }else if(tStuDtc.DTCType == DTC_REMOTE)
-        {
-                hal_Oled_ShowString(48,28,"remote",8,0);
-        }
-        hal_Oled_Refresh();
-        
-        hal_Oled_ShowString(0,40,"<ZoneType>: ",8,1);
-        hal_Oled_Refresh();
-        
-        if(tStuDtc.ZoneType == ZONE_TYP_24HOURS)
-        {
-                hal_Oled_ShowString(72,40,"24 hrs",8,1);
-        }else if(tStuDtc.ZoneType == ZONE_TYP_1ST)
-        {
-                hal_Oled_ShowString(72,40,"1ST",8,1);
-        }else if(tStuDtc.ZoneType == ZONE_TYP_2ND)
-        {
-                hal_Oled_ShowString(72,40,"2ND",8,1);
-        }
-        
-        hal_Oled_Refresh();
+        setValue = pStuDtc->DTCType;
+
+        OS_PT_INIT(&DrawPt);
+        DrawRunning = 1;
          
         editComplete = 0;
         timer = 0;
     }
+
+    if(DrawRunning)
+    {
+        DrawRunning = OS_PT_SCHEDULE(stgMenu_dl_EditDrawPT(&DrawPt, pModeMenu->pModeType, pStuDtc));
+        
+        return;     // keys wait until the page is complete
+    }
     
     if(pModeMenu->keyVal != 0xFF)
     {
@@ -1266,7 +1349,7 @@ static void stgMenu_dl_EditCBS(void)
                 {
                         setValue--;
                 }
-                tStuDtc.DTCType = (DTC_TYPE_TYPEDEF)setValue;  
+                pStuDtc->DTCType = (DTC_TYPE_TYPEDEF)setValue;  
                 hal_Oled_ClearArea(48,28,80,8);               
                 hal_Oled_ShowString(48,28,pDL_ZX_Edit_DTCType_Val[setValue],8,0);
                 hal_Oled_Refresh();
@@ -1281,7 +1364,7 @@ static void stgMenu_dl_EditCBS(void)
                 {
                         setValue--;
                 }
-                tStuDtc.ZoneType = (ZONE_TYPED_TYPEDEF)setValue;  
+                pStuDtc->ZoneType = (ZONE_TYPED_TYPEDEF)setValue;  
                 hal_Oled_ClearArea(72,40,56,8);                   
                 hal_Oled_ShowString(72,40,pDL_ZX_Edit_ZoneType_Val[setValue],8,0);
                 hal_Oled_Refresh();
@@ -1298,7 +1381,7 @@ static void stgMenu_dl_EditCBS(void)
                 {
                     setValue++;
                 }
-                tStuDtc.DTCType = (DTC_TYPE_TYPEDEF)setValue;  
+                pStuDtc->DTCType = (DTC_TYPE_TYPEDEF)setValue;  
                 hal_Oled_ClearArea(48,28,80,8);                
                 hal_Oled_ShowString(48,28,pDL_ZX_Edit_DTCType_Val[setValue],8,0);
                 hal_Oled_Refresh();
@@ -1312,7 +1395,7 @@ static void stgMenu_dl_EditCBS(void)
                 {
                     setValue++;
                 }
-                tStuDtc.ZoneType = (ZONE_TYPED_TYPEDEF)setValue; 
+                pStuDtc->ZoneType = (ZONE_TYPED_TYPEDEF)setValue; 
 
                 hal_Oled_ClearArea(72,40,56,8);                  
                 hal_Oled_ShowString(72,40,pDL_ZX_Edit_ZoneType_Val[setValue],8,0);
@@ -1325,10 +1408,10 @@ static void stgMenu_dl_EditCBS(void)
             if(stgMainMenuSelectedPos == 0)
             {
                 stgMainMenuSelectedPos = 1;
-                setValue = tStuDtc.ZoneType;
+                setValue = pStuDtc->ZoneType;
                 hal_Oled_ClearArea(48,28,80,8);        
 
-                hal_Oled_ShowString(48,28,pDL_ZX_Edit_DTCType_Val[tStuDtc.DTCType],8,1);       
+                hal_Oled_ShowString(48,28,pDL_ZX_Edit_DTCType_Val[pStuDtc->DTCType],8,1);       
 
                 hal_Oled_ClearArea(72,40,56,8);   
 
@@ -1338,7 +1421,7 @@ static void stgMenu_dl_EditCBS(void)
             else
             {
                 stgMainMenuSelectedPos = 0;
-                setValue = tStuDtc.DTCType;
+                setValue = pStuDtc->DTCType;
                 hal_Oled_ClearArea(48,28,80,8);
                         
                 hal_Oled_ShowString(48,28,pDL_ZX_Edit_DTCType_Val[setValue],8,0);               
@@ -1346,7 +1429,7 @@ static void stgMenu_dl_EditCBS(void)
                         
                 hal_Oled_ClearArea(72,40,56,8); 
 
-                hal_Oled_ShowString(72,40,pDL_ZX_Edit_ZoneType_Val[tStuDtc.ZoneType],8,1);       
+                hal_Oled_ShowString(72,40,pDL_ZX_Edit_ZoneType_Val[pStuDtc->ZoneType],8,1);       
                         
                 hal_Oled_Refresh();
             }
@@ -1360,7 +1443,7 @@ static void stgMenu_dl_EditCBS(void)
         else if(keys == KEY6_CLICK_RELEASE)  
         {
             timer = 0;
-            Device_SetDTCAttribute(tStuDtc.ID-1,&tStuDtc); 
+            Device_SetDTCAttribute(pStuDtc->ID-1,pStuDtc); 
             editComplete = 1;
             hal_Oled_Clear();
             hal_Oled_ShowString(16,20,"Update..",24,1);
@@ -1385,6 +1468,64 @@ static void stgMenu_dl_EditCBS(void)
     }
 }
 
+/*----------------------------------------------------------------------------
+@Name		: stgMenu_dl_EditDrawPT(pt, pTitle, pDtc)
+@Function	: draw the detector attribute page, one screen refresh per tick
+@Parameter	: 
+		--> pt		: protothread of the caller
+		--> pTitle	: menu title
+		--> pDtc	: detector to show
+------------------------------------------------------------------------------*/
+static char stgMenu_dl_EditDrawPT(OS_PtTypeDef *pt, char *pTitle, Stru_DTC *pDtc)
+{
+    OS_PT_BEGIN(pt);
+
+    hal_Oled_Clear();
+
+    OS_PT_YIELD(pt);
+
+    hal_Oled_ShowString(40,0,pTitle,12,1);
+    
+    hal_Oled_ShowString(0,16,"<Name>: ",8,1); 
+    hal_Oled_ShowString(48,16,pDtc->DeviceName,8,1);
+    
+    hal_Oled_ShowString(0,28,"<Type>: ",8,1);
+    hal_Oled_Refresh();
+
+    OS_PT_YIELD(pt);
+    
+    if(pDtc->DTCType == DTC_DOOR)
+    {
+            hal_Oled_ShowString(48,28,"door dtc",8,0);
+    }else if(pDtc->DTCType == DTC_PIR_MOTION)
+    {
+            hal_Oled_ShowString(48,28,"pir dtc",8,0);
+    }else if(pDtc->DTCType == DTC_REMOTE)
+    {
+            hal_Oled_ShowString(48,28,"remote",8,0);
+    }
+    
+    hal_Oled_ShowString(0,40,"<ZoneType>: ",8,1);
+    hal_Oled_Refresh();
+
+    OS_PT_YIELD(pt);
+    
+    if(pDtc->ZoneType == ZONE_TYP_24HOURS)
+    {
+            hal_Oled_ShowString(72,40,"24 hrs",8,1);
+    }else if(pDtc->ZoneType == ZONE_TYP_1ST)
+    {
+            hal_Oled_ShowString(72,40,"1ST",8,1);
+    }else if(pDtc->ZoneType == ZONE_TYP_2ND)
+    {
+            hal_Oled_ShowString(72,40,"2ND",8,1);
+    }
+    
+    hal_Oled_Refresh();
+
+    OS_PT_END(pt);
+}
+
 /*----------------------------------------------------------------------------
 @Name		: stgMenu_dl_DeleteCBS()
 @Function	: delete detectors Menu
@@ -1393,7 +1534,7 @@ static void stgMenu_dl_EditCBS(void)
 static void stgMenu_dl_DeleteCBS(void)
 {
     unsigned char keys = 0xFF;
-    static Stru_DTC tStuDtc;
+    static Stru_DTC *pStuDtc;                   // arena
     static unsigned short timer = 0;
     static unsigned char DelComplete = 0;
     
@@ -1402,10 +1543,12 @@ static void stgMenu_dl_DeleteCBS(void)
     if(pModeMenu->refreshScreenCmd == SCREEN_CMD_RESET)
     {   
         pModeMenu->refreshScreenCmd = SCREEN_CMD_NULL;
+
+        pStuDtc = App_ArenaAlloc(sizeof(Stru_DTC));
         stgMainMenuSelectedPos = 0; 
         if(Device_CheckDTCExisting(pModeMenu->reserved))
         {
-            Device_GetDTCStructure(&tStuDtc,pModeMenu->reserved);
+            Device_GetDTCStructure(pStuDtc,pModeMenu->reserved);
         }
              
         stgMainMenuSelectedPos = 0;
@@ -1415,7 +1558,7 @@ static void stgMenu_dl_DeleteCBS(void)
             
         //del zone-001
         hal_Oled_ShowString(28,14,"Del ",12,1); 
-        hal_Oled_ShowString(52,14,tStuDtc.DeviceName,12,1); 
+        hal_Oled_ShowString(52,14,pStuDtc->DeviceName,12,1); 
             
             
         hal_Oled_ShowString(25,28,"Are you sure?",12,1); 
@@ -1461,9 +1604,9 @@ static void stgMenu_dl_DeleteCBS(void)
             {
                 DelComplete = 1;
                 timer = 0;
-                tStuDtc.Mark = 0;
+                pStuDtc->Mark = 0;
 
-                Device_SetDTCAttribute(tStuDtc.ID-1,&tStuDtc);  
+                Device_SetDTCAttribute(pStuDtc->ID-1,pStuDtc);  
                 hal_Oled_Clear();
                 hal_Oled_ShowString(16,20,"Update..",24,1);
                 hal_Oled_Refresh();        
@@ -1677,11 +1820,6 @@ static void stgMenu_FactorySettingsCBS(void)
 ------------------------------------------------------------------------------*/
 static void S_ENArmModeProc()
 {
-    unsigned char tBuff[3], id, dat;   
-    Stru_DTC tStuDtc;                  
-
-    static unsigned short time1;
-
     if(pStuSystemMode->refreshScreenCmd == SCREEN_CMD_RESET)
     {
         pStuSystemMode->refreshScreenCmd = SCREEN_CMD_NULL;
@@ -1694,72 +1832,79 @@ static void S_ENArmModeProc()
 
         hal_Oled_Refresh();
 
-        time1 = 0;
+        SysModeDoorInfoTimer = 0;
     }
 
-    if(QueueDataLen(RFD_RxMsg))
+    S_ENArmModeRfdProc();
+
+    if(SysModeDoorInfoTimer)  
     {
-        QueueDataOut(RFD_RxMsg,&dat);
+        SysModeDoorInfoTimer--; 
+        if(SysModeDoorInfoTimer == 0)
+        {
+            hal_Oled_ClearArea(0,4,92,8);
+            hal_Oled_Refresh();        
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------
+@Name		: S_ENArmModeRfdProc()
+@Function	: Away arm mode RF message process
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void S_ENArmModeRfdProc()
+{
+    unsigned char *tBuff, hMsg, id;   
+    Stru_DTC tStuDtc;                  
+
+    if(QueueDataOut(RFD_RxMsg, &hMsg))
+    {
+        tBuff = RFDRxMsgGet(hMsg);		// read in place: tBuff[0]: function code, tBuff[1~2]: address
+        id = Device_DTCMatching(tBuff); 
 
-        if(dat == '#')
+        if(id != 0xFF)
         {
-            QueueDataOut(RFD_RxMsg,&tBuff[2]); // address high byte
-            QueueDataOut(RFD_RxMsg,&tBuff[1]); // address low byte
-            QueueDataOut(RFD_RxMsg,&tBuff[0]); // function code
+            Device_GetDTCStructure(&tStuDtc, id-1);
             
-            id = Device_DTCMatching(tBuff); 
-
-            if(id != 0xFF)
+            if(tStuDtc.DTCType == DTC_REMOTE)
             {
-                Device_GetDTCStructure(&tStuDtc, id-1);
-                
-                if(tStuDtc.DTCType == DTC_REMOTE)
+                if(tBuff[0] == SENSOR_CODE_REMOTE_DISARM)
                 {
-                    if(tBuff[0] == SENSOR_CODE_REMOTE_DISARM)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_DISARM);    
-                    }
-                    else if(tBuff[0] == SENSOR_CODE_REMOTE_HOMEARM)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_HOMEARM);    
-                    }
-                    else if(tBuff[0] == SENSOR_CODE_REMOTE_SOS)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_ALARM);    
-                        
-                        QueueDataIn(DtcTriggerIDMsg, &id, 1); 
-                    }
+                    SystemMode_Change(SYSTEM_MODE_DISARM);    
                 }
-                else if(tBuff[0] == SENSOR_CODE_DOOR_OPEN) 
+                else if(tBuff[0] == SENSOR_CODE_REMOTE_HOMEARM)
                 {
-                    SystemMode_Change(SYSTEM_MODE_ALARM);
-                    
-                    QueueDataIn(DtcTriggerIDMsg, &id, 1);
+                    SystemMode_Change(SYSTEM_MODE_HOMEARM);    
                 }
-                else if(tBuff[0]==SENSOR_CODE_DOOR_CLOSE)   
+                else if(tBuff[0] == SENSOR_CODE_REMOTE_SOS)
                 {
-                    time1 = 500;                          
+                    SystemMode_Change(SYSTEM_MODE_ALARM);    
+                    
+                    DtcTriggerIn(id, hMsg); 
                 }
+            }
+            else if(tBuff[0] == SENSOR_CODE_DOOR_OPEN) 
+            {
+                SystemMode_Change(SYSTEM_MODE_ALARM);
+                
+                DtcTriggerIn(id, hMsg);
+            }
+            else if(tBuff[0]==SENSOR_CODE_DOOR_CLOSE)   
+            {
+                SysModeDoorInfoTimer = 500;                          
+            }
 
-                if(time1 == 500) 
-                {
-                    hal_Oled_ClearArea(0,4,92,8); 
-                    hal_Oled_ShowString(2,4,"Door:",8,1); 
-                    hal_Oled_ShowString(32,4,tStuDtc.DeviceName,8,1);        
-                    hal_Oled_Refresh();                                        
-                }
+            if(SysModeDoorInfoTimer == 500) 
+            {
+                hal_Oled_ClearArea(0,4,92,8); 
+                hal_Oled_ShowString(2,4,"Door:",8,1); 
+                hal_Oled_ShowString(32,4,tStuDtc.DeviceName,8,1);        
+                hal_Oled_Refresh();                                        
             }
         }
-    }
 
-    if(time1)  
-    {
-        time1--; 
-        if(time1 == 0)
-        {
-            hal_Oled_ClearArea(0,4,92,8);
-            hal_Oled_Refresh();        
-        }
+        OS_MsgFree(hMsg);
     }
 }
 
@@ -1770,10 +1915,6 @@ static void S_ENArmModeProc()
 ------------------------------------------------------------------------------*/
 static void S_DisArmModeProc()
 {
-    unsigned char tBuff[3],id,dat;
-    Stru_DTC tStuDtc;
-    static unsigned short time1;
-
     if(pStuSystemMode->refreshScreenCmd == SCREEN_CMD_RESET)
     {
         pStuSystemMode->refreshScreenCmd = SCREEN_CMD_NULL;
@@ -1785,77 +1926,85 @@ static void S_DisArmModeProc()
         
         hal_Oled_Refresh();
         
-        time1 = 0;
+        SysModeDoorInfoTimer = 0;
     }
  
-    if(QueueDataLen(RFD_RxMsg))
+    S_DisArmModeRfdProc();
+
+    if(SysModeDoorInfoTimer)
     {
-        QueueDataOut(RFD_RxMsg,&dat);
-        if(dat == '#')
+        SysModeDoorInfoTimer --;
+        if(SysModeDoorInfoTimer == 0)
         {
-            QueueDataOut(RFD_RxMsg,&tBuff[2]);
-            QueueDataOut(RFD_RxMsg,&tBuff[1]);
-            QueueDataOut(RFD_RxMsg,&tBuff[0]);
-            id = Device_DTCMatching(tBuff); 
+            hal_Oled_ClearArea(0,4,92,8); 
+            hal_Oled_Refresh();        
+        }
+    }
+}
 
-            if(id != 0xFF)
+/*----------------------------------------------------------------------------
+@Name		: S_DisArmModeRfdProc()
+@Function	: Disarm mode RF message process
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void S_DisArmModeRfdProc()
+{
+    unsigned char *tBuff, hMsg, id;
+    Stru_DTC tStuDtc;
+
+    if(QueueDataOut(RFD_RxMsg, &hMsg))
+    {
+        tBuff = RFDRxMsgGet(hMsg);		// read in place: tBuff[0]: function code, tBuff[1~2]: address
+        id = Device_DTCMatching(tBuff); 
+
+        if(id != 0xFF)
+        {
+            Device_GetDTCStructure(&tStuDtc,id-1);
+             
+            if(tStuDtc.DTCType == DTC_REMOTE)
             {
-                Device_GetDTCStructure(&tStuDtc,id-1);
-                 
-                if(tStuDtc.DTCType == DTC_REMOTE)
+                if(tBuff[0] == SENSOR_CODE_REMOTE_ENARM)
                 {
-                    if(tBuff[0] == SENSOR_CODE_REMOTE_ENARM)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_ENARM);        
-                    }else if(tBuff[0] == SENSOR_CODE_REMOTE_DISARM)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_DISARM);      
-                    }else if(tBuff[0] == SENSOR_CODE_REMOTE_HOMEARM)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_HOMEARM);      
-                    }else if(tBuff[0] == SENSOR_CODE_REMOTE_SOS)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_ALARM);     
-                        QueueDataIn(DtcTriggerIDMsg, &id, 1);
-                    }
-                }
-                else if(tBuff[0]==SENSOR_CODE_DOOR_OPEN)
+                    SystemMode_Change(SYSTEM_MODE_ENARM);        
+                }else if(tBuff[0] == SENSOR_CODE_REMOTE_DISARM)
                 {
-                    if(tStuDtc.ZoneType==ZONE_TYP_24HOURS)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_ALARM);      
-                        QueueDataIn(DtcTriggerIDMsg, &id, 1);
-                    }
-                    else
-                    {
-                        time1 = 500;
-                    }
+                    SystemMode_Change(SYSTEM_MODE_DISARM);      
+                }else if(tBuff[0] == SENSOR_CODE_REMOTE_HOMEARM)
+                {
+                    SystemMode_Change(SYSTEM_MODE_HOMEARM);      
+                }else if(tBuff[0] == SENSOR_CODE_REMOTE_SOS)
+                {
+                    SystemMode_Change(SYSTEM_MODE_ALARM);     
+                    DtcTriggerIn(id, hMsg);
                 }
-                else if(tBuff[0]==SENSOR_CODE_DOOR_CLOSE)
+            }
+            else if(tBuff[0]==SENSOR_CODE_DOOR_OPEN)
+            {
+                if(tStuDtc.ZoneType==ZONE_TYP_24HOURS)
                 {
-                    time1 = 500;                                        
+                    SystemMode_Change(SYSTEM_MODE_ALARM);      
+                    DtcTriggerIn(id, hMsg);
                 }
-
-                if(time1 == 500)
+                else
                 {
-                    hal_Oled_ClearArea(0,4,92,8);       
-                    hal_Oled_ShowString(2,4,"Door:",8,1);
-                    hal_Oled_ShowString(32,4,tStuDtc.DeviceName,8,1);        
-                    hal_Oled_Refresh();                                        
-                }          
+                    SysModeDoorInfoTimer = 500;
+                }
+            }
+            else if(tBuff[0]==SENSOR_CODE_DOOR_CLOSE)
+            {
+                SysModeDoorInfoTimer = 500;                                        
             }
-                
-        }
-    }
 
-    if(time1)
-    {
-        time1 --;
-        if(time1 == 0)
-        {
-            hal_Oled_ClearArea(0,4,92,8); 
-            hal_Oled_Refresh();        
+            if(SysModeDoorInfoTimer == 500)
+            {
+                hal_Oled_ClearArea(0,4,92,8);       
+                hal_Oled_ShowString(2,4,"Door:",8,1);
+                hal_Oled_ShowString(32,4,tStuDtc.DeviceName,8,1);        
+                hal_Oled_Refresh();                                        
+            }          
         }
+            
+        OS_MsgFree(hMsg);
     }
 }
 
@@ -1866,9 +2015,6 @@ static void S_DisArmModeProc()
 ------------------------------------------------------------------------------*/
 static void S_HomeArmModeProc()
 {
-    unsigned char tBuff[3],id,dat;
-    Stru_DTC tStuDtc;
-    static unsigned short time1;
     if(pStuSystemMode->refreshScreenCmd == SCREEN_CMD_RESET)
     {
         pStuSystemMode->refreshScreenCmd = SCREEN_CMD_NULL;
@@ -1879,72 +2025,81 @@ static void S_HomeArmModeProc()
         hal_Oled_ShowString(16,20,"Home Arm",24,1);
         hal_Oled_Refresh();
         
-        time1 = 0;         
+        SysModeDoorInfoTimer = 0;         
     }
     
-    if(QueueDataLen(RFD_RxMsg))
+    S_HomeArmModeRfdProc();
+
+    if(SysModeDoorInfoTimer)
     {
-        QueueDataOut(RFD_RxMsg,&dat);
-        if(dat == '#')
+        SysModeDoorInfoTimer --;
+        if(SysModeDoorInfoTimer == 0)
         {
-            QueueDataOut(RFD_RxMsg,&tBuff[2]);
-            QueueDataOut(RFD_RxMsg,&tBuff[1]);
-            QueueDataOut(RFD_RxMsg,&tBuff[0]);
-            id = Device_DTCMatching(tBuff);      
-            if(id != 0xFF)
+            hal_Oled_ClearArea(0,4,92,8); 
+            hal_Oled_Refresh();        
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------
+@Name		: S_HomeArmModeRfdProc()
+@Function	: HomeArm mode RF message process
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void S_HomeArmModeRfdProc()
+{
+    unsigned char *tBuff, hMsg, id;
+    Stru_DTC tStuDtc;
+
+    if(QueueDataOut(RFD_RxMsg, &hMsg))
+    {
+        tBuff = RFDRxMsgGet(hMsg);		// read in place: tBuff[0]: function code, tBuff[1~2]: address
+        id = Device_DTCMatching(tBuff);      
+        if(id != 0xFF)
+        {
+            Device_GetDTCStructure(&tStuDtc,id-1);
+             
+            if(tStuDtc.DTCType == DTC_REMOTE)
             {
-                Device_GetDTCStructure(&tStuDtc,id-1);
-                 
-                if(tStuDtc.DTCType == DTC_REMOTE)
+                if(tBuff[0] == SENSOR_CODE_REMOTE_ENARM)
                 {
-                    if(tBuff[0] == SENSOR_CODE_REMOTE_ENARM)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_ENARM);      
-                    }else if(tBuff[0] == SENSOR_CODE_REMOTE_DISARM)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_DISARM); 
-                    }else if(tBuff[0] == SENSOR_CODE_REMOTE_SOS)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_ALARM);    
-                        QueueDataIn(DtcTriggerIDMsg, &id, 1);
-                    }
-                }
-                else if(tBuff[0]==SENSOR_CODE_DOOR_OPEN)
+                    SystemMode_Change(SYSTEM_MODE_ENARM);      
+                }else if(tBuff[0] == SENSOR_CODE_REMOTE_DISARM)
                 {
-                    if(tStuDtc.ZoneType != ZONE_TYP_2ND)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_ALARM);
-                        QueueDataIn(DtcTriggerIDMsg, &id, 1);
-                    }
-                    else
-                    {
-                        time1 = 500;
-                    }
-                        
-                }else if(tBuff[0]==SENSOR_CODE_DOOR_CLOSE)
+                    SystemMode_Change(SYSTEM_MODE_DISARM); 
+                }else if(tBuff[0] == SENSOR_CODE_REMOTE_SOS)
                 {
-                    time1 = 500;                                        
+                    SystemMode_Change(SYSTEM_MODE_ALARM);    
+                    DtcTriggerIn(id, hMsg);
                 }
-
-                if(time1 == 500)
+            }
+            else if(tBuff[0]==SENSOR_CODE_DOOR_OPEN)
+            {
+                if(tStuDtc.ZoneType != ZONE_TYP_2ND)
                 {
-                    hal_Oled_ClearArea(0,4,92,8);
-                    hal_Oled_ShowString(2,4,"Door:",8,1);
-                    hal_Oled_ShowString(32,4,tStuDtc.DeviceName,8,1); 
-                    hal_Oled_Refresh();                                               
-                } 
+                    SystemMode_Change(SYSTEM_MODE_ALARM);
+                    DtcTriggerIn(id, hMsg);
+                }
+                else
+                {
+                    SysModeDoorInfoTimer = 500;
+                }
+                    
+            }else if(tBuff[0]==SENSOR_CODE_DOOR_CLOSE)
+            {
+                SysModeDoorInfoTimer = 500;                                        
             }
-        }
-    }
 
-    if(time1)
-    {
-        time1 --;
-        if(time1 == 0)
-        {
-            hal_Oled_ClearArea(0,4,92,8); 
-            hal_Oled_Refresh();        
+            if(SysModeDoorInfoTimer == 500)
+            {
+                hal_Oled_ClearArea(0,4,92,8);
+                hal_Oled_ShowString(2,4,"Door:",8,1);
+                hal_Oled_ShowString(32,4,tStuDtc.DeviceName,8,1); 
+                hal_Oled_Refresh();                                               
+            } 
         }
+
+        OS_MsgFree(hMsg);
     }
 }
 
@@ -1955,15 +2110,9 @@ static void S_HomeArmModeProc()
 ------------------------------------------------------------------------------*/
 static void S_AlarmModeProc()
 {
-    static unsigned short timer = 0;
-    
-    static unsigned short timer2 = 0;
-    
-    static unsigned char displayAlarmFlag = 1;
-    
-    unsigned char tBuff[3], id, dat;
+    static OS_PtTypeDef BlinkPt;        // "Alarming" blink
 
-    Stru_DTC tStuDtc;
+    static OS_PtTypeDef TriggerPt;      // triggered detector info line
 
     if(pStuSystemMode->refreshScreenCmd == SCREEN_CMD_RESET)
     {
@@ -1978,113 +2127,139 @@ static void S_AlarmModeProc()
         
         hal_Oled_Refresh();
         
-        displayAlarmFlag = 1;
-        timer = 0;
-        timer2 = 0;
+        OS_PT_INIT(&BlinkPt);
+        OS_PT_INIT(&TriggerPt);
     }
 
-    if(QueueDataLen(RFD_RxMsg))
-    {
-        QueueDataOut(RFD_RxMsg,&dat);
-        
-        if(dat == '#')
-        {
-            QueueDataOut(RFD_RxMsg,&tBuff[2]); 
-            QueueDataOut(RFD_RxMsg,&tBuff[1]); 
-            QueueDataOut(RFD_RxMsg,&tBuff[0]); 
-            
-            id = Device_DTCMatching(tBuff); 
+    S_AlarmModeRfdProc();
 
-            if(id != 0xFF)
-            {
-                Device_GetDTCStructure(&tStuDtc, id-1);
-          
-                if(tStuDtc.DTCType == DTC_REMOTE) 
-                {
-                    if(tBuff[0] == SENSOR_CODE_REMOTE_DISARM)
-                    {
-                        SystemMode_Change(SYSTEM_MODE_DISARM);
-                    }
-                    else if(tBuff[0] == SENSOR_CODE_REMOTE_SOS) 
-                    {
-                        QueueDataIn(DtcTriggerIDMsg, &id, 1);
-                    }
-                }
-                else if(tBuff[0]==SENSOR_CODE_DOOR_OPEN)  
-                {
-                    QueueDataIn(DtcTriggerIDMsg, &id, 1);
-                }
-            }
-        }
-    }
+    S_AlarmTriggerPT(&TriggerPt);
 
-    if(QueueDataLen(DtcTriggerIDMsg) && (!timer))
-    {
-        QueueDataOut(DtcTriggerIDMsg,&id);
+    S_AlarmBlinkPT(&BlinkPt);
+}
 
-        if(id > 0)
-        {
-            Device_GetDTCStructure(&tStuDtc,id-1); 
-            
-            if(tStuDtc.DTCType == DTC_REMOTE)  
-            {
-                hal_Oled_ClearArea(0,4,92,8);             
-                hal_Oled_ShowString(2,4,"Remote:",8,1);
-                hal_Oled_ShowString(44,4,"sos",8,1);
+/*----------------------------------------------------------------------------
+@Name		: S_AlarmBlinkPT(pt)
+@Function	: blink "Alarming" every 500ms
+@Parameter	: 
+		--> pt	: protothread
+------------------------------------------------------------------------------*/
+static char S_AlarmBlinkPT(OS_PtTypeDef *pt)
+{
+    static unsigned short stamp;
 
-                OneNet_UpEventQueue(UPDATA_ALARMINFO_REMOTE);
-                OneNet_UpEventQueue((En_OneNetUpDatList)id); 
-            }
-            else if(tStuDtc.DTCType == DTC_DOOR)
-            {
-                hal_Oled_ClearArea(0,4,92,8);            
-                hal_Oled_ShowString(2,4,"Door:",8,1);
-                hal_Oled_ShowString(32,4,tStuDtc.DeviceName,8,1); 
+    OS_PT_BEGIN(pt);
 
-                OneNet_UpEventQueue(UPDATA_ALARMINFO_DOOR);   
-                OneNet_UpEventQueue((En_OneNetUpDatList)id); 
-            }
+    OS_PT_DELAY(pt, stamp, OS_MS_TO_TICKS(500));
 
-            hal_Oled_Refresh();
+    hal_Oled_ClearArea(0,20,128,24); 
+    hal_Oled_Refresh();
 
-            timer = 1;
-        }
-    }
-    
-    if(timer)
-    {
-        timer++;
+    OS_PT_DELAY(pt, stamp, OS_MS_TO_TICKS(500));
 
-        if(timer > 500)
-        {
-            timer = 0;
+    hal_Oled_ShowString(16,20,"Alarming",24,1);
+    hal_Oled_Refresh();
 
-            hal_Oled_ClearArea(0,4,92,8);        
-            hal_Oled_Refresh();
-        }
-    }
-    
-    timer2++;
+    OS_PT_END(pt);      // restarts on the next call
+}
 
-    if(timer2 > 49)
+/*----------------------------------------------------------------------------
+@Name		: S_AlarmTriggerPT(pt)
+@Function	: show the triggered detector for 5s, report it to the server
+@Parameter	: 
+		--> pt	: protothread
+------------------------------------------------------------------------------*/
+static char S_AlarmTriggerPT(OS_PtTypeDef *pt)
+{
+    static unsigned short stamp;
+
+    unsigned char id;
+
+    App_DtcTriggerTypeDef Trigger;
+
+    Stru_DTC tStuDtc;
+
+    OS_PT_BEGIN(pt);
+
+    OS_PT_WAIT_UNTIL(pt, RecQueueLen(DtcTrigger));
+
+    RecQueueOut(DtcTrigger, &Trigger);
+    id = Trigger.ID;
+
+    if(id > 0)
     {
-        timer2 = 0;
+        Device_GetDTCStructure(&tStuDtc,id-1); 
         
-        displayAlarmFlag = !displayAlarmFlag;
-        
-        if(displayAlarmFlag)
+        if(tStuDtc.DTCType == DTC_REMOTE)  
         {
-            hal_Oled_ShowString(16,20,"Alarming",24,1);
-            
-            hal_Oled_Refresh();
+            hal_Oled_ClearArea(0,4,92,8);             
+            hal_Oled_ShowString(2,4,"Remote:",8,1);
+            hal_Oled_ShowString(44,4,"sos",8,1);
 
+            OneNet_UpEventQueue(UPDATA_ALARMINFO_REMOTE);
+            OneNet_UpEventQueue((En_OneNetUpDatList)id); 
+            LatencyAdd(App_UplinkLatency, Trigger.Stamp);
         }
-        else
+        else if(tStuDtc.DTCType == DTC_DOOR)
         {
-            hal_Oled_ClearArea(0,20,128,24); 
+            hal_Oled_ClearArea(0,4,92,8);            
+            hal_Oled_ShowString(2,4,"Door:",8,1);
+            hal_Oled_ShowString(32,4,tStuDtc.DeviceName,8,1); 
 
-            hal_Oled_Refresh();
+            OneNet_UpEventQueue(UPDATA_ALARMINFO_DOOR);   
+            OneNet_UpEventQueue((En_OneNetUpDatList)id); 
+            LatencyAdd(App_UplinkLatency, Trigger.Stamp);
         }
+
+        hal_Oled_Refresh();
+
+        OS_PT_DELAY(pt, stamp, OS_MS_TO_TICKS(5000));
+
+        hal_Oled_ClearArea(0,4,92,8);        
+        hal_Oled_Refresh();
+    }
+
+    OS_PT_END(pt);      // restarts on the next call
+}
+
+/*----------------------------------------------------------------------------
+@Name		: S_AlarmModeRfdProc()
+@Function	: Alarm mode RF message process
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void S_AlarmModeRfdProc()
+{
+    unsigned char *tBuff, hMsg, id;
+
+    Stru_DTC tStuDtc;
+
+    if(QueueDataOut(RFD_RxMsg, &hMsg))
+    {
+        tBuff = RFDRxMsgGet(hMsg);		// read in place: tBuff[0]: function code, tBuff[1~2]: address
+        id = Device_DTCMatching(tBuff); 
+
+        if(id != 0xFF)
+        {
+            Device_GetDTCStructure(&tStuDtc, id-1);
+      
+            if(tStuDtc.DTCType == DTC_REMOTE) 
+            {
+                if(tBuff[0] == SENSOR_CODE_REMOTE_DISARM)
+                {
+                    SystemMode_Change(SYSTEM_MODE_DISARM);
+                }
+                else if(tBuff[0] == SENSOR_CODE_REMOTE_SOS) 
+                {
+                    DtcTriggerIn(id, hMsg);
+                }
+            }
+            else if(tBuff[0]==SENSOR_CODE_DOOR_OPEN)  
+            {
+                DtcTriggerIn(id, hMsg);
+            }
+        }
+
+        OS_MsgFree(hMsg);
     }
 }
 
@@ -2102,6 +2277,7 @@ static void SystemMode_Change(SYSTEMMODE_TYPEDEF sysMode)
         
         pStuSystemMode->refreshScreenCmd = SCREEN_CMD_RESET; 
       
+        App_ClockActive();
         OneNet_UpEventQueue((En_OneNetUpDatList)sysMode);
 
         ScreenControl(1);
@@ -2166,7 +2342,8 @@ static void ScreenControl(unsigned char cmd)
 static void HexToAscii(unsigned char *pHex, unsigned char *pAscii, int nLen)
 {
     unsigned char Nibble[2];
-    unsigned int i,j;
+    int i;
+    unsigned int j;
     for (i = 0; i < nLen; i++){
         Nibble[0] = (pHex[i] & 0xF0) >> 4;
         Nibble[1] = pHex[i] & 0x0F;
@@ -2190,6 +2367,33 @@ static void HexToAscii(unsigned char *pHex, unsigned char *pAscii, int nLen)
 ------------------------------------------------------------------------------*/
 void App_Pro(void)
 {
+    unsigned short events;
+
+    events = OS_EventAccept(OS_TASK_APP);
+
+    if(!(events & OS_EVT_TICK))
+    {
+        // woken up by event between ticks: handle the input at once, App time counters only run on tick
+        // key: the menu consumes keyVal inside its action(menu timers step once more per key, negligible)
+        if(events & APP_EVT_KEY)
+        {
+            ModeMenu_Action();
+            LatencyAdd(App_KeyLatency, App_KeyStamp);
+        }
+        else if(events & APP_EVT_RFD)
+        {
+            if((pModeMenu->menuPos == DESKTOP_MENU_POS) 
+            && (pModeMenu->refreshScreenCmd == SCREEN_CMD_NULL))
+            {
+                while(QueueDataLen(RFD_RxMsg) && (pStuSystemMode->refreshScreenCmd == SCREEN_CMD_NULL))
+                {
+                    pStuSystemMode->rfdProc();
+                }
+            }
+        }
+        return;
+    }
+
     if(pModeMenu->menuPos != DESKTOP_MENU_POS) 
     {
         SetupMenuTimeOutCnt++;
@@ -2202,7 +2406,11 @@ void App_Pro(void)
         }
     }
     
-	pModeMenu->action();
+	ModeMenu_Action();
+    if(events & APP_EVT_KEY)
+    {
+        LatencyAdd(App_KeyLatency, App_KeyStamp);
+    }
 
     if(pStuSystemMode->ID!=SYSTEM_MODE_ALARM)
         {
@@ -2213,11 +2421,116 @@ void App_Pro(void)
                 ScreenControl(0);     
             }
         }
+
+    App_ClockPolicy();
+}
+
+#if CFG_CLOCK_SCALING
+/*----------------------------------------------------------------------------
+@Name		: App_ClockActive()
+@Function	: activity(RF code, key, server message, mode change and its uplink):
+			  full clock at once and for APP_CLOCK_HOLD_PERIOD ticks
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void App_ClockActive(void)
+{
+    App_ClockHold = APP_CLOCK_HOLD_PERIOD;
+    Hal_Clock_Set(HAL_CLOCK_FULL);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: App_ClockPolicy()
+@Function	: clock mode of the App tick
+		--> low clock only while disarmed, on the desktop, the NB-IoT module
+			connected and no activity for APP_CLOCK_HOLD_PERIOD ticks
+		--> CFG_POWER_STOP: low clock(idle in STOP) armed as well, an RF edge
+			wakes the core; the alarm takes the wakelock: no STOP while it sounds,
+			USART2 traffic takes its own(Hal_USART)
+		--> a change refused by a module(transfer running) is tried next tick
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void App_ClockPolicy(void)
+{
+    if(App_ClockHold)
+    {
+        App_ClockHold--;
+    }
+
+#if CFG_POWER_STOP
+    if(pStuSystemMode->ID == SYSTEM_MODE_ALARM)
+    {
+        Hal_Power_WakeLock(HAL_POWER_LOCK_APP);
+    }
+    else
+    {
+        Hal_Power_WakeUnlock(HAL_POWER_LOCK_APP);
+    }
+#endif
+
+    if(App_ClockHold
+#if CFG_POWER_STOP
+    || (pStuSystemMode->ID == SYSTEM_MODE_ALARM)
+#else
+    || (pStuSystemMode->ID != SYSTEM_MODE_DISARM)
+#endif
+    || (pModeMenu->menuPos != DESKTOP_MENU_POS)
+    || (NbIotWorkState != NBIOT_SATE_CONN_ONENET))
+    {
+        Hal_Clock_Set(HAL_CLOCK_FULL);
+    }
+    else
+    {
+        Hal_Clock_Set(HAL_CLOCK_LOW);
+    }
+}
+#endif
+
+/*----------------------------------------------------------------------------
+@Name		: ModeMenu_Action()
+@Function	: run the active menu screen
+		--> screen changed or (re)entered: the arena is reset before the screen
+			takes its working memory on SCREEN_CMD_RESET/SCREEN_CMD_RECOVER
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void ModeMenu_Action(void)
+{
+    if((pModeMenu != App_ArenaOwner) || (pModeMenu->refreshScreenCmd != SCREEN_CMD_NULL))
+    {
+        App_ArenaOwner = pModeMenu;
+        App_ArenaUsed = 0;
+    }
+
+    pModeMenu->action();
+}
+
+/*----------------------------------------------------------------------------
+@Name		: App_ArenaAlloc(Size)
+@Function	: take working memory of the active screen from the arena(word aligned),
+			  valid until the screen changes, never freed one by one
+@Parameter	: 
+        --> Size: bytes
+@Return		: memory
+		--> APP_ARENA_SIZE too small(sizing error, missed by the checks on top):
+			traps(CFG_ASSERT), memory taken already is never handed out twice
+------------------------------------------------------------------------------*/
+static void *App_ArenaAlloc(unsigned short Size)
+{
+    void *p;
+
+    Size = (Size + 3) & ~3;
+    CFG_ASSERT((unsigned long)App_ArenaUsed + Size <= sizeof(App_Arena));
+
+    p = (unsigned char *)App_Arena + App_ArenaUsed;
+    App_ArenaUsed += Size;
+    return p;
 }
 
 /*---------------------------Event handler----------------------------------*/
 static void KeyEventHandler(KEY_VALUE_TYPEDEF keys)
 {
+    App_KeyStamp = Hal_Key_GetStamp();
+    App_ClockActive();
+
     if(!ScreenState)
     {
         ScreenControl(1);
@@ -2236,6 +2549,8 @@ static void KeyEventHandler(KEY_VALUE_TYPEDEF keys)
             PutoutScreenTiemr = 0;
         }
     }    
+
+    OS_EventPost(OS_TASK_APP, APP_EVT_KEY);
 	
 	if((keys==KEY1_CLICK)
 	|| (keys==KEY2_CLICK)
@@ -2249,24 +2564,63 @@ static void KeyEventHandler(KEY_VALUE_TYPEDEF keys)
 
 }
 
-static void RFDRxHandler(unsigned char *pBuff)
+static void RFDRxHandler(unsigned char hMsg)
 {
-	unsigned char temp;
-	unsigned char RFDBuff[3];
+	unsigned char *pCode;
+	unsigned char Addr;
+	
+	pCode = OS_MsgGet(hMsg)->Data;	// reordered in place
+	Addr = pCode[0];
+	pCode[0] = pCode[2] & 0x0F;		// function code
+	pCode[2] = Addr;				// address: pCode[1~2]
 	
-	RFDBuff[0] = pBuff[0];
-	RFDBuff[1] = pBuff[1];
-	RFDBuff[2] = pBuff[2];
-	RFDBuff[2] &= 0x0F; 		
+	App_ClockActive();
+	
+	if(!QueueDataIn(RFD_RxMsg, &hMsg, 1))
+	{
+		OS_MsgFree(hMsg);			// full: the new message is dropped
+	}
 	
-	temp = '#';
-	QueueDataIn(RFD_RxMsg, &temp, 1);
-	QueueDataIn(RFD_RxMsg, &RFDBuff[0], 3);
+	OS_EventPost(OS_TASK_APP, APP_EVT_RFD);
+}
+
+// drop the RF messages waiting for the mode process
+static void RFDRxMsgFlush(void)
+{
+	unsigned char hMsg;
+	
+	while(QueueDataOut(RFD_RxMsg, &hMsg))
+	{
+		OS_MsgFree(hMsg);
+	}
+}
+
+// RF message taken by the mode process: data read in place, decode -> process latency
+static unsigned char *RFDRxMsgGet(unsigned char hMsg)
+{
+	OS_MsgTypeDef *pMsg;
+	
+	pMsg = OS_MsgGet(hMsg);
+	LatencyAdd(App_RfdLatency, pMsg->Stamp);
+	
+	return pMsg->Data;
+}
+
+// triggered detector queued for the alarm screen and uplink, with the time of its RF code
+static void DtcTriggerIn(unsigned char id, unsigned char hMsg)
+{
+	App_DtcTriggerTypeDef Trigger;
+	
+	Trigger.ID = id;
+	Trigger.Stamp = OS_MsgGet(hMsg)->Stamp;
+	RecQueueIn(DtcTrigger, &Trigger);
 }
 
 
 static void ServerEventHandle(en_NBIot_MSG_TYPE type, unsigned char *pData)
 {
+    App_ClockActive();
+
     switch(type)
     {
         case NBIOT_HOST_STATE:      
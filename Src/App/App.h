@@ -17,6 +17,12 @@
 
 #define SETUPMENU_TIMEOUT_PERIOD        2000       
 
+#define APP_CLOCK_HOLD_PERIOD           (CFG_CLOCK_HOLD_MS / 10)    // App ticks(10ms) at full clock after activity
+
+// App task events
+#define APP_EVT_RFD                     OS_EVT_USER(0)      // RF frame received
+#define APP_EVT_KEY                     OS_EVT_USER(1)      // key event
+
 // Screen command
 typedef enum
 {
@@ -83,7 +89,7 @@ typedef struct MODE_MENU
 {
     unsigned char ID;        		// Menu ID
     MENU_POS menuPos;       		// Current Menu Position
-    unsigned char *pModeType; 		// Menu name pointer
+    char *pModeType; 				// Menu name pointer
     void (*action)(void); 			// Function pointer
     SCREEN_CMD refreshScreenCmd; 	// Screen command
     unsigned char reserved;  		
@@ -100,6 +106,7 @@ typedef struct SYSTEM_MODE
     SCREEN_CMD refreshScreenCmd;    
     unsigned char keyVal;           
     void (*action)(void);           
+    void (*rfdProc)(void);          // RF message process
 }stu_system_mode;
 
 typedef struct SYSTEM_TIME
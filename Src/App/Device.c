@@ -1,12 +1,16 @@
-#include "stm32f10x.h"
 #include "hal_i2c_eeprom.h"
 #include "device.h"
 
+#ifdef DEVICE_DEBUG_CREAT_DTC
 static void Device_CreatDTC(unsigned char n);
+#endif
 static unsigned char Device_ParaCheck(void);
 
 Stru_DTC	sDevice[DTC_SUM];	
 
+// detector records from STRU_DEVICEPARA_OFFSET fit in the EEPROM
+CFG_STATIC_ASSERT((STRU_DEVICEPARA_OFFSET + DTC_SUM * sizeof(Stru_DTC)) <= CFG_EEPROM_SIZE, eeprom_dtc_layout);
+
 
 /*----------------------------------------------------------------------------
 @Name		: Device_Init()
@@ -303,8 +307,9 @@ void Device_SetDTCAttribute(unsigned char index, Stru_DTC *psDevicePara)
 @Function	: creat the specific number of detectors
 @Parameter	: 
 		--> n : number
-@Note		:  Debug use
+@Note		:  Debug use, built with DEVICE_DEBUG_CREAT_DTC defined
 ------------------------------------------------------------------------------*/
+#ifdef DEVICE_DEBUG_CREAT_DTC
 static void Device_CreatDTC(unsigned char n)
 {
 	unsigned char i, j, Temp;
@@ -342,6 +347,7 @@ static void Device_CreatDTC(unsigned char n)
 		sDevice[i].Code[2] = 0xAA;
 	}
 }
+#endif
 
 
 /*----------------------------------------------------------------------------
@@ -1,7 +1,9 @@
 #ifndef __DEVICE_H_
 #define __DEVICE_H_
 
-#define DTC_SUM					20						
+#include "sysconfig.h"
+
+#define DTC_SUM					CFG_DTC_SUM						
 
 #define STRU_DTC_SIZE			sizeof(Stru_DTC)
 
@@ -33,7 +35,7 @@ typedef struct
 	unsigned char ID;				// device ID
 	unsigned char Mark;		 		// 0-unpaired 1-paired
 	unsigned char NameNum;			
-	unsigned char DeviceName[16];	// device name
+	char DeviceName[16];			// device name
 	DTC_TYPE_TYPEDEF DTCType;		// device type
 	ZONE_TYPED_TYPEDEF ZoneType;	
 
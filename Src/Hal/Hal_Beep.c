@@ -1,6 +1,9 @@
 #include "stm32F10x.h"
 #include "hal_timer.h"
 #include "hal_beep.h"
+#include "hal_clock.h"
+
+#if CFG_FEATURE_BEEP
 
 #define BEEP_PORT			GPIOB
 #define BEEP_PIN			GPIO_Pin_4
@@ -55,6 +58,9 @@ unsigned short NoteFreqAry[30] = {
 static void Hal_Beep_Config(void);
  
 static void Hal_Beep_PWMHandler(void);
+static unsigned char Hal_Beep_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz);
+
+static Hal_TimerHandle_t Beep_TimerHandle;	// 6ms periodic timer of Hal_Beep_PWMHandler
 
 
 static void Hal_Beep_Config(void)
@@ -100,13 +106,24 @@ static void Hal_Beep_Config(void)
 
 	TIM_Cmd(TIM3, ENABLE);  
 
+	Hal_Clock_NotifyRegister(Hal_Beep_ClockNotify);
+}
+
+// clock change(Hal_Clock): TIM3 keeps 1us per count, the tone does not change
+static unsigned char Hal_Beep_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz)
+{
+	if(Event == HAL_CLOCK_CHANGED)
+	{
+		HAL_CLOCK_TIM_RESCALE(TIM3, MHz);
+	}
+	return 1;
 }
 
 
 void Hal_Beep_Init(void)
 {
 	Hal_Beep_Config();
-	Hal_Timer_CreatTimer(T_BEEP, Hal_Beep_PWMHandler, 120, T_STATE_START); // TimeBase: 50us, period = 6ms
+	Beep_TimerHandle = Hal_Timer_CreatTimer(Hal_Beep_PWMHandler, HAL_TIMER_MS_TO_TICKS(6), T_STATE_START, T_MODE_PERIODIC, T_EXEC_TASK); // period = 6ms
 }
 
 void Hal_Beep_Pro(void)
@@ -141,8 +158,7 @@ static void Hal_Beep_PWMHandler(void)
 	{
 		i=0;
 	}
-	
-	Hal_Timer_ResetTimer(T_BEEP,T_STATE_START);
-	 
 }
  
+
+#endif
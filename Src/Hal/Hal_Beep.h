@@ -1,9 +1,18 @@
 #ifndef _HAL_BEEP_H
 #define _HAL_BEEP_H
 
+#include "sysconfig.h"
+
+#if CFG_FEATURE_BEEP
 void Hal_Beep_Init(void);
 void Hal_Beep_Pro(void);
 void Hal_Beep_PWMCtrl(unsigned char cmd);
+#else
+// buzzer left out(CFG_FEATURE_BEEP = 0): no code, no timer
+#define Hal_Beep_Init()
+#define Hal_Beep_Pro()
+#define Hal_Beep_PWMCtrl(cmd)
+#endif
 
 
 #endif
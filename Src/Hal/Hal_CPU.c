@@ -1,11 +1,63 @@
 #include "stm32f10x.h"
 #include "os_system.h"
 #include "hal_cpu.h"
+#include "hal_clock.h"
+#include "hal_power.h"
 
 static void Hal_CoreClock_Init(void);
+static unsigned char Hal_CPU_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz);
+static void Hal_CPU_CycleCounter_Init(void);
 static void Hal_CPU_Critical_Control(CPU_EA_TYPEDEF cmd, unsigned char *pSta);
 
+#if CFG_OS_PREEMPTIVE
+static unsigned int *Hal_CPU_StackInit(unsigned int *pStackTop, void (*entry)(void));
+static void Hal_CPU_ContextSwitch(void);
+#endif
 
+#if CFG_CPU_STACK_CHECK
+static void Hal_CPU_StackPaint(void);
+
+extern unsigned int Stack_Mem[];		// main stack(startup_stm32f10x_md.s)
+extern unsigned int __Vectors[];		// __Vectors[0]: initial SP, top of the main stack
+
+volatile unsigned char Hal_CPU_IsrNest;
+volatile unsigned char Hal_CPU_IsrNestPeak;
+#endif
+
+#if CFG_OS_TICKLESS_IDLE
+static unsigned short Hal_CPU_Idle(unsigned short Ticks);
+static void Hal_CPU_Sleep(void);
+#if CFG_POWER_STOP
+static unsigned short Hal_CPU_Stop(unsigned short Ticks);
+#endif
+
+volatile unsigned int Hal_CPU_IdleUs;			// us spent in sleep in current window
+volatile unsigned short Hal_CPU_WindowTicks;	// system ticks passed in current window
+volatile unsigned short Hal_CPU_IdleRate;		// idle rate of the last window(per-mille)
+#endif
+
+
+#if CFG_CPU_CRITICAL_BASEPRI
+/**************************************************************************
+	@Name		: Hal_CPU_Critical_Control
+	@Function	: CPU eadge condition handler: mask the interrupts at
+				  HAL_CPU_PRIO_CRITICAL and below, higher ones still run
+	@cmd		: control command, @*psta: BASEPRI before entering
+***************************************************************************/
+static void Hal_CPU_Critical_Control(CPU_EA_TYPEDEF cmd, unsigned char *pSta)
+{
+	if(cmd == CPU_ENTER_CRITICAL)
+	{
+		*pSta = (unsigned char)__get_BASEPRI();	// save mask level, sections nest
+		__set_BASEPRI(HAL_CPU_BASEPRI);
+	}
+	else if(cmd == CPU_EXIT_CRITICAL)
+	{
+		__set_BASEPRI(*pSta);
+	}
+}
+
+#else
 /**************************************************************************
 	@Name		: Hal_Get_Interrupt_State
 	@Function	: get CPU interrupt status
@@ -48,17 +100,524 @@ static void Hal_CPU_Critical_Control(CPU_EA_TYPEDEF cmd, unsigned char *pSta)
 		}
 	}
 }
+#endif
+
+#if CFG_OS_TICKLESS_IDLE
+/**************************************************************************
+	@Name		: Hal_CPU_Sleep
+	@Function	: wait for an interrupt inside a critical section
+		--> WFI ignores PRIMASK but not BASEPRI: the BASEPRI mask is
+			swapped for PRIMASK while waiting, so every interrupt wakes
+			the core, the masked ones still run after the critical section
+		--> PRIMASK of the caller is restored, not cleared
+***************************************************************************/
+static void Hal_CPU_Sleep(void)
+{
+#if CFG_CPU_CRITICAL_BASEPRI
+	unsigned int BasePri;
+	unsigned int PriMask;
+	
+	BasePri = __get_BASEPRI();
+	PriMask = __get_PRIMASK();
+	__disable_irq();
+	__set_BASEPRI(0);
+	__WFI();
+	__set_BASEPRI(BasePri);
+	__set_PRIMASK(PriMask);
+#else
+	__WFI();
+#endif
+}
+#endif
 
 void Hal_CPU_Init(void)
 {
+#if CFG_CPU_STACK_CHECK
+	Hal_CPU_StackPaint();
+#endif
 	Hal_CoreClock_Init();
+	Hal_CPU_CycleCounter_Init();
+	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);		// preemption priorities only: HAL_CPU_PRIO_xxx
 	OS_CPUInterruptCBSRegister(Hal_CPU_Critical_Control);
+#if CFG_OS_TICKLESS_IDLE
+	OS_CPUIdleCBSRegister(Hal_CPU_Idle);
+#endif
+#if CFG_OS_PROFILE
+	OS_CPUCycleCBSRegister(Hal_CPU_GetCycle);
+#endif
+#if CFG_OS_PREEMPTIVE
+	__set_PSP(0);											// PSP = 0: first context switch saves nothing
+	NVIC_SetPriority(PendSV_IRQn, (1<<__NVIC_PRIO_BITS) - 1);	// context switch after all other interrupts
+	OS_CPUContextCBSRegister(Hal_CPU_StackInit, Hal_CPU_ContextSwitch);
+#endif
 }
 
 static void Hal_CoreClock_Init(void)
 {
-	SysTick_Config(SystemCoreClock / 100); // 10ms
+	SysTick_Config(HAL_CPU_TICK_RELOAD); // system tick: 1/OS_TICK_HZ
+	Hal_Clock_NotifyRegister(Hal_CPU_ClockNotify);
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_ClockNotify
+	@Function	: clock change call-back(Hal_Clock): SysTick reload for the
+				  new HCLK, the rest of the current tick is scaled to the
+				  new clock and counted out first(as after a tickless sleep)
+--------------------------------------------------------------------------*/
+static unsigned char Hal_CPU_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz)
+{
+	unsigned int Rest;
+	
+	if(Event == HAL_CLOCK_CHANGED)
+	{
+		SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+		Rest = (unsigned int)(((unsigned long long)SysTick->VAL * HAL_CPU_TICK_RELOAD) / (SysTick->LOAD + 1));
+		if(Rest == 0)
+		{
+			Rest = 1;
+		}
+		SysTick->LOAD = Rest;
+		SysTick->VAL = 0;
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		SysTick->LOAD = HAL_CPU_TICK_RELOAD - 1;
+	}
+	return 1;
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_CycleCounter_Init
+	@Function	: enable DWT cycle counter(counts CPU core clock)
+--------------------------------------------------------------------------*/
+static void Hal_CPU_CycleCounter_Init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	HAL_CPU_DWT_CYCCNT = 0;
+	HAL_CPU_DWT_CTRL |= HAL_CPU_DWT_CTRL_CYCCNTENA;
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_GetCycle
+	@Function	: get DWT cycle counter
+	@Return		: free running CPU cycle counter
+--------------------------------------------------------------------------*/
+unsigned int Hal_CPU_GetCycle(void)
+{
+	return HAL_CPU_DWT_CYCCNT;
+}
+
+#if CFG_CPU_STACK_CHECK
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_StackPaint
+	@Function	: paint the unused main stack below the current SP at boot,
+				  HAL_CPU_STACK_PAINT_MARGIN words are left for this frame
+--------------------------------------------------------------------------*/
+static void Hal_CPU_StackPaint(void)
+{
+	unsigned int *p;
+	unsigned int *pEnd;
+	
+	pEnd = (unsigned int *)__get_MSP() - HAL_CPU_STACK_PAINT_MARGIN;
+	for(p = Stack_Mem; p < pEnd; p++)
+	{
+		*p = OS_STACK_PAINT;
+	}
+	
+	Hal_CPU_IsrNest = 0;
+	Hal_CPU_IsrNestPeak = 0;
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_GetStackSize
+	@Function	: size of the main stack(Stack_Size of the startup file)
+	@Return		: bytes
+--------------------------------------------------------------------------*/
+unsigned int Hal_CPU_GetStackSize(void)
+{
+	return __Vectors[0] - (unsigned int)Stack_Mem;
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_GetStackPeak
+	@Function	: main stack high-water mark: bytes above the lowest word
+				  which lost its paint(main, interrupts and OS tasks in the
+				  cooperative kernel)
+	@Return		: max bytes used, Hal_CPU_GetStackSize(): overflowed or never painted
+--------------------------------------------------------------------------*/
+unsigned int Hal_CPU_GetStackPeak(void)
+{
+	unsigned int *p;
+	
+	for(p = Stack_Mem; (p < (unsigned int *)__Vectors[0]) && (*p == OS_STACK_PAINT); p++);
+	
+	return __Vectors[0] - (unsigned int)p;
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_StackReport
+	@Function	: output stack usage as one line per call:
+				  Index 0: "STK,MSP,Size,Peak,IsrNestPeak\r\n"
+				  Index 1~: CFG_OS_PREEMPTIVE threads "STK,Task,Size,Peak\r\n",
+				  Task = OS_TASK_SUM: idle thread
+	@Output		: output function, e.g. Hal_USART_DebugDataQueue
+	@Return		: 1: line output, 0: Index past the last line
+--------------------------------------------------------------------------*/
+unsigned char Hal_CPU_StackReport(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len))
+{
+	unsigned char Buff[32];
+	unsigned char Len;
+	
+	Buff[0] = 'S';
+	Buff[1] = 'T';
+	Buff[2] = 'K';
+	Buff[3] = ',';
+	Len = 4;
+	
+	if(Index == 0)
+	{
+		Buff[Len++] = 'M';
+		Buff[Len++] = 'S';
+		Buff[Len++] = 'P';
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Hal_CPU_GetStackSize(), &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Hal_CPU_GetStackPeak(), &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Hal_CPU_IsrNestPeak, &Buff[Len]);
+	}
+#if CFG_OS_PREEMPTIVE
+	else if(Index <= OS_TASK_SUM + 1)
+	{
+		Index--;
+		Len += OS_UIntToStr(Index, &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr((Index < OS_TASK_SUM) ? (OS_TASK_STACK_SIZE * 4) : (OS_IDLE_STACK_SIZE * 4), &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(OS_TaskStackPeak(Index), &Buff[Len]);
+	}
+#endif
+	else
+	{
+		return 0;
+	}
+	Buff[Len++] = '\r';
+	Buff[Len++] = '\n';
+	
+	Output(Buff, Len);
+	return 1;
+}
+#endif
+
+#if CFG_OS_PREEMPTIVE
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_TaskExit
+	@Function	: return address of a thread, threads never return
+--------------------------------------------------------------------------*/
+static void Hal_CPU_TaskExit(void)
+{
+	while(1);
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_StackInit
+	@Function	: build the first context of a thread as saved by PendSV_Handler:
+				  hardware frame(xPSR, PC, LR, R12, R3~R0) then R11~R4
+	@pStackTop	: end address of the thread stack
+	@entry		: thread function
+	@Return		: stack pointer of the built context
+--------------------------------------------------------------------------*/
+static unsigned int *Hal_CPU_StackInit(unsigned int *pStackTop, void (*entry)(void))
+{
+	unsigned int *pSP;
+	unsigned char i;
+	
+	pSP = (unsigned int *)((unsigned int)pStackTop & ~0x07UL);	// AAPCS: 8 bytes aligned
+	
+	*(--pSP) = 0x01000000;						// xPSR: Thumb state
+	*(--pSP) = (unsigned int)entry;				// PC
+	*(--pSP) = (unsigned int)Hal_CPU_TaskExit;	// LR
+	for(i=0; i<5; i++)
+	{
+		*(--pSP) = 0;							// R12, R3, R2, R1, R0
+	}
+	for(i=0; i<8; i++)
+	{
+		*(--pSP) = 0;							// R11 ~ R4
+	}
+	
+	return pSP;
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_ContextSwitch
+	@Function	: request a context switch: pend PendSV(lowest priority)
+--------------------------------------------------------------------------*/
+static void Hal_CPU_ContextSwitch(void)
+{
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: PendSV_Handler()
+	@Function	: context switch: save R4~R11 on the thread stack(PSP),
+				  OS_SwitchContext selects the next thread, restore its context
+				  and return to thread mode on PSP
+--------------------------------------------------------------------------*/
+__asm void PendSV_Handler(void)
+{
+	extern OS_SwitchContext;
+	
+	PRESERVE8
+	
+	mrs		r0, psp
+	isb
+	cbz		r0, PendSV_NoSave		; PSP = 0: first switch from OS_Start
+	stmdb	r0!, {r4-r11}
+PendSV_NoSave
+	push	{r3, r14}				; r3 keeps the stack 8 bytes aligned
+	bl		OS_SwitchContext		; r0: saved SP -> r0: SP of the next thread
+	pop		{r3, r14}
+	ldmia	r0!, {r4-r11}
+	msr		psp, r0
+	isb
+	orr		r14, r14, #0x04			; EXC_RETURN: thread mode, PSP
+	bx		r14
+	nop
+}
+#endif
+
+#if CFG_OS_TICKLESS_IDLE
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_IdleCountUpdate
+	@Function	: add sleep time and passed ticks into the idle-rate window
+		--> the counts are taken as us at once: a window may span a clock
+			change(Hal_Clock), the SysTick counts of both clocks differ
+	@Counts		: SysTick counts slept at the current clock, @Ticks: system ticks passed
+--------------------------------------------------------------------------*/
+static void Hal_CPU_IdleCountUpdate(unsigned int Counts, unsigned short Ticks)
+{
+	Hal_CPU_IdleUs += Counts / (SystemCoreClock / 1000000);
+	Hal_CPU_WindowTicks += Ticks;
+	
+	if(Hal_CPU_WindowTicks >= HAL_CPU_IDLE_WINDOW)
+	{
+		// us slept per tick against the tick length
+		Hal_CPU_IdleRate = ((Hal_CPU_IdleUs / Hal_CPU_WindowTicks) * OS_TICK_HZ) / 1000;
+		if(Hal_CPU_IdleRate > 1000)
+		{
+			Hal_CPU_IdleRate = 1000;
+		}
+		
+		Hal_CPU_IdleUs = 0;
+		Hal_CPU_WindowTicks = 0;
+	}
+}
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_Idle
+	@Function	: OS idle call-back(called with interrupts masked):
+				  STOP when Hal_Power allows it(CFG_POWER_STOP, Hal_CPU_Stop);
+				  Ticks < 2: sleep(WFI) till any interrupt;
+				  otherwise stretch SysTick to the next task release and sleep,
+				  the pending SysTick interrupt counts the last tick on wake
+	@Ticks		: system ticks until the next task is due
+	@Return		: complete ticks slept which SysTick interrupt has not counted
+--------------------------------------------------------------------------*/
+static unsigned short Hal_CPU_Idle(unsigned short Ticks)
+{
+	unsigned int Start;
+	unsigned int End;
+	unsigned int Loaded;
+	unsigned int Reload;
+	unsigned int Ctrl;
+	unsigned int Counts;
+	unsigned short Complete;
+	
+	if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+	{
+		// tick already pending, let it be handled first
+		return 0;
+	}
+	
+	if(Ticks > HAL_CPU_IDLE_MAX_TICKS)
+	{
+		Ticks = HAL_CPU_IDLE_MAX_TICKS;
+	}
+	
+#if CFG_POWER_STOP
+	// us till the release: rest of the current tick and the whole ones
+	if(Hal_Power_StopAllowed((SysTick->VAL / (SystemCoreClock / 1000000)) + ((Ticks - 1) * (1000000 / OS_TICK_HZ))))
+	{
+		return Hal_CPU_Stop(Ticks);
+	}
+#endif
+	
+	if(Ticks < 2)
+	{
+		Start = SysTick->VAL;
+		Hal_CPU_Sleep();
+		End = SysTick->VAL;
+		
+		if(End <= Start)
+		{
+			Counts = Start - End;
+		}
+		else
+		{
+			// SysTick wrapped while sleeping
+			Counts = Start + (HAL_CPU_TICK_RELOAD - End);
+		}
+		
+		Hal_CPU_IdleCountUpdate(Counts, 0);
+		return 0;
+	}
+	
+	// stop SysTick, load the counts till the next task release
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+	{
+		// tick expired while stopping
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		return 0;
+	}
+	Start = SysTick->VAL;
+	Loaded = Start + (HAL_CPU_TICK_RELOAD * (Ticks - 1));
+	if(Loaded > HAL_CPU_IDLE_STOP_COMPENSATION)
+	{
+		Loaded -= HAL_CPU_IDLE_STOP_COMPENSATION;
+	}
+	SysTick->LOAD = Loaded;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	
+	Hal_CPU_Sleep();
+	
+	// read CTRL once: COUNTFLAG is cleared by reading
+	Ctrl = SysTick->CTRL;
+	SysTick->CTRL = Ctrl & ~SysTick_CTRL_ENABLE_Msk;
+	End = SysTick->VAL;
+	
+	if(Ctrl & SysTick_CTRL_COUNTFLAG_Msk)
+	{
+		// slept to the release tick, SysTick interrupt is pending and counts the last tick
+		Counts = Loaded;
+		Complete = Ticks - 1;
+		
+		Reload = (HAL_CPU_TICK_RELOAD - 1) - (Loaded - End);
+		if((Reload <= HAL_CPU_IDLE_STOP_COMPENSATION) || (Reload > (HAL_CPU_TICK_RELOAD - 1)))
+		{
+			Reload = HAL_CPU_TICK_RELOAD - 1;
+		}
+	}
+	else
+	{
+		// woken up early by another interrupt
+		Counts = Loaded - End;
+		
+		// counts passed since the last tick boundary
+		Reload = (HAL_CPU_TICK_RELOAD - Start) + Counts;
+		Complete = Reload / HAL_CPU_TICK_RELOAD;
+		Reload = ((Complete + 1) * HAL_CPU_TICK_RELOAD) - Reload;
+		
+		// SysTick stood still while stopped for reprogramming(as the sleep to the release)
+		if(Reload > HAL_CPU_IDLE_STOP_COMPENSATION)
+		{
+			Reload -= HAL_CPU_IDLE_STOP_COMPENSATION;
+		}
+		else
+		{
+			Reload = 1;
+		}
+	}
+	
+	// restart SysTick with the rest of the current tick, then back to normal reload
+	SysTick->LOAD = Reload;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD = HAL_CPU_TICK_RELOAD - 1;
+	
+	Hal_CPU_IdleCountUpdate(Counts, Complete);
+	
+	return Complete;
+}
+
+#if CFG_POWER_STOP
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_Stop
+	@Function	: idle in STOP(Hal_Power) till the next task release or a
+				  wake-up line: SysTick stands still with the clocks, the
+				  time passed(RTC) is counted out as after a tickless sleep
+		--> the BASEPRI mask is swapped for PRIMASK as in Hal_CPU_Sleep,
+			the RTC resynchronised after it(Hal_Power_Sync)
+	@Ticks		: system ticks until the next task is due(1 ~ HAL_CPU_IDLE_MAX_TICKS)
+	@Return		: complete ticks slept which SysTick interrupt has not counted
+--------------------------------------------------------------------------*/
+static unsigned short Hal_CPU_Stop(unsigned short Ticks)
+{
+	unsigned int Start;
+	unsigned int Reload;
+	unsigned int Counts;
+	unsigned long Us;
+	unsigned short Complete;
+#if CFG_CPU_CRITICAL_BASEPRI
+	unsigned int BasePri;
+	unsigned int PriMask;
+#endif
+	
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)
+	{
+		// tick expired while stopping
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		return 0;
+	}
+	Start = SysTick->VAL;
+	Us = (Start / (SystemCoreClock / 1000000)) + ((Ticks - 1) * (1000000 / OS_TICK_HZ));
+	
+#if CFG_CPU_CRITICAL_BASEPRI
+	BasePri = __get_BASEPRI();
+	PriMask = __get_PRIMASK();
+	__disable_irq();
+	__set_BASEPRI(0);
+	Us = Hal_Power_Stop(Us);
+	__set_BASEPRI(BasePri);
+	__set_PRIMASK(PriMask);
+#else
+	Us = Hal_Power_Stop(Us);
+#endif
+	Hal_Power_Sync();
+	Counts = (unsigned int)Us * (SystemCoreClock / 1000000);
+	
+	// counts passed since the last tick boundary
+	Reload = (HAL_CPU_TICK_RELOAD - Start) + Counts;
+	Complete = Reload / HAL_CPU_TICK_RELOAD;
+	Reload = ((Complete + 1) * HAL_CPU_TICK_RELOAD) - Reload;	// counts left: 1 ~ HAL_CPU_TICK_RELOAD
+	if(Reload > 1)
+	{
+		Reload -= 1;
+	}
+	
+	// restart SysTick with the rest of the current tick, then back to normal reload
+	SysTick->LOAD = Reload;
+	SysTick->VAL = 0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD = HAL_CPU_TICK_RELOAD - 1;
+	
+	Hal_CPU_IdleCountUpdate(Counts, Complete);
+	
+	return Complete;
+}
+#endif
+
+/*--------------------------------------------------------------------------
+	@Name		: Hal_CPU_GetIdleRate
+	@Function	: get CPU idle rate(time spent in sleep) of the last window
+	@Return		: idle rate in per-mille(0~1000)
+--------------------------------------------------------------------------*/
+unsigned short Hal_CPU_GetIdleRate(void)
+{
+	return Hal_CPU_IdleRate;
 }
+#endif
 
 
 /*--------------------------------------------------------------------------
@@ -67,5 +626,10 @@ static void Hal_CoreClock_Init(void)
 --------------------------------------------------------------------------*/
 void SysTick_Handler(void)
 {
+	HAL_CPU_ISR_ENTER();
 	OS_ClockInterruptHandle();
+#if CFG_OS_TICKLESS_IDLE
+	Hal_CPU_IdleCountUpdate(0, 1);
+#endif
+	HAL_CPU_ISR_EXIT();
 }
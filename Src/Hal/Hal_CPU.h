@@ -1,6 +1,56 @@
 #ifndef __HAL_CPU_H_
 #define __HAL_CPU_H_
 
+#include "sysconfig.h"
+
+// NVIC preemption priorities(NVIC_PriorityGroup_4: 16 levels, no sub priority), 0: highest
+// SysTick and PendSV stay at the lowest level(15)
+#define HAL_CPU_PRIO_RFD_SAMPLE			0		// TIM4: RF sampling, above the critical section mask
+#define HAL_CPU_PRIO_RFD_CAPTURE		0		// TIM1: RF edge capture(CFG_RFD_CAPTURE), above the critical section mask
+#define HAL_CPU_PRIO_CRITICAL			1		// critical sections mask this level and below
+#define HAL_CPU_PRIO_USART1				1
+#define HAL_CPU_PRIO_USART2				2
+#define HAL_CPU_PRIO_TIME				3		// TIM2: Hal_Time wrap count, Hal_Time_Now covers it while masked
+#define HAL_CPU_PRIO_RFD_WRAP			3		// TIM1 update: below the capture, which takes a wrap pending before its edge
+#define HAL_CPU_PRIO_POWER_WAKE			13		// EXTI/RTC alarm wake-up lines(Hal_Power), unmasked only in STOP
+#define HAL_CPU_PRIO_TIMER_DEFER		14		// Hal_Timer task wake-up handed down from TIM4
+#define HAL_CPU_PRIO_RFD_DEFER			14		// Hal_RFD task wake-up handed down from the TIM1 capture
+
+#define HAL_CPU_BASEPRI					(HAL_CPU_PRIO_CRITICAL << (8 - __NVIC_PRIO_BITS))
+
+// DWT cycle counter(not defined by core_cm3.h of this CMSIS version)
+#define HAL_CPU_DWT_CTRL				(*(volatile unsigned int *)0xE0001000)
+#define HAL_CPU_DWT_CYCCNT				(*(volatile unsigned int *)0xE0001004)
+#define HAL_CPU_DWT_CTRL_CYCCNTENA		0x00000001
+
+#define HAL_CPU_TICK_RELOAD				(SystemCoreClock / OS_TICK_HZ)			// SysTick counts per system tick
+
+// tickless idle(CFG_OS_TICKLESS_IDLE)
+#define HAL_CPU_IDLE_MAX_TICKS			(0x00FFFFFF / HAL_CPU_TICK_RELOAD)		// 24bit SysTick limits the stretched sleep
+#define HAL_CPU_IDLE_STOP_COMPENSATION	45										// SysTick counts lost while SysTick is stopped for reprogramming
+#define HAL_CPU_IDLE_WINDOW				OS_TICK_HZ								// idle rate window: 1s
+
+#if CFG_CPU_STACK_CHECK
+#define HAL_CPU_STACK_PAINT_MARGIN		16		// words below the boot SP kept unpainted(Hal_CPU_Init frame)
+
+extern volatile unsigned char Hal_CPU_IsrNest;		// interrupt handlers running now
+extern volatile unsigned char Hal_CPU_IsrNestPeak;	// max interrupt handlers running at once
+
+// first and last statement of the interrupt handlers
+#define HAL_CPU_ISR_ENTER()		do{ if(++Hal_CPU_IsrNest > Hal_CPU_IsrNestPeak) Hal_CPU_IsrNestPeak = Hal_CPU_IsrNest; }while(0)
+#define HAL_CPU_ISR_EXIT()		do{ Hal_CPU_IsrNest--; }while(0)
+#else
+#define HAL_CPU_ISR_ENTER()
+#define HAL_CPU_ISR_EXIT()
+#endif
+
 void Hal_CPU_Init(void);
+unsigned int Hal_CPU_GetCycle(void);
+unsigned short Hal_CPU_GetIdleRate(void);
+#if CFG_CPU_STACK_CHECK
+unsigned int Hal_CPU_GetStackSize(void);
+unsigned int Hal_CPU_GetStackPeak(void);
+unsigned char Hal_CPU_StackReport(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len));
+#endif
 
 #endif
@@ -0,0 +1,443 @@
+/********************************************************************************
+* Module: Hal_Clock											 					*
+* Function: core clock modes, switched at run time by the application:			*
+*		@ FULL(72MHz, PLL) while armed or busy, LOW(8MHz, HSE) while idle		*
+*		@ every module with a clock derived setting registers a call-back:		*
+*		  SysTick, TIM1/TIM2/TIM3/TIM4 prescalers, USART baud rates, SPI1		*
+*		@ residency: time and entries per mode and in STOP, current estimate	*
+*		  (CFG_CLOCK_RESIDENCY)													*
+* Description:																	*
+*		@ Hal_Clock_Set runs in task context: the modules are asked first		*
+*		  (HAL_CLOCK_QUERY), a module in a transfer refuses and the caller		*
+*		  tries again later; the PLL locks with interrupts on, the switch and	*
+*		  HAL_CLOCK_CHANGED run with PRIMASK: no interrupt sees a timer			*
+*		  counting at the old rate											*
+*		@ busy-wait delays(I2C, OLED reset) take longer at 8MHz, never shorter	*
+*		@ DWT cycle counts(CFG_OS_PROFILE) are cycles of the clock at the time		*
+*		@ STOP(Hal_Power) leaves LOW on HSI: same 8MHz, no module call-back,	*
+*		  HSE started again by Hal_Clock_Set(FULL) or Hal_Clock_Crystal		*
+*		@ To add a module: 														*
+*		--> Hal_Clock_NotifyRegister(x) in the module init, x reprograms the	*
+*			module for MHz on HAL_CLOCK_CHANGED									*
+*********************************************************************************/
+
+#include "stm32f10x.h" 
+#include "hal_clock.h"
+#include "hal_time.h"
+#include "os_system.h"
+
+static Hal_ClockNotify_t Hal_Clock_NotifyList[HAL_CLOCK_NOTIFY_MAX];
+static unsigned char Hal_Clock_NotifyNum;
+
+static HAL_CLOCK_MODE_TYPEDEF Hal_Clock_Mode = HAL_CLOCK_FULL;		// SystemInit: 72MHz
+
+static const unsigned char Hal_Clock_MHz[HAL_CLOCK_MODE_SUM] = {HAL_CLOCK_FULL_MHZ, HAL_CLOCK_LOW_MHZ};
+
+#if CFG_POWER_STOP
+static unsigned char Hal_Clock_HseStart(void);
+
+static unsigned char Hal_Clock_OnHsi;		// LOW from HSI: woken up from STOP
+static unsigned char Hal_Clock_HseOn;		// HSE started(not ready yet while on HSI)
+#endif
+
+#if CFG_CLOCK_RESIDENCY
+static void Hal_Clock_Account(void);
+
+// residency lines: the modes, then STOP(Hal_Power) with the clocks off
+#if CFG_POWER_STOP
+#define HAL_CLOCK_RES_STOP			HAL_CLOCK_MODE_SUM
+#define HAL_CLOCK_RES_SUM			(HAL_CLOCK_MODE_SUM + 1)
+
+static const char *Hal_Clock_Name[HAL_CLOCK_RES_SUM] = {"FULL", "LOW", "STOP"};
+static const unsigned long Hal_Clock_UA[HAL_CLOCK_RES_SUM] = {HAL_CLOCK_FULL_UA, HAL_CLOCK_LOW_UA, HAL_CLOCK_STOP_UA};
+#else
+#define HAL_CLOCK_RES_SUM			HAL_CLOCK_MODE_SUM
+
+static const char *Hal_Clock_Name[HAL_CLOCK_RES_SUM] = {"FULL", "LOW"};
+static const unsigned long Hal_Clock_UA[HAL_CLOCK_RES_SUM] = {HAL_CLOCK_FULL_UA, HAL_CLOCK_LOW_UA};
+#endif
+
+static unsigned long long Hal_Clock_Time[HAL_CLOCK_RES_SUM];		// us per mode
+static unsigned long Hal_Clock_Entries[HAL_CLOCK_RES_SUM];
+static unsigned long Hal_Clock_Refused;							// changes refused by a module
+static unsigned long long Hal_Clock_Stamp;							// start of the current mode
+#endif
+
+/******************************************************************
+	@Name		: Hal_Clock_Init
+	@Function	: clock modes inital(API): before the modules register,
+				  the clock of SystemInit(FULL) is the current mode
+*******************************************************************/
+void Hal_Clock_Init(void)
+{
+#if CFG_CLOCK_RESIDENCY
+	unsigned char i;
+	
+#endif
+	Hal_Clock_NotifyNum = 0;
+	Hal_Clock_Mode = HAL_CLOCK_FULL;
+#if CFG_POWER_STOP
+	Hal_Clock_OnHsi = 0;
+	Hal_Clock_HseOn = 1;
+#endif
+#if CFG_CLOCK_RESIDENCY
+	for(i=0; i<HAL_CLOCK_RES_SUM; i++)
+	{
+		Hal_Clock_Time[i] = 0;
+		Hal_Clock_Entries[i] = 0;
+	}
+	Hal_Clock_Entries[HAL_CLOCK_FULL] = 1;
+	Hal_Clock_Refused = 0;
+	Hal_Clock_Stamp = 0;			// Hal_Time counts from its init on
+#endif
+}
+
+/******************************************************************
+	@Name		: Hal_Clock_NotifyRegister
+	@Function	: add a clock change call-back(API), module init,
+				  registered again or registry full: not added
+	@Parameters	: 
+		* pNotify: call-back of the module
+*******************************************************************/
+void Hal_Clock_NotifyRegister(Hal_ClockNotify_t pNotify)
+{
+	unsigned char i;
+	
+	for(i=0; i<Hal_Clock_NotifyNum; i++)
+	{
+		if(Hal_Clock_NotifyList[i] == pNotify)
+		{
+			return;
+		}
+	}
+	if(Hal_Clock_NotifyNum < HAL_CLOCK_NOTIFY_MAX)
+	{
+		Hal_Clock_NotifyList[Hal_Clock_NotifyNum] = pNotify;
+		Hal_Clock_NotifyNum++;
+	}
+}
+
+/******************************************************************
+	@Name		: Hal_Clock_Set
+	@Function	: change the clock mode(API), task context
+		--> up: flash wait states, then PLL locked, then SYSCLK = PLL,
+			HSE started first when woken up from STOP(on HSI)
+		--> down: SYSCLK = HSE, then PLL off and flash wait states
+		--> APB1 stays within 36MHz, its timers at HCLK in both modes
+		--> HSE or PLL not ready within HAL_CLOCK_READY_TIMEOUT polls(as
+			SystemInit): the change is given up, the clock stays as it is
+	@Parameters	: 
+		* Mode: HAL_CLOCK_FULL, HAL_CLOCK_LOW
+	@Return		: 1: running in Mode, 0: refused by a module or HSE/PLL
+				  did not start, try again
+*******************************************************************/
+unsigned char Hal_Clock_Set(HAL_CLOCK_MODE_TYPEDEF Mode)
+{
+	unsigned char i;
+	unsigned int Sta;
+	unsigned int Timeout;
+	
+	if((Mode == Hal_Clock_Mode) || (Mode >= HAL_CLOCK_MODE_SUM))
+	{
+		return (Mode == Hal_Clock_Mode);
+	}
+	
+	for(i=0; i<Hal_Clock_NotifyNum; i++)
+	{
+		if(!Hal_Clock_NotifyList[i](HAL_CLOCK_QUERY, Hal_Clock_MHz[Mode]))
+		{
+		#if CFG_CLOCK_RESIDENCY
+			Hal_Clock_Refused++;
+		#endif
+			return 0;
+		}
+	}
+	
+	if(Mode == HAL_CLOCK_FULL)
+	{
+	#if CFG_POWER_STOP
+		if(!Hal_Clock_HseStart())						// PLL source
+		{
+			return 0;
+		}
+	#endif
+		FLASH_SetLatency(FLASH_Latency_2);				// 48~72MHz
+		RCC_PLLCmd(ENABLE);								// PLL source and x9 kept from SystemInit
+		for(Timeout = 0; RCC_GetFlagStatus(RCC_FLAG_PLLRDY) == RESET; Timeout++)
+		{
+			if(Timeout >= HAL_CLOCK_READY_TIMEOUT)
+			{
+				RCC_PLLCmd(DISABLE);
+				FLASH_SetLatency(FLASH_Latency_0);
+				return 0;
+			}
+		}
+	}
+	
+	Sta = __get_PRIMASK();
+	__disable_irq();
+#if CFG_CLOCK_RESIDENCY
+	Hal_Clock_Account();
+	Hal_Clock_Entries[Mode]++;
+#endif
+	if(Mode == HAL_CLOCK_FULL)
+	{
+		RCC_PCLK1Config(RCC_HCLK_Div2);					// APB1 36MHz max
+		RCC_SYSCLKConfig(RCC_SYSCLKSource_PLLCLK);
+		while(RCC_GetSYSCLKSource() != 0x08);
+	#if CFG_POWER_STOP
+		Hal_Clock_OnHsi = 0;
+	#endif
+	}
+	else
+	{
+		RCC_SYSCLKConfig(RCC_SYSCLKSource_HSE);
+		while(RCC_GetSYSCLKSource() != 0x04);
+		RCC_PCLK1Config(RCC_HCLK_Div1);
+	}
+	SystemCoreClockUpdate();
+	Hal_Clock_Mode = Mode;
+	
+	for(i=0; i<Hal_Clock_NotifyNum; i++)
+	{
+		Hal_Clock_NotifyList[i](HAL_CLOCK_CHANGED, Hal_Clock_MHz[Mode]);
+	}
+	__set_PRIMASK(Sta);
+	
+	if(Mode == HAL_CLOCK_LOW)
+	{
+		RCC_PLLCmd(DISABLE);
+		FLASH_SetLatency(FLASH_Latency_0);				// 0~24MHz
+	}
+	
+	return 1;
+}
+
+/******************************************************************
+	@Name		: Hal_Clock_GetMode
+	@Function	: current clock mode(API)
+*******************************************************************/
+HAL_CLOCK_MODE_TYPEDEF Hal_Clock_GetMode(void)
+{
+	return Hal_Clock_Mode;
+}
+
+/******************************************************************
+	@Name		: Hal_Clock_GetMHz
+	@Function	: HCLK of the current clock mode(API): prescaler of
+				  the 1us time bases at init is Hal_Clock_GetMHz() - 1
+	@Return		: MHz
+*******************************************************************/
+unsigned char Hal_Clock_GetMHz(void)
+{
+	return Hal_Clock_MHz[Hal_Clock_Mode];
+}
+
+#if CFG_POWER_STOP
+/******************************************************************
+	@Name		: Hal_Clock_Query
+	@Function	: ask the modules before the clocks stop(API, Hal_Power):
+				  STOP cuts a transfer as a clock change does
+	@Return		: 1: the clocks may stop, 0: refused by a module
+*******************************************************************/
+unsigned char Hal_Clock_Query(void)
+{
+	unsigned char i;
+	
+	for(i=0; i<Hal_Clock_NotifyNum; i++)
+	{
+		if(!Hal_Clock_NotifyList[i](HAL_CLOCK_QUERY, Hal_Clock_MHz[Hal_Clock_Mode]))
+		{
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/******************************************************************
+	@Name		: Hal_Clock_Wake
+	@Function	: STOP left(API, Hal_Power, interrupts off): the core
+				  runs on HSI at the LOW clock, HSE and PLL are off(a
+				  wake-up line pending at the entry: no STOP, still HSE)
+	@Parameters	: 
+		* Us: time slept, Hal_Time already moved on by it: STOP
+			  residency(CFG_CLOCK_RESIDENCY), not LOW
+*******************************************************************/
+void Hal_Clock_Wake(unsigned long Us)
+{
+	Hal_Clock_OnHsi = (RCC_GetSYSCLKSource() == 0x00);
+	Hal_Clock_HseOn = !Hal_Clock_OnHsi;
+#if CFG_CLOCK_RESIDENCY
+	Hal_Clock_Time[HAL_CLOCK_RES_STOP] += Us;
+	Hal_Clock_Entries[HAL_CLOCK_RES_STOP]++;
+	Hal_Clock_Stamp += Us;
+#else
+	(void)Us;
+#endif
+}
+
+/******************************************************************
+	@Name		: Hal_Clock_Crystal
+	@Function	: LOW back on the HSE crystal after STOP(API, idle path):
+				  HSE started on the first call, SYSCLK switched on a
+				  later call once it is ready(start-up ~2ms, not waited)
+	@Return		: 1: SYSCLK from the crystal(HSE or PLL), 0: HSI still
+*******************************************************************/
+unsigned char Hal_Clock_Crystal(void)
+{
+	unsigned int Sta;
+	
+	if(!Hal_Clock_OnHsi)
+	{
+		return 1;
+	}
+	if(!Hal_Clock_HseOn)
+	{
+		RCC_HSEConfig(RCC_HSE_ON);
+		Hal_Clock_HseOn = 1;
+	}
+	if(RCC_GetFlagStatus(RCC_FLAG_HSERDY) == RESET)
+	{
+		return 0;
+	}
+	
+	// same 8MHz: no module to reprogram
+	Sta = __get_PRIMASK();
+	__disable_irq();
+	RCC_SYSCLKConfig(RCC_SYSCLKSource_HSE);
+	while(RCC_GetSYSCLKSource() != 0x04);
+	Hal_Clock_OnHsi = 0;
+	__set_PRIMASK(Sta);
+	
+	return 1;
+}
+
+/******************************************************************
+	@Name		: Hal_Clock_HseStart(static)
+	@Function	: HSE on and ready for the PLL, waited: STOP left it off
+		--> not ready within HAL_CLOCK_READY_TIMEOUT polls: HSE off again
+			while the core runs on HSI, started again on the next call
+	@Return		: 1: HSE ready, 0: crystal did not start
+*******************************************************************/
+static unsigned char Hal_Clock_HseStart(void)
+{
+	unsigned int Timeout;
+	
+	if(!Hal_Clock_HseOn)
+	{
+		RCC_HSEConfig(RCC_HSE_ON);
+		Hal_Clock_HseOn = 1;
+	}
+	for(Timeout = 0; RCC_GetFlagStatus(RCC_FLAG_HSERDY) == RESET; Timeout++)
+	{
+		if(Timeout >= HAL_CLOCK_READY_TIMEOUT)
+		{
+			if(Hal_Clock_OnHsi)
+			{
+				RCC_HSEConfig(RCC_HSE_OFF);
+				Hal_Clock_HseOn = 0;
+			}
+			return 0;
+		}
+	}
+	return 1;
+}
+#endif
+
+#if CFG_CLOCK_RESIDENCY
+/******************************************************************
+	@Name		: Hal_Clock_Account(static)
+	@Function	: add the time since the last change to the current mode
+*******************************************************************/
+static void Hal_Clock_Account(void)
+{
+	unsigned long long Now;
+	
+	Now = Hal_Time_Now();
+	Hal_Clock_Time[Hal_Clock_Mode] += Now - Hal_Clock_Stamp;
+	Hal_Clock_Stamp = Now;
+}
+
+/******************************************************************
+	@Name		: Hal_Clock_Report
+	@Function	: output the clock mode residency as one line per call:
+				  Index 0~1: "CLK,Mode,MHz,Entries,ms,Permille,uA\r\n"
+				  Index 2: "CLK,STOP,0,Entries,ms,Permille,uA\r\n"(CFG_POWER_STOP)
+				  last: "CLK,AVG,Refused,uA\r\n"
+				  uA: HAL_CLOCK_xxx_UA weighted by the time in each mode,
+				  Run mode values: the sleep in idle(WFI) draws less
+	@Index		: line index
+	@Output		: output function, e.g. Hal_USART_DebugDataQueue
+	@Return		: 1: line output, 0: Index past the last line
+*******************************************************************/
+unsigned char Hal_Clock_Report(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len))
+{
+	unsigned char Buff[64] = "CLK,";
+	unsigned char Len = 4;
+	unsigned char i;
+	unsigned int Sta;
+	const char *pName;
+	unsigned long long Time[HAL_CLOCK_RES_SUM];
+	unsigned long long Total;
+	unsigned long long Charge;
+	
+	if(Index > HAL_CLOCK_RES_SUM)
+	{
+		return 0;
+	}
+	
+	Sta = __get_PRIMASK();
+	__disable_irq();
+	Hal_Clock_Account();
+	for(i=0; i<HAL_CLOCK_RES_SUM; i++)
+	{
+		Time[i] = Hal_Clock_Time[i];
+	}
+	__set_PRIMASK(Sta);
+	
+	Total = 0;
+	Charge = 0;
+	for(i=0; i<HAL_CLOCK_RES_SUM; i++)
+	{
+		Total += Time[i];
+		Charge += Time[i] * Hal_Clock_UA[i];
+	}
+	if(!Total)
+	{
+		Total = 1;
+	}
+	
+	if(Index < HAL_CLOCK_RES_SUM)
+	{
+		for(pName = Hal_Clock_Name[Index]; *pName; pName++)
+		{
+			Buff[Len++] = *pName;
+		}
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr((Index < HAL_CLOCK_MODE_SUM) ? Hal_Clock_MHz[Index] : 0, &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Hal_Clock_Entries[Index], &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr((unsigned long)(Time[Index] / 1000), &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr((unsigned long)(Time[Index] * 1000 / Total), &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Hal_Clock_UA[Index], &Buff[Len]);
+	}
+	else
+	{
+		Buff[Len++] = 'A';
+		Buff[Len++] = 'V';
+		Buff[Len++] = 'G';
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Hal_Clock_Refused, &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr((unsigned long)(Charge / Total), &Buff[Len]);
+	}
+	Buff[Len++] = '\r';
+	Buff[Len++] = '\n';
+	
+	Output(Buff, Len);
+	return 1;
+}
+#endif
@@ -0,0 +1,76 @@
+#ifndef __HAL_CLOCK_H_
+#define __HAL_CLOCK_H_
+
+#include "sysconfig.h"
+
+/*************************************************************
+	@Clock modes: the timer clocks follow HCLK in both modes
+		--> FULL: SYSCLK = PLL(HSE x9), APB1 = HCLK/2(timers x2), flash 2 wait states
+		--> LOW : SYSCLK = HSE, PLL off, APB1 = HCLK, flash 0 wait states
+			the crystal keeps the 1us time bases and the baud rates exact
+		--> STOP(Hal_Power, CFG_POWER_STOP) from LOW: the core wakes up on
+			HSI at the same 8MHz, HSE is started again only for FULL(PLL)
+			or the LSI calibration(Hal_Clock_Crystal)
+**************************************************************/
+#define HAL_CLOCK_FULL_MHZ			CFG_CORE_CLOCK_MHZ
+#define HAL_CLOCK_LOW_MHZ			8			// HSE crystal
+
+#define HAL_CLOCK_NOTIFY_MAX		8			// registered clock change call-backs
+#define HAL_CLOCK_READY_TIMEOUT		HSE_STARTUP_TIMEOUT	// HSERDY/PLLRDY polls before a start is given up(as SystemInit)
+
+// Run mode current of the MCU(code from flash, peripherals enabled), STM32F103xB datasheet
+// typical values: an estimate for the report, the board is not measured
+#define HAL_CLOCK_FULL_UA			36000
+#define HAL_CLOCK_LOW_UA			5500
+#define HAL_CLOCK_STOP_UA			15			// STOP, low-power regulator: 14uA + LSI/RTC
+
+typedef enum
+{
+	HAL_CLOCK_FULL = 0,
+	HAL_CLOCK_LOW,
+	HAL_CLOCK_MODE_SUM,
+}HAL_CLOCK_MODE_TYPEDEF;
+
+typedef enum
+{
+	HAL_CLOCK_QUERY = 0,		// before the change, interrupts on: return 0 to refuse(transfer running)
+	HAL_CLOCK_CHANGED,			// new clock running, interrupts off: reprogram the prescalers
+}HAL_CLOCK_EVENT_TYPEDEF;
+
+// clock change call-back of a module, MHz: HCLK of the new mode
+typedef unsigned char (*Hal_ClockNotify_t)(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz);
+
+/*************************************************************
+	@Timer rescale(HAL_CLOCK_CHANGED): 1 count per us at MHz, count kept
+		--> the update generation(UG) loads the prescaler at once and clears
+			the counter, the count is written back: at most one count is lost
+		--> TIM_UpdateSource_Regular set at init: UG raises no update flag,
+			a flag set while reloading is a wrap, the count restarts from 0
+**************************************************************/
+#define HAL_CLOCK_TIM_RESCALE(TIMx, MHz)											\
+	do{																				\
+		uint16_t Flag_ = (TIMx)->SR & TIM_FLAG_Update;								\
+		uint16_t Cnt_ = (TIMx)->CNT;												\
+		TIM_PrescalerConfig((TIMx), (uint16_t)((MHz) - 1), TIM_PSCReloadMode_Immediate);	\
+		if(!Flag_ && ((TIMx)->SR & TIM_FLAG_Update))								\
+		{																			\
+			Cnt_ = 0;																\
+		}																			\
+		TIM_SetCounter((TIMx), Cnt_);												\
+	}while(0)
+
+void Hal_Clock_Init(void);
+void Hal_Clock_NotifyRegister(Hal_ClockNotify_t pNotify);
+unsigned char Hal_Clock_Set(HAL_CLOCK_MODE_TYPEDEF Mode);
+HAL_CLOCK_MODE_TYPEDEF Hal_Clock_GetMode(void);
+unsigned char Hal_Clock_GetMHz(void);
+#if CFG_POWER_STOP
+unsigned char Hal_Clock_Query(void);
+void Hal_Clock_Wake(unsigned long Us);
+unsigned char Hal_Clock_Crystal(void);
+#endif
+#if CFG_CLOCK_RESIDENCY
+unsigned char Hal_Clock_Report(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len));
+#endif
+
+#endif
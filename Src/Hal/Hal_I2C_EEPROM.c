@@ -201,9 +201,9 @@ static void Hal_I2C_Delay(unsigned short t)
 
 /*-------------------------- EEPROM functions --------------------------------------*/
 /* Device: AT24C128, Device address: (MSB->LSB) 1 0 1 0 0 A1 A0 R/W
-/* A1, A0 grounded --> Device address: (MSB->LSB) 1 0 1 0 0 0 0 R/W
-/* Write to EEPROM --> Device address: (R/W = 0) 1 0 1 0 0 0 0 0
-/* Read from EEPROM --> Device address: (R/W = 1) 1 0 1 0 0 0 0 1
+   A1, A0 grounded --> Device address: (MSB->LSB) 1 0 1 0 0 0 0 R/W
+   Write to EEPROM --> Device address: (R/W = 0) 1 0 1 0 0 0 0 0
+   Read from EEPROM --> Device address: (R/W = 1) 1 0 1 0 0 0 0 1 */
 
 /*----------------------------------------------------------------------------
 @Name		: Hal_I2C_EEPROM_ByteWrite(address, Byte)
@@ -12,6 +12,8 @@
 
 #include "stm32f10x.h"
 #include "hal_key.h"
+#include "hal_time.h"
+#include "hal_power.h"
 
 
 static void Hal_Key_Config(void);
@@ -29,6 +31,8 @@ unsigned char (*GetKeyState[KEY_NUM])() = {  Hal_Key_GetKey_1_State,Hal_Key_GetK
 
 KeyEvent_CallBack_t KeyScanCBF; // KeyScan call-back function
 
+static unsigned long long KeyStamp;	// time of the last key event(us)
+
 unsigned char KeyStep[KEY_NUM];								
 unsigned short KeyScanTime[KEY_NUM];						
 unsigned short KeyPressLongTimer[KEY_NUM];					
@@ -157,6 +161,8 @@ void Hal_Key_Pro(void)
 		
 		if(KeyValue)
 		{
+			KeyStamp = Hal_Time_Now();
+			Hal_Power_WakeDone(HAL_POWER_WAKE_KEY);
 			if(KeyScanCBF)
 			{	 
 				KeyScanCBF((KEY_VALUE_TYPEDEF)KeyValue); 
@@ -166,6 +172,17 @@ void Hal_Key_Pro(void)
 	}
 }
 
+/*----------------------------------------------------------------------------
+@Name		: Hal_Key_GetStamp()
+@Function	: time of the last key event, read in the call-back or later
+@Parameter	: Null
+@Return		: Hal_Time_Now() when the key value was detected(us)
+------------------------------------------------------------------------------*/
+unsigned long long Hal_Key_GetStamp(void)
+{
+	return KeyStamp;
+}
+
 /*----------------------------------------------------------------------------
 @Name		: Hal_Key_Config()
 @Function	: Key config 
@@ -113,5 +113,6 @@ typedef void (*KeyEvent_CallBack_t)(KEY_VALUE_TYPEDEF KeyValue);
 void Hal_Key_Init(void);
 void Hal_Key_Pro(void);
 void Hal_Key_KeyScanCBF_Register(KeyEvent_CallBack_t pCBF);
+unsigned long long Hal_Key_GetStamp(void);
 
 #endif
@@ -23,7 +23,7 @@ static void Hal_Buz_Drive(unsigned char sta);
 static void Hal_LED_Handler(void);
 static void Hal_LED_Config(void);
 
-Queue4	LED_CMDBuffer[LED_TARGET_SUM]; 
+Queue(CFG_QUEUE_LED_CMD)	LED_CMDBuffer[LED_TARGET_SUM]; 
 
 unsigned short Led_Off[] = {0,10,LED_EFFECT_END};
 unsigned short Led_On[] = {1,10,LED_EFFECT_END};
@@ -38,6 +38,8 @@ unsigned char LED_LoadFlag[LED_TARGET_SUM];
 unsigned short *pLED[LED_TARGET_SUM];
 unsigned short LED_Timer[LED_TARGET_SUM];
 
+static Hal_TimerHandle_t LED_TimerHandle;	// 10ms periodic timer of Hal_LED_Handler
+
 void (*Hal_LED_Drive[LED_TARGET_SUM])(unsigned char) = { Hal_LED_1_Drive,Hal_Buz_Drive,
 };
 
@@ -45,7 +47,7 @@ void (*Hal_LED_Drive[LED_TARGET_SUM])(unsigned char) = { Hal_LED_1_Drive,Hal_Buz
 @Name		: Hal_LED_Init()
 @Function	: LED module initialization
 		--> LED GPIO init
-		--> creat LED Timer T_LED， Hal_LED_Handler as the Interrupt handler， period 10ms
+		--> creat the periodic LED Timer， Hal_LED_Handler as the handler， period 10ms
 		--> clear idle-flag for all registered devices 
 		--> empty LED_CMDBuffer
 @Parameter	: Null
@@ -54,7 +56,7 @@ void Hal_LED_Init(void)
 {
 	unsigned char i;
 	Hal_LED_Config();
-	Hal_Timer_CreatTimer(T_LED, Hal_LED_Handler, 200, T_STATE_START); // timebase=50us;
+	LED_TimerHandle = Hal_Timer_CreatTimer(Hal_LED_Handler, HAL_TIMER_MS_TO_TICKS(10), T_STATE_START, T_MODE_PERIODIC, T_EXEC_TASK); // period = 10ms
 	
 	for(i=0; i<LED_TARGET_SUM; i++)
 	{
@@ -62,6 +64,7 @@ void Hal_LED_Init(void)
 		pLED[i] = (unsigned short *)Led_Off;
 		LED_Timer[i] = *(pLED[i]+1);
 		QueueEmpty(LED_CMDBuffer[i]);
+		QueueRegister(LED_CMDBuffer[i], "LED_CMD");
 	}
 	
 	Hal_LED_MsgInput(LED_1,LED_OFF,1);
@@ -183,7 +186,6 @@ static void Hal_LED_Handler(void)
 		}
 		Hal_LED_Drive[i](*pLED[i]);
 	}
-	Hal_Timer_ResetTimer(T_LED,T_STATE_START);
 }
 
 /*----------------------------------------------------------------------------
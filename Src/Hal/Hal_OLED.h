@@ -44,6 +44,8 @@ enum
     ICON_MAX,
 };
 
+extern const unsigned char gImage_BMP[ICON_MAX][32];
+extern unsigned char OLED_GRAM[128][8];	// frame buffer(Hal_OLED_GRAM.c)
 
 void hal_OledInit(void);
 void hal_Oled_Color_Turn(unsigned char i);
@@ -52,11 +54,11 @@ void hal_Oled_Display_on(void);
 void hal_Oled_Display_Off(void);
 void hal_Oled_Refresh(void);
 void hal_Oled_Clear(void);
-static void hal_Oled_DrawPoint(unsigned char x,unsigned char y,unsigned char t);
+void hal_Oled_ClearGRAM(void);
 void hal_Oled_DrawLine(unsigned char x1,unsigned char y1,unsigned char x2,unsigned char y2,unsigned char mode);
 void hal_Oled_DrawCircle(unsigned char x,unsigned char y,unsigned char r);
 void hal_Oled_ShowChar(unsigned char x,unsigned char y,unsigned char chr,unsigned char size1,unsigned char mode);
-void hal_Oled_ShowString(unsigned char x,unsigned char y,unsigned char *chr,unsigned char size1,unsigned char mode);
+void hal_Oled_ShowString(unsigned char x,unsigned char y,const char *chr,unsigned char size1,unsigned char mode);
 void hal_Oled_ShowNum(unsigned char x,unsigned char y,unsigned int num,unsigned char len,unsigned char size1,unsigned char mode);
 void hal_Oled_ShowChinese(unsigned char x,unsigned char y,unsigned char num,unsigned char size1,unsigned char mode);
 void hal_Oled_ScrollDisplay(unsigned char num,unsigned char space,unsigned char mode);
@@ -0,0 +1,602 @@
+/********************************************************************************
+* Module: Hal_Power											 					*
+* Function: STOP mode for the idle time of the LOW clock:						*
+*		@ entered from the OS idle call-back(Hal_CPU) when the window till		*
+*		  the next task release and the next Hal_Timer expiry is long enough,	*
+*		  no wakelock is taken and every clock module agrees(HAL_CLOCK_QUERY)	*
+*		@ wake-up: RF data edge, key press(EXTI) or the RTC alarm at the end	*
+*		  of the window															*
+*		@ the time slept is read from the RTC(LSI) and handed to the modules	*
+*		  whose counters stood still: Hal_Time, Hal_Timer, Hal_RFD, SysTick		*
+*		@ wake-up statistics and RF wake-up -> decode latency					*
+*		  (CFG_POWER_WAKE_STAT)													*
+* Description:																	*
+*		@ the RTC keeps counting over a reset: the backup domain is reset and	*
+*		  the RTC set up only when it is not on LSI with HAL_POWER_BKP_MARK		*
+*		@ LSI is off by +-50%: the RTC counts are measured against Hal_Time		*
+*		  (HSE crystal) over HAL_POWER_CAL_MS before the first STOP and every	*
+*		  HAL_POWER_CAL_PERIOD_S, back on HSE first if woken up on HSI			*
+*		@ the wake-up lines are unmasked(EXTI_IMR) only around the WFI with		*
+*		  PRIMASK set: their interrupt handlers only clear a stray pending bit	*
+*		@ the edge waking the core is not captured(TIM1 stood still): the		*
+*		  first RF frame is lost, STOP is held off for HAL_POWER_WAKE_HOLD_MS	*
+*		  so the repeats of the code are captured								*
+*		@ To add a module: 														*
+*		--> Hal_Power_NotifyRegister(x) in the module init, x moves the			*
+*			module counters on by the time slept								*
+*********************************************************************************/
+
+#include "stm32f10x.h" 
+#include "hal_power.h"
+#include "hal_clock.h"
+#include "hal_time.h"
+#include "hal_timer.h"
+#include "hal_cpu.h"
+#include "os_system.h"
+
+#if CFG_POWER_STOP
+static unsigned char Hal_Power_RtcInit(void);
+static unsigned char Hal_Power_Calibrate(void);
+static unsigned long Hal_Power_Window(unsigned long Us);
+static unsigned long Hal_Power_AlarmSet(unsigned long Us);
+
+static Hal_PowerNotify_t Hal_Power_NotifyList[HAL_POWER_NOTIFY_MAX];
+static unsigned char Hal_Power_NotifyNum;
+
+static volatile unsigned char Hal_Power_Lock;		// wakelocks taken: HAL_POWER_LOCK_xxx
+static unsigned long long Hal_Power_HoldEnd;		// no STOP before(Hal_Time, RF wake-up)
+static unsigned long Hal_Power_Alarm;				// RTC alarm as written(RTC count)
+static unsigned char Hal_Power_SyncDue;			// RTC registers not read since the alarm wake-up
+
+// LSI calibration: CalCounts RTC counts in CalUs(0: not calibrated yet)
+static unsigned long Hal_Power_CalCounts;
+static unsigned long Hal_Power_CalUs;
+static unsigned char Hal_Power_CalRun;				// window running: STOP held off
+static unsigned long Hal_Power_CalRtc;				// RTC count at the window start
+static unsigned long long Hal_Power_CalStart;		// Hal_Time at the window start
+static unsigned long long Hal_Power_CalEnd;			// Hal_Time of the last calibration
+
+#if CFG_POWER_WAKE_STAT
+static unsigned long Hal_Power_Wakes[HAL_POWER_WAKE_SUM];
+static unsigned long Hal_Power_Calibrations;
+
+// wake-up -> first RF code / key event
+static HAL_POWER_WAKE_TYPEDEF Hal_Power_WakeSource;	// HAL_POWER_WAKE_SUM: none pending
+static unsigned long long Hal_Power_WakeStamp;
+static Hal_Time_LatencyTypeDef Hal_Power_Latency[HAL_POWER_WAKE_KEY + 1];
+#endif
+
+/******************************************************************
+	@Name		: Hal_Power_Init
+	@Function	: STOP mode inital(API): RTC on LSI(Hal_Power_RtcInit),
+				  wake-up lines configured but masked, not calibrated
+		--> LSI did not start: STOP refused for good(HAL_POWER_LOCK_RTC)
+*******************************************************************/
+void Hal_Power_Init(void)
+{
+	EXTI_InitTypeDef EXTI_InitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+	
+	Hal_Power_NotifyNum = 0;
+	Hal_Power_Lock = 0;
+	Hal_Power_HoldEnd = 0;
+	Hal_Power_CalCounts = 0;
+	Hal_Power_CalUs = 0;
+	Hal_Power_CalRun = 0;
+	Hal_Power_SyncDue = 0;
+#if CFG_POWER_WAKE_STAT
+	Hal_Power_WakeSource = HAL_POWER_WAKE_SUM;
+	LatencyRegister(Hal_Power_Latency[HAL_POWER_WAKE_RF], "WAKE_RF");
+	LatencyRegister(Hal_Power_Latency[HAL_POWER_WAKE_KEY], "WAKE_KEY");
+#endif
+	
+	if(Hal_Power_RtcInit())
+	{
+		Hal_Power_Alarm = RTC_GetCounter();		// passed: written by the first STOP
+	}
+	else
+	{
+		Hal_Power_Lock = HAL_POWER_LOCK_RTC;
+	}
+	
+	// EXTI line n: pin n of the port selected here
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOA, GPIO_PinSource11);	// RF data
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOB, GPIO_PinSource3);		// K1
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOB, GPIO_PinSource5);		// K2
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOB, GPIO_PinSource6);		// K3
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOB, GPIO_PinSource7);		// K4
+	GPIO_EXTILineConfig(GPIO_PortSourceGPIOB, GPIO_PinSource10);	// K5
+	
+	EXTI_InitStructure.EXTI_Mode = EXTI_Mode_Interrupt;
+	EXTI_InitStructure.EXTI_LineCmd = ENABLE;
+	EXTI_InitStructure.EXTI_Line = HAL_POWER_EXTI_RF;
+	EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising_Falling;
+	EXTI_Init(&EXTI_InitStructure);
+	EXTI_InitStructure.EXTI_Line = HAL_POWER_EXTI_KEY;
+	EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Falling;			// keys pull low
+	EXTI_Init(&EXTI_InitStructure);
+	EXTI_InitStructure.EXTI_Line = HAL_POWER_EXTI_RTC;
+	EXTI_InitStructure.EXTI_Trigger = EXTI_Trigger_Rising;
+	EXTI_Init(&EXTI_InitStructure);
+	
+	EXTI->IMR &= ~HAL_POWER_EXTI_ALL;								// unmasked by Hal_Power_Stop only
+	EXTI_ClearITPendingBit(HAL_POWER_EXTI_ALL);
+	
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_POWER_WAKE;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStructure.NVIC_IRQChannel = EXTI3_IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+	NVIC_InitStructure.NVIC_IRQChannel = EXTI9_5_IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+	NVIC_InitStructure.NVIC_IRQChannel = EXTI15_10_IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+	NVIC_InitStructure.NVIC_IRQChannel = RTCAlarm_IRQn;
+	NVIC_Init(&NVIC_InitStructure);
+}
+
+/******************************************************************
+	@Name		: Hal_Power_NotifyRegister
+	@Function	: add a wake-up call-back(API, module init),
+				  registered again or list full: ignored
+*******************************************************************/
+void Hal_Power_NotifyRegister(Hal_PowerNotify_t pNotify)
+{
+	unsigned char i;
+	
+	for(i=0; i<Hal_Power_NotifyNum; i++)
+	{
+		if(Hal_Power_NotifyList[i] == pNotify)
+		{
+			return;
+		}
+	}
+	if(Hal_Power_NotifyNum < HAL_POWER_NOTIFY_MAX)
+	{
+		Hal_Power_NotifyList[Hal_Power_NotifyNum++] = pNotify;
+	}
+}
+
+/******************************************************************
+	@Name		: Hal_Power_WakeLock, Hal_Power_WakeUnlock
+	@Function	: take or release a wakelock(API, task context):
+				  STOP refused while any is taken, WFI still allowed
+*******************************************************************/
+void Hal_Power_WakeLock(unsigned char Lock)
+{
+	Hal_Power_Lock |= Lock;
+}
+
+void Hal_Power_WakeUnlock(unsigned char Lock)
+{
+	Hal_Power_Lock &= (unsigned char)~Lock;
+}
+
+/******************************************************************
+	@Name		: Hal_Power_StopAllowed
+	@Function	: STOP for the idle window(API, idle path, interrupts
+				  masked): LOW clock, no wakelock, no RF wake-up hold,
+				  LSI calibrated and no module busy
+		--> runs the LSI calibration when it is due
+		--> STOP allowed: the RTC alarm written here, before the
+			PRIMASK section of Hal_Power_Stop(BASEPRI mask)
+	@Parameters	: 
+		* Us: time till the next task release
+	@Return		: 1: Hal_Power_Stop may be called, 0: WFI
+*******************************************************************/
+unsigned char Hal_Power_StopAllowed(unsigned long Us)
+{
+	if((Hal_Clock_GetMode() != HAL_CLOCK_LOW) || Hal_Power_Lock)
+	{
+		return 0;
+	}
+	if(Hal_Time_Now() < Hal_Power_HoldEnd)
+	{
+		return 0;
+	}
+	if(!Hal_Power_Calibrate())
+	{
+		return 0;
+	}
+	Us = Hal_Power_Window(Us);
+	if(Us < HAL_POWER_STOP_MIN_US)
+	{
+		return 0;
+	}
+	if(!Hal_Clock_Query())
+	{
+		return 0;
+	}
+	Hal_Power_AlarmSet(Us);
+	return 1;
+}
+
+/******************************************************************
+	@Name		: Hal_Power_Stop
+	@Function	: sleep in STOP till a wake-up line or the RTC alarm
+				  (API, idle path, PRIMASK set)
+		--> the RTC alarm ends the window(Hal_Power_AlarmSet), as a
+			rule already written by Hal_Power_StopAllowed
+		--> RTC wake-up: the resynchronisation is left to
+			Hal_Power_Sync(PRIMASK restored), RF or key wake-up: the
+			counter is read here for the time slept
+		--> time slept: RTC counts, an alarm wake-up half a count
+			before the counter read, plus the regulator wake-up
+		--> the call-backs move the module counters on, then
+			Hal_Clock takes the STOP residency(core on HSI)
+		--> a line pending before the WFI: no STOP, no call-back
+	@Parameters	: 
+		* MaxUs: time till the next task release
+	@Return		: us passed in this call(for SysTick)
+*******************************************************************/
+unsigned long Hal_Power_Stop(unsigned long MaxUs)
+{
+	unsigned long long Enter;
+	unsigned long Counts;
+	unsigned long Start;
+	unsigned long Pending;
+	unsigned long Slept;
+	HAL_POWER_WAKE_TYPEDEF Source;
+	unsigned char i;
+	
+	Enter = Hal_Time_Now();
+	MaxUs = Hal_Power_Window(MaxUs);
+	Start = Hal_Power_AlarmSet(MaxUs);
+	Counts = Hal_Power_Alarm - Start;
+	RTC_ClearFlag(RTC_FLAG_ALR);
+	
+	EXTI_ClearITPendingBit(HAL_POWER_EXTI_ALL);
+	EXTI->IMR |= HAL_POWER_EXTI_ALL;
+	PWR_EnterSTOPMode(PWR_Regulator_LowPower, PWR_STOPEntry_WFI);
+	EXTI->IMR &= ~HAL_POWER_EXTI_ALL;
+	
+	Pending = EXTI->PR & HAL_POWER_EXTI_ALL;
+	EXTI_ClearITPendingBit(HAL_POWER_EXTI_ALL);
+	NVIC_ClearPendingIRQ(EXTI3_IRQn);
+	NVIC_ClearPendingIRQ(EXTI9_5_IRQn);
+	NVIC_ClearPendingIRQ(EXTI15_10_IRQn);
+	NVIC_ClearPendingIRQ(RTCAlarm_IRQn);
+	
+	if(Pending & HAL_POWER_EXTI_RF)
+	{
+		Source = HAL_POWER_WAKE_RF;
+	}
+	else if(Pending & HAL_POWER_EXTI_KEY)
+	{
+		Source = HAL_POWER_WAKE_KEY;
+	}
+	else if(Pending & HAL_POWER_EXTI_RTC)
+	{
+		Source = HAL_POWER_WAKE_RTC;
+	}
+	else
+	{
+		Source = HAL_POWER_WAKE_OTHER;
+	}
+	
+	if(Source != HAL_POWER_WAKE_OTHER)
+	{
+		if(Source == HAL_POWER_WAKE_RTC)
+		{
+			Hal_Power_SyncDue = 1;
+			// the alarm count started half a count(on average) after the entry
+			Slept = (unsigned long)((((unsigned long long)Counts * 2 - 1) * Hal_Power_CalUs) / (2 * (unsigned long long)Hal_Power_CalCounts));
+		}
+		else
+		{
+			RTC_WaitForSynchro();			// RTC registers valid again after STOP
+			Slept = (unsigned long)(((unsigned long long)(RTC_GetCounter() - Start) * Hal_Power_CalUs) / Hal_Power_CalCounts);
+			if(Slept > MaxUs)
+			{
+				Slept = MaxUs;
+			}
+		}
+		Slept += HAL_POWER_WAKEUP_US;
+		
+		for(i=0; i<Hal_Power_NotifyNum; i++)
+		{
+			Hal_Power_NotifyList[i](Slept);
+		}
+		Hal_Clock_Wake(Slept);
+		
+		if(Source == HAL_POWER_WAKE_RF)
+		{
+			Hal_Power_HoldEnd = Hal_Time_Now() + (HAL_POWER_WAKE_HOLD_MS * 1000UL);
+		}
+	#if CFG_POWER_WAKE_STAT
+		if(Source <= HAL_POWER_WAKE_KEY)
+		{
+			Hal_Power_WakeSource = Source;
+			Hal_Power_WakeStamp = Hal_Time_Now();
+		}
+	#endif
+	}
+#if CFG_POWER_WAKE_STAT
+	Hal_Power_Wakes[Source]++;
+#endif
+	
+	return (unsigned long)(Hal_Time_Now() - Enter);
+}
+
+/******************************************************************
+	@Name		: Hal_Power_Sync
+	@Function	: RTC registers valid again after an alarm wake-up(API,
+				  idle path, right after Hal_Power_Stop with PRIMASK
+				  restored): up to an RTC clock, interrupts served
+*******************************************************************/
+void Hal_Power_Sync(void)
+{
+	if(Hal_Power_SyncDue)
+	{
+		RTC_WaitForSynchro();
+		Hal_Power_SyncDue = 0;
+	}
+}
+
+/******************************************************************
+	@Name		: Hal_Power_WakeDone
+	@Function	: the event of a wake-up line handled(API, task context):
+				  RF code decoded or key event, the first one after an
+				  RF or key wake-up adds the latency since the wake-up
+*******************************************************************/
+void Hal_Power_WakeDone(HAL_POWER_WAKE_TYPEDEF Source)
+{
+#if CFG_POWER_WAKE_STAT
+	if(Source != Hal_Power_WakeSource)
+	{
+		return;
+	}
+	Hal_Power_WakeSource = HAL_POWER_WAKE_SUM;
+	if((Hal_Time_Now() - Hal_Power_WakeStamp) < (HAL_POWER_WAKE_HOLD_MS * 1000UL))
+	{
+		LatencyAdd(Hal_Power_Latency[Source], Hal_Power_WakeStamp);
+	}
+#else
+	(void)Source;
+#endif
+}
+
+#if CFG_POWER_WAKE_STAT
+/******************************************************************
+	@Name		: Hal_Power_Report
+	@Function	: output the wake-up statistics, one line per call:
+				  0: "PWR,WAKE,Rf,Key,Rtc,Other\r\n"(STOP left per source,
+				     Other: a pending interrupt, STOP not entered)
+				  1: "PWR,LSI,Hz,Calibrations\r\n"(0 Hz: not calibrated)
+	@Index		: line(0 ~ 1)
+	@Output		: output function, e.g. Hal_USART_DebugDataQueue
+	@Return		: 1: line output, 0: no line at Index
+*******************************************************************/
+unsigned char Hal_Power_Report(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len))
+{
+	unsigned char Buff[64] = "PWR,";
+	unsigned char Len = 4;
+	unsigned char i;
+	unsigned long Hz;
+	
+	if(Index == 0)
+	{
+		Buff[Len++] = 'W';
+		Buff[Len++] = 'A';
+		Buff[Len++] = 'K';
+		Buff[Len++] = 'E';
+		for(i=0; i<HAL_POWER_WAKE_SUM; i++)
+		{
+			Buff[Len++] = ',';
+			Len += OS_UIntToStr(Hal_Power_Wakes[i], &Buff[Len]);
+		}
+	}
+	else if(Index == 1)
+	{
+		Hz = 0;
+		if(Hal_Power_CalUs)
+		{
+			Hz = (unsigned long)(((unsigned long long)Hal_Power_CalCounts * (HAL_POWER_RTC_PRESCALER + 1) * 1000000UL) / Hal_Power_CalUs);
+		}
+		Buff[Len++] = 'L';
+		Buff[Len++] = 'S';
+		Buff[Len++] = 'I';
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Hz, &Buff[Len]);
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Hal_Power_Calibrations, &Buff[Len]);
+	}
+	else
+	{
+		return 0;
+	}
+	Buff[Len++] = '\r';
+	Buff[Len++] = '\n';
+	
+	Output(Buff, Len);
+	return 1;
+}
+#endif
+
+/******************************************************************
+	@Name		: Hal_Power_RtcInit(static)
+	@Function	: RTC counting LSI / (HAL_POWER_RTC_PRESCALER + 1)
+		--> LSI is stopped by every reset: started again, at most
+			HAL_POWER_LSI_TIMEOUT polls
+		--> the backup domain keeps the RTC over a reset: reset(frees
+			the clock source) and set up only when the RTC does not run
+			on LSI or HAL_POWER_BKP_MARK is missing(PRL is write-only)
+	@Return		: 1: RTC counting, 0: LSI did not start
+*******************************************************************/
+static unsigned char Hal_Power_RtcInit(void)
+{
+	unsigned int Timeout;
+	
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+	PWR_BackupAccessCmd(ENABLE);
+	RCC_LSICmd(ENABLE);
+	for(Timeout = 0; RCC_GetFlagStatus(RCC_FLAG_LSIRDY) == RESET; Timeout++)
+	{
+		if(Timeout >= HAL_POWER_LSI_TIMEOUT)
+		{
+			RCC_LSICmd(DISABLE);
+			return 0;
+		}
+	}
+	
+	if(((RCC->BDCR & (RCC_BDCR_RTCEN | RCC_BDCR_RTCSEL)) == (RCC_BDCR_RTCEN | RCC_BDCR_RTCSEL_LSI))
+		&& (BKP_ReadBackupRegister(HAL_POWER_BKP_DR) == HAL_POWER_BKP_MARK))
+	{
+		RTC_WaitForSynchro();
+		return 1;
+	}
+	
+	RCC_BackupResetCmd(ENABLE);
+	RCC_BackupResetCmd(DISABLE);
+	RCC_RTCCLKConfig(RCC_RTCCLKSource_LSI);
+	RCC_RTCCLKCmd(ENABLE);
+	RTC_WaitForSynchro();
+	RTC_WaitForLastTask();
+	RTC_SetPrescaler(HAL_POWER_RTC_PRESCALER);
+	RTC_WaitForLastTask();
+	BKP_WriteBackupRegister(HAL_POWER_BKP_DR, HAL_POWER_BKP_MARK);
+	
+	return 1;
+}
+
+/******************************************************************
+	@Name		: Hal_Power_Calibrate(static)
+	@Function	: LSI calibration step(idle path): RTC counts against
+				  Hal_Time over HAL_POWER_CAL_MS or more
+		--> due: LOW back on the HSE crystal first(Hal_Clock_Crystal),
+			then the window starts, no STOP till it ends
+	@Return		: 1: calibrated, 0: not yet(STOP refused)
+*******************************************************************/
+static unsigned char Hal_Power_Calibrate(void)
+{
+	unsigned long long Now;
+	unsigned long Rtc;
+	
+	Now = Hal_Time_Now();
+	if(Hal_Power_CalRun)
+	{
+		if((Now - Hal_Power_CalStart) < (HAL_POWER_CAL_MS * 1000UL))
+		{
+			return 0;
+		}
+		Rtc = RTC_GetCounter() - Hal_Power_CalRtc;
+		Hal_Power_CalRun = 0;
+		Hal_Power_CalEnd = Now;
+		if(Rtc == 0)
+		{
+			return 0;						// RTC not counting: never STOP
+		}
+		Hal_Power_CalCounts = Rtc;
+		Hal_Power_CalUs = (unsigned long)(Now - Hal_Power_CalStart);
+	#if CFG_POWER_WAKE_STAT
+		Hal_Power_Calibrations++;
+	#endif
+		return 1;
+	}
+	
+	if(Hal_Power_CalUs && ((Now - Hal_Power_CalEnd) < (HAL_POWER_CAL_PERIOD_S * 1000000ULL)))
+	{
+		return 1;
+	}
+	if(!Hal_Clock_Crystal())
+	{
+		return 0;
+	}
+	Hal_Power_CalRtc = RTC_GetCounter();
+	Hal_Power_CalStart = Hal_Time_Now();
+	Hal_Power_CalRun = 1;
+	return 0;
+}
+
+/******************************************************************
+	@Name		: Hal_Power_Window(static)
+	@Function	: STOP window: the time till the next task release, no
+				  later than the next Hal_Timer expiry(TIM4 stands still)
+				  and HAL_POWER_STOP_MAX_MS
+	@Return		: us
+*******************************************************************/
+static unsigned long Hal_Power_Window(unsigned long Us)
+{
+	unsigned long Timer;
+	
+	Timer = Hal_Timer_NextUs();
+	if(Us > Timer)
+	{
+		Us = Timer;
+	}
+	if(Us > (HAL_POWER_STOP_MAX_MS * 1000UL))
+	{
+		Us = HAL_POWER_STOP_MAX_MS * 1000UL;
+	}
+	return Us;
+}
+
+/******************************************************************
+	@Name		: Hal_Power_AlarmSet(static)
+	@Function	: RTC alarm at the end of the STOP window(whole RTC
+				  counts), written only when the deadline moved: an alarm
+				  ahead and within a count of it is kept(RTC resolution)
+		--> a write waits for the RTC(RTOFF, ~3 LSI clocks) twice
+	@Parameters	: 
+		* Us: STOP window(Hal_Power_Window)
+	@Return		: RTC count at the call
+*******************************************************************/
+static unsigned long Hal_Power_AlarmSet(unsigned long Us)
+{
+	unsigned long Counts;
+	unsigned long Start;
+	unsigned long Alarm;
+	
+	Counts = (unsigned long)(((unsigned long long)Us * Hal_Power_CalCounts) / Hal_Power_CalUs);
+	if(Counts == 0)
+	{
+		Counts = 1;
+	}
+	Start = RTC_GetCounter();
+	Alarm = Start + Counts;
+	if(((Alarm + 1 - Hal_Power_Alarm) > 2) || ((long)(Hal_Power_Alarm - Start) <= 0))
+	{
+		RTC_WaitForLastTask();
+		RTC_SetAlarm(Alarm);
+		RTC_WaitForLastTask();
+		Hal_Power_Alarm = Alarm;
+	}
+	return Start;
+}
+
+/******************************************************************
+	@Name		: EXTI3_IRQHandler, EXTI9_5_IRQHandler,
+				  EXTI15_10_IRQHandler, RTCAlarm_IRQHandler
+	@Function	: wake-up lines: unmasked only in STOP with PRIMASK set
+				  and cleared by Hal_Power_Stop, a handler runs for a
+				  line set pending by software only: cleared
+*******************************************************************/
+void EXTI3_IRQHandler(void)
+{
+	HAL_CPU_ISR_ENTER();
+	EXTI_ClearITPendingBit(EXTI_Line3);
+	HAL_CPU_ISR_EXIT();
+}
+
+void EXTI9_5_IRQHandler(void)
+{
+	HAL_CPU_ISR_ENTER();
+	EXTI_ClearITPendingBit(EXTI_Line5 | EXTI_Line6 | EXTI_Line7);
+	HAL_CPU_ISR_EXIT();
+}
+
+void EXTI15_10_IRQHandler(void)
+{
+	HAL_CPU_ISR_ENTER();
+	EXTI_ClearITPendingBit(EXTI_Line10 | EXTI_Line11);
+	HAL_CPU_ISR_EXIT();
+}
+
+void RTCAlarm_IRQHandler(void)
+{
+	HAL_CPU_ISR_ENTER();
+	EXTI_ClearITPendingBit(EXTI_Line17);
+	HAL_CPU_ISR_EXIT();
+}
+#endif
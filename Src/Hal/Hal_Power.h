@@ -0,0 +1,74 @@
+#ifndef __HAL_POWER_H_
+#define __HAL_POWER_H_
+
+#include "sysconfig.h"
+
+#if CFG_POWER_STOP
+/*************************************************************
+	@STOP mode: from the OS idle call-back(Hal_CPU) at the LOW clock
+		--> EXTI wake-up lines(EXTI line n: pin n of one port):
+			RF data PA11 both edges, keys K1~K5(PB3, PB5~PB7, PB10) falling,
+			RTC alarm at the next task release or Hal_Timer expiry
+		--> no line left for K6(PB11, line 11 is PA11) and the NB-IoT RX
+			(PA3, line 3 is K1): K6 is seen at the next key scan, USART2
+			traffic holds HAL_POWER_LOCK_NBIOT while the module is awake
+		--> RTC on LSI(no LSE crystal on the board): ~40kHz +-50%,
+			calibrated against Hal_Time(HSE) before the first STOP and
+			every HAL_POWER_CAL_PERIOD_S, kept running over a reset
+**************************************************************/
+#define HAL_POWER_EXTI_RF			EXTI_Line11
+#define HAL_POWER_EXTI_KEY			(EXTI_Line3 | EXTI_Line5 | EXTI_Line6 | EXTI_Line7 | EXTI_Line10)
+#define HAL_POWER_EXTI_RTC			EXTI_Line17
+#define HAL_POWER_EXTI_ALL			(HAL_POWER_EXTI_RF | HAL_POWER_EXTI_KEY | HAL_POWER_EXTI_RTC)
+
+#define HAL_POWER_RTC_PRESCALER		1			// RTC counts LSI/2: ~50us, PRL = 0 is not allowed
+#define HAL_POWER_LSI_TIMEOUT		HSE_STARTUP_TIMEOUT	// LSIRDY polls before STOP is given up(start-up 85us max)
+#define HAL_POWER_BKP_DR			BKP_DR1		// RTC set up by Hal_Power: survives a reset with the RTC
+#define HAL_POWER_BKP_MARK			(0xA500 | HAL_POWER_RTC_PRESCALER)
+#define HAL_POWER_STOP_MIN_US		500			// shorter windows sleep in WFI: RTC access and wake-up take ~100us
+#define HAL_POWER_STOP_MAX_MS		1000		// RTC alarm at the latest(no periodic task due)
+#define HAL_POWER_WAKEUP_US			5			// low-power regulator wake-up(datasheet typ 5.4us), TIM2 not counting yet
+#define HAL_POWER_WAKE_HOLD_MS		250			// no STOP after an RF wake-up: TIM1 captures the frame repeats
+#define HAL_POWER_CAL_MS			1000		// LSI calibration window(STOP held off): +-1 RTC count = 50ppm
+#define HAL_POWER_CAL_PERIOD_S		600			// LSI calibrated again(temperature, supply drift)
+
+#define HAL_POWER_NOTIFY_MAX		4			// registered wake-up call-backs
+
+// wakelocks: STOP refused while any is taken
+#define HAL_POWER_LOCK_APP			0x01		// App: SYSTEM_MODE_ALARM
+#define HAL_POWER_LOCK_NBIOT		0x02		// Hal_USART: CFG_NBIOT_ACTIVE_MS after USART2 traffic, downlinks and responses
+#define HAL_POWER_LOCK_RTC			0x80		// Hal_Power: LSI did not start, no RTC alarm
+
+typedef enum
+{
+	HAL_POWER_WAKE_RF = 0,
+	HAL_POWER_WAKE_KEY,
+	HAL_POWER_WAKE_RTC,
+	HAL_POWER_WAKE_OTHER,		// a pending interrupt(USART RX, TIM1 wrap)
+	HAL_POWER_WAKE_SUM,
+}HAL_POWER_WAKE_TYPEDEF;
+
+// wake-up call-back of a module(interrupts off): its counters stood still for Us
+typedef void (*Hal_PowerNotify_t)(unsigned long Us);
+
+void Hal_Power_Init(void);
+void Hal_Power_NotifyRegister(Hal_PowerNotify_t pNotify);
+void Hal_Power_WakeLock(unsigned char Lock);
+void Hal_Power_WakeUnlock(unsigned char Lock);
+unsigned char Hal_Power_StopAllowed(unsigned long Us);
+unsigned long Hal_Power_Stop(unsigned long MaxUs);
+void Hal_Power_Sync(void);
+void Hal_Power_WakeDone(HAL_POWER_WAKE_TYPEDEF Source);
+#if CFG_POWER_WAKE_STAT
+unsigned char Hal_Power_Report(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len));
+#endif
+#else
+// WFI only(CFG_POWER_STOP = 0): no RTC, no EXTI lines
+#define Hal_Power_Init()
+#define Hal_Power_NotifyRegister(pNotify)
+#define Hal_Power_WakeLock(Lock)
+#define Hal_Power_WakeUnlock(Lock)
+#define Hal_Power_WakeDone(Source)
+#endif
+
+#endif
@@ -2,11 +2,20 @@
 * Module: Hal_RFD
 * Functionality: Implements RF wireless data reception and decoding:
 *       @ Configures GPIO for the RFD module
-*       @ Creates an RFD sampling timer with a TimeBase of 50us for OOK signal sampling
+*       @ CFG_RFD_CAPTURE = 1: TIM1_CH4 captures the edges of PA11 at 1us, the capture interrupt
+*		  queues one pulse record(level, width) per edge, no periodic sampling interrupt, and wakes
+*		  the RFD task(no period): no RF, no decode runs
+*       @ CFG_RFD_CAPTURE = 0: an RFD sampling timer with a TimeBase of 50us polls PA11(OOK signal sampling)
 *       @ Creates a repeat code filtering timer with a TimeBase of 1s to filter out duplicate signals
-*       @ Polls and decodes received data pulse width to obtain a 2-byte address code and 1-byte data code
-*       @ Transfers decoded data to the application layer via a callback function
+*       @ Polls the pulses or sampled data, decoding(pulse widths -> 2-byte address code and 1-byte data code) in Hal_RFD_Decode.c
+*       @ Transfers decoded data to the application layer via a callback function(message pool handle)
 * Notes:
+*       @ the decoder has no register access and is built on the PC as well(Host micro benchmarks)
+*       @ F1 timers capture one edge direction per channel: the capture interrupt toggles the
+*		  polarity(CC4P) after each edge, an edge within the interrupt latency(~1us) is lost
+*		  and shows as a wrong-level pulse, which the decoder drops with the frame
+*       @ STOP(Hal_Power): the edge waking the core is not captured, the pulse in progress is cut
+*		  and the polarity set from the level after the wake-up
 *       @ To adjust the allowable error range for sync code pulse width: 
 *		  modify RFD_TITLE_CLK_MINL and RFD_TITLE_CLK_MAXL in Hal_RFD.h
 *       @ To adjust the allowable error range for data code pulse width: 
@@ -18,37 +27,52 @@
 #include "stm32f10x.h" 
 #include "hal_rfd.h"
 #include "hal_timer.h"
+#include "hal_time.h"
+#include "hal_cpu.h"
+#include "hal_clock.h"
+#include "hal_power.h"
 #include "os_system.h"
 
 static void Hal_RFD_Config(void);
+#if CFG_RFD_CAPTURE
+static unsigned char Hal_RFD_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz);
+#if CFG_POWER_STOP
+static void Hal_RFD_PowerNotify(unsigned long Us);
+#endif
+#else
 static unsigned char Hal_RFD_GetRFD_IOState(void);
 static void Hal_PulseACQ_Handler(void);
+#endif
 static void Hal_RFD_DecodeFilter_Handler(void); 
 static void Hal_RFD_CodeHandler(unsigned char *pCode);
 
 /*-----------------------------------------------------------------------------*/
-unsigned char RFD_DecodeSteps;	// RFD Decode Steps
-enum {							
-	RFD_DECODE_PULSEDATA, 		// ev1527 RFD decode header          
-	RFD_DECODE_DATA       		// ev1527 RFD decode data      
-};
+#if CFG_RFD_CAPTURE
+volatile RecQueue(unsigned short, CFG_QUEUE_RFD_RX) RFD_RxBuffer;	// captured pulses: RFD_PULSE_HIGH | width(us)
 
-volatile Queue32 RFD_RxBuffer;  // RFD data receive queue
-Queue8 RFD_CodeBuffer;			// RFD message buffer
+static volatile unsigned short RFD_CapLast;		// TIM1 count of the last edge
+static volatile unsigned char RFD_CapWraps;		// TIM1 wraps since the last edge, stops at 2(pulse cut)
+#else
+volatile Queue(CFG_QUEUE_RFD_RX) RFD_RxBuffer;  // RFD data receive queue
+#endif
 
 volatile unsigned char RFD_DecodeFilterTimerIdle; // receive repeat code timer flag
 
 RFD_RxCallBack_t RFD_RxCBF;
 
+#if !CFG_RFD_CAPTURE
+static Hal_TimerHandle_t RFD_PulseTimer;	// 50us periodic sampling(TIM4 interrupt)
+#endif
+Hal_TimerHandle_t RFD_RecodeFltTimer;		// one-shot repeat code filter
+
 /*----------------------------------------------------------------------------
 @Name		: Hal_RFD_Init()
 @Function	: RFD module initial
-		--> RFD GPIO configure
+		--> RFD GPIO configure(and TIM1 capture)
 		--> call-back function RFD_RxCBF point to Null
 		--> clear RFD_DecodeFilterTimerIdle flag
-		--> RFD_DecodeSteps set to RFD_DECODE_PULSEDATA （obtain pulse widths sets for decoding）
+		--> decoder waits for a syn-header, codes go to Hal_RFD_CodeHandler
 		--> empty RFD_RxBuffer
-		--> empty RFD_CodeBuffer
 @Parameter	: Null
 ------------------------------------------------------------------------------*/
 void Hal_RFD_Init(void)
@@ -57,295 +81,97 @@ void Hal_RFD_Init(void)
 	
 	RFD_RxCBF = 0;
 	RFD_DecodeFilterTimerIdle = 0;
-	RFD_DecodeSteps = RFD_DECODE_PULSEDATA;
+	Hal_RFD_DecodeInit(Hal_RFD_CodeHandler);
 	
 	QueueEmpty(RFD_RxBuffer);
-	QueueEmpty(RFD_CodeBuffer);
+#if CFG_RFD_CAPTURE
+	RecQueueRegister(RFD_RxBuffer, "RFD_Rx");
+#else
+	QueueRegister(RFD_RxBuffer, "RFD_Rx");
 	
-	Hal_Timer_CreatTimer(T_RFD_PULSE_RX, Hal_PulseACQ_Handler, 1, T_STATE_START);				// TimeBase: 50us, Period: 50us
-	Hal_Timer_CreatTimer(T_RFD_RECODE_FLT, Hal_RFD_DecodeFilter_Handler, 20000, T_STATE_STOP);	// TimeBase: 50us, Period: 1s
+	RFD_PulseTimer = Hal_Timer_CreatTimer(Hal_PulseACQ_Handler, 1, T_STATE_START, T_MODE_PERIODIC, T_EXEC_ISR);		// TimeBase: 50us, Period: 50us, sampling stays in ISR
+#endif
+	RFD_RecodeFltTimer = Hal_Timer_CreatTimer(Hal_RFD_DecodeFilter_Handler, HAL_TIMER_MS_TO_TICKS(CFG_RFD_REPEAT_FILTER_MS), T_STATE_STOP, T_MODE_ONESHOT, T_EXEC_TASK);	// Period: 1s
 }
 
 /*----------------------------------------------------------------------------
 @Name		: Hal_RFD_Pro()
 @Function	: RFD polling function （receive and decode）
-		--> get data(byte) from RFD_RxBuffer
-		--> calculate the corresponding pulse width, and save to the width queue ClkTimeBuff
-		--> decode the pulse widths data, capture the syn-header
-		--> if syn-header detected, start decoding RF data, according pulse widths to decode <Bit '1'> and <Bit '0'>
-		--> after receiving 24 Bit valid data, combine the data to Code[3], prepare the dataframe
-		--> using call-back function to deliver data to application layer
-
-			<syn-header> ：
-			<Bit '1'> ：
-			<Bit '0'> ：
-			<Dataframe> ：
+		--> take the captured pulses(Hal_RFD_DecodePulse) or the sampled bytes(Hal_RFD_Decode)
+			out of RFD_RxBuffer
+		--> capture: run when the first record after an empty queue wakes the task, records
+			left behind(more than one run takes) wake it again
+		--> decoder: pulse widths, syn-header, 24 Bit code(Hal_RFD_Decode.c)
+		--> a code received twice in a row goes to Hal_RFD_CodeHandler
 @Parameter	: Null
 ------------------------------------------------------------------------------*/
 void Hal_RFD_Pro(void)
 {
-	Queue256 PulseTimeBuff;	// pulse width queue
-							// dataformat： {1000 0010, 0111 1111, 0001 1111, 1111 1000, ...}
-							//  		use 2byte to represent a set of data（1000 0010, 0111 1111） high-byte, low-byte
-							// 			bit[7] of high-byte represent high/low volateg： 1-->high, 0-->low
-							//			bit[0-6] of high-byte and bit[0-7] of low-byte represent the counts of pulse(0-32767) (0-1638.35ms)
+#if CFG_RFD_CAPTURE
+	unsigned short Pulse[CFG_QUEUE_RFD_RX];
+	unsigned short Num;
+	
+	Num = 0;
+	while((Num < CFG_QUEUE_RFD_RX) && RecQueueOut(RFD_RxBuffer, &Pulse[Num]))
+	{
+		Num++;
+	}
 	
-	static unsigned short Time1 = 0; 		// high time
-	static unsigned short Time2 = 0; 		// low time
-	static unsigned char ReadDataFlag = 0;	// 1：syn-header captured, 0：syn-header not captured
-	static unsigned char Len; 
-	static unsigned char Code[3]; 			// save Hex data（2 byte address， 1 byte data）
-	static unsigned char CodeTempBuff[3];
+	Hal_RFD_DecodePulse(Pulse, Num);
 	
-	/*-------------------------------------------------------*/	
-	switch(RFD_DecodeSteps)		
+	if(RecQueueLen(RFD_RxBuffer))
 	{
-		case RFD_DECODE_PULSEDATA:	
-		{
-			unsigned char Temp; 
-			unsigned char Num; 
-			static unsigned char DataState = 0; 
-			static unsigned short Count = 0;	// high/low voltage pulse counter （count * 50us = pulse width）
-			
-			QueueEmpty(PulseTimeBuff);
-			
-			while(QueueDataOut(RFD_RxBuffer, &Temp))
-			{
-				Num = 8; 
-				
-				while(Num--)
-				{
-					if(DataState) 
-					{
-						if(!(Temp & 0x80)) 
-						{
-							unsigned char Data; 	
-							
-							Data = Count / 256;		
-							Data |= 0x80;			
-							QueueDataIn(PulseTimeBuff, &Data, 1);
-							Data = Count % 256;		
-							QueueDataIn(PulseTimeBuff, &Data, 1);
-							
-							DataState = 0; 
-							Count = 0; 	   
-						}
-					}
-					
-					else 		
-					{
-						if(Temp & 0x80)	
-						{
-							unsigned char Data;		
-							
-							Data = Count / 256;		
-							Data &= 0x7F;			
-							QueueDataIn(PulseTimeBuff, &Data, 1);
-							Data = Count % 256;		
-							QueueDataIn(PulseTimeBuff, &Data, 1);	
-							
-							DataState = 1; 
-							Count = 0;	   
-						}
-					}
-					Count++;
-					Temp <<= 1;
-				}
-			}
-		}
-		
-		case RFD_DECODE_DATA:  
-		{
-			while(QueueDataLen(PulseTimeBuff)) 
-			{
-				if(!ReadDataFlag) // waiting syn-header
-				{
-					unsigned char Temp;
-					
-					while(!Time1 || !Time2)
-					{
-						if(!Time1)	
-						{
-							while(QueueDataOut(PulseTimeBuff, &Temp)) 
-							{
-								if(Temp & 0x80)			
-								{
-									Temp &= 0xFF7F; 	// obtain high-byte bit[0-6]
-									Time1 = Temp * 256; 
-									
-									QueueDataOut(PulseTimeBuff, &Temp); 
-									Time1 += Temp;
-									Time2 = 0;
-									break;
-								}
-								else
-								{
-									QueueDataOut(PulseTimeBuff, &Temp);
-								}									
-							}
-							
-							if(!QueueDataLen(PulseTimeBuff))
-							{
-								break; 
-							}									
-						}
-						
-						if(!Time2) 
-						{
-							QueueDataOut(PulseTimeBuff, &Temp); 
-							Time2 = Temp * 256;
-							
-							QueueDataOut(PulseTimeBuff, &Temp); 
-							Time2 += Temp;
-							
-							// Design tolerence: RFD_TITLE_CLK_MINL < Ratio < RFD_TITLE_CLK_MAXL 
-							// compare the high voltage/low voltage time ratio(1/31)
-							if((Time2 >= (Time1 * RFD_TITLE_CLK_MINL)) && (Time2 <= (Time1 * RFD_TITLE_CLK_MAXL)))
-							{
-								Time1 = 0;
-								Time2 = 0;
-								Len = 0;
-								
-								ReadDataFlag = 1; 
-								break;
-							}		
-							else
-							{
-								Time1 = 0;
-								Time2 = 0;
-							}
-						}
-					}
-				}
-				
-				if(ReadDataFlag) // syn-header detected, start receiving data
-				{
-					unsigned char Temp;
-								
-					if(!Time1) 
-					{
-						if(QueueDataOut(PulseTimeBuff, &Temp)) 
-						{
-							Temp &= 0xFF7F;
-							Time1 = Temp * 256;
-							
-							QueueDataOut(PulseTimeBuff, &Temp);
-							Time1 += Temp;
-							Time2 = 0;
-						}
-						else
-						{
-							break;
-						}
-					}
-					
-					
-					if(!Time2) 
-					{
-						if(QueueDataOut(PulseTimeBuff, &Temp))
-						{
-							bool RecvSuccFlag; 
-							
-							Time2 = Temp * 256;
-							QueueDataOut(PulseTimeBuff, &Temp);
-							Time2 += Temp;
-							
-							// <Bit '1'>
-							// Design torelence: RFD_DATA_CLK_MINL < Ratio < RFD_DATA_CLK_MAXL 
-							// compare high voltage/low voltage time ratio(3/1)						
-							if((Time1 > (Time2 * RFD_DATA_CLK_MINL)) && (Time1 <= (Time2 * RFD_DATA_CLK_MAXL)))
-							{
-								unsigned char i;
-								unsigned char c = 0x80; 
-								
-								for(i = 0; i < Len%8; i++) 
-								{
-									c >>= 1;
-									c &= 0x7F;
-								}
-								Code[Len/8] |= c; 
-								RecvSuccFlag = 1; 
-							}
-							
-							// <Bit '0'>
-							// Design torelence: RFD_DATA_CLK_MINL < Ratio < RFD_DATA_CLK_MAXL 
-							// compare high voltage/low voltage time ratio(1/3)	：	
-							else if((Time2 > (Time1*RFD_DATA_CLK_MINL)) && (Time2 <= (Time1*RFD_DATA_CLK_MAXL)))
-							{
-								unsigned char i;
-								unsigned char c = (unsigned char)0xFF7F; // 0x7F(0111 1111)
-								for(i = 0; i < Len%8; i++)
-								{
-									c >>= 1;
-									c |= 0x0080;
-								}
-								Code[Len/8] &= c;
-								RecvSuccFlag = 1;
-							}
-							else //error
-							{
-								RecvSuccFlag = 0;
-								ReadDataFlag = 0;
-							}
-							
-							Time1 = 0;
-							Time2 = 0;
-							
-							if((++Len ==24)  && RecvSuccFlag) // Len=24: 16bit address + 8bit data； RecvSuccFlag = 1 --> a set of Hex data(3byte) collected
-							{
-								ReadDataFlag = 0; // waiting for the next syn-header
-								
-								if((CodeTempBuff[0]==Code[0])&&(CodeTempBuff[1]==Code[1])&&(CodeTempBuff[2]==Code[2])) 
-									{
-										Hal_RFD_CodeHandler(Code); 
-									}
-									else
-									{
-										memcpy(CodeTempBuff, Code, 3); 
-									}
-							}
-						}
-						
-						else
-						{
-							break; 
-						}
-						
-					}
-				}
-			}
-		}
+		OS_TaskGetUp(OS_TASK_RFD);
 	}
+#else
+	unsigned char Sample[CFG_QUEUE_RFD_RX];
+	unsigned short Num;
+	
+	Num = QueueDataRead(RFD_RxBuffer, Sample, sizeof(Sample));
+	
+	Hal_RFD_Decode(Sample, Num);
+#endif
 }
 
 /*----------------------------------------------------------------------------
 @Name		: Hal_RFD_CodeHandler(pCode)
 @Function	: process the data to send
+		--> the code is written once into a message block, the call-back gets its handle
+		--> the block is stamped with the decode time(Hal_Time_Now)
+		--> no call-back or no free block: the code is dropped
 @Parameter	: 
 		pCode: coming-in pointer of the Hex data
 ------------------------------------------------------------------------------*/
 static void Hal_RFD_CodeHandler(unsigned char *pCode)
 {
-	static unsigned char tBuff[3];
-	unsigned char temp;
+	unsigned char hMsg;
+	OS_MsgTypeDef *pMsg;
  
-	if((Hal_Timer_GetState(T_RFD_RECODE_FLT)==T_STATE_START) && (!RFD_DecodeFilterTimerIdle))
+	if((Hal_Timer_GetState(RFD_RecodeFltTimer)==T_STATE_START) && (!RFD_DecodeFilterTimerIdle))
 	{
 		return;
 	}
 
-	Hal_Timer_ResetTimer(T_RFD_RECODE_FLT,T_STATE_START); 
-	memcpy(tBuff, pCode, 3);
+	Hal_Timer_ResetTimer(RFD_RecodeFltTimer,T_STATE_START); 
 	RFD_DecodeFilterTimerIdle = 0;	
+	Hal_Power_WakeDone(HAL_POWER_WAKE_RF);
 	
-	temp = '#';
-	QueueDataIn(RFD_CodeBuffer, &temp, 1);
-	QueueDataIn(RFD_CodeBuffer, &tBuff[0], 3);	// Hex dataframe format("# 0x00 0x00 0x00")
+	if(RFD_RxCBF == 0)
+	{
+		return;
+	}
 	
-	if(RFD_RxCBF) 		  
+	hMsg = OS_MsgAlloc(RFD_MSG_CODE);
+	if(hMsg == OS_MSG_NULL)
 	{
-		RFD_RxCBF(tBuff); 
+		return;
 	}
+	pMsg = OS_MsgGet(hMsg);
+	memcpy(pMsg->Data, pCode, 3);
+	pMsg->Len = 3;
+	pMsg->Stamp = Hal_Time_Now();
+	
+	RFD_RxCBF(hMsg); 
 }
 
 /*----------------------------------------------------------------------------
@@ -362,12 +188,110 @@ void Hal_RFD_RxCBF_Register(RFD_RxCallBack_t pCBF)
 	}
 }	
 
+#if CFG_RFD_CAPTURE
+/*----------------------------------------------------------------------------
+@Name		: TIM1_CC_IRQHandler()
+@Function	: TIM1_CH4 capture: one edge of PA11 ends the pulse of the other level
+		--> width = TIM1 counts(1us) since the last edge, wraps counted by TIM1_UP,
+			longer than RFD_PULSE_WIDTH_MAX: cut(the gap between frames)
+		--> an update pending before this capture(count in the lower half) is
+			counted here: TIM1_UP is below this interrupt and finds it cleared
+		--> record queued in RFD_RxBuffer, polarity toggled for the next edge
+		--> the queue was empty: RFD task woken(through RFD_CAP_DEFER_IRQn, this
+			interrupt is above the critical section mask)
+		--> runs from RAM(OS_RAMFUNC), above the critical section mask
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+OS_RAMFUNC void TIM1_CC_IRQHandler(void)
+{
+	unsigned short Ccr;
+	unsigned long Width;
+	unsigned short Pulse;
+	unsigned char Wake;
+	
+	HAL_CPU_ISR_ENTER();
+	Ccr = RFD_CAP_TIM->CCR4;		// clears the capture flag
+	if((RFD_CAP_TIM->SR & TIM_FLAG_Update) && (Ccr < 0x8000))
+	{
+		RFD_CAP_TIM->SR = (uint16_t)~TIM_FLAG_Update;
+		if(RFD_CapWraps < 2)
+		{
+			RFD_CapWraps++;
+		}
+	}
+	
+	Width = ((unsigned long)RFD_CapWraps << 16) + Ccr - RFD_CapLast;
+	if(Width > RFD_PULSE_WIDTH_MAX)
+	{
+		Width = RFD_PULSE_WIDTH_MAX;
+	}
+	// captured on the falling edge(CC4P set): the pulse was high
+	Pulse = (RFD_CAP_TIM->CCER & TIM_CCER_CC4P) ? RFD_PULSE_HIGH : 0;
+	Pulse |= (unsigned short)Width;
+	RFD_CAP_TIM->CCER ^= TIM_CCER_CC4P;
+	
+	RFD_CapLast = Ccr;
+	RFD_CapWraps = 0;
+	Wake = (RecQueueLen(RFD_RxBuffer) == 0);
+	RecQueueIn(RFD_RxBuffer, &Pulse);
+	if(Wake)
+	{
+	#if CFG_CPU_CRITICAL_BASEPRI
+		NVIC_SetPendingIRQ(RFD_CAP_DEFER_IRQn);
+	#else
+		OS_TaskGetUp(OS_TASK_RFD);
+	#endif
+	}
+	HAL_CPU_ISR_EXIT();
+}
+
+#if CFG_CPU_CRITICAL_BASEPRI
+/*----------------------------------------------------------------------------
+@Name		: CAN1_RX1_IRQHandler(RFD_CAP_DEFER_IRQn)
+@Function	: spare vector pended by the TIM1 capture: wake up the RFD task from
+			  below the critical section mask
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+void CAN1_RX1_IRQHandler(void)
+{
+	HAL_CPU_ISR_ENTER();
+	OS_TaskGetUp(OS_TASK_RFD);
+	HAL_CPU_ISR_EXIT();
+}
+#endif
+
+/*----------------------------------------------------------------------------
+@Name		: TIM1_UP_IRQHandler()
+@Function	: TIM1 wrap(65.536ms): counts the wraps of the pulse being captured
+		--> flag tested, cleared and counted with PRIMASK: the capture interrupt
+			preempting in between would count the same wrap
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+OS_RAMFUNC void TIM1_UP_IRQHandler(void)
+{
+	unsigned int Sta;
+	
+	HAL_CPU_ISR_ENTER();
+	Sta = __get_PRIMASK();
+	__disable_irq();
+	if(RFD_CAP_TIM->SR & TIM_FLAG_Update)
+	{
+		RFD_CAP_TIM->SR = (uint16_t)~TIM_FLAG_Update;
+		if(RFD_CapWraps < 2)
+		{
+			RFD_CapWraps++;
+		}
+	}
+	__set_PRIMASK(Sta);
+	HAL_CPU_ISR_EXIT();
+}
+#else
 /*----------------------------------------------------------------------------
 @Name		: Hal_PulseACQ_Handler
-@Function	: RFD pulse acquisition handler， TimeBase = 50us RFD_PULSE_RX timer IRQ handler；
+@Function	: RFD pulse acquisition handler， TimeBase = 50us periodic RFD_PulseTimer IRQ handler；
 @Parameter	: Null
 ------------------------------------------------------------------------------*/
-static void Hal_PulseACQ_Handler(void)
+OS_RAMFUNC static void Hal_PulseACQ_Handler(void)
 {
 	static unsigned char Temp;
 	static unsigned char Count = 0;
@@ -381,7 +305,6 @@ static void Hal_PulseACQ_Handler(void)
 		Count = 0;
 		QueueDataIn(RFD_RxBuffer, &Temp, 1);
 	}
-	Hal_Timer_ResetTimer(T_RFD_PULSE_RX, T_STATE_START);
 }
 
 /*----------------------------------------------------------------------------
@@ -389,10 +312,11 @@ static void Hal_PulseACQ_Handler(void)
 @Function	: Read the RFD IO state
 @Parameter	: Null
 ------------------------------------------------------------------------------*/
-static unsigned char Hal_RFD_GetRFD_IOState(void)
+OS_RAMFUNC static unsigned char Hal_RFD_GetRFD_IOState(void)
 {
-	return (GPIO_ReadInputDataBit(RFD_RX_PORT, RFD_RX_PIN));	
+	return ((RFD_RX_PORT->IDR & RFD_RX_PIN) ? 1 : 0);	// GPIO_ReadInputDataBit() without the call into flash
 }
+#endif
 
 /*----------------------------------------------------------------------------
 @Name		: Hal_RFD_DecodeFilter_Handler()
@@ -410,11 +334,18 @@ static void Hal_RFD_DecodeFilter_Handler(void)
 /*----------------------------------------------------------------------------
 @Name		: Hal_RFD_Config()
 @Function	: config RFD GPIO
+		--> CFG_RFD_CAPTURE: TIM1 counts 1us over 16 bit, CH4(PA11) captures the
+			rising edge first(the receiver idles low), digital filter RFD_CAP_FILTER
 @Parameter	: Null
 ------------------------------------------------------------------------------*/
 static void Hal_RFD_Config(void)
 {
 	GPIO_InitTypeDef GPIO_InitStructure;
+#if CFG_RFD_CAPTURE
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure;
+	TIM_ICInitTypeDef TIM_ICInitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+#endif
 	
 	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, ENABLE);
 	 
@@ -422,4 +353,93 @@ static void Hal_RFD_Config(void)
 	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
 	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IPU; 
 	GPIO_Init(RFD_RX_PORT, &GPIO_InitStructure);	
+	
+#if CFG_RFD_CAPTURE
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_TIM1, ENABLE);
+	
+	TIM_TimeBaseInitStructure.TIM_Period = 0xFFFF;						// wrap: 65.536ms
+	TIM_TimeBaseInitStructure.TIM_Prescaler = Hal_Clock_GetMHz()-1;		// APB2 = HCLK: 1MHz
+	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInitStructure.TIM_RepetitionCounter = 0;
+	TIM_TimeBaseInit(RFD_CAP_TIM, &TIM_TimeBaseInitStructure);
+	TIM_UpdateRequestConfig(RFD_CAP_TIM, TIM_UpdateSource_Regular);	// update flag on wraps only(clock rescale)
+	
+	TIM_ICInitStructure.TIM_Channel = TIM_Channel_4;
+	TIM_ICInitStructure.TIM_ICPolarity = TIM_ICPolarity_Rising;
+	TIM_ICInitStructure.TIM_ICSelection = TIM_ICSelection_DirectTI;
+	TIM_ICInitStructure.TIM_ICPrescaler = TIM_ICPSC_DIV1;
+	TIM_ICInitStructure.TIM_ICFilter = RFD_CAP_FILTER;
+	TIM_ICInit(RFD_CAP_TIM, &TIM_ICInitStructure);
+	
+	RFD_CapLast = 0;
+	RFD_CapWraps = 2;		// first pulse: idle, cut
+	
+	TIM_ClearFlag(RFD_CAP_TIM, TIM_FLAG_Update | TIM_FLAG_CC4);
+	TIM_ITConfig(RFD_CAP_TIM, TIM_IT_Update | TIM_IT_CC4, ENABLE);
+	
+	NVIC_InitStructure.NVIC_IRQChannel = RFD_CAP_CC_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_RFD_CAPTURE;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_Init(&NVIC_InitStructure);
+	
+	NVIC_InitStructure.NVIC_IRQChannel = RFD_CAP_UP_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_RFD_WRAP;
+	NVIC_Init(&NVIC_InitStructure);
+	
+#if CFG_CPU_CRITICAL_BASEPRI
+	NVIC_InitStructure.NVIC_IRQChannel = RFD_CAP_DEFER_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_RFD_DEFER;
+	NVIC_Init(&NVIC_InitStructure);
+#endif
+	
+	TIM_Cmd(RFD_CAP_TIM, ENABLE);
+	
+	Hal_Clock_NotifyRegister(Hal_RFD_ClockNotify);
+	Hal_Power_NotifyRegister(Hal_RFD_PowerNotify);
+#endif
+}
+
+#if CFG_RFD_CAPTURE
+/*----------------------------------------------------------------------------
+@Name		: Hal_RFD_ClockNotify(Event, MHz)
+@Function	: clock change call-back(Hal_Clock): TIM1 keeps 1us per count and
+			  its count, a pulse across the change keeps its width
+		--> the input filter samples the timer clock: at 8MHz it takes glitches
+			up to ~32us, still far below the shortest pulse(400us)
+@Parameter	: Event: HAL_CLOCK_CHANGED only, MHz: new HCLK
+------------------------------------------------------------------------------*/
+static unsigned char Hal_RFD_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz)
+{
+	if(Event == HAL_CLOCK_CHANGED)
+	{
+		HAL_CLOCK_TIM_RESCALE(RFD_CAP_TIM, MHz);
+	}
+	return 1;
+}
+
+#if CFG_POWER_STOP
+/*----------------------------------------------------------------------------
+@Name		: Hal_RFD_PowerNotify(Us)
+@Function	: STOP left(Hal_Power, interrupts off): TIM1 stood still, edges
+			  were not captured
+		--> the next pulse is cut, as the first one after a frame gap
+		--> next edge away from the level now: high -> falling(CC4P set)
+@Parameter	: Us: time slept
+------------------------------------------------------------------------------*/
+static void Hal_RFD_PowerNotify(unsigned long Us)
+{
+	(void)Us;
+	RFD_CapWraps = 2;
+	if(RFD_RX_PORT->IDR & RFD_RX_PIN)
+	{
+		RFD_CAP_TIM->CCER |= TIM_CCER_CC4P;
+	}
+	else
+	{
+		RFD_CAP_TIM->CCER &= (uint16_t)~TIM_CCER_CC4P;
+	}
 }
+#endif
+#endif
@@ -3,7 +3,7 @@
 
 #define RFD_CLK_SENDLEN			400		// CLK timebase(us)
 
-#define RFD_INT_FRQ				50
+#define RFD_INT_FRQ				50		// sampling period of the polled pin(us, CFG_RFD_CAPTURE = 0)
 
 #define RFDCLKEND				0xFFFF
 
@@ -14,12 +14,20 @@
 #define  RFD_DATA_CLK_MINL   	2
 #define  RFD_DATA_CLK_MAXL   	5
 
-// RFD resend times
-#define RFD_TX_NUM				15
-
 #define RFD_RX_PORT				GPIOA
 #define RFD_RX_PIN				GPIO_Pin_11
 
+// PA11 = TIM1_CH4: edges captured at 1us(CFG_RFD_CAPTURE)
+#define RFD_CAP_TIM				TIM1
+#define RFD_CAP_CC_IRQn			TIM1_CC_IRQn
+#define RFD_CAP_UP_IRQn			TIM1_UP_IRQn
+#define RFD_CAP_DEFER_IRQn		CAN1_RX1_IRQn	// task wake-up handed down to a spare vector(CFG_CPU_CRITICAL_BASEPRI)
+#define RFD_CAP_FILTER			0x0F	// fDTS/32, N=8: glitches below ~3.5us are not captured
+
+// captured pulse record(RFD_RxBuffer, Hal_RFD_DecodePulse)
+#define RFD_PULSE_HIGH			0x8000	// level of the pulse
+#define RFD_PULSE_WIDTH_MAX		0x7FFF	// width(us), longer pulses are cut to this
+
 #define RFD_NORMAL_DELDOUBLE_TIME  (T500MS+T50MS)
 
 typedef enum
@@ -30,10 +38,22 @@ typedef enum
 }RFD_SENDCLKTypeDef;
 
  
-typedef void (*RFD_RxCallBack_t)(unsigned char *pBuff);
+// message of a decoded ev1527 code(OS message pool): Data[0~2] = Code[0~2], Len = 3
+#define RFD_MSG_CODE			OS_MSG_TYPE_USER(0)
+
+// hMsg: message handle, the call-back owns the block and frees it(OS_MsgFree) when done
+typedef void (*RFD_RxCallBack_t)(unsigned char hMsg);
+
+// pCode: Code[0~2] of a decoded ev1527 code
+typedef void (*RFD_CodeCallBack_t)(unsigned char *pCode);
 
 void Hal_RFD_Init(void);
 void Hal_RFD_Pro(void);
 void Hal_RFD_RxCBF_Register(RFD_RxCallBack_t pCBF);
 
+// decoder(Hal_RFD_Decode.c)
+void Hal_RFD_DecodeInit(RFD_CodeCallBack_t pCBF);
+void Hal_RFD_Decode(const unsigned char *pSample, unsigned short Num);
+void Hal_RFD_DecodePulse(const unsigned short *pPulse, unsigned short Num);
+
 #endif
@@ -0,0 +1,331 @@
+/*************************************************************************************************************
+* Module: Hal_RFD_Decode
+* Functionality: ev1527 decoding of the RFD pin, plain C without register access:
+*       @ sampled bytes(1 bit = 50us) -> high/low pulse widths(GPIO polling)
+*       @ or captured pulse widths(1us, TIM1 input capture) taken as they are
+*       @ syn-header by the high/low ratio, then 24 Bit: 2-byte address code and 1-byte data code
+*       @ a code received twice in a row goes to the registered handler
+* Notes:
+*       @ Hal_RFD.c feeds RFD_RxBuffer(bytes or pulses) and owns the repeat filter and message pool
+*       @ the syn-header and bits are told by high/low ratios: the unit of the widths does not matter
+*       @ built on the PC as well(Host micro benchmarks)
+**************************************************************************************************************/
+
+#include <string.h>
+#include <stdbool.h>
+#include "hal_rfd.h"
+#include "os_system.h"
+
+// pulse width queue of one decode run
+// dataformat： {1000 0010, 0111 1111, 0001 1111, 1111 1000, ...}
+//  		use 2byte to represent a set of data（1000 0010, 0111 1111） high-byte, low-byte
+// 			bit[7] of high-byte represent high/low volateg： 1-->high, 0-->low
+//			bit[0-6] of high-byte and bit[0-7] of low-byte represent the width(0-32767)
+typedef Queue(CFG_QUEUE_RFD_PULSE) RFD_PulseQueueTypeDef;
+
+static void Hal_RFD_DecodeWidths(RFD_PulseQueueTypeDef *pPulse);
+
+/*-----------------------------------------------------------------------------*/
+static unsigned char DataState; 		// level of the pulse being counted
+static unsigned short Count;			// high/low voltage pulse counter （count * 50us = pulse width）
+static unsigned short Time1; 			// high time
+static unsigned short Time2; 			// low time
+static unsigned char ReadDataFlag;		// 1：syn-header captured, 0：syn-header not captured
+static unsigned char Len; 
+static unsigned char Code[3]; 			// save Hex data（2 byte address， 1 byte data）
+static unsigned char CodeTempBuff[3];
+
+static RFD_CodeCallBack_t RFD_CodeCBF;
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_RFD_DecodeInit(pCBF)
+@Function	: decoder waits for a syn-header, no code received before
+@Parameter	: 
+		pCBF: handler of the decoded codes
+------------------------------------------------------------------------------*/
+void Hal_RFD_DecodeInit(RFD_CodeCallBack_t pCBF)
+{
+	DataState = 0;
+	Count = 0;
+	Time1 = 0;
+	Time2 = 0;
+	ReadDataFlag = 0;
+	Len = 0;
+	memset(Code, 0, sizeof(Code));
+	memset(CodeTempBuff, 0, sizeof(CodeTempBuff));
+	
+	RFD_CodeCBF = pCBF;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_RFD_Decode(pSample, Num)
+@Function	: decode sampled bytes of the RFD pin(GPIO polling)
+		--> get data(byte) from pSample
+		--> calculate the corresponding pulse width, and save to the width queue PulseTimeBuff
+		--> Hal_RFD_DecodeWidths: syn-header, 24 Bit code
+@Parameter	: 
+		pSample: sampled bytes, bit[7] first, one bit every 50us
+		Num: number of bytes
+------------------------------------------------------------------------------*/
+void Hal_RFD_Decode(const unsigned char *pSample, unsigned short Num)
+{
+	RFD_PulseQueueTypeDef PulseTimeBuff;
+	unsigned char Temp; 
+	unsigned char Bit; 
+	
+	QueueEmpty(PulseTimeBuff);
+	
+	while(Num--)
+	{
+		Temp = *pSample++;
+		Bit = 8; 
+		
+		while(Bit--)
+		{
+			if(DataState) 
+			{
+				if(!(Temp & 0x80)) 
+				{
+					unsigned char Data; 	
+					
+					Data = Count / 256;		
+					Data |= 0x80;			
+					QueueDataIn(PulseTimeBuff, &Data, 1);
+					Data = Count % 256;		
+					QueueDataIn(PulseTimeBuff, &Data, 1);
+					
+					DataState = 0; 
+					Count = 0; 	   
+				}
+			}
+			
+			else 		
+			{
+				if(Temp & 0x80)	
+				{
+					unsigned char Data;		
+					
+					Data = Count / 256;		
+					Data &= 0x7F;			
+					QueueDataIn(PulseTimeBuff, &Data, 1);
+					Data = Count % 256;		
+					QueueDataIn(PulseTimeBuff, &Data, 1);	
+					
+					DataState = 1; 
+					Count = 0;	   
+				}
+			}
+			Count++;
+			Temp <<= 1;
+		}
+	}
+	
+	Hal_RFD_DecodeWidths(&PulseTimeBuff);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_RFD_DecodePulse(pPulse, Num)
+@Function	: decode captured pulses of the RFD pin(TIM1 input capture)
+		--> the pulse records are already in the width queue format
+		--> Hal_RFD_DecodeWidths: syn-header, 24 Bit code
+@Parameter	: 
+		pPulse: RFD_PULSE_HIGH | width(us, up to RFD_PULSE_WIDTH_MAX) per pulse
+		Num: number of pulses(up to CFG_QUEUE_RFD_PULSE / 2)
+------------------------------------------------------------------------------*/
+void Hal_RFD_DecodePulse(const unsigned short *pPulse, unsigned short Num)
+{
+	RFD_PulseQueueTypeDef PulseTimeBuff;
+	unsigned char Data;
+	
+	QueueEmpty(PulseTimeBuff);
+	
+	while(Num--)
+	{
+		Data = (unsigned char)(*pPulse >> 8);
+		QueueDataIn(PulseTimeBuff, &Data, 1);
+		Data = (unsigned char)*pPulse;
+		QueueDataIn(PulseTimeBuff, &Data, 1);
+		pPulse++;
+	}
+	
+	Hal_RFD_DecodeWidths(&PulseTimeBuff);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_RFD_DecodeWidths(pPulse)
+@Function	: decode the pulse widths data, capture the syn-header
+		--> if syn-header detected, start decoding RF data, according pulse widths to decode <Bit '1'> and <Bit '0'>
+		--> after receiving 24 Bit valid data, combine the data to Code[3], prepare the dataframe
+		--> the same code twice in a row: delivered through RFD_CodeCBF
+
+			<syn-header> ：
+			<Bit '1'> ：
+			<Bit '0'> ：
+			<Dataframe> ：
+@Parameter	: 
+		pPulse: pulse widths of this run, a syn-header or code may go on in the next run
+------------------------------------------------------------------------------*/
+static void Hal_RFD_DecodeWidths(RFD_PulseQueueTypeDef *pPulse)
+{
+	while(QueueDataLen(*pPulse)) 
+	{
+		if(!ReadDataFlag) // waiting syn-header
+		{
+			unsigned char Temp;
+			
+			while(!Time1 || !Time2)
+			{
+				if(!Time1)	
+				{
+					while(QueueDataOut(*pPulse, &Temp)) 
+					{
+						if(Temp & 0x80)			
+						{
+							Temp &= 0xFF7F; 	// obtain high-byte bit[0-6]
+							Time1 = Temp * 256; 
+							
+							QueueDataOut(*pPulse, &Temp); 
+							Time1 += Temp;
+							Time2 = 0;
+							break;
+						}
+						else
+						{
+							QueueDataOut(*pPulse, &Temp);
+						}									
+					}
+					
+					if(!QueueDataLen(*pPulse))
+					{
+						break; 
+					}									
+				}
+				
+				if(!Time2) 
+				{
+					QueueDataOut(*pPulse, &Temp); 
+					Time2 = Temp * 256;
+					
+					QueueDataOut(*pPulse, &Temp); 
+					Time2 += Temp;
+					
+					// Design tolerence: RFD_TITLE_CLK_MINL < Ratio < RFD_TITLE_CLK_MAXL 
+					// compare the high voltage/low voltage time ratio(1/31)
+					if((Time2 >= (Time1 * RFD_TITLE_CLK_MINL)) && (Time2 <= (Time1 * RFD_TITLE_CLK_MAXL)))
+					{
+						Time1 = 0;
+						Time2 = 0;
+						Len = 0;
+						
+						ReadDataFlag = 1; 
+						break;
+					}		
+					else
+					{
+						Time1 = 0;
+						Time2 = 0;
+					}
+				}
+			}
+		}
+		
+		if(ReadDataFlag) // syn-header detected, start receiving data
+		{
+			unsigned char Temp;
+						
+			if(!Time1) 
+			{
+				if(QueueDataOut(*pPulse, &Temp)) 
+				{
+					Temp &= 0xFF7F;
+					Time1 = Temp * 256;
+					
+					QueueDataOut(*pPulse, &Temp);
+					Time1 += Temp;
+					Time2 = 0;
+				}
+				else
+				{
+					break;
+				}
+			}
+			
+			
+			if(!Time2) 
+			{
+				if(QueueDataOut(*pPulse, &Temp))
+				{
+					bool RecvSuccFlag; 
+					
+					Time2 = Temp * 256;
+					QueueDataOut(*pPulse, &Temp);
+					Time2 += Temp;
+					
+					// <Bit '1'>
+					// Design torelence: RFD_DATA_CLK_MINL < Ratio < RFD_DATA_CLK_MAXL 
+					// compare high voltage/low voltage time ratio(3/1)						
+					if((Time1 > (Time2 * RFD_DATA_CLK_MINL)) && (Time1 <= (Time2 * RFD_DATA_CLK_MAXL)))
+					{
+						unsigned char i;
+						unsigned char c = 0x80; 
+						
+						for(i = 0; i < Len%8; i++) 
+						{
+							c >>= 1;
+							c &= 0x7F;
+						}
+						Code[Len/8] |= c; 
+						RecvSuccFlag = 1; 
+					}
+					
+					// <Bit '0'>
+					// Design torelence: RFD_DATA_CLK_MINL < Ratio < RFD_DATA_CLK_MAXL 
+					// compare high voltage/low voltage time ratio(1/3)	：	
+					else if((Time2 > (Time1*RFD_DATA_CLK_MINL)) && (Time2 <= (Time1*RFD_DATA_CLK_MAXL)))
+					{
+						unsigned char i;
+						unsigned char c = (unsigned char)0xFF7F; // 0x7F(0111 1111)
+						for(i = 0; i < Len%8; i++)
+						{
+							c >>= 1;
+							c |= 0x0080;
+						}
+						Code[Len/8] &= c;
+						RecvSuccFlag = 1;
+					}
+					else //error
+					{
+						RecvSuccFlag = 0;
+						ReadDataFlag = 0;
+					}
+					
+					Time1 = 0;
+					Time2 = 0;
+					
+					if((++Len ==24)  && RecvSuccFlag) // Len=24: 16bit address + 8bit data； RecvSuccFlag = 1 --> a set of Hex data(3byte) collected
+					{
+						ReadDataFlag = 0; // waiting for the next syn-header
+						
+						if((CodeTempBuff[0]==Code[0])&&(CodeTempBuff[1]==Code[1])&&(CodeTempBuff[2]==Code[2])) 
+							{
+								if(RFD_CodeCBF != 0)
+								{
+									RFD_CodeCBF(Code);
+								}
+							}
+							else
+							{
+								memcpy(CodeTempBuff, Code, 3); 
+							}
+					}
+				}
+				
+				else
+				{
+					break; 
+				}
+				
+			}
+		}
+	}
+}
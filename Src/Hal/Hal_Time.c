@@ -0,0 +1,264 @@
+/********************************************************************************
+* Module: Hal_Time											 					*
+* Function: 64bit monotonic microsecond timebase shared by all modules:		*
+*		@ TIM2 free running at 1MHz, update interrupt counts the wraps			*
+*		@ Hal_Time_Now: us since Hal_Time_Init, from tasks and interrupts		*
+*		@ latency statistics: a source stamps the event, the handler adds		*
+*		  the time passed since the stamp(CFG_TIME_LATENCY)						*
+* Description:																	*
+*		@ Hal_Time_Now takes no lock: the wrap count is read again until		*
+*		  it did not change, an update not yet taken by the interrupt			*
+*		  (masked, or the caller is above TIM2) is added from the flag			*
+*		@ STOP(Hal_Power): TIM2 stands still, moved on by the time slept		*
+*		@ To measure a new path: 												*
+*		--> LatencyRegister(x, "name") in the module init, stamp the event		*
+*			with Hal_Time_Now(), LatencyAdd(x, stamp) when it is handled		*
+*********************************************************************************/
+
+#include "stm32f10x.h" 
+#include "hal_time.h"
+#include "hal_cpu.h"
+#include "hal_clock.h"
+#include "hal_power.h"
+#include "os_system.h"
+
+static void Hal_Time_Config(void);
+static unsigned char Hal_Time_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz);
+#if CFG_POWER_STOP
+static void Hal_Time_PowerNotify(unsigned long Us);
+#endif
+
+static volatile unsigned long long Hal_Time_Wraps;	// TIM2 wraps since Hal_Time_Init
+
+#if CFG_TIME_LATENCY
+static Hal_Time_LatencyTypeDef *Hal_Time_LatencyList[HAL_TIME_LATENCY_REG_MAX];
+static const char *Hal_Time_LatencyName[HAL_TIME_LATENCY_REG_MAX];
+static unsigned char Hal_Time_LatencyNum;
+#endif
+
+/******************************************************************
+	@Name		: Hal_Time_Init
+	@Function	: timebase inital(API): time 0 from now on
+*******************************************************************/
+void Hal_Time_Init(void)
+{
+	Hal_Time_Wraps = 0;
+	Hal_Time_Config();
+}
+
+/******************************************************************
+	@Name		: Hal_Time_Now
+	@Function	: time since Hal_Time_Init(API), any context
+		--> TIM2 wrapped but the update interrupt not taken yet:
+			update flag set and a counter in the low half
+	@Return		: us
+*******************************************************************/
+unsigned long long Hal_Time_Now(void)
+{
+	unsigned long long Wraps;
+	unsigned short Cnt;
+	unsigned short Flag;
+	
+	do
+	{
+		Wraps = Hal_Time_Wraps;
+		Cnt = HAL_TIME_TIM->CNT;
+		Flag = HAL_TIME_TIM->SR & TIM_FLAG_Update;
+	}while(Wraps != Hal_Time_Wraps);
+	
+	if(Flag && (Cnt < (1U << (HAL_TIME_TIM_BITS - 1))))
+	{
+		Wraps++;
+	}
+	
+	return (Wraps << HAL_TIME_TIM_BITS) | Cnt;
+}
+
+#if CFG_TIME_LATENCY
+/******************************************************************
+	@Name		: Hal_Time_LatencyRegister
+	@Function	: clear a latency path and add it to the report,
+				  registered again or registry full: not reported
+	@Parameters	: 
+		* pLat: statistics of the path
+		* pName: name in the report
+*******************************************************************/
+void Hal_Time_LatencyRegister(Hal_Time_LatencyTypeDef *pLat, const char *pName)
+{
+	unsigned char i;
+	
+	pLat->Count = 0;
+	pLat->Min = 0xFFFFFFFF;
+	pLat->Max = 0;
+	pLat->Sum = 0;
+	
+	for(i=0; i<Hal_Time_LatencyNum; i++)
+	{
+		if(Hal_Time_LatencyList[i] == pLat)
+		{
+			return;
+		}
+	}
+	if(Hal_Time_LatencyNum < HAL_TIME_LATENCY_REG_MAX)
+	{
+		Hal_Time_LatencyList[Hal_Time_LatencyNum] = pLat;
+		Hal_Time_LatencyName[Hal_Time_LatencyNum] = pName;
+		Hal_Time_LatencyNum++;
+	}
+}
+
+/******************************************************************
+	@Name		: Hal_Time_LatencyAdd
+	@Function	: add the time since Stamp to a latency path
+				  (task context, one writer per path)
+	@Parameters	: 
+		* pLat: statistics of the path
+		* Stamp: Hal_Time_Now() at the event source
+*******************************************************************/
+void Hal_Time_LatencyAdd(Hal_Time_LatencyTypeDef *pLat, unsigned long long Stamp)
+{
+	unsigned long Latency;
+	
+	Latency = (unsigned long)(Hal_Time_Now() - Stamp);
+	
+	pLat->Count++;
+	pLat->Sum += Latency;
+	if(Latency < pLat->Min)
+	{
+		pLat->Min = Latency;
+	}
+	if(Latency > pLat->Max)
+	{
+		pLat->Max = Latency;
+	}
+}
+
+/******************************************************************
+	@Name		: Hal_Time_LatencyReport
+	@Function	: output a registered latency path as one line:
+				  "LAT,Name,Count,Min,Avg,Max\r\n"(us)
+	@Index		: registry index(0 ~ registered paths - 1)
+	@Output		: output function, e.g. Hal_USART_DebugDataQueue
+	@Return		: 1: line output, 0: no path registered at Index
+*******************************************************************/
+unsigned char Hal_Time_LatencyReport(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len))
+{
+	unsigned char Buff[64] = "LAT,";
+	unsigned char Len = 4;
+	unsigned char i;
+	unsigned long Val[4];
+	const char *pName;
+	Hal_Time_LatencyTypeDef *pLat;
+	
+	if(Index >= Hal_Time_LatencyNum)
+	{
+		return 0;
+	}
+	pLat = Hal_Time_LatencyList[Index];
+	
+	Val[0] = pLat->Count;
+	Val[1] = pLat->Count ? pLat->Min : 0;
+	Val[2] = pLat->Count ? (unsigned long)(pLat->Sum / pLat->Count) : 0;
+	Val[3] = pLat->Max;
+	
+	for(pName = Hal_Time_LatencyName[Index]; *pName && (Len < 16); pName++)
+	{
+		Buff[Len++] = *pName;
+	}
+	for(i=0; i<4; i++)
+	{
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Val[i], &Buff[Len]);
+	}
+	Buff[Len++] = '\r';
+	Buff[Len++] = '\n';
+	
+	Output(Buff, Len);
+	return 1;
+}
+#endif
+
+/******************************************************************
+	@Name		: Hal_Time_Config(static)
+	@Function	: TIM2 1us per count, full 16bit range, update interrupt
+*******************************************************************/
+static void Hal_Time_Config(void)
+{
+	TIM_TimeBaseInitTypeDef TIM_TimeBaseInitStructure;
+	NVIC_InitTypeDef NVIC_InitStructure;
+	
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
+	
+	TIM_DeInit(HAL_TIME_TIM);
+	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1;
+	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
+	TIM_TimeBaseInitStructure.TIM_Period = 0xFFFF; 					// wraps every 65536us
+	TIM_TimeBaseInitStructure.TIM_Prescaler = Hal_Clock_GetMHz()-1; // 72MHz->1us
+	TIM_TimeBaseInitStructure.TIM_RepetitionCounter = 0;
+	TIM_TimeBaseInit(HAL_TIME_TIM, &TIM_TimeBaseInitStructure);
+	TIM_UpdateRequestConfig(HAL_TIME_TIM, TIM_UpdateSource_Regular);	// update flag on wraps only(clock rescale)
+	
+	TIM_ClearFlag(HAL_TIME_TIM, TIM_FLAG_Update); 		
+	TIM_ITConfig(HAL_TIME_TIM, TIM_IT_Update, ENABLE); 
+	TIM_Cmd(HAL_TIME_TIM, ENABLE);
+	
+	NVIC_InitStructure.NVIC_IRQChannel = HAL_TIME_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_TIME;
+	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
+	NVIC_Init(&NVIC_InitStructure);
+	
+	Hal_Clock_NotifyRegister(Hal_Time_ClockNotify);
+	Hal_Power_NotifyRegister(Hal_Time_PowerNotify);
+}
+
+/******************************************************************
+	@Name		: Hal_Time_ClockNotify(static)
+	@Function	: clock change call-back(Hal_Clock): TIM2 keeps 1us
+				  per count and its count, the time goes on
+*******************************************************************/
+static unsigned char Hal_Time_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz)
+{
+	if(Event == HAL_CLOCK_CHANGED)
+	{
+		HAL_CLOCK_TIM_RESCALE(HAL_TIME_TIM, MHz);
+	}
+	return 1;
+}
+
+#if CFG_POWER_STOP
+/******************************************************************
+	@Name		: Hal_Time_PowerNotify(static)
+	@Function	: STOP left(Hal_Power, interrupts off): wrap count and
+				  TIM2 count set to the time after the sleep, a wrap
+				  in the sleep is counted here, not by the interrupt
+*******************************************************************/
+static void Hal_Time_PowerNotify(unsigned long Us)
+{
+	unsigned long long Now;
+	
+	Now = Hal_Time_Now() + Us;
+	HAL_TIME_TIM->SR = (uint16_t)~TIM_FLAG_Update;
+	Hal_Time_Wraps = Now >> HAL_TIME_TIM_BITS;
+	TIM_SetCounter(HAL_TIME_TIM, (uint16_t)Now);
+}
+#endif
+
+/******************************************************************
+	@Name		: TIM2_IRQHandler
+	@Function	: TIM2 Interrupt handler, every 65536us: one more wrap
+		--> flag cleared and count moved on with PRIMASK: Hal_Time_Now
+			in TIM4 interrupt never sees one without the other
+*******************************************************************/
+void TIM2_IRQHandler(void)
+{
+	unsigned int Sta;
+	
+	HAL_CPU_ISR_ENTER();
+	Sta = __get_PRIMASK();
+	__disable_irq();
+	HAL_TIME_TIM->SR = (uint16_t)~TIM_FLAG_Update;
+	Hal_Time_Wraps++;
+	__set_PRIMASK(Sta);
+	HAL_CPU_ISR_EXIT();
+}
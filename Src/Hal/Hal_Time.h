@@ -0,0 +1,41 @@
+#ifndef __HAL_TIME_H_
+#define __HAL_TIME_H_
+
+#include "sysconfig.h"
+
+/*************************************************************
+	@Timebase: TIM2 counts 1us free running(16bit), the update
+		interrupt extends it to 64bit: no wrap in the product life
+		--> Hal_Time_Now() from tasks and every interrupt level
+**************************************************************/
+#define HAL_TIME_TIM				TIM2
+#define HAL_TIME_IRQn				TIM2_IRQn
+#define HAL_TIME_TIM_BITS			16
+
+#define HAL_TIME_LATENCY_REG_MAX	6		// registered latency paths
+
+// one latency path: stamp at the source, added where the event is handled
+typedef struct
+{
+	unsigned long Count;
+	unsigned long Min;						// us
+	unsigned long Max;						// us
+	unsigned long long Sum;					// us
+}Hal_Time_LatencyTypeDef;
+
+void Hal_Time_Init(void);
+unsigned long long Hal_Time_Now(void);
+
+#if CFG_TIME_LATENCY
+void Hal_Time_LatencyRegister(Hal_Time_LatencyTypeDef *pLat, const char *pName);
+void Hal_Time_LatencyAdd(Hal_Time_LatencyTypeDef *pLat, unsigned long long Stamp);
+unsigned char Hal_Time_LatencyReport(unsigned char Index, void (*Output)(unsigned char *buf, unsigned int len));
+
+#define LatencyRegister(x,name)		Hal_Time_LatencyRegister(&(x),(name))
+#define LatencyAdd(x,stamp)			Hal_Time_LatencyAdd(&(x),(stamp))
+#else
+#define LatencyRegister(x,name)
+#define LatencyAdd(x,stamp)
+#endif
+
+#endif
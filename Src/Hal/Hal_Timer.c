@@ -1,137 +1,276 @@
 /********************************************************************************
 * Module: Hal_Timer											 					*
-* Function: Implementing a timer matrix: 										*
+* Function: Implementing a hierarchical timer wheel: 							*
 *		@ Configure timer parameters 									 		*
-*		@ Create a timer for a specified object 								*
+*		@ Create a timer at run time, get a handle(pool of CFG_TIMER_NUM)		*
 *		@ When the timer reaches the specified time, 							*
 *		  execute the provided callback function					 			*
+*		  --> in TIM4 interrupt(T_EXEC_ISR)										*
+*		  --> or deferred to task Hal_Timer_Pro(T_EXEC_TASK)					*
+*		@ one-shot or periodic(reloaded by the wheel, no drift)					*
 * Description:																	*
+*		@ TIM4 interrupt: one slot of level 0 per count, the timers in it		*
+*		  are the expired ones: the cost does not grow with the timers created	*
+*		@ a level above is moved down when the level below wraps				*
+*		  (every 64 counts one slot of level 1, every 4096 one of level 2...)	*
+*		@ the wheel lists are also changed from task context: TIM4 is above		*
+*		  the OS critical section mask, the few list updates run with PRIMASK	*
+*		@ STOP(Hal_Power) ends before the next expiry: the count jumps over		*
+*		  the counts slept on wake-up, only the slots passed are visited		*
 *		@ To add a new object: 													*
-*		--> Add the corresponding TIMER_ID_TYPEDEF in Hal_Timer.h				*
+*		--> Hal_Timer_CreatTimer in the module init, keep the handle			*
 *		@ To add a new TimeBase: 												*
 *		--> Add the corresponding TimeBase define macro in Hal_Timer.h			*
-*		@ To modify a TimeBase: 												*
-*		--> Change the .TIM_Period value in Hal_Timer_Config()					*
+*		@ To modify the TimeBase: 												*
+*		--> Change CFG_TIMER_TICK_US in SysConfig.h								*
 *********************************************************************************/
 
 #include "stm32f10x.h" 
 #include "hal_timer.h"
 #include "hal_led.h"
+#include "os_system.h"
+#include "hal_cpu.h"
+#include "hal_clock.h"
+#include "hal_power.h"
 
 static void Hal_Timer_Config(void);
+static unsigned char Hal_Timer_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz);
+#if CFG_POWER_STOP
+static void Hal_Timer_PowerNotify(unsigned long Us);
+static void Hal_Timer_Advance(unsigned long Counts);
+#endif
 static void Hal_Timer_TimerHandler(void);
+static void Hal_Timer_Expire(Hal_TimerHandle_t hTimer);
+static void Hal_Timer_Link(Hal_TimerHandle_t hTimer);
+static void Hal_Timer_Unlink(Hal_TimerHandle_t hTimer);
+static void Hal_Timer_Cascade(unsigned char Level);
 
-volatile Stu_TimerTypedef Stu_Timer[T_SUM];
+volatile Stu_TimerTypedef Stu_Timer[CFG_TIMER_NUM];
+
+static Hal_TimerHandle_t Hal_Timer_Wheel[HAL_TIMER_WHEEL_LEVELS][HAL_TIMER_WHEEL_SLOTS];	// first timer of each slot
+static volatile unsigned long Hal_Timer_Count;		// time base counts since Hal_Timer_Init
+
+// wheel lists changed outside TIM4 interrupt: TIM4 masked(PRIMASK) for a few instructions
+#define HAL_TIMER_LOCK(Sta)		do{ (Sta) = __get_PRIMASK(); __disable_irq(); }while(0)
+#define HAL_TIMER_UNLOCK(Sta)	__set_PRIMASK(Sta)
+
+#define HAL_TIMER_SLOT_INDEX(Expire, Level)	(((Expire) >> ((Level) * HAL_TIMER_WHEEL_BITS)) & (HAL_TIMER_WHEEL_SLOTS - 1))
+
+#if CFG_TIMER_JITTER
+volatile unsigned short Hal_Timer_DelayMin = 0xFFFF;	// TIM4 interrupt entry after the update event(us)
+volatile unsigned short Hal_Timer_DelayMax;
+#endif
 
 /******************************************************************
 	@Name		: Hal_Timer_Init
-	@Function	: timer inital(API)
+	@Function	: timer inital(API): all handles free, wheel empty
 *******************************************************************/
 void Hal_Timer_Init(void)
 {
-	unsigned char i;
+	unsigned char i, j;
 	Hal_Timer_Config();
 	
-	for(i=0; i<T_SUM; i++)
+	Hal_Timer_Count = 0;
+	for(i=0; i<HAL_TIMER_WHEEL_LEVELS; i++)
+	{
+		for(j=0; j<HAL_TIMER_WHEEL_SLOTS; j++)
+		{
+			Hal_Timer_Wheel[i][j] = HAL_TIMER_NULL;
+		}
+	}
+	
+	for(i=0; i<CFG_TIMER_NUM; i++)
 	{
-		Stu_Timer[i].state = T_STATE_STOP;
-		Stu_Timer[i].CurrentCount = 0;
+		Stu_Timer[i].state = T_STATE_INVALID;
+		Stu_Timer[i].Expire = 0;
 		Stu_Timer[i].func = 0;
 		Stu_Timer[i].Period = 0;
+		Stu_Timer[i].CompleteFlag = 0;
+		Stu_Timer[i].Mode = T_MODE_ONESHOT;
+		Stu_Timer[i].Exec = T_EXEC_TASK;
+		Stu_Timer[i].Next = HAL_TIMER_NULL;
+		Stu_Timer[i].Prev = HAL_TIMER_NULL;
+	}
+}
+
+/******************************************************************
+	@Name		: Hal_Timer_Pro
+	@Function	: timer task(API): run the deferred callbacks of
+				  completed T_EXEC_TASK timers, woken up by TIM4 interrupt
+		--> the flag is read and cleared with TIM4 masked: an expiry
+			after it wakes the task again, none is lost
+*******************************************************************/
+void Hal_Timer_Pro(void)
+{
+	unsigned char i;
+	unsigned char Complete;
+	unsigned int Sta;
+	
+	for(i=0; i<CFG_TIMER_NUM; i++)
+	{
+		if(Stu_Timer[i].CompleteFlag)
+		{
+			HAL_TIMER_LOCK(Sta);
+			Complete = Stu_Timer[i].CompleteFlag;
+			Stu_Timer[i].CompleteFlag = 0;
+			HAL_TIMER_UNLOCK(Sta);
+			if(Complete && Stu_Timer[i].func)
+			{
+				Stu_Timer[i].func();
+			}
+		}
 	}
 }
 
 /*******************************************************************
 	@Name		: Hal_Timer_CreatTimer
-	@Function	: creat timer 
+	@Function	: creat timer, take a free handle
 	@Parameters	: 
-		* TIMER_ID_TYPEDEF ID
 		* void (*proc)(void)
-		* unsigned short Period
-		* TIMER_STATE_TYPEDEF State
+		* unsigned long Period: 1 ~ HAL_TIMER_PERIOD_MAX time base counts
+		* TIMER_STATE_TYPEDEF State: T_STATE_START: runs from now
+		* TIMER_MODE_TYPEDEF Mode: T_MODE_ONESHOT / T_MODE_PERIODIC
+		* TIMER_EXEC_TYPEDEF Exec: T_EXEC_ISR / T_EXEC_TASK
+	@Return		: timer handle, HAL_TIMER_NULL: no free handle or bad period
 ********************************************************************/
-void Hal_Timer_CreatTimer(TIMER_ID_TYPEDEF ID, void (*proc)(void), unsigned short Period, TIMER_STATE_TYPEDEF State)
+Hal_TimerHandle_t Hal_Timer_CreatTimer(void (*proc)(void), unsigned long Period, TIMER_STATE_TYPEDEF State, TIMER_MODE_TYPEDEF Mode, TIMER_EXEC_TYPEDEF Exec)
 {
-	Stu_Timer[ID].state = State;
-	Stu_Timer[ID].CurrentCount = 0;
-	Stu_Timer[ID].func = proc;
-	Stu_Timer[ID].Period = Period;
+	unsigned char i;
+	
+	if((proc == 0) || (Period == 0) || (Period > HAL_TIMER_PERIOD_MAX))
+	{
+		return HAL_TIMER_NULL;
+	}
+	
+	for(i=0; i<CFG_TIMER_NUM; i++)
+	{
+		if(Stu_Timer[i].func == 0)
+		{
+			Stu_Timer[i].state = T_STATE_STOP;
+			Stu_Timer[i].Expire = Period;
+			Stu_Timer[i].Period = Period;
+			Stu_Timer[i].Mode = Mode;
+			Stu_Timer[i].Exec = Exec;
+			Stu_Timer[i].CompleteFlag = 0;
+			Stu_Timer[i].func = proc;
+			
+			if(State == T_STATE_START)
+			{
+				Hal_Timer_ResetTimer(i, T_STATE_START);
+			}
+			return i;
+		}
+	}
+	return HAL_TIMER_NULL;
 }
 
 /*******************************************************************
 	@Name		: Hal_ResetTimer
-	@Function	: Reset timer 
+	@Function	: Reset timer: a whole period from now
 	@Parameters	: 
-		* TIMER_ID_TYPEDEF ID
-		* TIMER_STATE_TYPEDEF State
+		* Hal_TimerHandle_t hTimer
+		* TIMER_STATE_TYPEDEF State: T_STATE_START: runs, T_STATE_STOP: stopped
 ********************************************************************/
-TIMER_RESULT_TYPEDEF Hal_Timer_ResetTimer(TIMER_ID_TYPEDEF ID, TIMER_STATE_TYPEDEF State)
+TIMER_RESULT_TYPEDEF Hal_Timer_ResetTimer(Hal_TimerHandle_t hTimer, TIMER_STATE_TYPEDEF State)
 {
-	if(Stu_Timer[ID].func)
+	unsigned int Sta;
+	
+	if((hTimer >= CFG_TIMER_NUM) || (Stu_Timer[hTimer].func == 0))
 	{
-		Stu_Timer[ID].state = State;
-		Stu_Timer[ID].CurrentCount = 0;
-		return T_SUCCESS;
+		return T_FAIL;
+	}
+	
+	HAL_TIMER_LOCK(Sta);
+	if(Stu_Timer[hTimer].state == T_STATE_START)
+	{
+		Hal_Timer_Unlink(hTimer);
+	}
+	if(State == T_STATE_START)
+	{
+		Stu_Timer[hTimer].Expire = Hal_Timer_Count + Stu_Timer[hTimer].Period;
+		Hal_Timer_Link(hTimer);
 	}
 	else
 	{
-		return T_FAIL;
+		Stu_Timer[hTimer].Expire = Stu_Timer[hTimer].Period;
 	}
+	Stu_Timer[hTimer].state = State;
+	HAL_TIMER_UNLOCK(Sta);
+	return T_SUCCESS;
 }
 
 /******************************************************************
 	@Name		: Hal_TimerDelete
-	@Function	: Delete timer 
+	@Function	: Delete timer, the handle is free again
 	@Parameters	: 
-		* TIMER_ID_TYPEDEF ID
+		* Hal_TimerHandle_t hTimer
 *******************************************************************/
-TIMER_RESULT_TYPEDEF Hal_Timer_TimerDelete(TIMER_ID_TYPEDEF ID)
+TIMER_RESULT_TYPEDEF Hal_Timer_TimerDelete(Hal_TimerHandle_t hTimer)
 {
-	if(Stu_Timer[ID].func)
+	unsigned int Sta;
+	
+	if((hTimer >= CFG_TIMER_NUM) || (Stu_Timer[hTimer].func == 0))
 	{
-		Stu_Timer[ID].state = T_STATE_STOP;
-		Stu_Timer[ID].CurrentCount = 0;
-		Stu_Timer[ID].func = 0;
-		return T_SUCCESS;
+		return T_FAIL;
 	}
-	else
+	
+	HAL_TIMER_LOCK(Sta);
+	if(Stu_Timer[hTimer].state == T_STATE_START)
 	{
-		return T_FAIL;
+		Hal_Timer_Unlink(hTimer);
 	}
+	Stu_Timer[hTimer].state = T_STATE_INVALID;
+	Stu_Timer[hTimer].CompleteFlag = 0;
+	Stu_Timer[hTimer].func = 0;
+	HAL_TIMER_UNLOCK(Sta);
+	return T_SUCCESS;
 }
 
 /********************************************************************
 	@Name		: Hal_Timer_StateControl
-	@Function	: change timer state
+	@Function	: change timer state: stop keeps the counts left,
+				  start runs on with them
 	@Parameters	: 
-		* TIMER_ID_TYPEDEF ID
+		* Hal_TimerHandle_t hTimer
 		* TIMER_STATE_TYPEDEF State
 *********************************************************************/
-TIMER_RESULT_TYPEDEF Hal_Timer_StateControl(TIMER_ID_TYPEDEF ID,TIMER_STATE_TYPEDEF State)
+TIMER_RESULT_TYPEDEF Hal_Timer_StateControl(Hal_TimerHandle_t hTimer, TIMER_STATE_TYPEDEF State)
 {
-	if(Stu_Timer[ID].func)
+	unsigned int Sta;
+	
+	if((hTimer >= CFG_TIMER_NUM) || (Stu_Timer[hTimer].func == 0))
+	{
+		return T_FAIL;
+	}
+	
+	HAL_TIMER_LOCK(Sta);
+	if((State == T_STATE_STOP) && (Stu_Timer[hTimer].state == T_STATE_START))
 	{
-		Stu_Timer[ID].state = State;
-		return T_SUCCESS;
+		Hal_Timer_Unlink(hTimer);
+		Stu_Timer[hTimer].Expire -= Hal_Timer_Count;
+		Stu_Timer[hTimer].state = T_STATE_STOP;
 	}
-	else
+	else if((State == T_STATE_START) && (Stu_Timer[hTimer].state == T_STATE_STOP))
 	{
-		return T_FAIL;
+		Stu_Timer[hTimer].Expire += Hal_Timer_Count;
+		Hal_Timer_Link(hTimer);
+		Stu_Timer[hTimer].state = T_STATE_START;
 	}
+	HAL_TIMER_UNLOCK(Sta);
+	return T_SUCCESS;
 }
 
 /********************************************************************
 	@Name		: Hal_Timer_GetState
 	@Function	: get timer state
 	@Parameters	: 
-		* TIMER_ID_TYPEDEF ID
+		* Hal_TimerHandle_t hTimer
 *********************************************************************/
-TIMER_STATE_TYPEDEF	Hal_Timer_GetState(TIMER_ID_TYPEDEF ID)
+TIMER_STATE_TYPEDEF	Hal_Timer_GetState(Hal_TimerHandle_t hTimer)
 {
-	if(Stu_Timer[ID].func)
+	if((hTimer < CFG_TIMER_NUM) && (Stu_Timer[hTimer].func))
 	{
-		return Stu_Timer[ID].state;
-	 
+		return Stu_Timer[hTimer].state;
 	}
 	else
 	{
@@ -139,10 +278,128 @@ TIMER_STATE_TYPEDEF	Hal_Timer_GetState(TIMER_ID_TYPEDEF ID)
 	}
 }
 
+/********************************************************************
+	@Name		: Hal_Timer_GetCount
+	@Function	: time base counts since Hal_Timer_Init
+*********************************************************************/
+unsigned long Hal_Timer_GetCount(void)
+{
+	return Hal_Timer_Count;
+}
+
+#if CFG_POWER_STOP
+/********************************************************************
+	@Name		: Hal_Timer_NextUs
+	@Function	: time till the next timer expiry(Hal_Power: TIM4 stands
+				  still in STOP, the RTC alarm wakes up for the expiry)
+	@Return		: us, 0xFFFFFFFF: no timer running
+*********************************************************************/
+unsigned long Hal_Timer_NextUs(void)
+{
+	unsigned long Delta;
+	unsigned long Min = 0xFFFFFFFF;
+	unsigned char i;
+	
+	for(i=0; i<CFG_TIMER_NUM; i++)
+	{
+		if(Stu_Timer[i].func && (Stu_Timer[i].state == T_STATE_START))
+		{
+			Delta = Stu_Timer[i].Expire - Hal_Timer_Count;
+			if(Delta < Min)
+			{
+				Min = Delta;
+			}
+		}
+	}
+	if(Min > (0xFFFFFFFF / CFG_TIMER_TICK_US))
+	{
+		return 0xFFFFFFFF;
+	}
+	
+	// Expire - Hal_Timer_Count >= 1: the first count ends with the current TIM4 period
+	return ((Min - 1) * CFG_TIMER_TICK_US) + (CFG_TIMER_TICK_US - TIM4->CNT);
+}
+#endif
+
+/********************************************************************
+	@Name		: Hal_Timer_Link(static)
+	@Function	: put a timer in the slot of its expiry: level n while
+				  the expiry is less than 2^((n+1)*BITS) counts away
+		--> Expire - Hal_Timer_Count >= 1: level 0 never gets the slot
+			being run, a periodic timer can not expire twice in one count
+*********************************************************************/
+OS_RAMFUNC static void Hal_Timer_Link(Hal_TimerHandle_t hTimer)
+{
+	unsigned long Delta;
+	unsigned char Level = 0;
+	unsigned short Slot;
+	Hal_TimerHandle_t Head;
+	
+	Delta = Stu_Timer[hTimer].Expire - Hal_Timer_Count;
+	while((Level < HAL_TIMER_WHEEL_LEVELS - 1) && (Delta >> ((Level + 1) * HAL_TIMER_WHEEL_BITS)))
+	{
+		Level++;
+	}
+	Slot = HAL_TIMER_SLOT_INDEX(Stu_Timer[hTimer].Expire, Level);
+	
+	Head = Hal_Timer_Wheel[Level][Slot];
+	Stu_Timer[hTimer].Slot = Level * HAL_TIMER_WHEEL_SLOTS + Slot;
+	Stu_Timer[hTimer].Prev = HAL_TIMER_NULL;
+	Stu_Timer[hTimer].Next = Head;
+	if(Head != HAL_TIMER_NULL)
+	{
+		Stu_Timer[Head].Prev = hTimer;
+	}
+	Hal_Timer_Wheel[Level][Slot] = hTimer;
+}
+
+/********************************************************************
+	@Name		: Hal_Timer_Unlink(static)
+	@Function	: take a timer out of its slot list
+*********************************************************************/
+OS_RAMFUNC static void Hal_Timer_Unlink(Hal_TimerHandle_t hTimer)
+{
+	Hal_TimerHandle_t Next = Stu_Timer[hTimer].Next;
+	Hal_TimerHandle_t Prev = Stu_Timer[hTimer].Prev;
+	
+	if(Prev != HAL_TIMER_NULL)
+	{
+		Stu_Timer[Prev].Next = Next;
+	}
+	else
+	{
+		Hal_Timer_Wheel[Stu_Timer[hTimer].Slot / HAL_TIMER_WHEEL_SLOTS][Stu_Timer[hTimer].Slot % HAL_TIMER_WHEEL_SLOTS] = Next;
+	}
+	if(Next != HAL_TIMER_NULL)
+	{
+		Stu_Timer[Next].Prev = Prev;
+	}
+}
+
+/********************************************************************
+	@Name		: Hal_Timer_Cascade(static)
+	@Function	: the slot of Level reached by the count: its timers go
+				  one level(or more) down
+*********************************************************************/
+OS_RAMFUNC static void Hal_Timer_Cascade(unsigned char Level)
+{
+	Hal_TimerHandle_t hTimer;
+	Hal_TimerHandle_t Next;
+	
+	hTimer = Hal_Timer_Wheel[Level][HAL_TIMER_SLOT_INDEX(Hal_Timer_Count, Level)];
+	Hal_Timer_Wheel[Level][HAL_TIMER_SLOT_INDEX(Hal_Timer_Count, Level)] = HAL_TIMER_NULL;
+	while(hTimer != HAL_TIMER_NULL)
+	{
+		Next = Stu_Timer[hTimer].Next;
+		Hal_Timer_Link(hTimer);
+		hTimer = Next;
+	}
+}
+
 /******************************************************************
 	@Name		: Hal_Timer_Config(static)
 	@Function	: config timer parameters
-	@TimeBase	: TIM_Period
+	@TimeBase	: TIM_Period = CFG_TIMER_TICK_US(SysConfig.h), e.g.
 		* TimeBase_5us		: 5 us
 		* TimeBase_10us		: 10 us
 		* TimeBase_20us		: 20 us
@@ -165,52 +422,244 @@ static void Hal_Timer_Config(void)
 	TIM_DeInit(TIM4);
 	TIM_TimeBaseInitStructure.TIM_ClockDivision = TIM_CKD_DIV1; 	// indicates the division ratio between the timer clock (CK_INT) frequency and sampling clock used by the digital filters (ETR, TIx)
 	TIM_TimeBaseInitStructure.TIM_CounterMode = TIM_CounterMode_Up;
-	TIM_TimeBaseInitStructure.TIM_Period = TimeBase_50us-1; 		// Auto Reload Register ARR(16bits): 0-65535, ARR:1-65536
-	TIM_TimeBaseInitStructure.TIM_Prescaler = 72-1; 				// 72MHz->1us, PSC:1-65536, PSC Register(16bits):0-65535
+	TIM_TimeBaseInitStructure.TIM_Period = CFG_TIMER_TICK_US-1; 	// Auto Reload Register ARR(16bits): 0-65535, ARR:1-65536
+	TIM_TimeBaseInitStructure.TIM_Prescaler = Hal_Clock_GetMHz()-1; // 72MHz->1us, PSC:1-65536, PSC Register(16bits):0-65535
 	TIM_TimeBaseInitStructure.TIM_RepetitionCounter = 0; 			// only for advacnced Timer1, Timer8
 	TIM_TimeBaseInit(TIM4, &TIM_TimeBaseInitStructure);
+	TIM_UpdateRequestConfig(TIM4, TIM_UpdateSource_Regular);		// update on overflow only: no tick from a clock rescale
 	
 	TIM_ClearFlag(TIM4, TIM_FLAG_Update); 		
 	TIM_ITConfig(TIM4, TIM_IT_Update, ENABLE); 
 	TIM_Cmd(TIM4, ENABLE);
 	
-	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_0);
+	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
 	NVIC_InitStructure.NVIC_IRQChannel = TIM4_IRQn;
 	NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
-	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 1;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_RFD_SAMPLE;
 	NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
 	NVIC_Init(&NVIC_InitStructure);
+	
+#if CFG_CPU_CRITICAL_BASEPRI
+	NVIC_InitStructure.NVIC_IRQChannel = HAL_TIMER_DEFER_IRQn;
+	NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_TIMER_DEFER;
+	NVIC_Init(&NVIC_InitStructure);
+#endif
+	
+	Hal_Clock_NotifyRegister(Hal_Timer_ClockNotify);
+	Hal_Power_NotifyRegister(Hal_Timer_PowerNotify);
 }
 
 /*************************************************************************
-	@Name		: Hal_Timer_TimerHandler(static)
-	@Function	: Timer handler for interrupt
+	@Name		: Hal_Timer_ClockNotify(static)
+	@Function	: clock change call-back(Hal_Clock): TIM4 keeps 1us per
+				  count, the time base count in progress goes on
+*************************************************************************/
+static unsigned char Hal_Timer_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz)
+{
+	if(Event == HAL_CLOCK_CHANGED)
+	{
+		HAL_CLOCK_TIM_RESCALE(TIM4, MHz);
+	}
+	return 1;
+}
+
+#if CFG_POWER_STOP
+/*************************************************************************
+	@Name		: Hal_Timer_PowerNotify(static)
+	@Function	: STOP left(Hal_Power, interrupts off): the time base
+				  count jumps over the counts slept, TIM4 goes on with the rest
+*************************************************************************/
+static void Hal_Timer_PowerNotify(unsigned long Us)
+{
+	unsigned long Counts;
+	
+	Counts = TIM4->CNT + Us;
+	TIM_SetCounter(TIM4, (uint16_t)(Counts % CFG_TIMER_TICK_US));
+	Hal_Timer_Advance(Counts / CFG_TIMER_TICK_US);
+}
+
+/*************************************************************************
+	@Name		: Hal_Timer_Advance(static)
+	@Function	: the time base count jumps by Counts at once: per level
+				  from the top, only the slots the jump passed are visited
+		--> a timer of such a slot expires if the jump passed its expiry,
+			otherwise it goes to the slot of its expiry from the new count
+		--> a periodic timer passed more than once expires once
 **************************************************************************/
-static void Hal_Timer_TimerHandler(void)
+static void Hal_Timer_Advance(unsigned long Counts)
 {
-	unsigned char i;
-	for(i=0; i<T_SUM; i++)
+	unsigned long From;
+	unsigned long Index;
+	unsigned long Slots;
+	unsigned char Level;
+	Hal_TimerHandle_t hTimer;
+	Hal_TimerHandle_t Next;
+	
+	From = Hal_Timer_Count;
+	Hal_Timer_Count += Counts;
+	
+	Level = HAL_TIMER_WHEEL_LEVELS;
+	while(Level--)
 	{
-		if((Stu_Timer[i].func) && (Stu_Timer[i].state == T_STATE_START))
+		Index = From >> (Level * HAL_TIMER_WHEEL_BITS);
+		Slots = (Hal_Timer_Count >> (Level * HAL_TIMER_WHEEL_BITS)) - Index;
+		if(Slots > HAL_TIMER_WHEEL_SLOTS)
 		{
-			Stu_Timer[i].CurrentCount++;
-			if(Stu_Timer[i].CurrentCount >= Stu_Timer[i].Period)
+			Slots = HAL_TIMER_WHEEL_SLOTS;
+		}
+		while(Slots--)
+		{
+			Index++;
+			hTimer = Hal_Timer_Wheel[Level][Index & (HAL_TIMER_WHEEL_SLOTS - 1)];
+			Hal_Timer_Wheel[Level][Index & (HAL_TIMER_WHEEL_SLOTS - 1)] = HAL_TIMER_NULL;
+			while(hTimer != HAL_TIMER_NULL)
 			{
-				Stu_Timer[i].state = T_STATE_STOP;
-				Stu_Timer[i].CurrentCount = Stu_Timer[i].CurrentCount; 
-				Stu_Timer[i].func(); 
+				Next = Stu_Timer[hTimer].Next;
+				if((Stu_Timer[hTimer].Expire - From) <= Counts)
+				{
+					Hal_Timer_Expire(hTimer);
+				}
+				else
+				{
+					Hal_Timer_Link(hTimer);
+				}
+				hTimer = Next;
 			}
 		}
 	}
 }
+#endif
+
+/*************************************************************************
+	@Name		: Hal_Timer_TimerHandler(static)
+	@Function	: Timer handler for interrupt: one time base count
+		--> level 0 wrapped: move the reached slots of the levels above down
+		--> every timer left in the level 0 slot expires now
+**************************************************************************/
+OS_RAMFUNC static void Hal_Timer_TimerHandler(void)
+{
+	Hal_TimerHandle_t hTimer;
+	unsigned char Level;
+	
+	Hal_Timer_Count++;
+	for(Level=1; Level<HAL_TIMER_WHEEL_LEVELS; Level++)
+	{
+		if(HAL_TIMER_SLOT_INDEX(Hal_Timer_Count, Level - 1) != 0)
+		{
+			break;
+		}
+		Hal_Timer_Cascade(Level);
+	}
+	
+	while((hTimer = Hal_Timer_Wheel[0][HAL_TIMER_SLOT_INDEX(Hal_Timer_Count, 0)]) != HAL_TIMER_NULL)
+	{
+		Hal_Timer_Unlink(hTimer);
+		Hal_Timer_Expire(hTimer);
+	}
+}
+
+/*************************************************************************
+	@Name		: Hal_Timer_Expire(static)
+	@Function	: a timer taken out of the wheel expires
+		--> periodic: back in the wheel at last expiry + Period before its
+			callback, the callback may stop or reset it; expiries already
+			passed(Hal_Timer_Advance) are skipped
+**************************************************************************/
+OS_RAMFUNC static void Hal_Timer_Expire(Hal_TimerHandle_t hTimer)
+{
+	unsigned long Late;
+	
+	if(Stu_Timer[hTimer].Mode == T_MODE_PERIODIC)
+	{
+		Stu_Timer[hTimer].Expire += Stu_Timer[hTimer].Period;
+		Late = Hal_Timer_Count - Stu_Timer[hTimer].Expire;
+		if(Late <= HAL_TIMER_PERIOD_MAX)
+		{
+			Stu_Timer[hTimer].Expire += ((Late / Stu_Timer[hTimer].Period) + 1) * Stu_Timer[hTimer].Period;
+		}
+		Hal_Timer_Link(hTimer);
+	}
+	else
+	{
+		Stu_Timer[hTimer].Expire = Stu_Timer[hTimer].Period;
+		Stu_Timer[hTimer].state = T_STATE_STOP;
+	}
+	
+	if(Stu_Timer[hTimer].Exec == T_EXEC_ISR)
+	{
+		Stu_Timer[hTimer].func(); 
+	}
+	else
+	{
+		Stu_Timer[hTimer].CompleteFlag = 1;
+	#if CFG_CPU_CRITICAL_BASEPRI
+		NVIC_SetPendingIRQ(HAL_TIMER_DEFER_IRQn);	// TIM4 is above the critical section mask
+	#else
+		OS_TaskGetUp(OS_TASK_TIMER);
+	#endif
+	}
+}
 
 
 /******************************************************************
 	@Name		: TIM4_IRQHandler
-	@Function	: TIM4 Interrupt handler
+	@Function	: TIM4 Interrupt handler, every CFG_TIMER_TICK_US(20kHz when
+				  polling RF): the whole RF sampling path runs from RAM(OS_RAMFUNC)
 *******************************************************************/
-void TIM4_IRQHandler(void)
+OS_RAMFUNC void TIM4_IRQHandler(void)
 {
-	TIM_ClearFlag(TIM4, TIM_FLAG_Update);
+#if CFG_TIMER_JITTER
+	unsigned short Delay;
+	
+	Delay = TIM4->CNT;		// first: counts(us) since the update event
+	if(Delay > Hal_Timer_DelayMax)
+	{
+		Hal_Timer_DelayMax = Delay;
+	}
+	if(Delay < Hal_Timer_DelayMin)
+	{
+		Hal_Timer_DelayMin = Delay;
+	}
+#endif
+	HAL_CPU_ISR_ENTER();
+	TIM4->SR = (uint16_t)~TIM_FLAG_Update;	// TIM_ClearFlag(TIM4, TIM_FLAG_Update) without the call into flash
 	Hal_Timer_TimerHandler(); // timebase: 1ms	
+	HAL_CPU_ISR_EXIT();
+}
+
+#if CFG_CPU_CRITICAL_BASEPRI
+/******************************************************************
+	@Name		: CAN1_SCE_IRQHandler(HAL_TIMER_DEFER_IRQn)
+	@Function	: spare vector pended by TIM4: wake up the Hal_Timer
+				  task from below the critical section mask
+*******************************************************************/
+void CAN1_SCE_IRQHandler(void)
+{
+	HAL_CPU_ISR_ENTER();
+	OS_TaskGetUp(OS_TASK_TIMER);
+	HAL_CPU_ISR_EXIT();
+}
+#endif
+
+#if CFG_TIMER_JITTER
+/******************************************************************
+	@Name		: Hal_Timer_JitterReport
+	@Function	: output the TIM4 interrupt entry delay since boot:
+				  "JIT,TIM4,Min,Max\r\n"(us), jitter = Max - Min
+		--> a delay above one period(CFG_TIMER_TICK_US) wraps, the sample is lost
+	@Output		: output function, e.g. Hal_USART_DebugDataQueue
+*******************************************************************/
+void Hal_Timer_JitterReport(void (*Output)(unsigned char *buf, unsigned int len))
+{
+	unsigned char Buff[24] = "JIT,TIM4,";
+	unsigned char Len = 9;
+	
+	Len += OS_UIntToStr(Hal_Timer_DelayMin, &Buff[Len]);
+	Buff[Len++] = ',';
+	Len += OS_UIntToStr(Hal_Timer_DelayMax, &Buff[Len]);
+	Buff[Len++] = '\r';
+	Buff[Len++] = '\n';
+	
+	Output(Buff, Len);
 }
+#endif
@@ -1,8 +1,13 @@
 #ifndef __HAL_TIMER_H_
 #define __HAL_TIMER_H_
 
+#include "sysconfig.h"
+
+// Hal_Timer task wake-up of TIM4 handed down to a spare vector(CFG_CPU_CRITICAL_BASEPRI)
+#define HAL_TIMER_DEFER_IRQn	CAN1_SCE_IRQn
+
 /*************************************************************
-	@TimeBase define:
+	@TimeBase define: TIM4 update = CFG_TIMER_TICK_US(SysConfig.h)
 **************************************************************/
 #define TimeBase_5us	5
 #define TimeBase_10us	10
@@ -16,17 +21,27 @@
 #define TimeBase_20ms	20000
 #define TimeBase_50ms	50000
 
+// timer periods in time base counts
+#define HAL_TIMER_MS_TO_TICKS(ms)	((unsigned long)(((unsigned long)(ms) * 1000) / CFG_TIMER_TICK_US))
+
+/*************************************************************
+	@Timer wheel: HAL_TIMER_WHEEL_LEVELS levels of 2^HAL_TIMER_WHEEL_BITS slots
+		level 0: one slot per time base count, level n: one slot per 2^(n*BITS) counts
+		--> a timer sits in the level of its distance to expiry and moves down
+			one level when the level below wraps, it expires from level 0
+		--> period: 1 ~ HAL_TIMER_PERIOD_MAX counts(50us: 1 count ~ 14.9 hours)
+**************************************************************/
+#define HAL_TIMER_WHEEL_BITS	6
+#define HAL_TIMER_WHEEL_SLOTS	(1 << HAL_TIMER_WHEEL_BITS)
+#define HAL_TIMER_WHEEL_LEVELS	5
+#define HAL_TIMER_PERIOD_MAX	((1UL << (HAL_TIMER_WHEEL_BITS * HAL_TIMER_WHEEL_LEVELS)) - 1)
+
+#define HAL_TIMER_NULL			0xFF	// no timer handle
+
 /************************************************************/
 
-typedef enum
-{
-	T_LED,	
-	T_RFD_PULSE_RX,		// RFD pulse collect timer
-	T_RFD_RECODE_FLT,	// RFD re-code timer
-	T_BEEP,
-	
-	T_SUM,
-}TIMER_ID_TYPEDEF;
+// timer handle of Hal_Timer_CreatTimer, a pool of CFG_TIMER_NUM(SysConfig.h)
+typedef unsigned char Hal_TimerHandle_t;
 
 typedef enum
 {
@@ -41,20 +56,46 @@ typedef enum
 	T_STATE_START,	
 }TIMER_STATE_TYPEDEF;
 
+typedef enum
+{
+	T_MODE_ONESHOT,	// stops at expiry, Hal_Timer_ResetTimer starts it again
+	T_MODE_PERIODIC,	// reloads itself at expiry: next expiry = last expiry + Period, no drift
+}TIMER_MODE_TYPEDEF;
+
+typedef enum
+{
+	T_EXEC_ISR,		// callback runs in TIM4 interrupt(only for short and timing critical work),
+					// not masked by critical sections: lock-free queue calls only, no OS calls
+	T_EXEC_TASK,	// callback deferred to task Hal_Timer_Pro
+}TIMER_EXEC_TYPEDEF;
+
 typedef struct
 {
-	TIMER_STATE_TYPEDEF state; 	// INVALID: failed; STOP: timer idle; START: timer run
-	unsigned char CompleteFlag; // 0: not complete; 1: complete
-	unsigned short CurrentCount; 
-	unsigned short Period; 
-	void (*func)(void); 
+	TIMER_STATE_TYPEDEF state; 	// INVALID: failed; STOP: timer idle; START: timer run(in the wheel)
+	unsigned char CompleteFlag; // 0: not complete; 1: complete, deferred callback pending
+	TIMER_MODE_TYPEDEF Mode;
+	TIMER_EXEC_TYPEDEF Exec;	// callback execution context
+	Hal_TimerHandle_t Next;		// slot list of the wheel
+	Hal_TimerHandle_t Prev;
+	unsigned short Slot;		// level * HAL_TIMER_WHEEL_SLOTS + slot index of the list
+	unsigned long Expire;		// time base count of the expiry(START), counts left(STOP)
+	unsigned long Period; 
+	void (*func)(void); 		// 0: handle free
 }Stu_TimerTypedef;
 
 void Hal_Timer_Init(void);
-void Hal_Timer_CreatTimer(TIMER_ID_TYPEDEF ID, void (*proc)(void), unsigned short Period, TIMER_STATE_TYPEDEF State);
-TIMER_RESULT_TYPEDEF Hal_Timer_ResetTimer(TIMER_ID_TYPEDEF ID, TIMER_STATE_TYPEDEF State);
-TIMER_RESULT_TYPEDEF Hal_Timer_TimerDelete(TIMER_ID_TYPEDEF ID);
-TIMER_RESULT_TYPEDEF Hal_Timer_StateControl(TIMER_ID_TYPEDEF ID,TIMER_STATE_TYPEDEF State);
-TIMER_STATE_TYPEDEF	Hal_Timer_GetState(TIMER_ID_TYPEDEF ID);
+void Hal_Timer_Pro(void);
+Hal_TimerHandle_t Hal_Timer_CreatTimer(void (*proc)(void), unsigned long Period, TIMER_STATE_TYPEDEF State, TIMER_MODE_TYPEDEF Mode, TIMER_EXEC_TYPEDEF Exec);
+TIMER_RESULT_TYPEDEF Hal_Timer_ResetTimer(Hal_TimerHandle_t hTimer, TIMER_STATE_TYPEDEF State);
+TIMER_RESULT_TYPEDEF Hal_Timer_TimerDelete(Hal_TimerHandle_t hTimer);
+TIMER_RESULT_TYPEDEF Hal_Timer_StateControl(Hal_TimerHandle_t hTimer, TIMER_STATE_TYPEDEF State);
+TIMER_STATE_TYPEDEF	Hal_Timer_GetState(Hal_TimerHandle_t hTimer);
+unsigned long Hal_Timer_GetCount(void);
+#if CFG_POWER_STOP
+unsigned long Hal_Timer_NextUs(void);
+#endif
+#if CFG_TIMER_JITTER
+void Hal_Timer_JitterReport(void (*Output)(unsigned char *buf, unsigned int len));
+#endif
 
 #endif
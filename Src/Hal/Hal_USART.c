@@ -3,9 +3,13 @@
 * Functionality: Implements USART1 and USART2 communication with host computer for reception, transmission, debugging, and serial data transparent transmission
 *                @ Configures USART1 and USART2 GPIO pins, USART parameters, NVIC priority
 *                @ USART1 polling to receive host computer debug data and echo (using queue buffer)
+*                @ the USART task has no period: it runs when data is queued for USART1(HAL_USART_EVT_TX)
+*                  and on the report tick timer of the periodic reports(HAL_USART_EVT_REPORT)
 *                @ USART2 sends a single byte to NBIOT
 *                @ USART2 sends multiple bytes of data to NBIOT
 *                @ USART2 sends string data to NBIOT
+*                @ CFG_POWER_STOP: USART2 RX(PA3) has no wake-up line, STOP is refused(HAL_POWER_LOCK_NBIOT)
+*                  for CFG_NBIOT_ACTIVE_MS after the last byte sent or received: the module is awake
 * Notes:
 *       @ Enable/disable USART debug functionality --> Comment/uncomment corresponding macros in Hal_USART.h
 *************************************************************************/
@@ -13,23 +17,68 @@
 #include "stm32f10x.h"
 #include "hal_usart.h"
 #include "os_system.h"
+#include "hal_cpu.h"
+#include "hal_timer.h"
+#include "hal_time.h"
+#include "hal_clock.h"
+#if CFG_POWER_STOP
+#include "hal_power.h"
+#endif
+
+// periodic reports built in: report tick timer
+#define HAL_USART_REPORT	(CFG_OS_PROFILE || CFG_OS_QUEUE_STAT || CFG_CPU_STACK_CHECK || CFG_TIMER_JITTER || CFG_TIME_LATENCY || CFG_CLOCK_RESIDENCY)
 
 static void Hal_USART_Config(void);
+static void Hal_USART_BaudConfig(void);
+static unsigned char Hal_USART_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz);
 static void Hal_USART_DebugPro(void);
+#if HAL_USART_REPORT
+static void Hal_USART_ReportTick(void);
+#endif
+#if CFG_OS_PROFILE
+static void Hal_USART_ProfilePro(void);
+#endif
+#if CFG_OS_QUEUE_STAT
+static void Hal_USART_QueueStatPro(void);
+#endif
+#if CFG_CPU_STACK_CHECK
+static void Hal_USART_StackPro(void);
+#endif
+#if CFG_TIMER_JITTER
+static void Hal_USART_JitterPro(void);
+#endif
+#if CFG_TIME_LATENCY
+static void Hal_USART_LatencyPro(void);
+#endif
+#if CFG_CLOCK_RESIDENCY
+static void Hal_USART_ClockPro(void);
+#endif
+#if CFG_POWER_STOP
+static void Hal_USART_NbiotActive(void);
+#if CFG_NBIOT_ACTIVE_MS
+static void Hal_USART_NbiotIdle(void);
+#endif
+#endif
 static void Hal_Usart2_SendByte(unsigned char dat);
 
 volatile unsigned char DebugIsBusy; // 1-USART1 is busy，0->idle
 
-volatile Queue256 DebugTxMsg; 		
+volatile Queue(CFG_QUEUE_DEBUG_TX) DebugTxMsg; 		
 
 USART_RxDat_CallBack_t	USART2_RxDatCBF;  
 
+#if CFG_POWER_STOP && CFG_NBIOT_ACTIVE_MS
+Hal_TimerHandle_t Hal_USART_NbiotTimer;		// NB-IoT module active time left(one-shot)
+#endif
+
 /*----------------------------------------------------------------------------
 @Name		: Hal_USART_Init()
 @Function	: USART Initialization
 		--> Configures GPIO pins, USART parameters, NVIC
 		--> Clears send queue DebugTxMsg
 		--> Sets UART send status flag DebugIsBusy to idle
+		--> report tick timer of the periodic reports(HAL_USART_REPORT_MS)
+		--> CFG_POWER_STOP: the NB-IoT module starts awake(HAL_POWER_LOCK_NBIOT)
 @Parameter	: Null
 ------------------------------------------------------------------------------*/
 void Hal_USART_Init(void)
@@ -37,32 +86,95 @@ void Hal_USART_Init(void)
 	Hal_USART_Config();
 	
 	QueueEmpty(DebugTxMsg);
+	QueueRegister(DebugTxMsg, "DebugTx");
 	
 	DebugIsBusy = 0; 		
 	USART2_RxDatCBF =0;		
+	
+#if HAL_USART_REPORT
+	Hal_Timer_CreatTimer(Hal_USART_ReportTick, HAL_TIMER_MS_TO_TICKS(HAL_USART_REPORT_MS), T_STATE_START, T_MODE_PERIODIC, T_EXEC_TASK);
+#endif
+#if CFG_POWER_STOP
+#if CFG_NBIOT_ACTIVE_MS
+	Hal_USART_NbiotTimer = Hal_Timer_CreatTimer(Hal_USART_NbiotIdle, HAL_TIMER_MS_TO_TICKS(CFG_NBIOT_ACTIVE_MS), T_STATE_STOP, T_MODE_ONESHOT, T_EXEC_TASK);
+#endif
+	Hal_USART_NbiotActive();
+#endif
 }
 
 /*----------------------------------------------------------------------------
 @Name		: Hal_USART_Pro()
-@Function	: UART debug polling function
+@Function	: UART debug task
+		--> HAL_USART_EVT_TX: start the transmission of DebugTxMsg
+		--> HAL_USART_EVT_REPORT: one step of the periodic reports
+		--> HAL_USART_EVT_NBIOT: NB-IoT module active time started again
 @Parameter	: Null
 ------------------------------------------------------------------------------*/
 void Hal_USART_Pro(void)
 {
+	unsigned short Events;
+	
+	Events = OS_EventAccept(OS_TASK_USART);
+	
 	Hal_USART_DebugPro();
+	
+#if CFG_POWER_STOP
+	if(Events & HAL_USART_EVT_NBIOT)
+	{
+		Hal_USART_NbiotActive();
+	}
+#endif
+	
+	if(!(Events & HAL_USART_EVT_REPORT))
+	{
+		return;
+	}
+#if CFG_OS_PROFILE
+	Hal_USART_ProfilePro();
+#endif
+#if CFG_OS_QUEUE_STAT
+	Hal_USART_QueueStatPro();
+#endif
+#if CFG_CPU_STACK_CHECK
+	Hal_USART_StackPro();
+#endif
+#if CFG_TIMER_JITTER
+	Hal_USART_JitterPro();
+#endif
+#if CFG_TIME_LATENCY
+	Hal_USART_LatencyPro();
+#endif
+#if CFG_CLOCK_RESIDENCY
+	Hal_USART_ClockPro();
+#endif
 }
 
 /*----------------------------------------------------------------------------
 @Name		: Hal_USART_DebugDataQueue(buf, len)
 @Function	: Enqueues received debug data into the send queue DebugTxMsg
+		--> wakes up the USART task to start the transmission
 @Parameter	: 
 		buf: Pointer to data buffer
 		len: Data length to send
 ------------------------------------------------------------------------------*/
 void Hal_USART_DebugDataQueue(unsigned char *buf, unsigned int len) 
 {
-    QueueDataIn(DebugTxMsg, &buf[0], len);
+    QueueDataInLock(DebugTxMsg, &buf[0], len);	// producers: tasks and the USART1 RX interrupt(echo)
+    OS_EventPost(OS_TASK_USART, HAL_USART_EVT_TX);
+}
+
+#if HAL_USART_REPORT
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_ReportTick()
+@Function	: report tick timer call-back(Hal_Timer task): one step of the
+			  periodic reports in the USART task
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_ReportTick(void)
+{
+	OS_EventPost(OS_TASK_USART, HAL_USART_EVT_REPORT);
 }
+#endif
 
 /*------------------------------------------------------------------------------
 @Name			: Hal_USART2_RxDatCBSRegister(Usart_RxDat_CallBack_t pCBS)
@@ -103,6 +215,143 @@ static void Hal_USART_DebugPro(void)
     } 
 }
 
+#if CFG_OS_PROFILE
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_ProfilePro()
+@Function	: Periodic task profile report through USART1
+		--> one task line per report tick to keep DebugTxMsg from overflowing
+		--> per-tick load peak line after the task lines
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_ProfilePro(void)
+{
+	static unsigned short ReportTimer = 0;
+	static unsigned char ReportID = OS_TASK_SUM + 1;
+	
+	if(ReportID < OS_TASK_SUM)
+	{
+		OS_ProfileReport((OS_TaskIDTypeDef)ReportID, Hal_USART_DebugDataQueue);
+		ReportID++;
+	}
+	else if(ReportID == OS_TASK_SUM)
+	{
+		OS_LoadReport(Hal_USART_DebugDataQueue);
+		ReportID++;
+	}
+	else
+	{
+		ReportTimer++;
+		if(ReportTimer >= HAL_USART_PROFILE_PERIOD)
+		{
+			ReportTimer = 0;
+			ReportID = 0;
+		}
+	}
+}
+#endif
+
+#if CFG_OS_QUEUE_STAT
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_QueueStatPro()
+@Function	: Periodic queue statistics report through USART1
+		--> one registered queue per report tick to keep DebugTxMsg from overflowing
+		--> half a period after the profile report, the two never share DebugTxMsg
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_QueueStatPro(void)
+{
+	static unsigned short ReportTimer = HAL_USART_QUEUE_STAT_PERIOD / 2;
+	static unsigned char ReportIndex = 0xFF;
+	
+	if(ReportIndex != 0xFF)
+	{
+		if(OS_QueueReport(ReportIndex, Hal_USART_DebugDataQueue))
+		{
+			ReportIndex++;
+		}
+		else
+		{
+			ReportIndex = 0xFF;
+		}
+	}
+	else
+	{
+		ReportTimer++;
+		if(ReportTimer >= HAL_USART_QUEUE_STAT_PERIOD)
+		{
+			ReportTimer = 0;
+			ReportIndex = 0;
+		}
+	}
+}
+#endif
+
+#if CFG_CPU_STACK_CHECK
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_StackPro()
+@Function	: Periodic stack usage report through USART1
+		--> one line per report tick, a quarter period after the profile report
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_StackPro(void)
+{
+	static unsigned short ReportTimer = HAL_USART_STACK_PERIOD / 4;
+	static unsigned char ReportIndex = 0xFF;
+	
+	if(ReportIndex != 0xFF)
+	{
+		if(Hal_CPU_StackReport(ReportIndex, Hal_USART_DebugDataQueue))
+		{
+			ReportIndex++;
+		}
+		else
+		{
+			ReportIndex = 0xFF;
+		}
+	}
+	else
+	{
+		ReportTimer++;
+		if(ReportTimer >= HAL_USART_STACK_PERIOD)
+		{
+			ReportTimer = 0;
+			ReportIndex = 0;
+		}
+	}
+}
+#endif
+
+#if CFG_POWER_STOP
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_NbiotActive()
+@Function	: USART2 traffic: the module is awake for CFG_NBIOT_ACTIVE_MS(active
+			  timer), a byte it sends in STOP would be lost(no wake-up line)
+		--> HAL_POWER_LOCK_NBIOT taken, released by the one-shot timer
+		--> tasks only(Hal_Timer): the RX interrupt posts HAL_USART_EVT_NBIOT
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_NbiotActive(void)
+{
+	Hal_Power_WakeLock(HAL_POWER_LOCK_NBIOT);
+#if CFG_NBIOT_ACTIVE_MS
+	Hal_Timer_ResetTimer(Hal_USART_NbiotTimer, T_STATE_START);
+#endif
+}
+
+#if CFG_NBIOT_ACTIVE_MS
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_NbiotIdle()
+@Function	: active time timer call-back(Hal_Timer task): no USART2 traffic
+			  for CFG_NBIOT_ACTIVE_MS, the module is in PSM, STOP allowed again
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_NbiotIdle(void)
+{
+	Hal_Power_WakeUnlock(HAL_POWER_LOCK_NBIOT);
+}
+#endif
+#endif
+
 /*----------------------------------------------------------------------------
 @Name		: Hal_Usart2_SendByte(dat)
 @Function	: USART2 sends a single byte
@@ -120,6 +369,7 @@ static void Hal_Usart2_SendByte(unsigned char dat)
 /*----------------------------------------------------------------------------
 @Name		: Hal_Uart2_Send_Data(*buf, len)
 @Function	: USART2 sends multiple bytes of data
+		--> CFG_POWER_STOP: the module answers within its active time
 @Parameter	: 
 		--> buf: Pointer to data to be sent
 		--> len: Data length to send
@@ -130,6 +380,9 @@ void Hal_USART2_Send_Data(unsigned char *buf, unsigned int len)
 	#ifndef DEBUG_PRINT_USART1RX_TO_USART2TX
     unsigned int t; 
         
+#if CFG_POWER_STOP
+    Hal_USART_NbiotActive();
+#endif
     for(t=0; t < len; t++)
     {
         Hal_Usart2_SendByte(buf[t]);
@@ -139,19 +392,20 @@ void Hal_USART2_Send_Data(unsigned char *buf, unsigned int len)
 
 /*****************************************************************************************************************
 * @brief  This function is used to send string data through USART2.
+*         CFG_POWER_STOP: the module answers within its active time.
 * @param  buf: Starting address of the string to be sent, pointer type unsigned char.
 * @retval No return value.
 *****************************************************************************************************************/
 void Hal_USART2_Send_String(const unsigned char *buf) 
 {
 	#ifndef DEBUG_PRINT_USART1RX_TO_USART2TX
-    unsigned char i; 
-    
+#if CFG_POWER_STOP
+    Hal_USART_NbiotActive();
+#endif
     while(*buf) 
     {
         Hal_Usart2_SendByte(*buf);
         
-        i = *buf;
         buf++;
     }
 	#endif
@@ -165,7 +419,6 @@ void Hal_USART2_Send_String(const unsigned char *buf)
 static void Hal_USART_Config(void) 
 {
 	GPIO_InitTypeDef GPIO_InitStructure;
-	USART_InitTypeDef USART_InitStructure;
     NVIC_InitTypeDef NVIC_InitStructure;
 	
     RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, ENABLE);
@@ -197,15 +450,7 @@ static void Hal_USART_Config(void)
 	GPIO_Init(NBIOT_RX_PORT, &GPIO_InitStructure);
 	
 	
-    USART_InitStructure.USART_BaudRate = 9600; 							// Baud rate (Baud Rate) is 9600    
-    USART_InitStructure.USART_WordLength = USART_WordLength_8b; 		// Data bits (Word Length) is 8 bits      
-    USART_InitStructure.USART_StopBits = USART_StopBits_1; 				// Stop bits (Stop Bits) is 1 bit      
-    USART_InitStructure.USART_Parity = USART_Parity_No; 				// Parity bit (Parity) is no parity 
-    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None; // Hardware flow control (Hardware Flow Control) is none  
-    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx; 	// Operation mode, enable receive (Rx) and transmit (Tx)    
-    
-	USART_Init(DEBUG_USART_PORT, &USART_InitStructure);   				// Initialize USART1     
-    USART_Init(NBIOT_PORT, &USART_InitStructure);    					// Initialize USART2
+	Hal_USART_BaudConfig();
 	
 	USART_ITConfig(DEBUG_USART_PORT, USART_IT_RXNE, ENABLE); 	// Enable USART1 receive interrupt (RXNE), when USART receives new data, it will trigger an interrupt      
 	// !!! Disable USART1 transmit interrupt (TXE): TXE is set to 1 after reset, and can only be cleared by writing to the TDR register
@@ -219,20 +464,67 @@ static void Hal_USART_Config(void)
     USART_Cmd(NBIOT_PORT, ENABLE);  							// Enable USART2 port, i.e., enable USART2 functionality, allowing data transmission and reception.
 	
 	/* Set USART1 interrupt priority */
-	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_0); 			// Set NVIC priority grouping
+	NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4); 			// Set NVIC priority grouping: preemption priorities only
     NVIC_InitStructure.NVIC_IRQChannel = USART1_IRQn; 			// Set interrupt channel to USART1 interrupt
-    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0; 	// Set preemption priority to 0, i.e., highest priority
-    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0; 			// Set sub-priority to 0, i.e., first to respond among same-priority preemption interrupts
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_USART1; 	// Below RF sampling, masked by critical sections
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0; 			// No sub-priority in group 4
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE; 			// Enable this interrupt channel
     NVIC_Init(&NVIC_InitStructure); 
 	
 	/* Set USART2 interrupt priority */
-    NVIC_PriorityGroupConfig(NVIC_PriorityGroup_0);
+    NVIC_PriorityGroupConfig(NVIC_PriorityGroup_4);
     NVIC_InitStructure.NVIC_IRQChannel = USART2_IRQn;			// Set interrupt channel to USART2 interrupt
-    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = 0;
-    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 1;			// Set sub-priority to 1
+    NVIC_InitStructure.NVIC_IRQChannelPreemptionPriority = HAL_CPU_PRIO_USART2;	// USART1 first, as the sub-priority did before
+    NVIC_InitStructure.NVIC_IRQChannelSubPriority = 0;
     NVIC_InitStructure.NVIC_IRQChannelCmd = ENABLE;
     NVIC_Init(&NVIC_InitStructure);   							// Enable this interrupt channel
+	
+	Hal_Clock_NotifyRegister(Hal_USART_ClockNotify);
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_BaudConfig()
+@Function	: USART1 and USART2 frame format and baud rate, the baud rate
+			  register is computed from the APB clock at the time of the call
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_BaudConfig(void)
+{
+	USART_InitTypeDef USART_InitStructure;
+	
+    USART_InitStructure.USART_BaudRate = 9600; 							// Baud rate (Baud Rate) is 9600    
+    USART_InitStructure.USART_WordLength = USART_WordLength_8b; 		// Data bits (Word Length) is 8 bits      
+    USART_InitStructure.USART_StopBits = USART_StopBits_1; 				// Stop bits (Stop Bits) is 1 bit      
+    USART_InitStructure.USART_Parity = USART_Parity_No; 				// Parity bit (Parity) is no parity 
+    USART_InitStructure.USART_HardwareFlowControl = USART_HardwareFlowControl_None; // Hardware flow control (Hardware Flow Control) is none  
+    USART_InitStructure.USART_Mode = USART_Mode_Rx | USART_Mode_Tx; 	// Operation mode, enable receive (Rx) and transmit (Tx)    
+    
+	USART_Init(DEBUG_USART_PORT, &USART_InitStructure);   				// Initialize USART1     
+    USART_Init(NBIOT_PORT, &USART_InitStructure);    					// Initialize USART2
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_ClockNotify(Event, MHz)
+@Function	: clock change call-back(Hal_Clock)
+		--> HAL_CLOCK_QUERY: refused while a byte is on a TX line(DebugTxMsg
+			draining, or the last byte still shifting out): it would be cut
+		--> HAL_CLOCK_CHANGED: baud rates again from the new APB clocks
+		--> a byte being received across the change is lost(NB-IoT URC):
+			App keeps the full clock while the module is busy
+@Parameter	: Event: clock change step, MHz: new HCLK
+@Return		: HAL_CLOCK_QUERY: 0: busy
+------------------------------------------------------------------------------*/
+static unsigned char Hal_USART_ClockNotify(HAL_CLOCK_EVENT_TYPEDEF Event, unsigned char MHz)
+{
+	(void)MHz;		// USART_Init reads the APB clocks back(RCC)
+	if(Event == HAL_CLOCK_QUERY)
+	{
+		// TC read from the register: the flag poll of the driver waits for it
+		return !DebugIsBusy && (DEBUG_USART_PORT->SR & USART_FLAG_TC) && (NBIOT_PORT->SR & USART_FLAG_TC);
+	}
+	
+	Hal_USART_BaudConfig();
+	return 1;
 }
 
 /*----------------------------------------------------------------------------
@@ -244,6 +536,7 @@ void USART1_IRQHandler(void)
 {
     unsigned char dat; // Variable to temporarily store data received from USART1
 
+    HAL_CPU_ISR_ENTER();
     // USART1 serial port reception: Check USART1 receive interrupt flag (RXNE)
     if (USART_GetITStatus(USART1, USART_IT_RXNE) != RESET) 
     {
@@ -280,6 +573,7 @@ void USART1_IRQHandler(void)
 		// TXE pending bit is cleared only by a write to the USART_DR register (USART_SendData()).
 		// USART_ClearITPendingBit(USART1, USART_IT_TXE); // If transmit buffer is empty, clear transmit interrupt flag
     }
+    HAL_CPU_ISR_EXIT();
 }
 
 /*----------------------------------------------------------------------------
@@ -291,6 +585,7 @@ void USART2_IRQHandler(void)
 {
     unsigned char dat; // Define a variable to temporarily store received data
     
+    HAL_CPU_ISR_ENTER();
 	// USART2 serial port reception: Check USART2 receive interrupt flag (RXNE)
     if(USART_GetITStatus(USART2, USART_IT_RXNE) != RESET)
     {   
@@ -301,6 +596,11 @@ void USART2_IRQHandler(void)
             USART2_RxDatCBF(dat);   // Call the function, passing dat data to the application layer
         } 
 		
+		OS_EventPost(OS_TASK_NBIOT, HAL_USART_EVT_NBIOT_RX);	// wake up NB-IoT task at once instead of next tick
+#if CFG_POWER_STOP
+		OS_EventPost(OS_TASK_USART, HAL_USART_EVT_NBIOT);		// module awake: active time again
+#endif
+		
 		#ifdef DEBUG_PRINT_USART2RX_TO_USART1TX
              //Hal_DebugDataQueue(&dat,1);
         #endif 
@@ -316,4 +616,106 @@ void USART2_IRQHandler(void)
 //        // If transmit buffer is empty (transmit interrupt flag), clear transmit interrupt flag
 //        USART_ClearITPendingBit(USART2, USART_IT_TXE);
     }
+    HAL_CPU_ISR_EXIT();
+}
+
+#if CFG_TIMER_JITTER
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_JitterPro()
+@Function	: Periodic RF sampling jitter report through USART1
+		--> one line, three quarters of a period after the profile report
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_JitterPro(void)
+{
+	static unsigned short ReportTimer = HAL_USART_JITTER_PERIOD * 3 / 4;
+	
+	ReportTimer++;
+	if(ReportTimer >= HAL_USART_JITTER_PERIOD)
+	{
+		ReportTimer = 0;
+		Hal_Timer_JitterReport(Hal_USART_DebugDataQueue);
+	}
+}
+#endif
+
+#if CFG_TIME_LATENCY
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_LatencyPro()
+@Function	: Periodic event latency report through USART1
+		--> one line per report tick, five eighths of a period after the profile report
+		--> a line waits while DebugTxMsg is more than half full: the reports
+			drift against each other(one tick per line), a collision is delayed, not dropped
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_LatencyPro(void)
+{
+	static unsigned short ReportTimer = HAL_USART_LATENCY_PERIOD * 5 / 8;
+	static unsigned char ReportIndex = 0xFF;
+	
+	if(ReportIndex != 0xFF)
+	{
+		if(QueueDataLen(DebugTxMsg) > (CFG_QUEUE_DEBUG_TX / 2))
+		{
+			return;
+		}
+		if(Hal_Time_LatencyReport(ReportIndex, Hal_USART_DebugDataQueue))
+		{
+			ReportIndex++;
+		}
+		else
+		{
+			ReportIndex = 0xFF;
+		}
+	}
+	else
+	{
+		ReportTimer++;
+		if(ReportTimer >= HAL_USART_LATENCY_PERIOD)
+		{
+			ReportTimer = 0;
+			ReportIndex = 0;
+		}
+	}
+}
+#endif
+
+#if CFG_CLOCK_RESIDENCY
+/*----------------------------------------------------------------------------
+@Name		: Hal_USART_ClockPro()
+@Function	: Periodic clock mode residency report through USART1
+		--> one line per report tick, seven eighths of a period after the profile report
+		--> a line waits while DebugTxMsg is more than half full(as the latency report)
+@Parameter	: Null
+------------------------------------------------------------------------------*/
+static void Hal_USART_ClockPro(void)
+{
+	static unsigned short ReportTimer = HAL_USART_CLOCK_PERIOD * 7 / 8;
+	static unsigned char ReportIndex = 0xFF;
+	
+	if(ReportIndex != 0xFF)
+	{
+		if(QueueDataLen(DebugTxMsg) > (CFG_QUEUE_DEBUG_TX / 2))
+		{
+			return;
+		}
+		if(Hal_Clock_Report(ReportIndex, Hal_USART_DebugDataQueue))
+		{
+			ReportIndex++;
+		}
+		else
+		{
+			ReportIndex = 0xFF;
+		}
+	}
+	else
+	{
+		ReportTimer++;
+		if(ReportTimer >= HAL_USART_CLOCK_PERIOD)
+		{
+			ReportTimer = 0;
+			ReportIndex = 0;
+		}
+	}
 }
+#endif
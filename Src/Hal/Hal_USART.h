@@ -1,18 +1,7 @@
 #ifndef __HAL_USART_H_
 #define __HAL_USART_H_
 
-/*------------------------------------------------------------------------------------------
-  Disable USART debugging functions by commenting out the corresponding macro definitions:
-      (1) USART1 receives data echo              DEBUG_PRINT_USART1_RX
-      (2) USART1 receives data and transmits it to USART2    DEBUG_PRINT_USART1RX_TO_USART2TX
-      (3) USART2 receives data and transmits it to USART1    DEBUG_PRINT_USART2RX_TO_USART1TX
-  USART1 cannot use the transparent transmission function in monitoring mode: 
-            to prevent USART1 data from interfering with the interaction data of USART2 and NB module
-/*------------------------------------------------------------------------------------------*/
-//#define DEBUG_PRINT_USART1_RX   			// USART1_RX echo enable			  	    
-//#define DEBUG_PRINT_USART1RX_TO_USART2TX 	// USART1_RX unvanished transmission to USART2_TX enable  
-#define DEBUG_PRINT_USART2RX_TO_USART1TX	// USART1 printout USART2_RX data
-/*------------------------------------------------------------------------------------------*/
+#include "sysconfig.h"		// USART debugging functions: DEBUG_PRINT_xxx
 
 /* USART1 TX/RX port: */
 // DEBUG_TX_PORT
@@ -35,6 +24,35 @@
 
 #define NBIOT_PORT          USART2
 
+// report tick of the periodic USART1 reports(Hal_USART_Pro, one line of a running report per tick)
+#define HAL_USART_REPORT_MS			10
+
+// task profile report period(CFG_OS_PROFILE): report ticks between two reports, one line per tick
+#define HAL_USART_PROFILE_PERIOD	500
+
+// queue statistics report period(CFG_OS_QUEUE_STAT): report ticks between two reports, one line per tick
+#define HAL_USART_QUEUE_STAT_PERIOD	500
+
+// stack usage report period(CFG_CPU_STACK_CHECK): report ticks between two reports, one line per tick
+#define HAL_USART_STACK_PERIOD		500
+
+// RF sampling jitter report period(CFG_TIMER_JITTER): report ticks between two reports
+#define HAL_USART_JITTER_PERIOD		500
+
+// event latency report period(CFG_TIME_LATENCY): report ticks between two reports, one line per tick
+#define HAL_USART_LATENCY_PERIOD	500
+
+// clock mode residency report period(CFG_CLOCK_RESIDENCY): report ticks between two reports, one line per tick
+#define HAL_USART_CLOCK_PERIOD		500
+
+// events of the USART task(no periodic release)
+#define HAL_USART_EVT_TX		OS_EVT_USER(0)		// data queued in DebugTxMsg
+#define HAL_USART_EVT_REPORT	OS_EVT_USER(1)		// report tick
+#define HAL_USART_EVT_NBIOT		OS_EVT_USER(2)		// byte received on USART2(NB-IoT module awake)
+
+// event posted to the NB-IoT task on every USART2 received byte
+#define HAL_USART_EVT_NBIOT_RX	OS_EVT_USER(0)
+
 typedef void (*USART_RxDat_CallBack_t)(unsigned char dat);
 
 void Hal_USART_Init(void);
@@ -0,0 +1,55 @@
+#ifndef __OS_PT_H_
+#define __OS_PT_H_
+
+/*------------------------------------------------------------------------------------------
+  Protothread: stackless coroutine on top of the OS task loop
+  	(1) a pt function is called again on every tick of its task and resumes after the last yield
+  	(2) only the resume point is kept in OS_PtTypeDef, locals do NOT survive a yield: use static
+  	(3) the body is one switch statement: never yield from inside another switch of the pt body
+  	(4) the return value tells the caller whether the pt is still running	-> OS_PT_SCHEDULE()
+  	
+  Usage:
+  	static char XxxPT(OS_PtTypeDef *pt)
+  	{
+  		OS_PT_BEGIN(pt);
+  		step1();
+  		OS_PT_YIELD(pt);
+  		step2();
+  		OS_PT_END(pt);
+  	}
+------------------------------------------------------------------------------------------*/
+typedef unsigned short OS_PtTypeDef;
+
+typedef enum
+{
+	OS_PT_WAITING,		// blocked on a condition
+	OS_PT_YIELDED,		// gave up the rest of this tick
+	OS_PT_EXITED,		// left by OS_PT_EXIT()
+	OS_PT_ENDED,		// ran through OS_PT_END()
+}OS_PT_STATE_TYPEDEF;
+
+// the resume point falls through into its case label: on purpose(gcc -Wimplicit-fallthrough)
+#if defined(__GNUC__) && (__GNUC__ >= 7)
+#define OS_PT_FALLTHROUGH			__attribute__((fallthrough))
+#else
+#define OS_PT_FALLTHROUGH
+#endif
+
+#define OS_PT_INIT(pt)				(*(pt) = 0)
+
+#define OS_PT_BEGIN(pt)				{ unsigned char OS_PtYieldFlag = 1; (void)OS_PtYieldFlag; switch(*(pt)) { case 0:
+
+#define OS_PT_END(pt)				} OS_PtYieldFlag = 0; OS_PT_INIT(pt); return OS_PT_ENDED; }
+
+#define OS_PT_YIELD(pt)				do { OS_PtYieldFlag = 0; *(pt) = __LINE__; OS_PT_FALLTHROUGH; case __LINE__: if(OS_PtYieldFlag == 0) return OS_PT_YIELDED; } while(0)
+
+#define OS_PT_WAIT_UNTIL(pt, cond)	do { *(pt) = __LINE__; OS_PT_FALLTHROUGH; case __LINE__: if(!(cond)) return OS_PT_WAITING; } while(0)
+
+#define OS_PT_EXIT(pt)				do { OS_PT_INIT(pt); return OS_PT_EXITED; } while(0)
+
+// block for the given OS ticks, stamp is a static unsigned short of the pt function
+#define OS_PT_DELAY(pt, stamp, ticks)	do { (stamp) = OS_GetTickCount(); OS_PT_WAIT_UNTIL(pt, (unsigned short)(OS_GetTickCount() - (stamp)) >= (ticks)); } while(0)
+
+#define OS_PT_SCHEDULE(f)			((f) < OS_PT_EXITED)
+
+#endif
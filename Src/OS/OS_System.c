@@ -1,9 +1,76 @@
+#include <string.h>
 #include "OS_System.h"
 
+// compiler barrier: queue data and indexes are accessed in program order(single core, no cache)
+#if defined(__CC_ARM)
+#define OS_QUEUE_BARRIER()		__schedule_barrier()
+#elif defined(__GNUC__)
+#define OS_QUEUE_BARRIER()		__asm volatile("" ::: "memory")
+#else
+#define OS_QUEUE_BARRIER()
+#endif
+
 volatile OS_TaskTypeDef OS_Task[OS_TASK_SUM];
 
+unsigned char OS_TaskOrder[OS_TASK_SUM];	// created task IDs sorted by priority
+unsigned char OS_TaskNum;					// number of created tasks
+
+volatile unsigned short OS_TickCount;		// system tick counter
+volatile unsigned char OS_PeakReleases;		// max tasks released in one tick
+
 CPUInterrupt_CallBack_t CPUInterrupptCtrlCBS;
 
+static void OS_TaskRelease(unsigned char ID);
+static void OS_TaskPeriodRelease(unsigned char ID);
+static unsigned char OS_TaskSelect(void);
+static void OS_TaskDeadlineCheck(unsigned char ID, unsigned short Release);
+
+#if CFG_OS_TICKLESS_IDLE
+CPUIdle_CallBack_t CPUIdleCBS;
+
+static void OS_Idle(void);
+#endif
+
+#if CFG_OS_PROFILE
+CPUCycle_CallBack_t CPUCycleCBS;
+
+OS_ProfileTypeDef OS_Profile[OS_TASK_SUM];
+volatile unsigned char OS_RunningTask = OS_TASK_SUM;	// task running now, OS_TASK_SUM: none
+volatile unsigned int OS_TickLoadCycle;				// task execution cycles finished in current tick
+volatile unsigned int OS_PeakLoadCycle;				// max task execution cycles in one tick
+
+static void OS_ProfileClear(unsigned char ID);
+static unsigned int OS_ProfileStart(unsigned char ID, unsigned int ReleaseCycle);
+static void OS_ProfileEnd(unsigned char ID, unsigned int StartCycle);
+#endif
+
+OS_MsgTypeDef OS_MsgPool[OS_MSG_POOL_NUM];	// message blocks
+volatile unsigned int OS_MsgUsed;			// bit n set: block n taken
+
+#if CFG_OS_QUEUE_STAT
+OS_QueueCtrlTypeDef *OS_QueueList[OS_QUEUE_REG_MAX];	// registered queues
+const char *OS_QueueName[OS_QUEUE_REG_MAX];
+unsigned short OS_QueueSize[OS_QUEUE_REG_MAX];			// bytes or records
+unsigned char OS_QueueNum;
+
+static void OS_QueuePeak(OS_QueueCtrlTypeDef *pCtrl, unsigned short Tail);
+#endif
+
+#if CFG_OS_PREEMPTIVE
+CPUStackInit_CallBack_t CPUStackInitCBS;
+CPUSwitch_CallBack_t CPUSwitchCBS;
+
+unsigned int OS_TaskStack[OS_TASK_SUM][OS_TASK_STACK_SIZE];	// task stacks
+unsigned int OS_IdleStack[OS_IDLE_STACK_SIZE];				// idle thread stack
+unsigned int *OS_TaskSP[OS_TASK_SUM+1];						// saved stack pointers, [OS_TASK_SUM]: idle thread
+volatile unsigned char OS_TaskActive[OS_TASK_SUM];			// 1: task started and not finished(may be preempted)
+volatile unsigned char OS_CurrentTask = OS_TASK_SUM;		// thread on CPU, OS_TASK_SUM: idle thread
+volatile unsigned char OS_PreemptRunning;					// 1: scheduler started
+
+static void OS_TaskThread(void);
+static void OS_IdleThread(void);
+#endif
+
 
 /********************************************************************************************************
 	@Name		: OS_CPUInterruptCBSRegister
@@ -18,6 +85,38 @@ void OS_CPUInterruptCBSRegister(CPUInterrupt_CallBack_t pCPUInterruptCtrlCBS)
 	}
 }
 
+#if CFG_OS_PREEMPTIVE
+/********************************************************************************************************
+	@Name		: OS_CPUContextCBSRegister
+	@Function	: register CPU context functions for preemptive kernel
+	@pStackInitCBS: thread stack initial call-back function's address
+	@pSwitchCBS	: context switch request call-back function's address
+********************************************************************************************************/
+void OS_CPUContextCBSRegister(CPUStackInit_CallBack_t pStackInitCBS, CPUSwitch_CallBack_t pSwitchCBS)
+{
+	if(CPUStackInitCBS == 0)
+	{
+		CPUStackInitCBS = pStackInitCBS;
+		CPUSwitchCBS = pSwitchCBS;
+	}
+}
+#endif
+
+#if CFG_OS_TICKLESS_IDLE
+/********************************************************************************************************
+	@Name		: OS_CPUIdleCBSRegister
+	@Function	: register CPU idle(sleep) function
+	@pCPUIdleCBS: CPU idle call-back function's address
+********************************************************************************************************/
+void OS_CPUIdleCBSRegister(CPUIdle_CallBack_t pCPUIdleCBS)
+{
+	if(CPUIdleCBS == 0)
+	{
+		CPUIdleCBS = pCPUIdleCBS;
+	}
+}
+#endif
+
 /********************************************************************************************************
 	@Name		: OS_TaskInit                                                         
 	@Function	: System task initial				                                     
@@ -31,22 +130,172 @@ void OS_TaskInit(void)
 		OS_Task[i].RunFlag = OS_SLEEP;
 		OS_Task[i].RunPeriod = 0;
 		OS_Task[i].RunTimer = 0;
+		OS_Task[i].Priority = OS_PRIO_LOWEST;
+		OS_Task[i].Deadline = OS_DEADLINE_NONE;
+		OS_Task[i].ReleaseTick = 0;
+		OS_Task[i].MissCnt = 0;
+		OS_Task[i].Events = 0;
+	#if CFG_OS_PROFILE
+		OS_ProfileClear(i);
+	#endif
 	}	
+	OS_TaskNum = 0;
+	OS_TickCount = 0;
+	OS_PeakReleases = 0;
+	OS_MsgUsed = 0;
 }
 
 
 /*******************************************************************************
 	@Name		: OS_CreatTask
 	@Function	: Creat task
+	@Period		: release period in system ticks, OS_PERIOD_NONE: released by OS_TaskGetUp/OS_EventPost only
+	@Offset		: release phase in system ticks(0 ~ Period-1), tasks of the same period
+				  with different offsets are released in different ticks
+	@Priority	: 0(highest) ~ 255(lowest)
+	@Deadline	: relative deadline in system ticks from task release, OS_DEADLINE_NONE: no deadline
+	@flag		: not used, a task starts OS_SLEEP
 *******************************************************************************/
-void OS_CreatTask(unsigned char ID, void (*proc)(void), unsigned short Period, OS_TaskStatusTypeDef flag)
+void OS_CreatTask(unsigned char ID, void (*proc)(void), unsigned short Period, unsigned short Offset, unsigned char Priority, unsigned short Deadline, OS_TaskStatusTypeDef flag)
 {	
+	unsigned char i;
+	
+	(void)flag;
 	if(!OS_Task[ID].task)
 	{
 		OS_Task[ID].task = proc;
 		OS_Task[ID].RunFlag = OS_SLEEP;
 		OS_Task[ID].RunPeriod = Period;
+		// first release after Offset+1 ticks
 		OS_Task[ID].RunTimer = 0;
+		if(Period)
+		{
+			OS_Task[ID].RunTimer = Period - 1 - (Offset % Period);
+		}
+		OS_Task[ID].Priority = Priority;
+		OS_Task[ID].Deadline = Deadline;
+		OS_Task[ID].MissCnt = 0;
+		OS_Task[ID].Events = 0;
+		
+		// insert into priority order list, behind tasks of the same priority
+		for(i=OS_TaskNum; i>0; i--)
+		{
+			if(OS_Task[OS_TaskOrder[i-1]].Priority <= Priority)
+			{
+				break;
+			}
+			OS_TaskOrder[i] = OS_TaskOrder[i-1];
+		}
+		OS_TaskOrder[i] = ID;
+		OS_TaskNum++;
+	}
+}
+
+/*******************************************************************************
+	@Name		: OS_TaskRelease
+	@Function	: set a task ready and stamp its release tick,
+				  a task still waiting keeps its first release tick
+*******************************************************************************/
+static void OS_TaskRelease(unsigned char ID)
+{
+	if(OS_Task[ID].RunFlag != OS_RUN)
+	{
+		OS_Task[ID].ReleaseTick = OS_TickCount;
+		OS_Task[ID].RunFlag = OS_RUN;
+	#if CFG_OS_PROFILE
+		if(CPUCycleCBS != 0)
+		{
+			OS_Profile[ID].ReleaseCycle = CPUCycleCBS();
+		}
+	#endif
+	#if CFG_OS_PREEMPTIVE
+		// let the scheduler check if the released task preempts the running one
+		if(OS_PreemptRunning)
+		{
+			CPUSwitchCBS();
+		}
+	#endif
+	}
+}
+
+/*******************************************************************************
+	@Name		: OS_TaskPeriodRelease
+	@Function	: periodic release of a task, mark OS_EVT_TICK
+*******************************************************************************/
+static void OS_TaskPeriodRelease(unsigned char ID)
+{
+#if CFG_OS_PROFILE
+#if CFG_OS_PREEMPTIVE
+	if((OS_Task[ID].RunFlag == OS_RUN) || OS_TaskActive[ID])
+#else
+	if((OS_Task[ID].RunFlag == OS_RUN) || (OS_RunningTask == ID))
+#endif
+	{
+		OS_Profile[ID].Overruns++;
+	}
+#endif
+	OS_Task[ID].Events |= OS_EVT_TICK;
+	OS_TaskRelease(ID);
+}
+
+/*******************************************************************************
+	@Name		: OS_TaskSelect
+	@Function	: select the next task to run: highest priority first,
+				  earliest absolute deadline among ready tasks of the same priority
+	@Return		: task ID, OS_TASK_SUM: no task ready
+*******************************************************************************/
+static unsigned char OS_TaskSelect(void)
+{
+	unsigned char i;
+	unsigned char ID;
+	unsigned char Sel = OS_TASK_SUM;
+	signed short Slack;
+	signed short SelSlack = 0;
+	
+	for(i=0; i<OS_TaskNum; i++)
+	{
+		ID = OS_TaskOrder[i];
+	#if CFG_OS_PREEMPTIVE
+		if((OS_Task[ID].RunFlag == OS_RUN) || OS_TaskActive[ID])
+	#else
+		if(OS_Task[ID].RunFlag == OS_RUN)
+	#endif
+		{
+			if((Sel != OS_TASK_SUM) && (OS_Task[ID].Priority != OS_Task[Sel].Priority))
+			{
+				break;
+			}
+			
+			if(OS_Task[ID].Deadline == OS_DEADLINE_NONE)
+			{
+				Slack = 0x7FFF;
+			}
+			else
+			{
+				Slack = (signed short)(OS_Task[ID].ReleaseTick + OS_Task[ID].Deadline - OS_TickCount);
+			}
+			
+			if((Sel == OS_TASK_SUM) || (Slack < SelSlack))
+			{
+				Sel = ID;
+				SelSlack = Slack;
+			}
+		}
+	}
+	
+	return Sel;
+}
+
+/*******************************************************************************
+	@Name		: OS_TaskDeadlineCheck
+	@Function	: task finished: count deadline miss if finished at or after the deadline tick
+	@Release	: release tick of the finished run
+*******************************************************************************/
+static void OS_TaskDeadlineCheck(unsigned char ID, unsigned short Release)
+{
+	if((OS_Task[ID].Deadline != OS_DEADLINE_NONE) && ((unsigned short)(OS_TickCount - Release) >= OS_Task[ID].Deadline))
+	{
+		OS_Task[ID].MissCnt++;
 	}
 }
 
@@ -58,42 +307,337 @@ void OS_CreatTask(unsigned char ID, void (*proc)(void), unsigned short Period, O
 void OS_ClockInterruptHandle(void)
 {
 	unsigned char i;
+	unsigned char Releases = 0;
+	OS_TickCount++;
 	for(i=0; i<OS_TASK_SUM; i++)	
 	{
-		if(OS_Task[i].task)	
+		if((OS_Task[i].task) && (OS_Task[i].RunPeriod != OS_PERIOD_NONE))	
 		{					
 			OS_Task[i].RunTimer++;
 			if(OS_Task[i].RunTimer >= OS_Task[i].RunPeriod)	
 			{
 				OS_Task[i].RunTimer = 0;
-				OS_Task[i].RunFlag = OS_RUN;
+				OS_TaskPeriodRelease(i);
+				Releases++;
 			}
 			
 		}
 	}
 	
+	// per-tick load peak
+	if(Releases > OS_PeakReleases)
+	{
+		OS_PeakReleases = Releases;
+	}
+#if CFG_OS_PROFILE
+	if(OS_TickLoadCycle > OS_PeakLoadCycle)
+	{
+		OS_PeakLoadCycle = OS_TickLoadCycle;
+	}
+	OS_TickLoadCycle = 0;
+#endif
 }
 
+#if CFG_OS_PREEMPTIVE
 /*******************************************************************************
 	@Name		: OS_Start
-	@Function	: Start task
+	@Function	: Start task: build the first context of every task thread and
+				  the idle thread, then switch to the highest priority ready thread
 *******************************************************************************/
 void OS_Start(void)
 {
 	unsigned char i;
+	unsigned short j;
+	
+	// paint the thread stacks for OS_TaskStackPeak
+	for(i=0; i<OS_TASK_SUM; i++)
+	{
+		for(j=0; j<OS_TASK_STACK_SIZE; j++)
+		{
+			OS_TaskStack[i][j] = OS_STACK_PAINT;
+		}
+	}
+	for(j=0; j<OS_IDLE_STACK_SIZE; j++)
+	{
+		OS_IdleStack[j] = OS_STACK_PAINT;
+	}
+	
+	for(i=0; i<OS_TASK_SUM; i++)
+	{
+		OS_TaskActive[i] = 0;
+		if(OS_Task[i].task)
+		{
+			OS_TaskSP[i] = CPUStackInitCBS(&OS_TaskStack[i][OS_TASK_STACK_SIZE], OS_TaskThread);
+		}
+	}
+	OS_TaskSP[OS_TASK_SUM] = CPUStackInitCBS(&OS_IdleStack[OS_IDLE_STACK_SIZE], OS_IdleThread);
+	
+	OS_CurrentTask = OS_TASK_SUM;
+	OS_PreemptRunning = 1;
+	CPUSwitchCBS();		// first switch never returns here
+	
+	while(1);
+}
+
+/*******************************************************************************
+	@Name		: OS_TaskStackPeak
+	@Function	: stack high-water mark of a thread: words above the lowest
+				  one which lost its paint
+	@ID			: task ID, OS_TASK_SUM: idle thread
+	@Return		: max stack used(bytes)
+*******************************************************************************/
+unsigned short OS_TaskStackPeak(unsigned char ID)
+{
+	unsigned int *pStack;
+	unsigned short Size;
+	unsigned short i;
+	
+	if(ID < OS_TASK_SUM)
+	{
+		pStack = OS_TaskStack[ID];
+		Size = OS_TASK_STACK_SIZE;
+	}
+	else
+	{
+		pStack = OS_IdleStack;
+		Size = OS_IDLE_STACK_SIZE;
+	}
+	
+	for(i=0; (i<Size) && (pStack[i] == OS_STACK_PAINT); i++);
+	
+	return (Size - i) * 4;
+}
+
+/*******************************************************************************
+	@Name		: OS_SwitchContext
+	@Function	: called by the CPU context switch handler: save the stack pointer
+				  of the current thread and select the next one
+	@pSP		: stack pointer of the saved context, 0: first switch(nothing saved)
+	@Return		: stack pointer of the context to restore
+*******************************************************************************/
+unsigned int *OS_SwitchContext(unsigned int *pSP)
+{
+	unsigned char ID;
+	
+	if(pSP != 0)
+	{
+		OS_TaskSP[OS_CurrentTask] = pSP;
+	}
+	
+	ID = OS_TaskSelect();	// OS_TASK_SUM: no task ready -> idle thread
+	OS_CurrentTask = ID;
+	
+	return OS_TaskSP[ID];
+}
+
+/*******************************************************************************
+	@Name		: OS_TaskThread
+	@Function	: thread body of every task: one task handler call per release,
+				  then give up the CPU till the next release.
+				  the handler may be preempted by a higher priority task anywhere
+*******************************************************************************/
+static void OS_TaskThread(void)
+{
+	unsigned char ID = OS_CurrentTask;
+	unsigned short Release;
+	unsigned char IptStatus;
+#if CFG_OS_PROFILE
+	unsigned int ReleaseCycle;
+	unsigned int StartCycle;
+#endif
+	
+	while(1)
+	{
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+		Release = OS_Task[ID].ReleaseTick;
+	#if CFG_OS_PROFILE
+		ReleaseCycle = OS_Profile[ID].ReleaseCycle;
+	#endif
+		OS_Task[ID].RunFlag = OS_SLEEP;
+		OS_TaskActive[ID] = 1;
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+		
+	#if CFG_OS_PROFILE
+		StartCycle = OS_ProfileStart(ID, ReleaseCycle);
+	#endif
+		(*(OS_Task[ID].task))();
+	#if CFG_OS_PROFILE
+		OS_ProfileEnd(ID, StartCycle);
+	#endif
+		
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+		OS_TaskDeadlineCheck(ID, Release);
+		OS_TaskActive[ID] = 0;
+		CPUSwitchCBS();		// switched out here, back again on the next release
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	}
+}
+
+/*******************************************************************************
+	@Name		: OS_IdleThread
+	@Function	: runs when no task is ready
+*******************************************************************************/
+static void OS_IdleThread(void)
+{
+#if CFG_OS_TICKLESS_IDLE
+	unsigned char IptStatus;
+#endif
+	
+	while(1)
+	{
+	#if CFG_OS_TICKLESS_IDLE
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+		if(OS_TaskSelect() == OS_TASK_SUM)
+		{
+			OS_Idle();
+		}
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	#endif
+	}
+}
+
+#else
+/*******************************************************************************
+	@Name		: OS_Start
+	@Function	: Start task: run the selected ready task, selection restarts from
+				  the highest priority after every task, count deadline misses
+*******************************************************************************/
+void OS_Start(void)
+{
+	unsigned char ID;
+	unsigned short Release = 0;
+	unsigned char IptStatus;
+#if CFG_OS_PROFILE
+	unsigned int ReleaseCycle = 0;
+	unsigned int StartCycle;
+#endif
 	while(1)
 	{
-		for(i=0; i<OS_TASK_SUM; i++)
+		if(CPUInterrupptCtrlCBS != 0)
+		{
+			CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+		}
+		ID = OS_TaskSelect();
+		if(ID != OS_TASK_SUM)
+		{
+			Release = OS_Task[ID].ReleaseTick;
+		#if CFG_OS_PROFILE
+			ReleaseCycle = OS_Profile[ID].ReleaseCycle;
+		#endif
+			OS_Task[ID].RunFlag = OS_SLEEP;
+		}
+	#if CFG_OS_TICKLESS_IDLE
+		else
+		{
+			OS_Idle();
+		}
+	#endif
+		if(CPUInterrupptCtrlCBS != 0)
+		{
+			CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+		}
+		
+		if(ID != OS_TASK_SUM)
+		{
+		#if CFG_OS_PROFILE
+			StartCycle = OS_ProfileStart(ID, ReleaseCycle);
+		#endif
+			(*(OS_Task[ID].task))();
+		#if CFG_OS_PROFILE
+			OS_ProfileEnd(ID, StartCycle);
+		#endif
+			
+			OS_TaskDeadlineCheck(ID, Release);
+		}
+	}
+}
+#endif
+
+#if CFG_OS_TICKLESS_IDLE
+/*******************************************************************************
+	@Name		: OS_GetIdleTicks
+	@Function	: get system ticks until the next task is due
+	@Return		: ticks to the nearest task release(0xFFFF: no task created)
+*******************************************************************************/
+static unsigned short OS_GetIdleTicks(void)
+{
+	unsigned char i;
+	unsigned short Ticks = 0xFFFF;
+	unsigned short Remain;
+
+	for(i=0; i<OS_TASK_SUM; i++)
+	{
+		if((OS_Task[i].task) && (OS_Task[i].RunPeriod != OS_PERIOD_NONE))
+		{
+			if(OS_Task[i].RunTimer < OS_Task[i].RunPeriod)
+			{
+				Remain = OS_Task[i].RunPeriod - OS_Task[i].RunTimer;
+			}
+			else
+			{
+				Remain = 1;
+			}
+
+			if(Remain < Ticks)
+			{
+				Ticks = Remain;
+			}
+		}
+	}
+
+	return Ticks;
+}
+
+/*******************************************************************************
+	@Name		: OS_TickCompensate
+	@Function	: add the system ticks passed in sleep to all task timers
+		--> a sleep past a release keeps the phase: the task timer goes on
+			with the ticks after the release, one release for the periods
+			slept through
+	@Ticks		: ticks slept without clock interrupt
+*******************************************************************************/
+static void OS_TickCompensate(unsigned short Ticks)
+{
+	unsigned char i;
+	unsigned long Passed;
+	OS_TickCount += Ticks;
+	for(i=0; i<OS_TASK_SUM; i++)
+	{
+		if((OS_Task[i].task) && (OS_Task[i].RunPeriod != OS_PERIOD_NONE))
 		{
-			if(OS_Task[i].RunFlag == OS_RUN)
+			Passed = (unsigned long)OS_Task[i].RunTimer + Ticks;
+			OS_Task[i].RunTimer = (unsigned short)(Passed % OS_Task[i].RunPeriod);
+			if(Passed >= OS_Task[i].RunPeriod)
 			{
-				OS_Task[i].RunFlag = OS_SLEEP;
-		 
-				(*(OS_Task[i].task))();	
+				OS_TaskPeriodRelease(i);
 			}
-		}	
+		}
+	}
+}
+
+/*******************************************************************************
+	@Name		: OS_Idle
+	@Function	: no task ready: hand the CPU to the idle call-back till the next
+				  task release(or any interrupt), then correct the task timers.
+				  called inside the critical section of the ready check, or a
+				  wake-up from interrupt could be missed
+*******************************************************************************/
+static void OS_Idle(void)
+{
+	unsigned short Ticks;
+
+	if((CPUIdleCBS == 0) || (CPUInterrupptCtrlCBS == 0))
+	{
+		return;
+	}
+
+	Ticks = CPUIdleCBS(OS_GetIdleTicks());
+	if(Ticks)
+	{
+		OS_TickCompensate(Ticks);
 	}
 }
+#endif
 
 /*******************************************************************************
 	@Name		: OS_TaskGetUp
@@ -107,7 +651,7 @@ void OS_TaskGetUp(OS_TaskIDTypeDef taskID)
 	{
 		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
 	}
-	OS_Task[taskID].RunFlag = OS_RUN;	
+	OS_TaskRelease(taskID);	
 	if(CPUInterrupptCtrlCBS != 0)
 	{
 		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
@@ -133,88 +677,681 @@ void OS_TaskSleep(OS_TaskIDTypeDef taskID)
 	}
 }
 
-/********************************************************************************************************
-	@Name		: S_QueueEmpty
-	@Function	: empty(Initialize) a queue
-	@Head->head pointer, Tail->tail pointer,  HBuff->queue buffer
-********************************************************************************************************/
-void S_QueueEmpty(unsigned char **Head, unsigned char **Tail, unsigned char *HBuff)
+/*******************************************************************************
+	@Name		: OS_EventPost
+	@Function	: post event flags to a task and make it ready at once,
+				  callable from interrupt and task
+	@taskID		: ID of the receiving task
+	@Events		: event flags, OS_EVT_USER(n)
+*******************************************************************************/
+void OS_EventPost(OS_TaskIDTypeDef taskID, unsigned short Events)
 {
-		*Head = HBuff;
-		*Tail = HBuff;
-}
-
-/********************************************************************************************************
-	@Name		: S_QueueDataIn
-	@Function	: input data to a queue
-	@Head->head pointer, Tail->tail pointer,  HBuff->queue buffer, Len->queue buffer length, HData->data buffer, DataLen->data length
-********************************************************************************************************/
-void S_QueueDataIn(unsigned char **Head, unsigned char **Tail, unsigned char *HBuff, unsigned short Len, unsigned char *HData, unsigned short DataLen)
-{	
-	unsigned short num;
 	unsigned char IptStatus;
-	
 	if(CPUInterrupptCtrlCBS != 0)
 	{
 		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
 	}
-	for(num = 0; num < DataLen; num++, HData++)
-	{
-			**Tail = *HData;
-			(*Tail)++;
-			if(*Tail == HBuff+Len)
-				*Tail = HBuff;
-			if(*Tail == *Head)
-			{
-					if(++(*Head) == HBuff+Len)
-						*Head = HBuff;		
-			}
-	}	
+	OS_Task[taskID].Events |= Events;
+	OS_TaskRelease(taskID);
 	if(CPUInterrupptCtrlCBS != 0)
 	{
 		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
 	}
 }
 
-/********************************************************************************************************
-	@Name		: S_QueueDataOut
-	@Function	: output data from a queue
-	@Head->head pointer, Tail->tail pointer,  HBuff->queue buffer, Len->queue buffer length, Data->data buffer
-********************************************************************************************************/
-unsigned char S_QueueDataOut(unsigned char **Head, unsigned char **Tail, unsigned char *HBuff, unsigned short Len, unsigned char *Data)
-{					   
-	unsigned char back = 0;
+/*******************************************************************************
+	@Name		: OS_EventAccept
+	@Function	: get and clear the pending event flags of a task
+	@taskID		: ID of task
+	@Return		: pending event flags, OS_EVT_TICK: released by period
+*******************************************************************************/
+unsigned short OS_EventAccept(OS_TaskIDTypeDef taskID)
+{
+	unsigned short Events;
 	unsigned char IptStatus;
 	if(CPUInterrupptCtrlCBS != 0)
 	{
 		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
 	}
-	*Data = 0;
-	if(*Tail != *Head)
-	{
-			*Data = **Head;
-			back = 1; 				
-			if(++(*Head) == HBuff+Len)
-				*Head = HBuff;
-	}
+	Events = OS_Task[taskID].Events;
+	OS_Task[taskID].Events = 0;
 	if(CPUInterrupptCtrlCBS != 0)
 	{
 		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
 	}
-	return back;	
+	return Events;
+}
+
+/*******************************************************************************
+	@Name		: OS_TaskGetMissCnt
+	@Function	: get deadline miss counter of a task
+	@taskID		: ID of task
+*******************************************************************************/
+unsigned short OS_TaskGetMissCnt(OS_TaskIDTypeDef taskID)
+{
+	return OS_Task[taskID].MissCnt;
 }
 
+#if CFG_OS_PROFILE
 /********************************************************************************************************
-	@Name		: S_QueueDataLen
-	@Function	: get data length in a queue
-	@Head->head pointer, Tail->tail pointer, Len->queue buffer length
+	@Name		: OS_CPUCycleCBSRegister
+	@Function	: register CPU cycle counter function for task profiler
+	@pCPUCycleCBS: CPU cycle counter call-back function's address
 ********************************************************************************************************/
-unsigned short S_QueueDataLen(unsigned char **Head, unsigned char **Tail, unsigned short Len)
+void OS_CPUCycleCBSRegister(CPUCycle_CallBack_t pCPUCycleCBS)
 {
-		if(*Tail > *Head)
-			return *Tail-*Head;
-		if(*Tail < *Head)
-			return *Tail+Len-*Head;
-		return 0;
+	if(CPUCycleCBS == 0)
+	{
+		CPUCycleCBS = pCPUCycleCBS;
+	}
+}
+
+/*******************************************************************************
+	@Name		: OS_ProfileClear
+	@Function	: clear profile statistics of a task
+*******************************************************************************/
+static void OS_ProfileClear(unsigned char ID)
+{
+	OS_Profile[ID].Runs = 0;
+	OS_Profile[ID].Overruns = 0;
+	OS_Profile[ID].MinCycle = 0xFFFFFFFF;
+	OS_Profile[ID].MaxCycle = 0;
+	OS_Profile[ID].SumCycle = 0;
+	OS_Profile[ID].MaxLatency = 0;
 }
 
+/*******************************************************************************
+	@Name		: OS_ProfileStart
+	@Function	: task start: record release latency
+	@Return		: cycle counter at task start
+*******************************************************************************/
+static unsigned int OS_ProfileStart(unsigned char ID, unsigned int ReleaseCycle)
+{
+	unsigned int Cycle;
+	
+	if(CPUCycleCBS == 0)
+	{
+		return 0;
+	}
+	
+	Cycle = CPUCycleCBS();
+	if((Cycle - ReleaseCycle) > OS_Profile[ID].MaxLatency)
+	{
+		OS_Profile[ID].MaxLatency = Cycle - ReleaseCycle;
+	}
+	OS_RunningTask = ID;
+	
+	return Cycle;
+}
+
+/*******************************************************************************
+	@Name		: OS_ProfileEnd
+	@Function	: task end: record execution cycles
+*******************************************************************************/
+static void OS_ProfileEnd(unsigned char ID, unsigned int StartCycle)
+{
+	unsigned int Cycle;
+	
+	OS_RunningTask = OS_TASK_SUM;
+	if(CPUCycleCBS == 0)
+	{
+		return;
+	}
+	
+	Cycle = CPUCycleCBS() - StartCycle;
+	OS_TickLoadCycle += Cycle;
+	OS_Profile[ID].Runs++;
+	OS_Profile[ID].SumCycle += Cycle;
+	if(Cycle < OS_Profile[ID].MinCycle)
+	{
+		OS_Profile[ID].MinCycle = Cycle;
+	}
+	if(Cycle > OS_Profile[ID].MaxCycle)
+	{
+		OS_Profile[ID].MaxCycle = Cycle;
+	}
+}
+
+/*******************************************************************************
+	@Name		: OS_ProfileReport
+	@Function	: output profile of a task as one line and restart its statistics:
+				  "PRF,ID,Runs,MinCycle,AvgCycle,MaxCycle,Overruns,MaxLatency,DeadlineMiss\r\n"
+	@taskID		: ID of task, not created task has no output
+	@Output		: output function, e.g. Hal_USART_DebugDataQueue
+*******************************************************************************/
+void OS_ProfileReport(OS_TaskIDTypeDef taskID, OS_ProfileOutput_t Output)
+{
+	unsigned char Buff[96];
+	unsigned char Len;
+	unsigned char i;
+	unsigned char IptStatus;
+	unsigned int Val[8];
+	
+	if(!OS_Task[taskID].task)
+	{
+		return;
+	}
+	
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+	}
+	Val[0] = taskID;
+	Val[1] = OS_Profile[taskID].Runs;
+	Val[2] = OS_Profile[taskID].Runs ? OS_Profile[taskID].MinCycle : 0;
+	Val[3] = OS_Profile[taskID].Runs ? (OS_Profile[taskID].SumCycle / OS_Profile[taskID].Runs) : 0;
+	Val[4] = OS_Profile[taskID].MaxCycle;
+	Val[5] = OS_Profile[taskID].Overruns;
+	Val[6] = OS_Profile[taskID].MaxLatency;
+	Val[7] = OS_Task[taskID].MissCnt;
+	OS_ProfileClear(taskID);
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	}
+	
+	Buff[0] = 'P';
+	Buff[1] = 'R';
+	Buff[2] = 'F';
+	Len = 3;
+	for(i=0; i<8; i++)
+	{
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Val[i], &Buff[Len]);
+	}
+	Buff[Len++] = '\r';
+	Buff[Len++] = '\n';
+	
+	Output(Buff, Len);
+}
+
+/*******************************************************************************
+	@Name		: OS_LoadReport
+	@Function	: output the per-tick load peaks as one line and restart them:
+				  "LOAD,PeakReleases,PeakCycles\r\n"
+				  PeakReleases: max tasks released in one tick,
+				  PeakCycles: max task execution cycles finished in one tick
+	@Output		: output function, e.g. Hal_USART_DebugDataQueue
+*******************************************************************************/
+void OS_LoadReport(OS_ProfileOutput_t Output)
+{
+	unsigned char Buff[32];
+	unsigned char Len;
+	unsigned char IptStatus;
+	unsigned int Releases;
+	unsigned int Cycles;
+	
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+	}
+	Releases = OS_PeakReleases;
+	Cycles = OS_PeakLoadCycle;
+	OS_PeakReleases = 0;
+	OS_PeakLoadCycle = 0;
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	}
+	
+	Buff[0] = 'L';
+	Buff[1] = 'O';
+	Buff[2] = 'A';
+	Buff[3] = 'D';
+	Buff[4] = ',';
+	Len = 5;
+	Len += OS_UIntToStr(Releases, &Buff[Len]);
+	Buff[Len++] = ',';
+	Len += OS_UIntToStr(Cycles, &Buff[Len]);
+	Buff[Len++] = '\r';
+	Buff[Len++] = '\n';
+	
+	Output(Buff, Len);
+}
+#endif
+
+/*******************************************************************************
+	@Name		: OS_UIntToStr
+	@Function	: unsigned integer to decimal string(report lines)
+	@Return		: string length
+*******************************************************************************/
+unsigned char OS_UIntToStr(unsigned int Val, unsigned char *pBuff)
+{
+	unsigned char Temp[10];
+	unsigned char Len = 0;
+	unsigned char i;
+	
+	do
+	{
+		Temp[Len++] = '0' + (Val % 10);
+		Val /= 10;
+	}while(Val);
+	
+	for(i=0; i<Len; i++)
+	{
+		pBuff[i] = Temp[Len-1-i];
+	}
+	return Len;
+}
+
+/*******************************************************************************
+	@Name		: OS_GetTickCount
+	@Function	: get system tick counter
+*******************************************************************************/
+unsigned short OS_GetTickCount(void)
+{
+	return OS_TickCount;
+}
+
+/*******************************************************************************
+	@Name		: OS_GetPeakReleases
+	@Function	: get max tasks released by the clock interrupt in one tick
+*******************************************************************************/
+unsigned char OS_GetPeakReleases(void)
+{
+	return OS_PeakReleases;
+}
+
+/********************************************************************************************************
+	@Name		: S_QueueEmpty
+	@Function	: empty(Initialize) a queue
+	@pCtrl->queue control
+********************************************************************************************************/
+void S_QueueEmpty(OS_QueueCtrlTypeDef *pCtrl)
+{
+	unsigned char IptStatus;
+	
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+	}
+	pCtrl->Head = pCtrl->Tail;
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	}
+}
+
+/********************************************************************************************************
+	@Name		: S_QueueDataIn
+	@Function	: input data to a queue(producer side), all data or nothing
+				  runs from RAM: RF sampling pushes from TIM4 at 20kHz
+	@pCtrl->queue control, HBuff->queue buffer, Size->queue buffer size(power of 2), HData->data buffer, DataLen->data length
+	@Return		: 1: stored, 0: not enough space, data dropped
+********************************************************************************************************/
+OS_RAMFUNC unsigned char S_QueueDataIn(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *HData, unsigned short DataLen)
+{	
+	unsigned short In;
+	unsigned short Pos;
+	unsigned short Span;
+	
+	In = pCtrl->Tail;
+	if((unsigned short)(Size - (unsigned short)(In - pCtrl->Head)) < DataLen)
+	{
+#if CFG_OS_QUEUE_STAT
+		pCtrl->Overflows++;
+		pCtrl->Dropped += DataLen;
+#endif
+		return 0;
+	}
+	OS_QUEUE_BARRIER();		// space seen before the buffer is written
+	
+	Pos = In & (Size - 1);
+	if(DataLen == 1)
+	{
+		HBuff[Pos] = *HData;
+	}
+	else
+	{
+		Span = Size - Pos;	// bytes to the buffer end
+		if(Span > DataLen)
+		{
+			Span = DataLen;
+		}
+		memcpy(&HBuff[Pos], HData, Span);
+		memcpy(HBuff, &HData[Span], DataLen - Span);
+	}
+	
+	OS_QUEUE_BARRIER();		// data written before it is published
+	pCtrl->Tail = In + DataLen;
+#if CFG_OS_QUEUE_STAT
+	OS_QueuePeak(pCtrl, In + DataLen);
+#endif
+	return 1;
+}
+
+/********************************************************************************************************
+	@Name		: S_QueueDataOut
+	@Function	: output one byte from a queue(consumer side)
+	@pCtrl->queue control, HBuff->queue buffer, Size->queue buffer size(power of 2), Data->data buffer
+	@Return		: 1: one byte output, 0: queue empty(*Data = 0)
+********************************************************************************************************/
+unsigned char S_QueueDataOut(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *Data)
+{					   
+	unsigned short Out;
+	
+	Out = pCtrl->Head;
+	if(Out == pCtrl->Tail)
+	{
+		*Data = 0;
+		return 0;
+	}
+	OS_QUEUE_BARRIER();		// data published before it is read
+	
+	*Data = HBuff[Out & (Size - 1)];
+	
+	OS_QUEUE_BARRIER();		// data read before the space is released
+	pCtrl->Head = Out + 1;
+	return 1;	
+}
+
+/********************************************************************************************************
+	@Name		: S_QueueDataRead
+	@Function	: output up to DataLen bytes from a queue(consumer side)
+	@pCtrl->queue control, HBuff->queue buffer, Size->queue buffer size(power of 2), HData->data buffer, DataLen->buffer length
+	@Return		: bytes output
+********************************************************************************************************/
+unsigned short S_QueueDataRead(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *HData, unsigned short DataLen)
+{
+	unsigned short Out;
+	unsigned short Pos;
+	unsigned short Span;
+	unsigned short Len;
+	
+	Out = pCtrl->Head;
+	Len = pCtrl->Tail - Out;
+	if(Len > DataLen)
+	{
+		Len = DataLen;
+	}
+	if(!Len)
+	{
+		return 0;
+	}
+	OS_QUEUE_BARRIER();
+	
+	Pos = Out & (Size - 1);
+	Span = Size - Pos;
+	if(Span > Len)
+	{
+		Span = Len;
+	}
+	memcpy(HData, &HBuff[Pos], Span);
+	memcpy(&HData[Span], HBuff, Len - Span);
+	
+	OS_QUEUE_BARRIER();
+	pCtrl->Head = Out + Len;
+	return Len;
+}
+
+/********************************************************************************************************
+	@Name		: S_QueueDataLen
+	@Function	: get data length in a queue
+	@pCtrl->queue control
+********************************************************************************************************/
+unsigned short S_QueueDataLen(OS_QueueCtrlTypeDef *pCtrl)
+{
+	return (unsigned short)(pCtrl->Tail - pCtrl->Head);
+}
+
+/********************************************************************************************************
+	@Name		: S_RecQueueIn
+	@Function	: input one record to a record queue(producer side)
+				  runs from RAM: RF edge capture pushes from TIM1
+	@pCtrl->queue control(indexes in records), HBuff->record buffer, Num->number of records(power of 2), RecSize->record size, pRec->record
+	@Return		: 1: stored, 0: queue full, record rejected
+********************************************************************************************************/
+OS_RAMFUNC unsigned char S_RecQueueIn(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Num, unsigned short RecSize, const void *pRec)
+{
+	unsigned short In;
+	
+	In = pCtrl->Tail;
+	if((unsigned short)(In - pCtrl->Head) >= Num)
+	{
+#if CFG_OS_QUEUE_STAT
+		pCtrl->Overflows++;
+		pCtrl->Dropped++;
+#endif
+		return 0;
+	}
+	OS_QUEUE_BARRIER();
+	
+	memcpy(&HBuff[(In & (Num - 1)) * RecSize], pRec, RecSize);
+	
+	OS_QUEUE_BARRIER();
+	pCtrl->Tail = In + 1;
+#if CFG_OS_QUEUE_STAT
+	OS_QueuePeak(pCtrl, In + 1);
+#endif
+	return 1;
+}
+
+/********************************************************************************************************
+	@Name		: S_RecQueueOut
+	@Function	: output one record from a record queue(consumer side)
+	@pCtrl->queue control(indexes in records), HBuff->record buffer, Num->number of records(power of 2), RecSize->record size, pRec->record buffer
+	@Return		: 1: one record output, 0: queue empty
+********************************************************************************************************/
+unsigned char S_RecQueueOut(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Num, unsigned short RecSize, void *pRec)
+{
+	unsigned short Out;
+	
+	Out = pCtrl->Head;
+	if(Out == pCtrl->Tail)
+	{
+		return 0;
+	}
+	OS_QUEUE_BARRIER();
+	
+	memcpy(pRec, &HBuff[(Out & (Num - 1)) * RecSize], RecSize);
+	
+	OS_QUEUE_BARRIER();
+	pCtrl->Head = Out + 1;
+	return 1;
+}
+
+/********************************************************************************************************
+	@Name		: S_QueueDataInLock
+	@Function	: S_QueueDataIn with interrupts masked, for queues with more than one producer
+********************************************************************************************************/
+unsigned char S_QueueDataInLock(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *HData, unsigned short DataLen)
+{
+	unsigned char IptStatus;
+	unsigned char back;
+	
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+	}
+	back = S_QueueDataIn(pCtrl, HBuff, Size, HData, DataLen);
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	}
+	return back;
+}
+
+/********************************************************************************************************
+	@Name		: S_QueueDataOutLock
+	@Function	: S_QueueDataOut with interrupts masked, for queues with more than one consumer
+********************************************************************************************************/
+unsigned char S_QueueDataOutLock(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *Data)
+{
+	unsigned char IptStatus;
+	unsigned char back;
+	
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+	}
+	back = S_QueueDataOut(pCtrl, HBuff, Size, Data);
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	}
+	return back;
+}
+
+/********************************************************************************************************
+	@Name		: OS_MsgAlloc
+	@Function	: take a free block of the message pool
+	@Type		: message type
+	@Return		: handle of the block, OS_MSG_NULL: no block free
+********************************************************************************************************/
+unsigned char OS_MsgAlloc(unsigned char Type)
+{
+	unsigned char IptStatus;
+	unsigned char hMsg = OS_MSG_NULL;
+	unsigned char i;
+	
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+	}
+	for(i=0; i<OS_MSG_POOL_NUM; i++)
+	{
+		if(!(OS_MsgUsed & (1UL << i)))
+		{
+			OS_MsgUsed |= (1UL << i);
+			hMsg = i;
+			break;
+		}
+	}
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	}
+	
+	if(hMsg != OS_MSG_NULL)
+	{
+		OS_MsgPool[hMsg].Type = Type;
+		OS_MsgPool[hMsg].Len = 0;
+	}
+	return hMsg;
+}
+
+/********************************************************************************************************
+	@Name		: OS_MsgGet
+	@Function	: message block of a handle, read and written in place by the owner of the handle
+********************************************************************************************************/
+OS_MsgTypeDef *OS_MsgGet(unsigned char hMsg)
+{
+	return &OS_MsgPool[hMsg];
+}
+
+/********************************************************************************************************
+	@Name		: OS_MsgFree
+	@Function	: give a block back to the message pool, OS_MSG_NULL is ignored
+********************************************************************************************************/
+void OS_MsgFree(unsigned char hMsg)
+{
+	unsigned char IptStatus;
+	
+	if(hMsg >= OS_MSG_POOL_NUM)
+	{
+		return;
+	}
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_ENTER_CRITICAL,&IptStatus);
+	}
+	OS_MsgUsed &= ~(1UL << hMsg);
+	if(CPUInterrupptCtrlCBS != 0)
+	{
+		CPUInterrupptCtrlCBS(CPU_EXIT_CRITICAL,&IptStatus);
+	}
+}
+
+#if CFG_OS_QUEUE_STAT
+/********************************************************************************************************
+	@Name		: OS_QueuePeak
+	@Function	: producer side: record the max queue length after a write
+********************************************************************************************************/
+OS_RAMFUNC static void OS_QueuePeak(OS_QueueCtrlTypeDef *pCtrl, unsigned short Tail)
+{
+	unsigned short Len;
+	
+	Len = Tail - pCtrl->Head;
+	if(Len > pCtrl->Peak)
+	{
+		pCtrl->Peak = Len;
+	}
+}
+
+/********************************************************************************************************
+	@Name		: S_QueueRegister
+	@Function	: add a queue to the statistics registry, registered again or registry full: ignored
+	@pCtrl->queue control, pName->queue name, Size->queue size in bytes(records)
+********************************************************************************************************/
+void S_QueueRegister(OS_QueueCtrlTypeDef *pCtrl, const char *pName, unsigned short Size)
+{
+	unsigned char i;
+	
+	for(i=0; i<OS_QueueNum; i++)
+	{
+		if(OS_QueueList[i] == pCtrl)
+		{
+			return;
+		}
+	}
+	if(OS_QueueNum < OS_QUEUE_REG_MAX)
+	{
+		OS_QueueList[OS_QueueNum] = pCtrl;
+		OS_QueueName[OS_QueueNum] = pName;
+		OS_QueueSize[OS_QueueNum] = Size;
+		OS_QueueNum++;
+	}
+}
+
+/*******************************************************************************
+	@Name		: OS_QueueReport
+	@Function	: output statistics of a registered queue as one line:
+				  "QUE,Index,Name,Size,Len,Peak,Overflows,Dropped\r\n"
+	@Index		: registry index(0 ~ registered queues - 1)
+	@Output		: output function, e.g. Hal_USART_DebugDataQueue
+	@Return		: 1: line output, 0: no queue registered at Index
+*******************************************************************************/
+unsigned char OS_QueueReport(unsigned char Index, OS_ProfileOutput_t Output)
+{
+	unsigned char Buff[64];
+	unsigned char Len;
+	unsigned char i;
+	unsigned int Val[5];
+	const char *pName;
+	OS_QueueCtrlTypeDef *pCtrl;
+	
+	if(Index >= OS_QueueNum)
+	{
+		return 0;
+	}
+	pCtrl = OS_QueueList[Index];
+	
+	Val[0] = OS_QueueSize[Index];
+	Val[1] = S_QueueDataLen(pCtrl);
+	Val[2] = pCtrl->Peak;
+	Val[3] = pCtrl->Overflows;
+	Val[4] = pCtrl->Dropped;
+	
+	Buff[0] = 'Q';
+	Buff[1] = 'U';
+	Buff[2] = 'E';
+	Buff[3] = ',';
+	Len = 4;
+	Len += OS_UIntToStr(Index, &Buff[Len]);
+	Buff[Len++] = ',';
+	for(pName = OS_QueueName[Index]; *pName && (Len < 24); pName++)
+	{
+		Buff[Len++] = *pName;
+	}
+	for(i=0; i<5; i++)
+	{
+		Buff[Len++] = ',';
+		Len += OS_UIntToStr(Val[i], &Buff[Len]);
+	}
+	Buff[Len++] = '\r';
+	Buff[Len++] = '\n';
+	
+	Output(Buff, Len);
+	return 1;
+}
+#endif
@@ -1,41 +1,162 @@
 #ifndef __OS_SYSTEM_H_
 #define __OS_SYSTEM_H_
 
-extern void S_QueueEmpty(unsigned char **Head, unsigned char **Tail, unsigned char *HBuff);
-extern void S_QueueDataIn(unsigned char **Head, unsigned char **Tail, unsigned char *HBuff, unsigned short Len, unsigned char *HData, unsigned short DataLen);
-extern unsigned char S_QueueDataOut(unsigned char **Head, unsigned char **Tail, unsigned char *HBuff, unsigned short Len, unsigned char *Data);
-extern unsigned short S_QueueDataLen(unsigned char **Head, unsigned char **Tail, unsigned short Len);
+#include "sysconfig.h"
+
+#define OS_TICK_HZ				CFG_OS_TICK_HZ							// system tick rate(SysConfig.h)
+#define OS_MS_TO_TICKS(ms)		((unsigned short)(((unsigned long)(ms) * OS_TICK_HZ) / 1000))
+
+#if CFG_OS_PREEMPTIVE
+#define OS_TASK_STACK_SIZE		256		// task stack size in words
+#define OS_IDLE_STACK_SIZE		64		// idle thread stack size in words
+#endif
+
+#define OS_STACK_PAINT			0xA5A5A5A5UL	// unused stack words(high-water mark)
+
+#if CFG_OS_QUEUE_STAT
+#define OS_QUEUE_REG_MAX		16		// queues in the statistics registry
+#endif
+
+#define OS_MSG_POOL_NUM			CFG_MSG_POOL_NUM	// blocks in the message pool(max 32)
+#define OS_MSG_DATA_SIZE		6		// data bytes per message block
+
+// RAM functions: the scatter file(Src/Startup/SecurityHost.sct) places the sections in RW_IRAM1,
+// __main copies them from flash with the initialized data at boot, other compilers: flash
+#if CFG_OS_RAMFUNC && defined(__CC_ARM)
+#define OS_RAMFUNC				__attribute__((section(".ramfunc")))
+#define OS_RAMCONST				__attribute__((section(".ramconst")))
+#else
+#define OS_RAMFUNC
+#define OS_RAMCONST
+#endif
+
+
+/*------------------------------------------------------------------------------------------
+  Byte queue: single producer/single consumer ring
+  	(1) Head: read index, only written by the consumer; Tail: write index, only written by the producer
+  	(2) indexes run free(16 bit), buffer size is a power of 2: position = index & (size - 1)
+  	(3) QueueDataIn/QueueDataOut/QueueDataRead take no lock: one producer and one consumer
+  		context per queue(e.g. ISR -> task, task -> task)
+  	(4) more producers(or consumers) on one queue use QueueDataInLock(or QueueDataOutLock)
+  	(5) QueueDataIn stores all data or nothing: data is dropped when the queue is full
+  	(6) QueueEmpty masks interrupts, use it to initialize or from the consumer side
+  	(7) CFG_OS_QUEUE_STAT: QueueRegister adds a queue to the registry of OS_QueueReport,
+  		the statistics are kept by the producer side and never cleared
+------------------------------------------------------------------------------------------*/
+// queue control: indexes and statistics
+typedef struct
+{
+	volatile unsigned short Head;		// read index
+	volatile unsigned short Tail;		// write index
+#if CFG_OS_QUEUE_STAT
+	unsigned short Peak;				// max length
+	unsigned short Overflows;			// writes rejected for no space
+	unsigned int Dropped;				// bytes(records) of the rejected writes
+#endif
+}OS_QueueCtrlTypeDef;
+
+extern void S_QueueEmpty(OS_QueueCtrlTypeDef *pCtrl);
+extern unsigned char S_QueueDataIn(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *HData, unsigned short DataLen);
+extern unsigned char S_QueueDataOut(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *Data);
+extern unsigned short S_QueueDataRead(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *HData, unsigned short DataLen);
+extern unsigned short S_QueueDataLen(OS_QueueCtrlTypeDef *pCtrl);
+extern unsigned char S_QueueDataInLock(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *HData, unsigned short DataLen);
+extern unsigned char S_QueueDataOutLock(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Size, unsigned char *Data);
  
  
-#define QueueEmpty(x)	   S_QueueEmpty((unsigned char**)&(x).Head,(unsigned char**)&(x).Tail,(unsigned char*)(x).Buff) 
-#define QueueDataIn(x,y,z) S_QueueDataIn((unsigned char**)&(x).Head,(unsigned char**)&(x).Tail,(unsigned char*)(x).Buff,sizeof((x).Buff),(y),(z))
-#define QueueDataOut(x,y)  S_QueueDataOut((unsigned char**)&(x).Head,(unsigned char**)&(x).Tail,(unsigned char*)(x).Buff,sizeof((x).Buff),(y)) 
-#define QueueDataLen(x)	   S_QueueDataLen((unsigned char**)&(x).Head,(unsigned char**)&(x).Tail,sizeof((x).Buff))  
+#define QueueEmpty(x)	   		S_QueueEmpty((OS_QueueCtrlTypeDef*)&(x).Ctrl) 
+#define QueueDataIn(x,y,z) 		S_QueueDataIn((OS_QueueCtrlTypeDef*)&(x).Ctrl,(unsigned char*)(x).Buff,sizeof((x).Buff),(y),(z))
+#define QueueDataOut(x,y)  		S_QueueDataOut((OS_QueueCtrlTypeDef*)&(x).Ctrl,(unsigned char*)(x).Buff,sizeof((x).Buff),(y)) 
+#define QueueDataRead(x,y,z)	S_QueueDataRead((OS_QueueCtrlTypeDef*)&(x).Ctrl,(unsigned char*)(x).Buff,sizeof((x).Buff),(y),(z))
+#define QueueDataLen(x)	   		S_QueueDataLen((OS_QueueCtrlTypeDef*)&(x).Ctrl)  
+#define QueueDataInLock(x,y,z) 	S_QueueDataInLock((OS_QueueCtrlTypeDef*)&(x).Ctrl,(unsigned char*)(x).Buff,sizeof((x).Buff),(y),(z))
+#define QueueDataOutLock(x,y)  	S_QueueDataOutLock((OS_QueueCtrlTypeDef*)&(x).Ctrl,(unsigned char*)(x).Buff,sizeof((x).Buff),(y)) 
 
 
-/* */
+/* queue of N bytes(power of 2), sizes from SysConfig.h: Queue(CFG_QUEUE_xxx) name; */
+#define Queue(N)				struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[N];}
+
+/* queue N holds N bytes(power of 2), the older sizes which are no power of 2 keep their
+   names for source compatibility and are rounded up: the capacity is given next to them */
 typedef struct
 {
-	unsigned char *Head; 
-	unsigned char *Tail; 
-	unsigned char Buff[4+1];
+	OS_QueueCtrlTypeDef Ctrl; 
+	unsigned char Buff[4];
 }Queue4;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[8+1];}    Queue8;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[16+1];}   Queue16; 
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[32+1];}   Queue32;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[64+1];}   Queue64;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[90+1];}   Queue90;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[120+1];}  Queue120;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[340+1];}  Queue340;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[745+1];}  Queue745;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[128+1];}  Queue128;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[248+1];}  Queue248;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[256+1];}  Queue256;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[512+1];}  Queue512;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[1024+1];} Queue1K;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[2048+1];} Queue2K;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[5120+1];} Queue5K;
-typedef struct{unsigned char *Head; unsigned char *Tail; unsigned char Buff[10240+1];} Queue10K;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[8];}     Queue8;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[16];}    Queue16; 
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[32];}    Queue32;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[64];}    Queue64;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[128];}   Queue90;		// 128 bytes
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[128];}   Queue120;		// 128 bytes
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[512];}   Queue340;		// 512 bytes
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[1024];}  Queue745;		// 1K bytes
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[128];}   Queue128;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[256];}   Queue248;		// 256 bytes
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[256];}   Queue256;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[512];}   Queue512;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[1024];}  Queue1K;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[2048];}  Queue2K;
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[8192];}  Queue5K;		// 8K bytes
+typedef struct{OS_QueueCtrlTypeDef Ctrl; unsigned char Buff[16384];} Queue10K;		// 16K bytes: most of the 20K RAM
+
+
+/*------------------------------------------------------------------------------------------
+  Record queue: single producer/single consumer ring of fixed size records
+  	(1) declare: RecQueue(type, N) name;  N: number of records, power of 2
+  	(2) RecQueueIn/RecQueueOut copy one whole record, indexes and statistics count records
+  	(3) overflow policy: a record is rejected when the queue is full(return 0),
+  		queued records are never overwritten or split
+  	(4) QueueEmpty empties a record queue as well
+------------------------------------------------------------------------------------------*/
+extern unsigned char S_RecQueueIn(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Num, unsigned short RecSize, const void *pRec);
+extern unsigned char S_RecQueueOut(OS_QueueCtrlTypeDef *pCtrl, unsigned char *HBuff, unsigned short Num, unsigned short RecSize, void *pRec);
+
+#define RecQueue(type,N)		struct{OS_QueueCtrlTypeDef Ctrl; type Rec[N];}
+#define RecQueueIn(x,y)			S_RecQueueIn((OS_QueueCtrlTypeDef*)&(x).Ctrl,(unsigned char*)(x).Rec,sizeof((x).Rec)/sizeof((x).Rec[0]),sizeof((x).Rec[0]),(y))
+#define RecQueueOut(x,y)		S_RecQueueOut((OS_QueueCtrlTypeDef*)&(x).Ctrl,(unsigned char*)(x).Rec,sizeof((x).Rec)/sizeof((x).Rec[0]),sizeof((x).Rec[0]),(y))
+#define RecQueueLen(x)			S_QueueDataLen((OS_QueueCtrlTypeDef*)&(x).Ctrl)
+
+
+/*------------------------------------------------------------------------------------------
+  Queue registry(CFG_OS_QUEUE_STAT), without CFG_OS_QUEUE_STAT the registration is left out
+  	QueueRegister(x, "name")		byte queue, statistics in bytes
+  	RecQueueRegister(x, "name")		record queue, statistics in records
+------------------------------------------------------------------------------------------*/
+#if CFG_OS_QUEUE_STAT
+extern void S_QueueRegister(OS_QueueCtrlTypeDef *pCtrl, const char *pName, unsigned short Size);
+
+#define QueueRegister(x,name)		S_QueueRegister((OS_QueueCtrlTypeDef*)&(x).Ctrl,(name),sizeof((x).Buff))
+#define RecQueueRegister(x,name)	S_QueueRegister((OS_QueueCtrlTypeDef*)&(x).Ctrl,(name),sizeof((x).Rec)/sizeof((x).Rec[0]))
+#else
+#define QueueRegister(x,name)
+#define RecQueueRegister(x,name)
+#endif
+
+
+/*------------------------------------------------------------------------------------------
+  Message pool: fixed blocks for event messages, passed by a 1 byte handle
+  	(1) the producer takes a block(OS_MsgAlloc), writes the message into it and passes the
+  		handle on(call-back, byte queue), the block is not copied
+  	(2) the owner of the handle reads the message in place(OS_MsgGet) and frees the block
+  		(OS_MsgFree) when done, a handle which is not passed on is freed by its holder
+  	(3) OS_MsgAlloc/OS_MsgFree mask interrupts: tasks and ISRs take blocks from one pool
+  	(4) no block free: OS_MsgAlloc returns OS_MSG_NULL, the message is dropped
+------------------------------------------------------------------------------------------*/
+#define OS_MSG_NULL				0xFF
+#define OS_MSG_TYPE_USER(n)		(n)		// message types are defined by the producers
+
+typedef struct
+{
+	unsigned char Type;						// message type
+	unsigned char Len;						// data length
+	unsigned char Data[OS_MSG_DATA_SIZE];
+	unsigned long long Stamp;				// event time at the producer(Hal_Time_Now, us)
+}OS_MsgTypeDef;
+
+unsigned char OS_MsgAlloc(unsigned char Type);
+OS_MsgTypeDef *OS_MsgGet(unsigned char hMsg);
+void OS_MsgFree(unsigned char hMsg);
 
 
 
@@ -48,6 +169,26 @@ typedef enum
 // define a CPU interrupt control call-back function pointer: CPUInterrupt_CallBack_t,
 typedef void (*CPUInterrupt_CallBack_t)(CPU_EA_TYPEDEF cmd,unsigned char *pSta);
 
+// define a CPU idle call-back function pointer: CPUIdle_CallBack_t,
+// called with interrupts masked, Ticks: system ticks until the next task is due,
+// return: complete system ticks slept which the clock interrupt has not counted
+typedef unsigned short (*CPUIdle_CallBack_t)(unsigned short Ticks);
+
+// define a CPU cycle counter call-back function pointer: CPUCycle_CallBack_t,
+// return: free running CPU cycle counter
+typedef unsigned int (*CPUCycle_CallBack_t)(void);
+
+// define a CPU stack initial call-back function pointer: CPUStackInit_CallBack_t,
+// build the first context of a thread on its stack, return: stack pointer of the saved context
+typedef unsigned int *(*CPUStackInit_CallBack_t)(unsigned int *pStackTop, void (*entry)(void));
+
+// define a CPU context switch call-back function pointer: CPUSwitch_CallBack_t,
+// request a context switch(executed when no interrupt is active and interrupts are enabled)
+typedef void (*CPUSwitch_CallBack_t)(void);
+
+// define a profile output function pointer: OS_ProfileOutput_t, e.g. Hal_USART_DebugDataQueue
+typedef void (*OS_ProfileOutput_t)(unsigned char *buf, unsigned int len);
+
 
 // task ID
 typedef enum
@@ -58,10 +199,34 @@ typedef enum
 	OS_TASK4,
 	OS_TASK5,
 	OS_TASK6,
+	OS_TASK7,
 	
 	OS_TASK_SUM	// trick to count number of enum members
 }OS_TaskIDTypeDef;
 
+// task ID assignment
+#define OS_TASK_LED		OS_TASK1
+#define OS_TASK_KEY		OS_TASK2
+#define OS_TASK_RFD		OS_TASK3
+#define OS_TASK_USART	OS_TASK4
+#define OS_TASK_NBIOT	OS_TASK5
+#define OS_TASK_APP		OS_TASK6
+#define OS_TASK_TIMER	OS_TASK7
+
+// task period: 0 -> no periodic release, the task only runs on OS_TaskGetUp/OS_EventPost
+#define OS_PERIOD_NONE		0
+
+// task priority: lower value runs first, tasks of same priority run earliest deadline first
+#define OS_PRIO_HIGHEST		0
+#define OS_PRIO_LOWEST		255
+
+// task relative deadline: 0 -> no deadline
+#define OS_DEADLINE_NONE	0
+
+// task event flags: OS_EVT_TICK is set by periodic release, user events start from OS_EVT_USER(0)
+#define OS_EVT_TICK			0x0001
+#define OS_EVT_USER(n)		(0x0002 << (n))		// n: 0~14
+
 
 // system running state
 typedef enum
@@ -77,16 +242,55 @@ typedef struct
 	OS_TaskStatusTypeDef RunFlag;		// task running state
 	unsigned short	RunPeriod;			// task handler run time
 	unsigned short RunTimer;			// task handler timer
+	unsigned char Priority;				// task priority(0: highest)
+	unsigned short Deadline;			// relative deadline in system ticks(0: none)
+	unsigned short ReleaseTick;			// system tick of the latest release
+	unsigned short MissCnt;				// deadline miss counter
+	unsigned short Events;				// pending event flags
 }OS_TaskTypeDef;
 
+#if CFG_OS_PROFILE
+// task profile structure, statistics since the last report
+typedef struct
+{
+	unsigned int Runs;					// run counter
+	unsigned int Overruns;				// periodic releases while the task is still ready or running
+	unsigned int MinCycle;				// min execution cycles
+	unsigned int MaxCycle;				// max execution cycles
+	unsigned int SumCycle;				// sum of execution cycles(average = SumCycle / Runs)
+	unsigned int ReleaseCycle;			// cycle counter at the latest release
+	unsigned int MaxLatency;			// max cycles from release to start
+}OS_ProfileTypeDef;
+#endif
+
  
 /*******************************************************************************/
 void OS_CPUInterruptCBSRegister(CPUInterrupt_CallBack_t pCPUInterruptCtrlCBS);
+void OS_CPUIdleCBSRegister(CPUIdle_CallBack_t pCPUIdleCBS);
 void OS_ClockInterruptHandle(void);
 void OS_TaskInit(void);
-void OS_CreatTask(unsigned char ID, void (*proc)(void), unsigned short TimeDly, OS_TaskStatusTypeDef flag);
+void OS_CreatTask(unsigned char ID, void (*proc)(void), unsigned short TimeDly, unsigned short Offset, unsigned char Priority, unsigned short Deadline, OS_TaskStatusTypeDef flag);
 void OS_Start(void);
 void OS_TaskGetUp(OS_TaskIDTypeDef taskID);	
 void OS_TaskSleep(OS_TaskIDTypeDef taskID);
+void OS_EventPost(OS_TaskIDTypeDef taskID, unsigned short Events);
+unsigned short OS_EventAccept(OS_TaskIDTypeDef taskID);
+unsigned short OS_TaskGetMissCnt(OS_TaskIDTypeDef taskID);
+unsigned short OS_GetTickCount(void);
+unsigned char OS_GetPeakReleases(void);
+unsigned char OS_UIntToStr(unsigned int Val, unsigned char *pBuff);
+#if CFG_OS_PREEMPTIVE
+void OS_CPUContextCBSRegister(CPUStackInit_CallBack_t pStackInitCBS, CPUSwitch_CallBack_t pSwitchCBS);
+unsigned int *OS_SwitchContext(unsigned int *pSP);
+unsigned short OS_TaskStackPeak(unsigned char ID);
+#endif
+#if CFG_OS_PROFILE
+void OS_CPUCycleCBSRegister(CPUCycle_CallBack_t pCPUCycleCBS);
+void OS_ProfileReport(OS_TaskIDTypeDef taskID, OS_ProfileOutput_t Output);
+void OS_LoadReport(OS_ProfileOutput_t Output);
+#endif
+#if CFG_OS_QUEUE_STAT
+unsigned char OS_QueueReport(unsigned char Index, OS_ProfileOutput_t Output);
+#endif
 
 #endif
@@ -37,6 +37,7 @@ Stack_Size      EQU     0x00000400
                 AREA    STACK, NOINIT, READWRITE, ALIGN=3
 Stack_Mem       SPACE   Stack_Size
 __initial_sp
+                EXPORT  Stack_Mem                  ; main stack bottom(Hal_CPU stack check)
 
 
 ; <h> Heap Configuration
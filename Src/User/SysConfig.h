@@ -0,0 +1,167 @@
+#ifndef __SYSCONFIG_H_
+#define __SYSCONFIG_H_
+
+/*------------------------------------------------------------------------------------------
+  Product configuration: sizes, rates and optional subsystems of the firmware
+  	(1) the modules take their sizes from here: a product variant only edits this file
+  	(2) CFG_FEATURE_xxx = 0: the subsystem compiles to no code and no RAM,
+  		its calls are empty macros in the module header(-DCFG_FEATURE_xxx=0 also works)
+  	(3) kernel options and debug instrumentation are CFG_xxx 0/1 switches here as well,
+  		the modules test them with #if(-DCFG_xxx=1 builds them in)
+  	(4) the checks at the end stop the build on an inconsistent configuration,
+  		checks on structure sizes sit next to the structures(Device.c)
+------------------------------------------------------------------------------------------*/
+
+/* optional subsystems: 1: built in, 0: left out */
+#ifndef CFG_FEATURE_BEEP
+#define CFG_FEATURE_BEEP			1			// PWM buzzer(TIM3): alarm sound
+#endif
+
+/* RF receive path: 1: TIM1_CH4 input capture of PA11(edges, 1us), 0: PA11 polled every 50us(TIM4) */
+#ifndef CFG_RFD_CAPTURE
+#define CFG_RFD_CAPTURE				1
+#endif
+
+/* core clock scaling(App, Hal_Clock): 1: 8MHz(HSE) while disarmed and idle, 72MHz on activity, 0: 72MHz always */
+#ifndef CFG_CLOCK_SCALING
+#define CFG_CLOCK_SCALING			1
+#endif
+
+/* STOP mode(Hal_Power): 1: the low clock idles in STOP, woken by RF, keys or the RTC alarm, 0: WFI only
+   (needs CFG_CLOCK_SCALING and CFG_RFD_CAPTURE: polled RF samples every time base count) */
+#ifndef CFG_POWER_STOP
+#define CFG_POWER_STOP				(CFG_CLOCK_SCALING && CFG_RFD_CAPTURE)
+#endif
+
+/* kernel and CPU options(OS_System, Hal_CPU): 1: on, 0: off */
+#ifndef CFG_OS_TICKLESS_IDLE
+#define CFG_OS_TICKLESS_IDLE		1			// sleep while no task is ready, SysTick stretched to the next release
+#endif
+#ifndef CFG_OS_PREEMPTIVE
+#define CFG_OS_PREEMPTIVE			0			// every task on its own stack, preempted by priority
+#endif
+#ifndef CFG_OS_RAMFUNC
+#define CFG_OS_RAMFUNC				1			// OS_RAMFUNC code and OS_RAMCONST tables run from SRAM(no flash wait states)
+#endif
+#ifndef CFG_CPU_CRITICAL_BASEPRI
+#define CFG_CPU_CRITICAL_BASEPRI	1			// critical sections mask by priority(BASEPRI), RF is never held off, 0: PRIMASK
+#endif
+
+/* debug instrumentation, reported through USART1: 1: built in, 0: left out(product image) */
+#ifndef CFG_OS_PROFILE
+#define CFG_OS_PROFILE				0			// execution cycles, runs, overruns and release latency per task
+#endif
+#ifndef CFG_OS_QUEUE_STAT
+#define CFG_OS_QUEUE_STAT			0			// peak length, overflows and dropped data of registered queues
+#endif
+#ifndef CFG_CPU_STACK_CHECK
+#define CFG_CPU_STACK_CHECK			0			// stacks painted at boot: high-water marks, interrupt nesting peak
+#endif
+#ifndef CFG_TIMER_JITTER
+#define CFG_TIMER_JITTER			0			// TIM4 interrupt entry delay after the update event(us)
+#endif
+#ifndef CFG_TIME_LATENCY
+#define CFG_TIME_LATENCY			0			// event stamp -> handled per registered path: count, min, avg, max(us)
+#endif
+#ifndef CFG_CLOCK_RESIDENCY
+#define CFG_CLOCK_RESIDENCY			0			// time and entries per clock mode, current estimate from the datasheet
+#endif
+#ifndef CFG_POWER_WAKE_STAT
+#define CFG_POWER_WAKE_STAT			0			// STOP entries per wake-up source, wake-up -> decode latency paths
+#endif
+
+/* USART1 debugging(Hal_USART), comment out to disable:
+      (1) USART1 receives data echo                          DEBUG_PRINT_USART1_RX
+      (2) USART1 receives data and transmits it to USART2    DEBUG_PRINT_USART1RX_TO_USART2TX
+      (3) USART2 receives data and transmits it to USART1    DEBUG_PRINT_USART2RX_TO_USART1TX
+   USART1 cannot use the transparent transmission function in monitoring mode:
+      to prevent USART1 data from interfering with the interaction data of USART2 and NB module */
+//#define DEBUG_PRINT_USART1_RX   			// USART1_RX echo enable
+//#define DEBUG_PRINT_USART1RX_TO_USART2TX 	// USART1_RX unvanished transmission to USART2_TX enable
+#define DEBUG_PRINT_USART2RX_TO_USART1TX	// USART1 printout USART2_RX data
+
+/* clocks and rates */
+#define CFG_CORE_CLOCK_MHZ			72			// HCLK, TIM4 clock(APB1 x2)
+#define CFG_OS_TICK_HZ				1000		// system tick(SysTick)
+#if CFG_RFD_CAPTURE
+#define CFG_TIMER_TICK_US			1000		// Hal_Timer time base(TIM4 update), RF edges are timed by TIM1
+#else
+#define CFG_TIMER_TICK_US			50			// Hal_Timer time base(TIM4 update) = RF sampling period
+#endif
+#define CFG_RFD_POLL_MS				2			// Hal_RFD_Pro period(sampling) or wake-up deadline(capture): RF data decoded per run
+#define CFG_RFD_REPEAT_FILTER_MS	1000		// a repeated RF code is dropped within this time
+#define CFG_CLOCK_HOLD_MS			2000		// full clock kept after RF, key, server or mode activity(CFG_CLOCK_SCALING)
+#define CFG_NBIOT_ACTIVE_MS			2000		// NB-IoT module awake after USART2 traffic(active timer T3324), no STOP till then, 0: always awake
+
+/* tables */
+#define CFG_DTC_SUM					20			// detectors(EEPROM records)
+#define CFG_MSG_POOL_NUM			8			// OS message blocks
+#define CFG_TIMER_NUM				8			// Hal_Timer handles: LED, RFD(2), Beep, USART reports, NB-IoT activity and spares
+
+/* queues(bytes, power of 2) */
+#define CFG_QUEUE_DEBUG_TX			256			// USART1 transmit
+#define CFG_QUEUE_RFD_RX			32			// RF pulses(capture, records) or samples(8 per byte), ISR -> Hal_RFD_Pro
+#define CFG_QUEUE_RFD_PULSE			256			// pulse widths of one decode run(Hal_RFD_Pro stack)
+#define CFG_QUEUE_LED_CMD			4			// commands per LED
+#define CFG_QUEUE_APP_RFD_MSG		4			// RF code message handles -> App
+#define CFG_QUEUE_APP_DTC_TRIGGER	8			// triggered detectors(records: ID, RF stamp)
+
+/* EEPROM(AT24C128) */
+#define CFG_EEPROM_SIZE				16384
+#define CFG_EEPROM_PAGE				64
+
+
+/*------------------------------------------------------------------------------------------
+  Compile-time checks: a failed check is an array of negative size named CFG_ASSERT_<name>
+------------------------------------------------------------------------------------------*/
+#define CFG_STATIC_ASSERT(expr, name)	typedef char CFG_ASSERT_##name[(expr) ? 1 : -1]
+#define CFG_IS_POW2(x)					(((x) != 0) && (((x) & ((x) - 1)) == 0))
+
+/* run-time check of what the checks here can not see: a failed check stops there
+   (gcc: undefined instruction -> HardFault, host build: SIGILL; others: endless loop) */
+#if defined(__GNUC__)
+#define CFG_ASSERT(expr)				do{ if(!(expr)) { __builtin_trap(); } }while(0)
+#else
+#define CFG_ASSERT(expr)				do{ if(!(expr)) { while(1); } }while(0)
+#endif
+
+// queue indexes are masked with size - 1
+CFG_STATIC_ASSERT(CFG_IS_POW2(CFG_QUEUE_DEBUG_TX), queue_debug_tx_pow2);
+CFG_STATIC_ASSERT(CFG_IS_POW2(CFG_QUEUE_RFD_RX), queue_rfd_rx_pow2);
+CFG_STATIC_ASSERT(CFG_IS_POW2(CFG_QUEUE_RFD_PULSE), queue_rfd_pulse_pow2);
+CFG_STATIC_ASSERT(CFG_IS_POW2(CFG_QUEUE_LED_CMD), queue_led_cmd_pow2);
+CFG_STATIC_ASSERT(CFG_IS_POW2(CFG_QUEUE_APP_RFD_MSG), queue_app_rfd_msg_pow2);
+CFG_STATIC_ASSERT(CFG_IS_POW2(CFG_QUEUE_APP_DTC_TRIGGER), queue_app_dtc_trigger_pow2);
+
+// SysTick reload is 24 bit
+CFG_STATIC_ASSERT((CFG_CORE_CLOCK_MHZ * 1000000UL / CFG_OS_TICK_HZ) <= 0x1000000UL, os_tick_systick_range);
+CFG_STATIC_ASSERT((1000000UL % CFG_OS_TICK_HZ) == 0, os_tick_whole_us);
+
+// TIM4 counts 1us(prescaler: CFG_CORE_CLOCK_MHZ), the period register is 16 bit
+CFG_STATIC_ASSERT((CFG_TIMER_TICK_US >= 1) && (CFG_TIMER_TICK_US <= 0x10000UL), timer_tick_tim4_range);
+#if CFG_RFD_CAPTURE
+// pulses of two decode deadlines(shortest pulse: one ev1527 clock, 400us) fit in the pulse queues
+CFG_STATIC_ASSERT((2 * CFG_RFD_POLL_MS * 1000UL / 400) <= CFG_QUEUE_RFD_RX, queue_rfd_rx_poll);
+CFG_STATIC_ASSERT((2 * CFG_QUEUE_RFD_RX) <= CFG_QUEUE_RFD_PULSE, queue_rfd_pulse_capture);
+#else
+// Hal_RFD counts pulse widths in samples: 8 samples per ev1527 clock(400us)
+CFG_STATIC_ASSERT(CFG_TIMER_TICK_US * 8 == 400, timer_tick_rfd_sample);
+// RF samples of two decode periods fit in the sample queue(one late run)
+CFG_STATIC_ASSERT((2 * CFG_RFD_POLL_MS * 1000UL / CFG_TIMER_TICK_US / 8) <= CFG_QUEUE_RFD_RX, queue_rfd_rx_poll);
+#endif
+// Hal_Timer periods are counts of CFG_TIMER_TICK_US up to 2^30(timer wheel)
+CFG_STATIC_ASSERT((CFG_RFD_REPEAT_FILTER_MS * 1000UL / CFG_TIMER_TICK_US) < (1UL << 30), rfd_repeat_filter_timer_range);
+
+// STOP is entered from the low clock only(the core wakes up on HSI at the same 8MHz),
+// RF edges are captured: no sampling timer due every time base count
+CFG_STATIC_ASSERT(!CFG_POWER_STOP || (CFG_CLOCK_SCALING && CFG_RFD_CAPTURE), power_stop_clock_scaling);
+
+// message in-use bitmap is 32 bit, detector index 0xFF: none
+CFG_STATIC_ASSERT((CFG_MSG_POOL_NUM >= 1) && (CFG_MSG_POOL_NUM <= 32), msg_pool_bitmap);
+CFG_STATIC_ASSERT((CFG_DTC_SUM >= 1) && (CFG_DTC_SUM < 0xFF), dtc_sum_index);
+// timer handle 0xFF: none
+CFG_STATIC_ASSERT((CFG_TIMER_NUM >= 4) && (CFG_TIMER_NUM < 0xFF), timer_num_handle);
+
+CFG_STATIC_ASSERT(CFG_IS_POW2(CFG_EEPROM_PAGE) && ((CFG_EEPROM_SIZE % CFG_EEPROM_PAGE) == 0), eeprom_page);
+
+#endif
@@ -0,0 +1,629 @@
+/**
+  * SecurityHost_v1.0/bench.c
+  *
+  * Copyright (c) 2025 yuchenEm
+  * Licensed under the MIT License
+  */
+
+/************************************************************************
+* Module: Bench
+* Function: benchmark firmware(BENCH_BUILD), replaces the main of main.c
+*		@ HAL hot paths timed by the DWT cycle counter, interrupts off per run
+*		@ results on USART1(polled, 9600 8N1), one line per item:
+*			"BENCH,START,CoreClock,Overhead\r\n"
+*			"BENCH,Name,Iterations,MinCycle,AvgCycle,MaxCycle\r\n"
+*			"BENCH,END,Errors\r\n"
+*		@ Overhead: cycles of an empty measurement, subtracted from every run
+*		@ Errors: failed result checks(EEPROM read back, RF decode, DTC index)
+* Notes:
+*		@ keil: a target with BENCH_BUILD defined, same files as the firmware
+*		@ EEPROM: the last page is written, device parameters stay untouched
+*************************************************************************/
+
+#ifdef BENCH_BUILD
+
+#include "stm32f10x.h"
+#include "hal_cpu.h"
+#include "hal_clock.h"
+#include "hal_power.h"
+#include "hal_timer.h"
+#include "hal_time.h"
+#include "hal_led.h"
+#include "hal_beep.h"
+#include "hal_rfd.h"
+#include "hal_oled.h"
+#include "hal_i2c_eeprom.h"
+#include "hal_usart.h"
+#include "os_system.h"
+#include "device.h"
+
+#define BENCH_EEPROM_ADDR		(CFG_EEPROM_SIZE - CFG_EEPROM_PAGE)	// last page of AT24C128
+#define BENCH_EEPROM_LEN		CFG_EEPROM_PAGE
+#define BENCH_RFD_CODE			0x12AB02
+#if CFG_RFD_CAPTURE
+#define BENCH_RFD_FRAME_LEN		50		// captured pulses of one ev1527 frame: sync 2 + 24 bits of 2
+#define BENCH_RFD_CHUNK			(CFG_RFD_POLL_MS * 1000 / RFD_CLK_SENDLEN)	// pulses per RFD run at its deadline(2ms): one per unit at most
+#else
+#define BENCH_RFD_FRAME_LEN		128		// sampled bytes of one ev1527 frame: 8 samples(50us) = 1 unit(400us)
+#define BENCH_RFD_CHUNK			(CFG_RFD_POLL_MS * 1000 / RFD_INT_FRQ / 8)	// sampled bytes per RFD task period(2ms)
+#endif
+
+#define BENCH_START()			(Bench_Start = Hal_CPU_GetCycle())
+#define BENCH_STOP()			Bench_Stop()
+
+typedef struct
+{
+	const char *Name;
+	void (*Run)(void);			// one run: untimed preparation, timed part between BENCH_START and BENCH_STOP
+	unsigned short Iterations;
+}Bench_ItemTypeDef;
+
+static void Bench_Stop(void);
+static void Bench_Nop(void);
+static void Bench_QueueIn1(void);
+static void Bench_QueueIn16(void);
+static void Bench_QueueOut1(void);
+static void Bench_QueueOut16(void);
+static void Bench_QueueRead16(void);
+static void Bench_QueueInLock1(void);
+static void Bench_MsgHandoff(void);
+static void Bench_TimerHandler(void);
+static void Bench_TimerHandlerFull(void);
+static void Bench_TimeNow(void);
+static void Bench_RFDFrame(void);
+static void Bench_RFDRxHandler(unsigned char hMsg);
+static void Bench_OledString(void);
+static void Bench_OledRefresh(void);
+static void Bench_EEPROMPageWrite(void);
+static void Bench_EEPROMSequentialRead(void);
+static void Bench_DTCMatchLast(void);
+static void Bench_DTCMatchMiss(void);
+
+#if CFG_RFD_CAPTURE
+extern volatile RecQueue(unsigned short, CFG_QUEUE_RFD_RX) RFD_RxBuffer;
+#else
+extern volatile Queue(CFG_QUEUE_RFD_RX) RFD_RxBuffer;
+#endif
+extern Hal_TimerHandle_t RFD_RecodeFltTimer;
+extern Stru_DTC sDevice[DTC_SUM];
+extern void TIM4_IRQHandler(void);
+
+// the bench page is past the detector records
+CFG_STATIC_ASSERT((STRU_DEVICEPARA_OFFSET + DTC_SUM * sizeof(Stru_DTC)) <= BENCH_EEPROM_ADDR, bench_eeprom_page);
+
+static const Bench_ItemTypeDef Bench_Item[] =
+{
+	{"queue_in_1",			Bench_QueueIn1,				1000},
+	{"queue_in_16",			Bench_QueueIn16,			1000},
+	{"queue_out_1",			Bench_QueueOut1,			1000},
+	{"queue_out_16",		Bench_QueueOut16,			1000},
+	{"queue_read_16",		Bench_QueueRead16,			1000},
+	{"queue_in_lock_1",		Bench_QueueInLock1,			1000},
+	{"msg_handoff",			Bench_MsgHandoff,			1000},
+	{"timer_handler",		Bench_TimerHandler,			1000},
+	{"timer_handler_full",	Bench_TimerHandlerFull,		1000},
+	{"time_now",			Bench_TimeNow,				1000},
+	{"rfd_frame",			Bench_RFDFrame,				100},
+	{"oled_string",			Bench_OledString,			100},
+	{"oled_refresh",		Bench_OledRefresh,			20},
+	{"eeprom_page_write",	Bench_EEPROMPageWrite,		8},
+	{"eeprom_seq_read",		Bench_EEPROMSequentialRead,	8},
+	{"dtc_match_last",		Bench_DTCMatchLast,			1000},
+	{"dtc_match_miss",		Bench_DTCMatchMiss,			1000},
+};
+
+static unsigned int Bench_Start;
+static unsigned int Bench_Cycles;		// timed cycles of the current run
+static unsigned int Bench_Overhead;
+static unsigned int Bench_Errors;
+
+static Queue256 Bench_Queue;
+static Queue4 Bench_MsgQueue;
+static unsigned char Bench_RFDMsg = OS_MSG_NULL;	// handle of the last decoded code
+static unsigned char Bench_Data[BENCH_EEPROM_LEN];
+#if CFG_RFD_CAPTURE
+static unsigned short Bench_RFDFrameData[BENCH_RFD_FRAME_LEN];
+#else
+static unsigned char Bench_RFDFrameData[BENCH_RFD_FRAME_LEN];
+#endif
+
+/*----------------------------------------------------------------------------
+@Name		: Bench_Putc(c)
+@Function	: send one byte on USART1, wait until sent
+------------------------------------------------------------------------------*/
+static void Bench_Putc(unsigned char c)
+{
+	USART_SendData(DEBUG_USART_PORT, c);
+	while(USART_GetFlagStatus(DEBUG_USART_PORT, USART_FLAG_TXE) == RESET);
+}
+
+static void Bench_PutStr(const char *pStr)
+{
+	while(*pStr)
+	{
+		Bench_Putc(*pStr++);
+	}
+}
+
+static void Bench_PutUInt(unsigned int Val)
+{
+	unsigned char Buff[10];
+	unsigned char Len = 0;
+
+	Bench_Putc(',');
+	do
+	{
+		Buff[Len++] = '0' + (Val % 10);
+		Val /= 10;
+	}while(Val);
+
+	while(Len)
+	{
+		Bench_Putc(Buff[--Len]);
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Bench_Stop()
+@Function	: add the cycles since BENCH_START to the run, without the overhead
+------------------------------------------------------------------------------*/
+static void Bench_Stop(void)
+{
+	unsigned int Cycles;
+
+	Cycles = Hal_CPU_GetCycle() - Bench_Start;
+	Bench_Cycles += (Cycles > Bench_Overhead) ? (Cycles - Bench_Overhead) : 0;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Bench_Measure(pItem, pMin, pAvg, pMax)
+@Function	: run an item its iterations times, interrupts off in every run
+@Parameter	:
+		pItem: item to run
+		pMin, pAvg, pMax: cycles of the runs
+------------------------------------------------------------------------------*/
+static void Bench_Measure(const Bench_ItemTypeDef *pItem, unsigned int *pMin, unsigned int *pAvg, unsigned int *pMax)
+{
+	unsigned int Sum = 0;
+	unsigned short i;
+
+	*pMin = 0xFFFFFFFF;
+	*pMax = 0;
+	for(i=0; i<pItem->Iterations; i++)
+	{
+		Bench_Cycles = 0;
+
+		__disable_irq();
+		pItem->Run();
+		__enable_irq();
+
+		Sum += Bench_Cycles;
+		if(Bench_Cycles < *pMin)
+		{
+			*pMin = Bench_Cycles;
+		}
+		if(Bench_Cycles > *pMax)
+		{
+			*pMax = Bench_Cycles;
+		}
+	}
+	*pAvg = Sum / pItem->Iterations;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Bench_Calibrate()
+@Function	: cycles of an empty measurement(counter read and call)
+------------------------------------------------------------------------------*/
+static void Bench_Calibrate(void)
+{
+	const Bench_ItemTypeDef Item = {"nop", Bench_Nop, 100};
+	unsigned int Min, Avg, Max;
+
+	Bench_Overhead = 0;
+	Bench_Measure(&Item, &Min, &Avg, &Max);
+	Bench_Overhead = Min;
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Bench_Init()
+@Function	: HAL modules of the benchmarks, fixed test data
+		--> TIM4 interrupt off: the timer handler only runs in its benchmark
+		--> RF frame: ev1527 BENCH_RFD_CODE as captured by TIM1(pulse records)
+			or sampled by the 50us pulse timer(CFG_RFD_CAPTURE = 0)
+		--> all DTC_SUM detectors paired(RAM only, EEPROM unchanged)
+------------------------------------------------------------------------------*/
+static void Bench_Init(void)
+{
+	unsigned char i;
+	unsigned char Len;
+
+	Hal_Clock_Init();
+	Hal_CPU_Init();
+	OS_TaskInit();
+	Hal_Power_Init();
+	Hal_Time_Init();
+	Hal_Timer_Init();
+	TIM_ITConfig(TIM4, TIM_IT_Update, DISABLE);
+	Hal_LED_Init();
+	Hal_Beep_Init();
+	Hal_RFD_Init();
+	Hal_RFD_RxCBF_Register(Bench_RFDRxHandler);
+	Hal_USART_Init();
+	Hal_I2C_EEPROM_Init();
+	hal_OledInit();
+
+	for(i=0; i<BENCH_EEPROM_LEN; i++)
+	{
+		Bench_Data[i] = i * 7 + 1;
+	}
+
+	// sync: high 1 unit, low 31 units; bit '1': high 3 low 1; bit '0': high 1 low 3
+#if CFG_RFD_CAPTURE
+	Bench_RFDFrameData[0] = RFD_PULSE_HIGH | RFD_CLK_SENDLEN;
+	Bench_RFDFrameData[1] = 31 * RFD_CLK_SENDLEN;
+	Len = 2;
+	for(i=0; i<24; i++)
+	{
+		unsigned char Bit = (BENCH_RFD_CODE >> (23 - i)) & 0x01;
+
+		Bench_RFDFrameData[Len++] = RFD_PULSE_HIGH | ((Bit ? 3 : 1) * RFD_CLK_SENDLEN);
+		Bench_RFDFrameData[Len++] = (Bit ? 1 : 3) * RFD_CLK_SENDLEN;
+	}
+#else
+	Bench_RFDFrameData[0] = 0xFF;
+	for(Len=1; Len<32; Len++)
+	{
+		Bench_RFDFrameData[Len] = 0x00;
+	}
+	for(i=0; i<24; i++)
+	{
+		unsigned char Bit = (BENCH_RFD_CODE >> (23 - i)) & 0x01;
+
+		Bench_RFDFrameData[Len++] = 0xFF;
+		Bench_RFDFrameData[Len++] = Bit ? 0xFF : 0x00;
+		Bench_RFDFrameData[Len++] = Bit ? 0xFF : 0x00;
+		Bench_RFDFrameData[Len++] = 0x00;
+	}
+#endif
+
+	for(i=0; i<DTC_SUM; i++)
+	{
+		sDevice[i].ID = i;
+		sDevice[i].Mark = 1;
+		sDevice[i].Code[0] = 0x5A;
+		sDevice[i].Code[1] = 0x3C;
+		sDevice[i].Code[2] = i;
+	}
+}
+
+static void Bench_Nop(void)
+{
+	BENCH_START();
+	BENCH_STOP();
+}
+
+/*-------------------------- OS queue ----------------------------------------*/
+static void Bench_QueueIn1(void)
+{
+	QueueEmpty(Bench_Queue);
+
+	BENCH_START();
+	QueueDataIn(Bench_Queue, Bench_Data, 1);
+	BENCH_STOP();
+}
+
+static void Bench_QueueIn16(void)
+{
+	QueueEmpty(Bench_Queue);
+
+	BENCH_START();
+	QueueDataIn(Bench_Queue, Bench_Data, 16);
+	BENCH_STOP();
+}
+
+static void Bench_QueueOut1(void)
+{
+	unsigned char Dat;
+
+	QueueEmpty(Bench_Queue);
+	QueueDataIn(Bench_Queue, Bench_Data, 16);
+
+	BENCH_START();
+	QueueDataOut(Bench_Queue, &Dat);
+	BENCH_STOP();
+}
+
+// byte by byte as the consumers of the firmware read
+static void Bench_QueueOut16(void)
+{
+	unsigned char Dat;
+	unsigned char i;
+
+	QueueEmpty(Bench_Queue);
+	QueueDataIn(Bench_Queue, Bench_Data, 16);
+
+	BENCH_START();
+	for(i=0; i<16; i++)
+	{
+		QueueDataOut(Bench_Queue, &Dat);
+	}
+	BENCH_STOP();
+}
+
+static void Bench_QueueRead16(void)
+{
+	unsigned char Buff[16];
+
+	QueueEmpty(Bench_Queue);
+	QueueDataIn(Bench_Queue, Bench_Data, 16);
+
+	BENCH_START();
+	QueueDataRead(Bench_Queue, Buff, 16);
+	BENCH_STOP();
+}
+
+// interrupts masked by the OS call-back, as for a queue with several producers
+static void Bench_QueueInLock1(void)
+{
+	QueueEmpty(Bench_Queue);
+
+	BENCH_START();
+	QueueDataInLock(Bench_Queue, Bench_Data, 1);
+	BENCH_STOP();
+}
+
+// one RF message from the pool through a handle queue, as Hal_RFD -> RFDRxHandler -> App
+static void Bench_MsgHandoff(void)
+{
+	unsigned char hMsg;
+	unsigned char *pData;
+
+	BENCH_START();
+	hMsg = OS_MsgAlloc(RFD_MSG_CODE);
+	pData = OS_MsgGet(hMsg)->Data;
+	pData[0] = 0x02;
+	pData[1] = 0xAB;
+	pData[2] = 0x12;
+	QueueDataIn(Bench_MsgQueue, &hMsg, 1);
+	QueueDataOut(Bench_MsgQueue, &hMsg);
+	OS_MsgFree(hMsg);
+	BENCH_STOP();
+}
+
+/*-------------------------- Hal_Timer ---------------------------------------*/
+// TIM4 update: Hal_Timer_TimerHandler with the timers of LED, Beep, RFD
+static void Bench_TimerHandler(void)
+{
+	QueueEmpty(RFD_RxBuffer);
+
+	BENCH_START();
+	TIM4_IRQHandler();
+	BENCH_STOP();
+}
+
+// a timer that is not meant to expire during the benchmarks
+static void Bench_TimerIdle(void)
+{
+}
+
+// the same with every free handle taken by a 1 minute periodic timer: the cost stays that of timer_handler
+static void Bench_TimerHandlerFull(void)
+{
+	while(Hal_Timer_CreatTimer(Bench_TimerIdle, HAL_TIMER_MS_TO_TICKS(60000), T_STATE_START, T_MODE_PERIODIC, T_EXEC_TASK) != HAL_TIMER_NULL);
+	
+	Bench_TimerHandler();
+}
+
+/*-------------------------- Hal_Time ----------------------------------------*/
+// 64bit timestamp read, as taken by every event source
+static void Bench_TimeNow(void)
+{
+	static unsigned long long Last;
+	unsigned long long Now;
+
+	BENCH_START();
+	Now = Hal_Time_Now();
+	BENCH_STOP();
+
+	if(Now < Last)
+	{
+		Bench_Errors++;
+	}
+	Last = Now;
+}
+
+/*-------------------------- Hal_RFD -----------------------------------------*/
+static void Bench_RFDFeed(unsigned char Timed)
+{
+	unsigned char i;
+	unsigned char Len;
+#if CFG_RFD_CAPTURE
+	unsigned char j;
+#endif
+
+	for(i=0; i<BENCH_RFD_FRAME_LEN; i+=Len)
+	{
+		Len = BENCH_RFD_FRAME_LEN - i;
+		if(Len > BENCH_RFD_CHUNK)
+		{
+			Len = BENCH_RFD_CHUNK;
+		}
+#if CFG_RFD_CAPTURE
+		for(j=0; j<Len; j++)
+		{
+			RecQueueIn(RFD_RxBuffer, &Bench_RFDFrameData[i + j]);
+		}
+#else
+		QueueDataIn(RFD_RxBuffer, &Bench_RFDFrameData[i], Len);
+#endif
+
+		if(Timed)
+		{
+			BENCH_START();
+		}
+		Hal_RFD_Pro();
+		if(Timed)
+		{
+			BENCH_STOP();
+		}
+	}
+}
+
+/*----------------------------------------------------------------------------
+@Name		: Bench_RFDFrame()
+@Function	: Hal_RFD_Pro decoding one frame, fed as the capture interrupt(or
+			  the 50us sampling) would
+		--> sampled: a frame ends with the sync high of the next one, every
+			run completes the code of the frame before
+		--> repeat filter stopped: every decoded code reaches Bench_RFDRxHandler
+------------------------------------------------------------------------------*/
+static void Bench_RFDFrame(void)
+{
+	static unsigned char Primed = 0;
+	unsigned char *pCode;
+
+	QueueEmpty(RFD_RxBuffer);
+	if(!Primed)
+	{
+		// first code is only compared, the second one is delivered
+		Bench_RFDFeed(0);
+		Bench_RFDFeed(0);
+		Primed = 1;
+	}
+	OS_MsgFree(Bench_RFDMsg);
+	Bench_RFDMsg = OS_MSG_NULL;
+	Hal_Timer_StateControl(RFD_RecodeFltTimer, T_STATE_STOP);
+
+	Bench_RFDFeed(1);
+
+	if(Bench_RFDMsg == OS_MSG_NULL)
+	{
+		Bench_Errors++;
+		return;
+	}
+	pCode = OS_MsgGet(Bench_RFDMsg)->Data;
+	if((pCode[0] != ((BENCH_RFD_CODE >> 16) & 0xFF)) || (pCode[1] != ((BENCH_RFD_CODE >> 8) & 0xFF))
+		|| (pCode[2] != (BENCH_RFD_CODE & 0xFF)))
+	{
+		Bench_Errors++;
+	}
+}
+
+// RFD call-back: keep the handle for the check of Bench_RFDFrame
+static void Bench_RFDRxHandler(unsigned char hMsg)
+{
+	OS_MsgFree(Bench_RFDMsg);
+	Bench_RFDMsg = hMsg;
+}
+
+/*-------------------------- Hal_OLED ----------------------------------------*/
+static void Bench_OledString(void)
+{
+	BENCH_START();
+	hal_Oled_ShowString(0, 24, "BENCH 0123456789", 16, 1);
+	BENCH_STOP();
+}
+
+static void Bench_OledRefresh(void)
+{
+	BENCH_START();
+	hal_Oled_Refresh();
+	BENCH_STOP();
+}
+
+/*-------------------------- Hal_I2C_EEPROM ----------------------------------*/
+static void Bench_EEPROMPageWrite(void)
+{
+	BENCH_START();
+	Hal_I2C_EEPROM_PageWrite(BENCH_EEPROM_ADDR, Bench_Data, BENCH_EEPROM_LEN);
+	BENCH_STOP();
+}
+
+static void Bench_EEPROMSequentialRead(void)
+{
+	unsigned char Buff[BENCH_EEPROM_LEN];
+	unsigned char i;
+
+	BENCH_START();
+	Hal_I2C_EEPROM_SequentialRead(BENCH_EEPROM_ADDR, Buff, BENCH_EEPROM_LEN);
+	BENCH_STOP();
+
+	for(i=0; i<BENCH_EEPROM_LEN; i++)
+	{
+		if(Buff[i] != Bench_Data[i])
+		{
+			Bench_Errors++;
+			break;
+		}
+	}
+}
+
+/*-------------------------- Device ------------------------------------------*/
+// worst hit: the last of DTC_SUM paired detectors
+static void Bench_DTCMatchLast(void)
+{
+	unsigned char Code[3] = {0x5A, 0x3C, DTC_SUM - 1};
+	unsigned char ID;
+
+	BENCH_START();
+	ID = Device_DTCMatching(Code);
+	BENCH_STOP();
+
+	if(ID != (DTC_SUM - 1))
+	{
+		Bench_Errors++;
+	}
+}
+
+static void Bench_DTCMatchMiss(void)
+{
+	unsigned char Code[3] = {0x5A, 0x3C, 0xEE};
+	unsigned char ID;
+
+	BENCH_START();
+	ID = Device_DTCMatching(Code);
+	BENCH_STOP();
+
+	if(ID != 0xFF)
+	{
+		Bench_Errors++;
+	}
+}
+
+int main(void)
+{
+	unsigned int Min, Avg, Max;
+	unsigned char i;
+
+	Bench_Init();
+	Bench_Calibrate();
+
+	Bench_PutStr("BENCH,START");
+	Bench_PutUInt(SystemCoreClock);
+	Bench_PutUInt(Bench_Overhead);
+	Bench_PutStr("\r\n");
+
+	for(i=0; i<sizeof(Bench_Item)/sizeof(Bench_Item[0]); i++)
+	{
+		Bench_Measure(&Bench_Item[i], &Min, &Avg, &Max);
+
+		Bench_PutStr("BENCH,");
+		Bench_PutStr(Bench_Item[i].Name);
+		Bench_PutUInt(Bench_Item[i].Iterations);
+		Bench_PutUInt(Min);
+		Bench_PutUInt(Avg);
+		Bench_PutUInt(Max);
+		Bench_PutStr("\r\n");
+	}
+
+	Bench_PutStr("BENCH,END");
+	Bench_PutUInt(Bench_Errors);
+	Bench_PutStr("\r\n");
+
+	while(1)
+	{
+		__WFI();
+	}
+}
+
+#endif
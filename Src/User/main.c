@@ -8,7 +8,10 @@
 #include "stm32f10x.h"
 #include "hal_led.h"
 #include "hal_timer.h"
+#include "hal_time.h"
 #include "hal_cpu.h"
+#include "hal_clock.h"
+#include "hal_power.h"
 #include "hal_key.h"
 #include "hal_rfd.h"
 #include "hal_usart.h"
@@ -16,31 +19,45 @@
 #include "app.h"
 #include "hal_nbiot.h"
 
+#ifndef BENCH_BUILD
 int main()
 {
+	Hal_Clock_Init();	// clock modes: before the modules register for clock changes
 	Hal_CPU_Init(); 	
 	OS_TaskInit();		
+	Hal_Power_Init();	// STOP mode: before the modules register for wake-up
+	Hal_Time_Init();	// us timebase: event stamps of all modules
 	Hal_Timer_Init(); 	
+	OS_CreatTask(OS_TASK_TIMER, Hal_Timer_Pro, OS_PERIOD_NONE, 0, 1, OS_MS_TO_TICKS(1), OS_RUN); // deferred timer callbacks, woken by TIM4
 	
+	// Systick=1ms(OS_TICK_HZ)
+	// period/offset: 10ms tasks are released in different ticks to spread the load
+	// priority: RF decoding always runs before UI work(priority 0 = highest)
+	// deadline: system ticks from release to task finished
 	Hal_LED_Init();		
-	OS_CreatTask(OS_TASK1, Hal_LED_Pro, 1, OS_RUN); // Systick=10ms; runperiod=10ms
+	OS_CreatTask(OS_TASK_LED, Hal_LED_Pro, OS_MS_TO_TICKS(10), OS_MS_TO_TICKS(3), 4, OS_MS_TO_TICKS(10), OS_RUN);
 	
 	Hal_Key_Init(); 	
-	OS_CreatTask(OS_TASK2, Hal_Key_Pro, 1, OS_RUN);
+	OS_CreatTask(OS_TASK_KEY, Hal_Key_Pro, OS_MS_TO_TICKS(10), OS_MS_TO_TICKS(1), 1, OS_MS_TO_TICKS(5), OS_RUN);
 	
 	Hal_RFD_Init();		
-	OS_CreatTask(OS_TASK3,Hal_RFD_Pro, 1, OS_RUN);
+#if CFG_RFD_CAPTURE
+	OS_CreatTask(OS_TASK_RFD, Hal_RFD_Pro, OS_PERIOD_NONE, 0, OS_PRIO_HIGHEST, OS_MS_TO_TICKS(CFG_RFD_POLL_MS), OS_RUN);	// woken by the captured edges
+#else
+	OS_CreatTask(OS_TASK_RFD, Hal_RFD_Pro, OS_MS_TO_TICKS(CFG_RFD_POLL_MS), 0, OS_PRIO_HIGHEST, OS_MS_TO_TICKS(CFG_RFD_POLL_MS), OS_RUN);
+#endif
 	
 	Hal_USART_Init();	
-	OS_CreatTask(OS_TASK4,Hal_USART_Pro, 1, OS_RUN);
+	OS_CreatTask(OS_TASK_USART, Hal_USART_Pro, OS_PERIOD_NONE, 0, 3, OS_MS_TO_TICKS(5), OS_RUN);	// woken by queued data and the report tick
 	
 	Hal_NBIOT_Init();
-	OS_CreatTask(OS_TASK5, Hal_NBIOT_Pro, 1, OS_RUN);
+	OS_CreatTask(OS_TASK_NBIOT, Hal_NBIOT_Pro, OS_MS_TO_TICKS(10), OS_MS_TO_TICKS(5), 2, OS_MS_TO_TICKS(10), OS_RUN);
 
 	App_Init(); 		
-	OS_CreatTask(OS_TASK6, App_Pro, 1, OS_RUN);
+	OS_CreatTask(OS_TASK_APP, App_Pro, OS_MS_TO_TICKS(10), OS_MS_TO_TICKS(7), 5, OS_MS_TO_TICKS(10), OS_RUN);
 	
 	/* Start scheduler*/
 	OS_Start();
 	
 }
+#endif
@@ -22,6 +22,7 @@
 
 /* Includes ------------------------------------------------------------------*/
 #include "stm32f10x_it.h"
+#include "os_system.h"
 
 /** @addtogroup STM32F10x_StdPeriph_Template
   * @{
@@ -122,9 +123,11 @@ void DebugMon_Handler(void)
   * @param  None
   * @retval None
   */
+#if !CFG_OS_PREEMPTIVE	// preemptive kernel: PendSV_Handler in Hal_CPU.c
 void PendSV_Handler(void)
 {
 }
+#endif
 
 /**
   * @brief  This function handles SysTick Handler.